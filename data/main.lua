@@ -3,6 +3,8 @@ load_module("constants.lua")
 
 local hTextFont = -1
 local hIconFont = -1
+local hCpuLoadAggregator = nil
+local hCpuTempAggregator = nil
 
 -------------------------------------------------------------------------------
 -- Initialization
@@ -20,6 +22,10 @@ function on_initialize()
 
     hTextFont = load_font("Segoe UI Variable Display Semib", 13)
     hIconFont = load_font("Segoe Fluent Icons", 16)
+
+    -- colors follow the trend, a single spike does not make them flash
+    hCpuLoadAggregator = add_aggregator("processor.load", 5000, 60000)
+    hCpuTempAggregator = add_aggregator("processor_temperature.package", 5000, 60000)
 end
 
 -------------------------------------------------------------------------------
@@ -39,21 +45,24 @@ function on_update(w, h)
     local vramLoad = get_vram_utilization()
     local gpuTemp = get_gpu_temperature()
 
-    local cpuLoadStr = string.format("<color='%s'>%.1f%%</>",
-        eval_color_from_value(cpuLoad, LoadThresholds), cpuLoad)
-    local cpuPkgTempStr = string.format("<color='%s'>%.0f\194\176C</>",
-        eval_color_from_value(cpuPkgTemp, TemperatureThresholds), cpuPkgTemp);
-    local ramLoadStr = string.format("<color='%s'>%d%%</>, <color='%s'>(%d%%)</>",
-        eval_color_from_value(ramLoad.physicalLoad, LoadThresholds), ramLoad.physicalLoad,
-        eval_color_from_value(ramLoad.virtualLoad, LoadThresholds), ramLoad.virtualLoad)
-    local egressStr = string.format("<color='#b2533e'>%s/s</>", bytes_to_str(netStats.egress))
-    local ingressStr = string.format("<color='#186f65'>%s/s</>", bytes_to_str(netStats.ingress))
-    local gpuLoadStr = string.format("<color='%s'>%.1f%%</>",
-        eval_color_from_value(gpuLoad.graphicsEngineLoad, LoadThresholds), gpuLoad.graphicsEngineLoad)
-    local vramLoadStr = string.format("<color='%s'>%d%%</>",
-        eval_color_from_value(vramLoad, LoadThresholds), vramLoad)
-    local gpuTempStr = string.format("<color='%s'>%.0f\194\176C</>",
-        eval_color_from_value(gpuTemp, TemperatureThresholds), gpuTemp);
+    -- the metrics of a disabled provider are nil, they show as "--"
+    local cpuLoadStr = format_metric("%.1f%%", cpuLoad, LoadThresholds, aggregate_or(hCpuLoadAggregator, "average", cpuLoad))
+    local cpuPkgTempStr = format_metric("%.0f\194\176C", cpuPkgTemp, TemperatureThresholds,
+        aggregate_or(hCpuTempAggregator, "average", cpuPkgTemp))
+    local ramLoadStr = "--"
+    if ramLoad then
+        ramLoadStr = format_metric("%d%%", ramLoad.physicalLoad, LoadThresholds) .. ", " ..
+            format_metric("(%d%%)", ramLoad.virtualLoad, LoadThresholds)
+    end
+    local egressStr = "--"
+    local ingressStr = "--"
+    if netStats then
+        egressStr = string.format("<color='#b2533e'>%s/s</>", bytes_to_str(netStats.egress))
+        ingressStr = string.format("<color='#186f65'>%s/s</>", bytes_to_str(netStats.ingress))
+    end
+    local gpuLoadStr = format_metric("%.1f%%", gpuLoad and gpuLoad.graphicsEngineLoad, LoadThresholds)
+    local vramLoadStr = format_metric("%d%%", vramLoad, LoadThresholds)
+    local gpuTempStr = format_metric("%.0f\194\176C", gpuTemp, TemperatureThresholds)
 
     local m = h / 2
     draw_text(hIconFont, 0, 0, 25, m, Icon.CPULoad, TextAlignment.Center, LineAlignment.Center)
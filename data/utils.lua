@@ -10,6 +10,28 @@ function eval_color_from_value(value, thresholds)
     return color
 end
 
+---@param fmt string format of the value, without the color tag
+---@param value number|nil nil when its provider is disabled, see `set_provider_enabled`
+---@param thresholds table color table
+---@param colorValue number|nil what the color is evaluated from, the value itself by default
+function format_metric(fmt, value, thresholds, colorValue)
+    if value == nil then
+        return "--"
+    end
+    return string.format("<color='%s'>" .. fmt .. "</>", eval_color_from_value(colorValue or value, thresholds), value)
+end
+
+---@param handle integer|nil aggregator, see `add_aggregator`
+---@param field string "average", "min", "max", "p50", "p95" or "p99"
+---@param value number returned until the aggregator has seen a sample
+function aggregate_or(handle, field, value)
+    local aggregate = handle and get_aggregate(handle)
+    if aggregate == nil then
+        return value
+    end
+    return aggregate[field]
+end
+
 ---@param numBytes number value to evaluate
 function bytes_to_str(numBytes)
     if numBytes < 1024 then
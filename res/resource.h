@@ -17,6 +17,8 @@
 #define ID_TOGGLE_TASKBAR_INFO          1003
 #define ID_SWITCH_MODE                  1005
 #define ID_START_ON_BOOT                1006
+#define ID_METRICS_ENDPOINT             1007
+#define ID_SNAPSHOT_STREAM              1008
 #define ID_FORCE_CRASH                  2004
 
 // Next default values for new objects
@@ -66,6 +66,7 @@ def initCommonsLibraries(compileConfigs: CompileConfigs):
             "oleaut32",
             "comsuppw",
             "dwmapi",
+            "ws2_32",
             ]
 
 def initCommonsDefines(compileConfigs: CompileConfigs, isShippingBuild: bool, enableAsan: bool):
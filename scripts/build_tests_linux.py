@@ -0,0 +1,129 @@
+import os
+import sys
+import glob
+import argparse
+import subprocess
+
+# Builds floral, the vendored Lua and the standalone programs of src/floral/test with g++, then runs
+# the tests. Each <name>_test.cpp / <name>_bench.cpp is its own program linked with floral and Lua
+# (see testing.h), the app modules it drives are included in its source.
+#   python scripts/build_tests_linux.py [--sanitize] [--bench] [--filter NAME]
+
+k_rootDir = os.path.normpath(os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+k_sourceDir = os.path.join(k_rootDir, "src")
+k_floralDir = os.path.join(k_sourceDir, "floral")
+k_luaDir = os.path.join(k_sourceDir, "lua")
+k_testDir = os.path.join(k_floralDir, "test")
+
+# floral sources the tests do not need and which only build with clang (anonymous aggregates)
+k_excludedFloralSources = [
+        "geometry_generator.cpp",
+        "vector_math.cpp",
+        ]
+
+# the same Lua sources as the app (see build_config.py)
+k_excludedLuaSources = [
+        "lua.c",
+        "luac.c",
+        "loslib.c",
+        "loadlib.c",
+        "liolib.c",
+        "print.c",
+        "linit.c",
+        ]
+
+# programs which test Windows-only modules
+k_windowsOnlyPrograms = [
+        "publication_reader_test",
+        ]
+
+k_compileFlags = [
+        "-std=c++20",
+        "-mavx",
+        "-fno-exceptions",
+        "-fno-rtti",
+        "-Wall",
+        "-Wextra",
+        "-g",
+        "-O2",
+
+        "-Wno-missing-field-initializers",
+        "-Wno-int-to-pointer-cast",
+        "-Wno-unused-parameter",
+        ]
+
+# Lua is C: built as C++ it would throw its errors, and the programs do not have exceptions
+k_luaCompileFlags = [
+        "-std=gnu99",
+        "-g",
+        "-O2",
+        "-w",
+        ]
+
+k_sanitizeFlags = [
+        "-fsanitize=address,undefined",
+        "-fno-omit-frame-pointer",
+        ]
+
+def run(command):
+    print(" ".join(command))
+    return subprocess.run(command).returncode == 0
+
+def buildLibrary(buildDir, compiler, flags, sourceDir, pattern, excludedSources, name):
+    objects = []
+    for source in sorted(glob.glob(os.path.join(sourceDir, pattern))):
+        if os.path.basename(source) in excludedSources:
+            continue
+        obj = os.path.join(buildDir, name, os.path.basename(source) + ".o")
+        if not run([compiler] + flags + [f"-I{k_sourceDir}", "-c", source, "-o", obj]):
+            return None
+        objects.append(obj)
+
+    library = os.path.join(buildDir, f"lib{name}.a")
+    if os.path.exists(library):
+        os.remove(library)
+    if not run(["ar", "rcs", library] + objects):
+        return None
+    return library
+
+def buildProgram(buildDir, flags, libraries, source):
+    program = os.path.join(buildDir, os.path.splitext(os.path.basename(source))[0])
+    if not run(["g++"] + flags + [f"-I{k_sourceDir}", source] + libraries + ["-lpthread", "-lm", "-o", program]):
+        return None
+    return program
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description = "Builds and runs the floral tests on Linux")
+    parser.add_argument("--build-dir", action = "store", default = os.path.join(k_rootDir, "build/linux/tests"))
+    parser.add_argument("--sanitize", help = "build with ASan and UBSan", action = "store_true")
+    parser.add_argument("--bench", help = "run the benchmarks as well", action = "store_true")
+    parser.add_argument("--filter", help = "only the programs whose name contains FILTER", action = "store", default = "")
+    args = parser.parse_args()
+
+    sanitizeFlags = k_sanitizeFlags if args.sanitize else []
+    flags = k_compileFlags + sanitizeFlags
+    os.makedirs(os.path.join(args.build_dir, "floral"), exist_ok = True)
+    os.makedirs(os.path.join(args.build_dir, "lua"), exist_ok = True)
+    floral = buildLibrary(args.build_dir, "g++", flags, k_floralDir, "*.cpp", k_excludedFloralSources, "floral")
+    lua = buildLibrary(args.build_dir, "gcc", k_luaCompileFlags + sanitizeFlags, k_luaDir, "*.c", k_excludedLuaSources, "lua")
+    if floral is None or lua is None:
+        sys.exit(1)
+
+    failures = []
+    for source in sorted(glob.glob(os.path.join(k_testDir, "*.cpp"))):
+        name = os.path.splitext(os.path.basename(source))[0]
+        if name in k_windowsOnlyPrograms or args.filter not in name:
+            continue
+        program = buildProgram(args.build_dir, flags, [floral, lua], source)
+        if program is None:
+            failures.append(f"{name} (build)")
+            continue
+        # a test returns the number of checks which failed, a benchmark 0
+        if name.endswith("_test") or args.bench:
+            if not run([program]):
+                failures.append(name)
+
+    if failures:
+        print("FAILED: " + ", ".join(failures))
+        sys.exit(1)
+    print("all passed")
@@ -0,0 +1,218 @@
+#include "aggregator.h"
+
+#include <floral/assert.h>
+#include <floral/log.h>
+#include <floral/misc.h>
+
+#include "scripting.h"
+
+static AGGContext s_aggregatorContext;
+
+// ----------------------------------------------------------------------------
+
+static AGGAggregator* GetAggregator(const s32 i_aggregator)
+{
+    if (i_aggregator < 0 || i_aggregator >= (s32)k_maxAggregators || !s_aggregatorContext.aggregators[i_aggregator].used)
+    {
+        return nullptr;
+    }
+    return &s_aggregatorContext.aggregators[i_aggregator];
+}
+
+// ----------------------------------------------------------------------------
+
+// the handles seen by the scripts are 1-based, 0 is never valid
+static s32 CheckAggregatorHandle(lua_State* i_vm, const s32 i_index)
+{
+    return (s32)luaL_checkinteger(i_vm, i_index) - 1;
+}
+
+// add_aggregator(name, halfLifeMs, windowMs), a handle or nil when there is no such series or too
+// many aggregators
+static s32 ScriptingAddAggregator(lua_State* i_vm)
+{
+    LOG_SCOPE(lua2cpp);
+    const HSTSeries* series = HSTFindSeries(luaL_checkstring(i_vm, 1));
+    const lua_Number halfLifeMs = luaL_checknumber(i_vm, 2);
+    const lua_Number windowMs = luaL_checknumber(i_vm, 3);
+    if (series == nullptr || halfLifeMs <= 0 || windowMs < 1)
+    {
+        LOG_ERROR("add_aggregator expects a history series, a positive half-life and window");
+        lua_pushnil(i_vm);
+        return 1;
+    }
+
+    const s32 aggregator = AGGCreate((u32)(series - HSTGetSeries(0)), halfLifeMs, (u64)windowMs);
+    if (aggregator < 0)
+    {
+        LOG_ERROR("Too many aggregators (max: %d)", k_maxAggregators);
+        lua_pushnil(i_vm);
+        return 1;
+    }
+
+    lua_pushinteger(i_vm, aggregator + 1);
+    return 1;
+}
+
+static s32 ScriptingRemoveAggregator(lua_State* i_vm)
+{
+    const s32 aggregator = CheckAggregatorHandle(i_vm, 1);
+    const bool found = GetAggregator(aggregator) != nullptr;
+    AGGDestroy(aggregator);
+    lua_pushboolean(i_vm, found ? 1 : 0);
+    return 1;
+}
+
+// get_aggregate(handle), { average, min, max, p50, p95, p99, samplesCount } or nil before the first
+// sample
+static s32 ScriptingGetAggregate(lua_State* i_vm)
+{
+    AGGResult result;
+    if (!AGGGetResult(CheckAggregatorHandle(i_vm, 1), &result))
+    {
+        lua_pushnil(i_vm);
+        return 1;
+    }
+
+    lua_createtable(i_vm, 0, 7);
+    lua_pushnumber(i_vm, result.average);
+    lua_setfield(i_vm, -2, "average");
+    lua_pushnumber(i_vm, result.minValue);
+    lua_setfield(i_vm, -2, "min");
+    lua_pushnumber(i_vm, result.maxValue);
+    lua_setfield(i_vm, -2, "max");
+    lua_pushnumber(i_vm, result.p50);
+    lua_setfield(i_vm, -2, "p50");
+    lua_pushnumber(i_vm, result.p95);
+    lua_setfield(i_vm, -2, "p95");
+    lua_pushnumber(i_vm, result.p99);
+    lua_setfield(i_vm, -2, "p99");
+    lua_pushinteger(i_vm, (lua_Integer)result.samplesCount);
+    lua_setfield(i_vm, -2, "samplesCount");
+    return 1;
+}
+
+// get_quantile(handle, q), q in [0, 1]
+static s32 ScriptingGetQuantile(lua_State* i_vm)
+{
+    f64 value = 0.0;
+    if (!AGGGetQuantile(CheckAggregatorHandle(i_vm, 1), luaL_checknumber(i_vm, 2), &value))
+    {
+        lua_pushnil(i_vm);
+        return 1;
+    }
+
+    lua_pushnumber(i_vm, value);
+    return 1;
+}
+
+// ----------------------------------------------------------------------------
+
+void AGGInitialize(linear_allocator_t* const i_allocator)
+{
+    LOG_SCOPE(aggregator);
+
+    s_aggregatorContext.arena = create_arena(i_allocator, SIZE_KB(4) + k_maxAggregators * AGGStatsGetMemorySize());
+    for (u32 i = 0; i < k_maxAggregators; i++)
+    {
+        s_aggregatorContext.aggregators[i].used = false;
+        AGGStatsAllocate(&s_aggregatorContext.aggregators[i], &s_aggregatorContext.arena);
+    }
+    s_aggregatorContext.lock = create_mutex();
+
+    s_aggregatorContext.ready = true;
+    LOG_DEBUG("%d aggregators, quantiles within %.0f%%", k_maxAggregators, k_sketchRelativeAccuracy * 100.0);
+}
+
+void AGGCleanUp()
+{
+    FLORAL_ASSERT(s_aggregatorContext.ready);
+    mutex_destroy(&s_aggregatorContext.lock);
+    s_aggregatorContext.ready = false;
+}
+
+void AGGBindScriptingAPIs()
+{
+    SCRRegisterFunc(&ScriptingAddAggregator, "add_aggregator", nullptr);
+    SCRRegisterFunc(&ScriptingRemoveAggregator, "remove_aggregator", nullptr);
+    SCRRegisterFunc(&ScriptingGetAggregate, "get_aggregate", nullptr);
+    SCRRegisterFunc(&ScriptingGetQuantile, "get_quantile", nullptr);
+}
+
+void AGGResetScriptAggregators()
+{
+    lock_guard_t guard(&s_aggregatorContext.lock);
+    for (u32 i = 0; i < k_maxAggregators; i++)
+    {
+        s_aggregatorContext.aggregators[i].used = false;
+    }
+}
+
+void AGGAppend(const u32 i_providerIndex)
+{
+    u32 firstSeries = 0;
+    u32 seriesCount = 0;
+    HSTGetProviderSeries(i_providerIndex, &firstSeries, &seriesCount);
+
+    lock_guard_t guard(&s_aggregatorContext.lock);
+    for (u32 i = 0; i < k_maxAggregators; i++)
+    {
+        AGGAggregator* aggregator = &s_aggregatorContext.aggregators[i];
+        if (!aggregator->used || aggregator->series < firstSeries || aggregator->series >= firstSeries + seriesCount)
+        {
+            continue;
+        }
+
+        const HSTSeries* series = HSTGetSeries(aggregator->series);
+        const HSTWindow window = HSTGetWindowLast(series, 1);
+        u64 timestampMs = 0;
+        f64 value = 0.0;
+        if (window.length > 0 && HSTReadSample(series, window, 0, &timestampMs, &value))
+        {
+            AGGStatsAdd(aggregator, timestampMs, value);
+        }
+    }
+}
+
+s32 AGGCreate(const u32 i_series, const f64 i_halfLifeMs, const u64 i_windowMs)
+{
+    FLORAL_ASSERT(i_halfLifeMs > 0.0 && i_windowMs > 0);
+    lock_guard_t guard(&s_aggregatorContext.lock);
+    for (u32 i = 0; i < k_maxAggregators; i++)
+    {
+        AGGAggregator* aggregator = &s_aggregatorContext.aggregators[i];
+        if (aggregator->used)
+        {
+            continue;
+        }
+
+        AGGStatsReset(aggregator, i_series, i_halfLifeMs, i_windowMs);
+        aggregator->used = true;
+        return (s32)i;
+    }
+    return -1;
+}
+
+void AGGDestroy(const s32 i_aggregator)
+{
+    lock_guard_t guard(&s_aggregatorContext.lock);
+    AGGAggregator* aggregator = GetAggregator(i_aggregator);
+    if (aggregator != nullptr)
+    {
+        aggregator->used = false;
+    }
+}
+
+bool AGGGetResult(const s32 i_aggregator, AGGResult* o_result)
+{
+    lock_guard_t guard(&s_aggregatorContext.lock);
+    const AGGAggregator* aggregator = GetAggregator(i_aggregator);
+    return aggregator != nullptr && AGGStatsGetResult(*aggregator, o_result);
+}
+
+bool AGGGetQuantile(const s32 i_aggregator, const f64 i_quantile, f64* o_value)
+{
+    lock_guard_t guard(&s_aggregatorContext.lock);
+    const AGGAggregator* aggregator = GetAggregator(i_aggregator);
+    return aggregator != nullptr && AGGStatsGetQuantile(*aggregator, i_quantile, o_value);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+#include <floral/memory.h>
+#include <floral/thread.h>
+
+#include "history.h"
+
+// Streaming statistics over a history series, created by the scripts so that colors and alerts can
+// follow a trend rather than single noisy samples: an exponentially weighted moving average, the
+// min / max over a sliding time window and quantiles (a DDSketch with a fixed number of bins).
+// They are fed by the sampling thread as the samples are appended, in O(1) per sample (amortized
+// for the min / max, which may lag the window by 1 / 511th of it), and all of their memory is
+// reserved upfront.
+
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_maxAggregators = 64;
+constexpr u32 k_aggregatorDequeCapacity = 512; // candidates the min / max can remember, a window is cut in as many buckets
+constexpr u32 k_sketchBinsCount = 512;         // per sign, about 8 orders of magnitude, the lowest bins are merged past that
+constexpr f64 k_sketchRelativeAccuracy = 0.02;
+
+// the candidates for the window's min (or max), in time order, each one better than all those
+// before it and at most one per bucket of the window
+struct AGGDeque
+{
+    u64* timestamps;
+    f64* values;
+    u32 head;
+    u32 count;
+};
+
+// the bin i counts the values in (gamma^(i-1), gamma^i], 'minIndex' is the index of bins[0]
+struct AGGSketchStore
+{
+    u32* bins;
+    s32 minIndex;
+    s32 maxUsedIndex;
+    u32 count;
+};
+
+struct AGGSketch
+{
+    AGGSketchStore positives;
+    AGGSketchStore negatives; // by magnitude
+    u32 zerosCount;
+};
+
+struct AGGAggregator
+{
+    bool used;
+    u32 series;
+    f64 halfLifeMs;
+    u64 windowMs;
+
+    u32 samplesCount;
+    u64 lastMs;
+    f64 average;
+    AGGDeque minDeque;
+    AGGDeque maxDeque;
+    // the quantiles are over the current epoch and the previous one, between 1 and 2 windows
+    AGGSketch sketches[2];
+    u32 epoch;
+    u64 epochStartMs;
+};
+
+// the state of an aggregator at some point, as returned to the scripts
+struct AGGResult
+{
+    u32 samplesCount;
+    f64 average;
+    f64 minValue;
+    f64 maxValue;
+    f64 p50;
+    f64 p95;
+    f64 p99;
+};
+
+struct AGGContext
+{
+    AGGAggregator aggregators[k_maxAggregators];
+    mutex_t lock; // between the sampling thread feeding them and the scripts
+
+    arena_t arena;
+    bool ready;
+};
+
+// ----------------------------------------------------------------------------
+
+// must come after HSTInitialize()
+void AGGInitialize(linear_allocator_t* const i_allocator);
+void AGGCleanUp();
+void AGGBindScriptingAPIs();
+// the aggregators belong to the scripts, they go away with the VM
+void AGGResetScriptAggregators();
+
+// sampling thread only, right after HSTAppend()
+void AGGAppend(const u32 i_providerIndex);
+
+// returns an index in the aggregators, -1 when they are all used
+s32 AGGCreate(const u32 i_series, const f64 i_halfLifeMs, const u64 i_windowMs);
+void AGGDestroy(const s32 i_aggregator);
+// false until the aggregator has seen a sample
+bool AGGGetResult(const s32 i_aggregator, AGGResult* o_result);
+bool AGGGetQuantile(const s32 i_aggregator, const f64 i_quantile, f64* o_value);
+
+// the statistics of a single aggregator, without the lock (aggregator_stats.cpp)
+size AGGStatsGetMemorySize();
+void AGGStatsAllocate(AGGAggregator* const o_aggregator, arena_t* const i_arena);
+void AGGStatsReset(AGGAggregator* const o_aggregator, const u32 i_series, const f64 i_halfLifeMs, const u64 i_windowMs);
+void AGGStatsAdd(AGGAggregator* const io_aggregator, const u64 i_timestampMs, const f64 i_value);
+bool AGGStatsGetResult(const AGGAggregator& i_aggregator, AGGResult* o_result);
+bool AGGStatsGetQuantile(const AGGAggregator& i_aggregator, const f64 i_quantile, f64* o_value);
@@ -0,0 +1,337 @@
+#include "aggregator.h"
+
+#include <floral/assert.h>
+#include <floral/misc.h>
+
+#include <math.h>
+
+// The statistics of an aggregator alone, without the lock nor the scripts, see aggregator.cpp
+
+// ----------------------------------------------------------------------------
+
+// values closer to 0 than that all go to the zeros, they would need way too many bins
+constexpr f64 k_sketchMinMagnitude = 1e-9;
+
+static const f64 k_sketchGamma = (1.0 + k_sketchRelativeAccuracy) / (1.0 - k_sketchRelativeAccuracy);
+static const f64 k_sketchInvLogGamma = 1.0 / log(k_sketchGamma);
+
+// ----------------------------------------------------------------------------
+
+static void DequeReset(AGGDeque* const o_deque)
+{
+    o_deque->head = 0;
+    o_deque->count = 0;
+}
+
+static u32 DequeSlot(const AGGDeque& i_deque, const u32 i_position)
+{
+    return (i_deque.head + i_position) % k_aggregatorDequeCapacity;
+}
+
+// the candidates are kept per bucket of the window, there are never more buckets in a window than
+// the deque holds: a candidate may outlive the window by a bucket, never an older one be forgotten
+static u64 GetDequeBucketMs(const u64 i_windowMs)
+{
+    return (i_windowMs + k_aggregatorDequeCapacity - 2) / (k_aggregatorDequeCapacity - 1);
+}
+
+static void DequePush(AGGDeque* const io_deque, const u64 i_timestampMs, const f64 i_value, const bool i_keepsMin, const u64 i_windowMs)
+{
+    // the candidates the new value beats can never be the min (max) again, it outlives them
+    while (io_deque->count > 0)
+    {
+        const f64 back = io_deque->values[DequeSlot(*io_deque, io_deque->count - 1)];
+        if (i_keepsMin ? back < i_value : back > i_value)
+        {
+            break;
+        }
+        io_deque->count--;
+    }
+
+    const u64 bucketMs = GetDequeBucketMs(i_windowMs);
+    const u32 backSlot = io_deque->count > 0 ? DequeSlot(*io_deque, io_deque->count - 1) : 0;
+    if (io_deque->count > 0 && io_deque->timestamps[backSlot] / bucketMs == i_timestampMs / bucketMs)
+    {
+        // same bucket as a better candidate, which stands for both
+        io_deque->timestamps[backSlot] = i_timestampMs;
+    }
+    else
+    {
+        FLORAL_ASSERT(io_deque->count < k_aggregatorDequeCapacity);
+        const u32 slot = DequeSlot(*io_deque, io_deque->count);
+        io_deque->timestamps[slot] = i_timestampMs;
+        io_deque->values[slot] = i_value;
+        io_deque->count++;
+    }
+
+    // out of the window, the newest one always stays
+    while (io_deque->timestamps[io_deque->head] + i_windowMs <= i_timestampMs)
+    {
+        io_deque->head = DequeSlot(*io_deque, 1);
+        io_deque->count--;
+    }
+}
+
+static void SketchStoreReset(AGGSketchStore* const o_store)
+{
+    mem_fill(o_store->bins, 0, k_sketchBinsCount * sizeof(u32));
+    o_store->minIndex = 0;
+    o_store->maxUsedIndex = 0;
+    o_store->count = 0;
+}
+
+// moves the bins so that the first one is i_minIndex, those falling off the bottom are merged into
+// the new lowest one, the caller makes sure nothing falls off the top
+static void SketchStoreMove(AGGSketchStore* const io_store, const s32 i_minIndex)
+{
+    if (i_minIndex > io_store->minIndex)
+    {
+        const u32 shift = (u32)(i_minIndex - io_store->minIndex);
+        u32 collapsed = 0;
+        for (u32 i = 0; i <= math_min(shift, k_sketchBinsCount - 1); i++)
+        {
+            collapsed += io_store->bins[i];
+        }
+        for (u32 i = 1; i < k_sketchBinsCount; i++)
+        {
+            io_store->bins[i] = i + shift < k_sketchBinsCount ? io_store->bins[i + shift] : 0;
+        }
+        io_store->bins[0] = collapsed;
+    }
+    else
+    {
+        const u32 shift = (u32)(io_store->minIndex - i_minIndex);
+        for (u32 i = k_sketchBinsCount; i-- > 0;)
+        {
+            io_store->bins[i] = i >= shift ? io_store->bins[i - shift] : 0;
+        }
+    }
+    io_store->minIndex = i_minIndex;
+}
+
+static void SketchStoreAdd(AGGSketchStore* const io_store, const s32 i_index)
+{
+    s32 index = i_index;
+    if (io_store->count == 0)
+    {
+        io_store->minIndex = index;
+        io_store->maxUsedIndex = index;
+    }
+    else if (index < io_store->minIndex)
+    {
+        // as low as the values seen so far allow, what still does not fit goes to the lowest bin
+        const s32 minIndex = math_max(index, io_store->maxUsedIndex - (s32)k_sketchBinsCount + 1);
+        SketchStoreMove(io_store, minIndex);
+        index = math_max(index, minIndex);
+    }
+    else if (index >= io_store->minIndex + (s32)k_sketchBinsCount)
+    {
+        SketchStoreMove(io_store, index - (s32)k_sketchBinsCount + 1);
+    }
+
+    io_store->bins[index - io_store->minIndex]++;
+    io_store->maxUsedIndex = math_max(io_store->maxUsedIndex, index);
+    io_store->count++;
+}
+
+static u32 SketchStoreGetBin(const AGGSketchStore& i_store, const s32 i_index)
+{
+    if (i_store.count == 0 || i_index < i_store.minIndex || i_index >= i_store.minIndex + (s32)k_sketchBinsCount)
+    {
+        return 0;
+    }
+    return i_store.bins[i_index - i_store.minIndex];
+}
+
+static void SketchReset(AGGSketch* const o_sketch)
+{
+    SketchStoreReset(&o_sketch->positives);
+    SketchStoreReset(&o_sketch->negatives);
+    o_sketch->zerosCount = 0;
+}
+
+static void SketchAdd(AGGSketch* const io_sketch, const f64 i_value)
+{
+    const f64 magnitude = fabs(i_value);
+    if (magnitude < k_sketchMinMagnitude)
+    {
+        io_sketch->zerosCount++;
+        return;
+    }
+
+    const s32 index = (s32)ceil(log(magnitude) * k_sketchInvLogGamma);
+    SketchStoreAdd(i_value > 0.0 ? &io_sketch->positives : &io_sketch->negatives, index);
+}
+
+// the value of the bin, within k_sketchRelativeAccuracy of all those it counts
+static f64 SketchBinValue(const s32 i_index)
+{
+    return 2.0 * pow(k_sketchGamma, (f64)i_index) / (k_sketchGamma + 1.0);
+}
+
+static void GetStoresRange(const AGGSketchStore& i_a, const AGGSketchStore& i_b, s32* o_first, s32* o_last)
+{
+    *o_first = 0;
+    *o_last = -1;
+    bool found = false;
+    const AGGSketchStore* stores[] = { &i_a, &i_b };
+    for (const AGGSketchStore* store : stores)
+    {
+        if (store->count == 0)
+        {
+            continue;
+        }
+        const s32 last = store->minIndex + (s32)k_sketchBinsCount - 1;
+        *o_first = found ? math_min(*o_first, store->minIndex) : store->minIndex;
+        *o_last = found ? math_max(*o_last, last) : last;
+        found = true;
+    }
+}
+
+// over both epochs, walking the bins from the lowest value to the highest one
+static bool SketchesGetQuantile(const AGGSketch* i_sketches, const f64 i_quantile, f64* o_value)
+{
+    const AGGSketch& a = i_sketches[0];
+    const AGGSketch& b = i_sketches[1];
+    const u32 negativesCount = a.negatives.count + b.negatives.count;
+    const u32 zerosCount = a.zerosCount + b.zerosCount;
+    const u32 totalCount = negativesCount + zerosCount + a.positives.count + b.positives.count;
+    if (totalCount == 0)
+    {
+        return false;
+    }
+
+    const f64 rank = math_clamp(i_quantile, 0.0, 1.0) * (f64)(totalCount - 1);
+    u64 seenCount = 0;
+    s32 first = 0;
+    s32 last = -1;
+
+    GetStoresRange(a.negatives, b.negatives, &first, &last);
+    for (s32 i = last; i >= first; i--)
+    {
+        seenCount += SketchStoreGetBin(a.negatives, i) + SketchStoreGetBin(b.negatives, i);
+        if ((f64)seenCount > rank)
+        {
+            *o_value = -SketchBinValue(i);
+            return true;
+        }
+    }
+
+    seenCount += zerosCount;
+    if ((f64)seenCount > rank)
+    {
+        *o_value = 0.0;
+        return true;
+    }
+
+    GetStoresRange(a.positives, b.positives, &first, &last);
+    for (s32 i = first; i <= last; i++)
+    {
+        seenCount += SketchStoreGetBin(a.positives, i) + SketchStoreGetBin(b.positives, i);
+        if ((f64)seenCount > rank)
+        {
+            *o_value = SketchBinValue(i);
+            return true;
+        }
+    }
+
+    // only the rounding of the rank can get here
+    *o_value = last >= first ? SketchBinValue(last) : 0.0;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+size AGGStatsGetMemorySize()
+{
+    const size dequeSize = k_aggregatorDequeCapacity * (sizeof(u64) + sizeof(f64));
+    const size sketchSize = 2 * k_sketchBinsCount * sizeof(u32);
+    return 2 * dequeSize + 2 * sketchSize;
+}
+
+void AGGStatsAllocate(AGGAggregator* const o_aggregator, arena_t* const i_arena)
+{
+    AGGDeque* deques[] = { &o_aggregator->minDeque, &o_aggregator->maxDeque };
+    for (AGGDeque* deque : deques)
+    {
+        deque->timestamps = arena_push_podarr(i_arena, u64, k_aggregatorDequeCapacity);
+        deque->values = arena_push_podarr(i_arena, f64, k_aggregatorDequeCapacity);
+    }
+    for (AGGSketch& sketch : o_aggregator->sketches)
+    {
+        sketch.positives.bins = arena_push_podarr(i_arena, u32, k_sketchBinsCount);
+        sketch.negatives.bins = arena_push_podarr(i_arena, u32, k_sketchBinsCount);
+    }
+}
+
+void AGGStatsReset(AGGAggregator* const o_aggregator, const u32 i_series, const f64 i_halfLifeMs, const u64 i_windowMs)
+{
+    o_aggregator->series = i_series;
+    o_aggregator->halfLifeMs = i_halfLifeMs;
+    o_aggregator->windowMs = i_windowMs;
+    o_aggregator->samplesCount = 0;
+    o_aggregator->lastMs = 0;
+    o_aggregator->average = 0.0;
+    DequeReset(&o_aggregator->minDeque);
+    DequeReset(&o_aggregator->maxDeque);
+    SketchReset(&o_aggregator->sketches[0]);
+    SketchReset(&o_aggregator->sketches[1]);
+    o_aggregator->epoch = 0;
+    o_aggregator->epochStartMs = 0;
+}
+
+void AGGStatsAdd(AGGAggregator* const io_aggregator, const u64 i_timestampMs, const f64 i_value)
+{
+    if (io_aggregator->samplesCount == 0)
+    {
+        io_aggregator->average = i_value;
+        io_aggregator->epochStartMs = i_timestampMs;
+    }
+    else if (i_timestampMs > io_aggregator->lastMs)
+    {
+        // the weight of the past halves every half-life, whatever the sampling interval is
+        const f64 elapsedMs = (f64)(i_timestampMs - io_aggregator->lastMs);
+        const f64 alpha = 1.0 - exp2(-elapsedMs / io_aggregator->halfLifeMs);
+        io_aggregator->average += alpha * (i_value - io_aggregator->average);
+    }
+    io_aggregator->lastMs = i_timestampMs;
+    io_aggregator->samplesCount++;
+
+    DequePush(&io_aggregator->minDeque, i_timestampMs, i_value, true, io_aggregator->windowMs);
+    DequePush(&io_aggregator->maxDeque, i_timestampMs, i_value, false, io_aggregator->windowMs);
+
+    if (i_timestampMs >= io_aggregator->epochStartMs + io_aggregator->windowMs)
+    {
+        if (i_timestampMs >= io_aggregator->epochStartMs + 2 * io_aggregator->windowMs)
+        {
+            // nothing recent enough in the current epoch either
+            SketchReset(&io_aggregator->sketches[io_aggregator->epoch & 1]);
+        }
+        io_aggregator->epoch++;
+        io_aggregator->epochStartMs = i_timestampMs;
+        SketchReset(&io_aggregator->sketches[io_aggregator->epoch & 1]);
+    }
+    SketchAdd(&io_aggregator->sketches[io_aggregator->epoch & 1], i_value);
+}
+
+bool AGGStatsGetResult(const AGGAggregator& i_aggregator, AGGResult* o_result)
+{
+    if (i_aggregator.samplesCount == 0)
+    {
+        return false;
+    }
+
+    o_result->samplesCount = i_aggregator.samplesCount;
+    o_result->average = i_aggregator.average;
+    o_result->minValue = i_aggregator.minDeque.values[i_aggregator.minDeque.head];
+    o_result->maxValue = i_aggregator.maxDeque.values[i_aggregator.maxDeque.head];
+    SketchesGetQuantile(i_aggregator.sketches, 0.5, &o_result->p50);
+    SketchesGetQuantile(i_aggregator.sketches, 0.95, &o_result->p95);
+    SketchesGetQuantile(i_aggregator.sketches, 0.99, &o_result->p99);
+    return true;
+}
+
+bool AGGStatsGetQuantile(const AGGAggregator& i_aggregator, const f64 i_quantile, f64* o_value)
+{
+    return SketchesGetQuantile(i_aggregator.sketches, i_quantile, o_value);
+}
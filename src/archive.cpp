@@ -0,0 +1,580 @@
+#include "archive.h"
+
+#include <floral/assert.h>
+#include <floral/log.h>
+#include <floral/misc.h>
+#include <floral/string_utils.h>
+#include <floral/time.h>
+
+#include "scripting.h"
+
+static ARCContext s_archiveContext;
+
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_maxReadSamples = 65536;
+
+static u64 GetMonotonicMs()
+{
+    return (u64)time_ticks_to_ms(time_get_ticks());
+}
+
+// days since 1970-01-01 of a proleptic Gregorian date
+static s64 DaysFromCivil(s64 i_year, const u32 i_month, const u32 i_day)
+{
+    i_year -= i_month <= 2;
+    const s64 era = (i_year >= 0 ? i_year : i_year - 399) / 400;
+    const u32 yearOfEra = (u32)(i_year - era * 400);
+    const u32 dayOfYear = (153 * (i_month > 2 ? i_month - 3 : i_month + 9) + 2) / 5 + i_day - 1;
+    const u32 dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + (s64)dayOfEra - 719468;
+}
+
+static u64 ToUnixMs(const u64 i_monotonicMs)
+{
+    return s_archiveContext.anchorUnixMs + i_monotonicMs - s_archiveContext.anchorMonotonicMs;
+}
+
+static tstr GetSegmentFileName(arena_t* const i_arena, const u64 i_startMs)
+{
+    return tstr_printf(i_arena, LITERAL("%llu.mwa"), (unsigned long long)i_startMs);
+}
+
+// under the lock
+static void AddIndexEntry(const ARCIndexEntry& i_entry)
+{
+    s_archiveContext.index[s_archiveContext.indexCount % k_maxArchiveBlocks] = i_entry;
+    s_archiveContext.indexCount++;
+}
+
+static bool IsSegmentIndexed(const u32 i_segmentId)
+{
+    return s_archiveContext.segments[i_segmentId % k_maxArchiveSegments].id == i_segmentId && i_segmentId < s_archiveContext.segmentsCount;
+}
+
+// before a new segment is added, from the oldest one: the segments about to be overwritten in the
+// ring, those whose blocks all fell out of the index and the expired ones are deleted
+static void PruneSegments(const u64 i_nowMs)
+{
+    for (;;)
+    {
+        u64 startMs = 0;
+        {
+            lock_guard_t guard(&s_archiveContext.lock);
+            const u32 id = s_archiveContext.oldestSegmentId;
+            if (id >= s_archiveContext.segmentsCount || (s_archiveContext.segmentOpened && id == s_archiveContext.segment.id))
+            {
+                return;
+            }
+
+            // the oldest entry of a full index is the next one to be overwritten
+            const u32 oldestIndexedId =
+                s_archiveContext.indexCount > k_maxArchiveBlocks ? s_archiveContext.index[s_archiveContext.indexCount % k_maxArchiveBlocks].segmentId : 0;
+            ARCSegment* segment = &s_archiveContext.segments[id % k_maxArchiveSegments];
+            if (s_archiveContext.segmentsCount - id < k_maxArchiveSegments - 1 && id >= oldestIndexedId &&
+                segment->startMs + k_maxArchiveAgeMs >= i_nowMs)
+            {
+                return;
+            }
+
+            // the readers stop looking at it from now on
+            startMs = segment->startMs;
+            segment->id = ~0u;
+            s_archiveContext.oldestSegmentId++;
+        }
+
+        scratch_region_t scratch = scratch_begin(&s_archiveContext.writeArena);
+        if (!file_delete(&s_archiveContext.writeGroup, GetSegmentFileName(scratch.arena, startMs)))
+        {
+            LOG_WARNING("Cannot delete the archive segment %llu, it is left for the next start", (unsigned long long)startMs);
+        }
+        scratch_end(&scratch);
+    }
+}
+
+static bool OpenSegment(const u64 i_startMs)
+{
+    LOG_SCOPE(archive);
+    PruneSegments(i_startMs);
+    scratch_region_t scratch = scratch_begin(&s_archiveContext.writeArena);
+
+    const u32 seriesCount = HSTGetSeriesCount();
+    const u32 headerBlocksCount = ARCGetSegmentHeaderBlocksCount(seriesCount);
+    const_cstr* names = arena_push_podarr(scratch.arena, const_cstr, seriesCount);
+    for (u32 i = 0; i < seriesCount; i++)
+    {
+        names[i] = HSTGetSeries(i)->name;
+    }
+    u8* buffer = arena_push_podarr_aligned(scratch.arena, u8, headerBlocksCount * k_archiveBlockSize, 8);
+    ARCWriteSegmentHeader(buffer, i_startMs, names, seriesCount);
+
+    s_archiveContext.segmentFile = file_wopen(&s_archiveContext.writeGroup, GetSegmentFileName(scratch.arena, i_startMs));
+    if (s_archiveContext.segmentFile.hasErrors)
+    {
+        LOG_ERROR("Cannot create the archive segment, the samples will not be archived");
+        scratch_end(&scratch);
+        return false;
+    }
+    file_write(s_archiveContext.segmentFile, buffer, headerBlocksCount * k_archiveBlockSize);
+    scratch_end(&scratch);
+
+    lock_guard_t guard(&s_archiveContext.lock);
+    s_archiveContext.segment = {
+        .id = s_archiveContext.segmentsCount,
+        .startMs = i_startMs,
+        .headerBlocksCount = headerBlocksCount
+    };
+    s_archiveContext.segments[s_archiveContext.segment.id % k_maxArchiveSegments] = s_archiveContext.segment;
+    s_archiveContext.segmentsCount++;
+    s_archiveContext.segmentBlocksCount = 0;
+    s_archiveContext.segmentOpened = true;
+    LOG_DEBUG("Archiving into segment %llu", (unsigned long long)i_startMs);
+    return true;
+}
+
+static void CloseSegment()
+{
+    if (s_archiveContext.segmentOpened)
+    {
+        file_flush(s_archiveContext.segmentFile);
+        file_close(&s_archiveContext.segmentFile);
+        s_archiveContext.segmentOpened = false;
+    }
+}
+
+static void SealBlock(ARCEncoder* const io_encoder, const u32 i_series)
+{
+    ARCEndBlock(io_encoder);
+    const ARCBlockHeader* header = (const ARCBlockHeader*)io_encoder->block;
+    io_encoder->samplesCount = 0;
+
+    if (s_archiveContext.segmentBlocksCount >= k_maxSegmentBlocks)
+    {
+        CloseSegment();
+        // never reuse the name of the previous segment
+        OpenSegment(math_max(ARCGetUnixTimeMs(), s_archiveContext.segment.startMs + 1));
+    }
+    if (!s_archiveContext.segmentOpened)
+    {
+        return;
+    }
+
+    // written as a whole before being indexed, the readers never see it half done
+    file_write(s_archiveContext.segmentFile, io_encoder->block, k_archiveBlockSize);
+    const ARCIndexEntry entry = {
+        .firstMs = header->firstMs,
+        .durationMs = (u32)(header->lastMs - header->firstMs),
+        .segmentId = s_archiveContext.segment.id,
+        .blockIndex = (u16)s_archiveContext.segmentBlocksCount,
+        .series = (u16)i_series
+    };
+    s_archiveContext.segmentBlocksCount++;
+
+    lock_guard_t guard(&s_archiveContext.lock);
+    AddIndexEntry(entry);
+}
+
+struct SegmentIndexing
+{
+    const u32* seriesMap; // from the segment's series to the history's, ~0u when gone
+    u32 segmentId;
+};
+
+static void IndexSegmentBlock(voidptr i_data, const u8* i_block, const u32 i_blockIndex)
+{
+    const SegmentIndexing* indexing = (const SegmentIndexing*)i_data;
+    const ARCBlockHeader* blockHeader = (const ARCBlockHeader*)i_block;
+    if (indexing->seriesMap[blockHeader->series] == ~0u || blockHeader->lastMs - blockHeader->firstMs > 0xffffffffull)
+    {
+        return;
+    }
+
+    const ARCIndexEntry entry = {
+        .firstMs = blockHeader->firstMs,
+        .durationMs = (u32)(blockHeader->lastMs - blockHeader->firstMs),
+        .segmentId = indexing->segmentId,
+        .blockIndex = (u16)i_blockIndex,
+        .series = (u16)indexing->seriesMap[blockHeader->series]
+    };
+    AddIndexEntry(entry);
+}
+
+static void IndexSegment(file_handle_t* const i_file, const ARCSegmentFile& i_segment, arena_t* const i_arena)
+{
+    const ARCSegmentHeader& header = i_segment.header;
+
+    // the series may have changed since, they are matched by name
+    u32* seriesMap = arena_push_podarr(i_arena, u32, header.seriesCount);
+    for (u32 i = 0; i < header.seriesCount; i++)
+    {
+        c8 name[k_maxHistoryNameLength];
+        cstr_xcopy(name, k_maxHistoryNameLength, i_segment.names + i * k_maxHistoryNameLength);
+        const HSTSeries* series = HSTFindSeries(name);
+        seriesMap[i] = series ? (u32)(series - HSTGetSeries(0)) : ~0u;
+    }
+
+    const ARCSegment segment = {
+        .id = s_archiveContext.segmentsCount++,
+        .startMs = header.startMs,
+        .headerBlocksCount = header.headerBlocksCount
+    };
+    s_archiveContext.segments[segment.id % k_maxArchiveSegments] = segment;
+
+    SegmentIndexing indexing = { seriesMap, segment.id };
+    const u32 droppedCount = ARCScanSegmentBlocks(i_file, i_segment, i_arena, &IndexSegmentBlock, &indexing);
+    if (droppedCount > 0)
+    {
+        LOG_WARNING("Segment %llu: %d torn or corrupted block(s) dropped", (unsigned long long)header.startMs, droppedCount);
+    }
+}
+
+static void ScanSegments()
+{
+    LOG_SCOPE(archive);
+    scratch_region_t scratch = scratch_begin(&s_archiveContext.readArena);
+
+    // their names tell how old the segments are, only those which are kept get opened
+    ARCSegmentFile* segments = arena_push_podarr(scratch.arena, ARCSegmentFile, s_archiveContext.readGroup.fileCount);
+    u32 segmentsCount = 0;
+    dll_t<file_t>::node_t* it = nullptr;
+    dll_for_each(&s_archiveContext.readGroup.fileList, it)
+    {
+        ARCSegmentFile segment = {};
+        segment.path = it->data.path;
+        if (ARCParseFileNameMs(segment.path, &segment.startMs))
+        {
+            segments[segmentsCount++] = segment;
+        }
+        else
+        {
+            LOG_WARNING("Ignoring an archive file which is not a segment");
+        }
+    }
+
+    for (u32 i = 1; i < segmentsCount; i++)
+    {
+        const ARCSegmentFile segment = segments[i];
+        u32 j = i;
+        for (; j > 0 && segments[j - 1].startMs > segment.startMs; j--)
+        {
+            segments[j] = segments[j - 1];
+        }
+        segments[j] = segment;
+    }
+
+    // from the newest one, until the retention is reached, all those before are deleted
+    const u64 nowMs = ARCGetUnixTimeMs();
+    size keptSize = 0;
+    u32 first = segmentsCount;
+    for (; first > 0; first--)
+    {
+        ARCSegmentFile* segment = &segments[first - 1];
+        if (segmentsCount - first >= k_maxArchiveSegments - 1 || segment->startMs + k_maxArchiveAgeMs < nowMs)
+        {
+            break;
+        }
+
+        file_handle_t file = file_ropen(&s_archiveContext.readGroup, segment->path);
+        if (!file.hasErrors)
+        {
+            segment->fileSize = file_get_size(file);
+            file_close(&file);
+        }
+        if (keptSize + segment->fileSize > k_maxArchiveSize)
+        {
+            break;
+        }
+        keptSize += segment->fileSize;
+    }
+    for (u32 i = 0; i < first; i++)
+    {
+        if (!file_delete(&s_archiveContext.readGroup, segments[i].path))
+        {
+            LOG_WARNING("Cannot delete the archive segment %llu", (unsigned long long)segments[i].startMs);
+        }
+    }
+
+    // oldest first, the index then ends up in chronological order
+    for (u32 i = first; i < segmentsCount; i++)
+    {
+        file_handle_t file = file_ropen(&s_archiveContext.readGroup, segments[i].path);
+        if (file.hasErrors)
+        {
+            continue;
+        }
+
+        // what a segment needs is gone once it is indexed
+        scratch_region_t segmentScratch = scratch_begin(scratch.arena);
+        if (ARCReadSegmentHeader(&file, segmentScratch.arena, &segments[i]))
+        {
+            IndexSegment(&file, segments[i], segmentScratch.arena);
+        }
+        else
+        {
+            LOG_WARNING("Ignoring an invalid archive segment");
+        }
+        scratch_end(&segmentScratch);
+        file_close(&file);
+    }
+
+    scratch_end(&scratch);
+    LOG_DEBUG("%d archive segments, %d expired ones deleted, %d blocks indexed", segmentsCount - first, first,
+              math_min(s_archiveContext.indexCount, k_maxArchiveBlocks));
+}
+
+// ----------------------------------------------------------------------------
+
+// read_archive(name, fromMs, toMs), two arrays of timestamps (Unix ms) and values, oldest first
+static s32 ScriptingReadArchive(lua_State* i_vm)
+{
+    const HSTSeries* series = HSTFindSeries(luaL_checkstring(i_vm, 1));
+    const lua_Number fromMs = luaL_checknumber(i_vm, 2);
+    const lua_Number toMs = luaL_checknumber(i_vm, 3);
+    if (series == nullptr || toMs < fromMs)
+    {
+        lua_pushnil(i_vm);
+        return 1;
+    }
+
+    scratch_region_t scratch = scratch_begin(&s_archiveContext.readArena);
+    u64* timestamps = arena_push_podarr(scratch.arena, u64, k_maxReadSamples);
+    f64* values = arena_push_podarr(scratch.arena, f64, k_maxReadSamples);
+    const u32 seriesIndex = (u32)(series - HSTGetSeries(0));
+    const u32 samplesCount = ARCRead(seriesIndex, fromMs > 0 ? (u64)fromMs : 0, toMs > 0 ? (u64)toMs : 0, timestamps, values,
+                                     k_maxReadSamples, scratch.arena);
+
+    lua_createtable(i_vm, (s32)samplesCount, 0);
+    lua_createtable(i_vm, (s32)samplesCount, 0);
+    for (u32 i = 0; i < samplesCount; i++)
+    {
+        lua_pushnumber(i_vm, (lua_Number)timestamps[i]);
+        lua_rawseti(i_vm, -3, (s32)i + 1);
+        lua_pushnumber(i_vm, values[i]);
+        lua_rawseti(i_vm, -2, (s32)i + 1);
+    }
+    scratch_end(&scratch);
+    return 2;
+}
+
+static s32 ScriptingGetUnixTimeMs(lua_State* i_vm)
+{
+    lua_pushnumber(i_vm, (lua_Number)ARCGetUnixTimeMs());
+    return 1;
+}
+
+// ----------------------------------------------------------------------------
+
+void ARCInitialize(linear_allocator_t* const i_allocator, file_system_t* const i_fileSystem)
+{
+    LOG_SCOPE(archive);
+
+    s_archiveContext.fileSystem = i_fileSystem;
+    const timepoint now = time_get_system_now();
+    s_archiveContext.anchorMonotonicMs = GetMonotonicMs();
+    s_archiveContext.anchorUnixMs = (u64)DaysFromCivil(now.year, now.month, now.day) * 86400000ull +
+                             (u64)now.hour * 3600000ull + (u64)now.minute * 60000ull + (u64)now.second * 1000ull + now.millisecond;
+
+    const u32 seriesCount = HSTGetSeriesCount();
+    s_archiveContext.arena = create_arena(i_allocator, SIZE_KB(4) + k_maxArchiveBlocks * sizeof(ARCIndexEntry) +
+                                                    seriesCount * (k_archiveBlockSize + 8));
+    s_archiveContext.writeArena = create_arena(i_allocator, SIZE_KB(16));
+    s_archiveContext.readArena = create_arena(i_allocator, SIZE_KB(128) + k_maxReadSamples * (sizeof(u64) + sizeof(f64)) +
+                                                        k_maxArchiveBlocks * sizeof(ARCIndexEntry));
+    s_archiveContext.index = arena_push_podarr(&s_archiveContext.arena, ARCIndexEntry, k_maxArchiveBlocks);
+    s_archiveContext.indexCount = 0;
+    s_archiveContext.segmentsCount = 0;
+    s_archiveContext.oldestSegmentId = 0;
+    s_archiveContext.lock = create_mutex();
+    for (u32 i = 0; i < k_maxArchiveSegments; i++)
+    {
+        s_archiveContext.segments[i].id = ~0u;
+    }
+
+    for (u32 i = 0; i < seriesCount; i++)
+    {
+        s_archiveContext.encoders[i] = {};
+        s_archiveContext.encoders[i].block = arena_push_podarr_aligned(&s_archiveContext.arena, u8, k_archiveBlockSize, 8);
+    }
+
+    s_archiveContext.readGroup = file_system_find_all_files(i_fileSystem, tstr_literal(LITERAL("archive")), tstr_literal(LITERAL("mwa")));
+    ScanSegments();
+
+    s_archiveContext.writeGroup = create_file_group(i_fileSystem, tstr_literal(LITERAL("archive")));
+    s_archiveContext.segmentOpened = false;
+    u64 startMs = ARCGetUnixTimeMs();
+    if (s_archiveContext.segmentsCount > 0)
+    {
+        const ARCSegment& last = s_archiveContext.segments[(s_archiveContext.segmentsCount - 1) % k_maxArchiveSegments];
+        startMs = math_max(startMs, last.startMs + 1);
+    }
+    OpenSegment(startMs);
+
+    s_archiveContext.ready = true;
+}
+
+void ARCCleanUp()
+{
+    LOG_SCOPE(archive);
+    FLORAL_ASSERT(s_archiveContext.ready);
+    for (u32 i = 0; i < HSTGetSeriesCount(); i++)
+    {
+        if (s_archiveContext.encoders[i].samplesCount > 0)
+        {
+            SealBlock(&s_archiveContext.encoders[i], i);
+        }
+    }
+    CloseSegment();
+    mutex_destroy(&s_archiveContext.lock);
+    s_archiveContext.ready = false;
+    LOG_DEBUG("Archive closed.");
+}
+
+void ARCBindScriptingAPIs()
+{
+    SCRRegisterFunc(&ScriptingReadArchive, "read_archive", nullptr);
+    SCRRegisterFunc(&ScriptingGetUnixTimeMs, "get_unix_time_ms", nullptr);
+}
+
+void ARCAppend(const u32 i_providerIndex)
+{
+    if (!s_archiveContext.segmentOpened)
+    {
+        return;
+    }
+
+    u32 firstSeries = 0;
+    u32 seriesCount = 0;
+    HSTGetProviderSeries(i_providerIndex, &firstSeries, &seriesCount);
+    for (u32 i = firstSeries; i < firstSeries + seriesCount; i++)
+    {
+        const HSTSeries* series = HSTGetSeries(i);
+        const HSTWindow window = HSTGetWindowLast(series, 1);
+        u64 timestampMs = 0;
+        f64 value = 0.0;
+        if (window.length == 0 || !HSTReadSample(series, window, 0, &timestampMs, &value))
+        {
+            continue;
+        }
+
+        ARCEncoder* encoder = &s_archiveContext.encoders[i];
+        if (encoder->samplesCount > 0 && timestampMs - encoder->openedMs > k_maxArchiveBlockAgeMs)
+        {
+            SealBlock(encoder, i);
+        }
+
+        const u64 unixMs = ToUnixMs(timestampMs);
+        if (encoder->samplesCount > 0 && ARCEncodeSample(encoder, unixMs, value))
+        {
+            continue;
+        }
+
+        if (encoder->samplesCount > 0)
+        {
+            SealBlock(encoder, i);
+        }
+        ARCBeginBlock(encoder, encoder->block, (u16)i, unixMs, value);
+        encoder->openedMs = timestampMs;
+    }
+}
+
+u64 ARCGetUnixTimeMs()
+{
+    return ToUnixMs(GetMonotonicMs());
+}
+
+bool ARCParseFileNameMs(const tstr& i_path, u64* o_startMs)
+{
+    u64 startMs = 0;
+    size i = 0;
+    for (; i < i_path.length && i_path.data[i] >= LITERAL('0') && i_path.data[i] <= LITERAL('9'); i++)
+    {
+        startMs = startMs * 10 + (u64)(i_path.data[i] - LITERAL('0'));
+    }
+    *o_startMs = startMs;
+    return i > 0 && i < 20 && i < i_path.length && i_path.data[i] == LITERAL('.');
+}
+
+u32 ARCRead(const u32 i_series, const u64 i_fromMs, const u64 i_toMs, u64* o_timestamps, f64* o_values, const u32 i_maxSamples,
+            arena_t* const i_scratchArena)
+{
+    LOG_SCOPE(archive);
+    scratch_region_t scratch = scratch_begin(i_scratchArena);
+
+    // the blocks overlapping the range, found under the lock and read after it
+    ARCIndexEntry* entries = arena_push_podarr(scratch.arena, ARCIndexEntry, k_maxArchiveBlocks);
+    u32 entriesCount = 0;
+    ARCSegment* segments = arena_push_podarr(scratch.arena, ARCSegment, k_maxArchiveSegments);
+    {
+        lock_guard_t guard(&s_archiveContext.lock);
+        const u32 oldest = s_archiveContext.indexCount > k_maxArchiveBlocks ? s_archiveContext.indexCount - k_maxArchiveBlocks : 0;
+        for (u32 i = oldest; i < s_archiveContext.indexCount; i++)
+        {
+            const ARCIndexEntry& entry = s_archiveContext.index[i % k_maxArchiveBlocks];
+            if (entry.series == i_series && entry.firstMs <= i_toMs && entry.firstMs + entry.durationMs >= i_fromMs &&
+                IsSegmentIndexed(entry.segmentId))
+            {
+                entries[entriesCount++] = entry;
+            }
+        }
+        mem_copy(segments, s_archiveContext.segments, sizeof(s_archiveContext.segments));
+    }
+
+    u64* blockTimestamps = arena_push_podarr(scratch.arena, u64, k_maxArchiveBlockSamples);
+    f64* blockValues = arena_push_podarr(scratch.arena, f64, k_maxArchiveBlockSamples);
+    u8* block = arena_push_podarr_aligned(scratch.arena, u8, k_archiveBlockSize, 8);
+    file_handle_t file = { nullptr, true };
+    u32 fileSegmentId = ~0u;
+    u32 samplesCount = 0;
+    for (u32 i = 0; i < entriesCount && samplesCount < i_maxSamples; i++)
+    {
+        const ARCIndexEntry& entry = entries[i];
+        const ARCSegment& segment = segments[entry.segmentId % k_maxArchiveSegments];
+        if (entry.segmentId != fileSegmentId)
+        {
+            if (!file.hasErrors)
+            {
+                file_close(&file);
+            }
+
+            const tstr path = GetSegmentFileName(scratch.arena, segment.startMs);
+            if (!file_exist(&s_archiveContext.readGroup, path))
+            {
+                // a segment started since the last look at the folder
+                file_group_reset(&s_archiveContext.readGroup);
+                file_system_find_all_files(s_archiveContext.fileSystem, tstr_literal(LITERAL("archive")), tstr_literal(LITERAL("mwa")),
+                                           &s_archiveContext.readGroup);
+            }
+            file = file_ropen(&s_archiveContext.readGroup, path);
+            fileSegmentId = entry.segmentId;
+        }
+        if (file.hasErrors)
+        {
+            continue;
+        }
+
+        file_seek(file, ((size)segment.headerBlocksCount + entry.blockIndex) * k_archiveBlockSize);
+        file_read(file, k_archiveBlockSize, block);
+        if (!ARCValidateBlock(block))
+        {
+            continue;
+        }
+
+        const u32 blockSamplesCount = ARCDecodeBlock(block, blockTimestamps, blockValues, k_maxArchiveBlockSamples);
+        for (u32 j = 0; j < blockSamplesCount && samplesCount < i_maxSamples; j++)
+        {
+            if (blockTimestamps[j] >= i_fromMs && blockTimestamps[j] <= i_toMs)
+            {
+                o_timestamps[samplesCount] = blockTimestamps[j];
+                o_values[samplesCount] = blockValues[j];
+                samplesCount++;
+            }
+        }
+    }
+
+    if (!file.hasErrors)
+    {
+        file_close(&file);
+    }
+    scratch_end(&scratch);
+    return samplesCount;
+}
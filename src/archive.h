@@ -0,0 +1,172 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+#include <floral/file_system.h>
+#include <floral/memory.h>
+#include <floral/thread.h>
+
+#include "history.h"
+
+// Long term storage of the history series, for looking back at what happened hours or days ago.
+// Each series is compressed on its own (Gorilla: delta of delta timestamps, XORed doubles) into
+// fixed-size blocks, appended to segment files in 'archive/'. A segment starts with the names of
+// its series, each block is checksummed so a block torn by a crash is recognized and dropped on
+// the next start. Timestamps are wall clock ms since the Unix epoch, the archive outlives the
+// monotonic clock of a session. The segments past the retention (too old, or more than the index
+// can hold) are deleted, at start and whenever a new segment is opened.
+
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_archiveBlockSize = 1024;
+constexpr u32 k_archiveVersion = 2;
+constexpr u32 k_maxArchiveBlocks = 32768;   // indexed, the oldest ones are forgotten first
+constexpr u32 k_maxArchiveSegments = 256;
+constexpr u32 k_maxSegmentBlocks = 4096;    // a new segment file is started past that
+constexpr u64 k_maxArchiveBlockAgeMs = 15 * 60 * 1000; // bounds what a crash can lose
+constexpr u64 k_maxArchiveAgeMs = 7ull * 24 * 60 * 60 * 1000;
+constexpr size k_maxArchiveSize = (size)k_maxArchiveBlocks * k_archiveBlockSize; // on disk, about what the index holds
+
+struct ARCBlockHeader
+{
+    u32 magic;
+    u32 checksum; // of the whole block, computed with this field set to 0
+    u16 series;   // in the segment's series names
+    u16 samplesCount;
+    u32 bitsCount;
+    u64 firstMs;
+    u64 lastMs;
+    f64 firstValue;
+};
+
+// the shortest sample is 2 bits, plus the first one in the header
+constexpr u32 k_maxArchiveBlockSamples = (k_archiveBlockSize - sizeof(ARCBlockHeader)) * 8 / 2 + 1;
+
+// followed by 'seriesCount' names of k_maxHistoryNameLength bytes, padded up to 'headerBlocksCount'
+// blocks
+struct ARCSegmentHeader
+{
+    u32 magic;
+    u32 version;
+    u32 blockSize;
+    u32 seriesCount;
+    u64 startMs;
+    u32 headerBlocksCount;
+    u32 checksum; // of the header and the names, computed with this field set to 0
+};
+
+// the block being filled for a series, the samples after the first one are bit-packed, most
+// significant bit first
+struct ARCEncoder
+{
+    u8* block;
+    u32 bitsCount;
+    u64 accumulator; // pending bits, the last (bitsCount % 64) ones, flushed to the block 64 at a time
+
+    u32 samplesCount;
+    u64 openedMs; // monotonic
+    u64 prevMs;
+    s64 prevDelta;
+    u64 prevValue;
+    u32 prevLeading;
+    u32 prevTrailing;
+};
+
+// a segment left by a previous session, as its file and header tell
+struct ARCSegmentFile
+{
+    tstr path;
+    u64 startMs; // from the name
+    ARCSegmentHeader header;
+    const c8* names;
+    size fileSize;
+};
+
+// a block of a segment which passed its checks, i_blockIndex is after the segment's header
+typedef void (*ARCBlockCallback)(voidptr i_data, const u8* i_block, const u32 i_blockIndex);
+
+struct ARCSegment
+{
+    u32 id;
+    u64 startMs; // also names the file
+    u32 headerBlocksCount;
+};
+
+struct ARCIndexEntry
+{
+    u64 firstMs;
+    u32 durationMs; // blocks never span more than k_maxArchiveBlockAgeMs when written by a session
+    u32 segmentId;
+    u16 blockIndex; // after the segment's header
+    u16 series;     // in the history
+};
+
+struct ARCContext
+{
+    file_system_t* fileSystem;
+
+    // the wall clock when the sampler's monotonic clock read 'anchorMonotonicMs'
+    u64 anchorUnixMs;
+    u64 anchorMonotonicMs;
+
+    // owned by the sampling thread
+    ARCEncoder encoders[k_maxHistorySeries];
+    file_group_t writeGroup;
+    arena_t writeArena;
+    file_handle_t segmentFile;
+    ARCSegment segment;
+    u32 segmentBlocksCount;
+    bool segmentOpened;
+
+    // owned by the reader
+    file_group_t readGroup;
+    arena_t readArena;
+
+    // shared, the index only gets entries for blocks which are fully written
+    mutex_t lock;
+    ARCSegment segments[k_maxArchiveSegments]; // by id modulo the capacity
+    u32 segmentsCount;
+    u32 oldestSegmentId; // the oldest segment not deleted yet
+    ARCIndexEntry* index; // ring, by insertion order
+    u32 indexCount;
+
+    arena_t arena;
+    bool ready;
+};
+
+// ----------------------------------------------------------------------------
+
+// must come after HSTInitialize(), indexes the segments left by the previous sessions
+void ARCInitialize(linear_allocator_t* const i_allocator, file_system_t* const i_fileSystem);
+// seals the blocks being filled, the sampler must be stopped
+void ARCCleanUp();
+void ARCBindScriptingAPIs();
+
+// sampling thread only, right after HSTAppend()
+void ARCAppend(const u32 i_providerIndex);
+
+u64 ARCGetUnixTimeMs();
+// "<unix ms>.<extension>", the names of the segments and of the streams, false for the other files
+bool ARCParseFileNameMs(const tstr& i_path, u64* o_startMs);
+// samples of the series between [i_fromMs, i_toMs] (Unix ms), oldest first
+u32 ARCRead(const u32 i_series, const u64 i_fromMs, const u64 i_toMs, u64* o_timestamps, f64* o_values, const u32 i_maxSamples,
+            arena_t* const i_scratchArena);
+
+// block level codec (archive_codec.cpp), the encoder writes into the block it was begun with, 8 bytes aligned
+void ARCBeginBlock(ARCEncoder* const io_encoder, u8* i_block, const u16 i_series, const u64 i_timestampMs, const f64 i_value);
+// false when the block is full, the sample is then not written
+bool ARCEncodeSample(ARCEncoder* const io_encoder, const u64 i_timestampMs, const f64 i_value);
+void ARCEndBlock(ARCEncoder* const io_encoder);
+bool ARCValidateBlock(const u8* i_block);
+u32 ARCDecodeBlock(const u8* i_block, u64* o_timestamps, f64* o_values, const u32 i_maxSamples);
+// of a segment header or a block, its checksum field counted as 0
+u32 ARCComputeChecksum(u8* io_data, const size i_size, u32* io_checksumField);
+
+// the segment files, without the index (archive_segment.cpp)
+u32 ARCGetSegmentHeaderBlocksCount(const u32 i_seriesCount);
+// o_buffer holds ARCGetSegmentHeaderBlocksCount() blocks, 8 bytes aligned
+void ARCWriteSegmentHeader(u8* o_buffer, const u64 i_startMs, const const_cstr* i_names, const u32 i_seriesCount);
+// reads and checks the header of a segment, o_segment's path and start are left as they are
+bool ARCReadSegmentHeader(file_handle_t* const i_file, arena_t* const i_arena, ARCSegmentFile* o_segment);
+// the blocks after the header, returns how many were torn or corrupted and skipped
+u32 ARCScanSegmentBlocks(file_handle_t* const i_file, const ARCSegmentFile& i_segment, arena_t* const i_arena,
+                         ARCBlockCallback i_callback, voidptr i_data);
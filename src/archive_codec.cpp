@@ -0,0 +1,354 @@
+#include "archive.h"
+
+#include <floral/assert.h>
+#include <floral/hashing.h>
+#include <floral/misc.h>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
+// The block codec alone, without the segments nor the index: ARCAppend() feeds it, ARCRead()
+// decodes what the index points at, the tests drive it directly
+
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_blockMagic = 0x4241574d; // 'MWAB'
+constexpr u32 k_blockPayloadBits = (k_archiveBlockSize - sizeof(ARCBlockHeader)) * 8;
+// the longest a sample can get: '1111' + 32 bits of timestamp, '11' + 6 + 6 + 64 bits of value
+constexpr u32 k_maxSampleBits = 36 + 78;
+constexpr u32 k_checksumSeed = 0x6d6f6e69;
+
+static_assert(sizeof(ARCBlockHeader) == 40, "Block header layout changed, bump k_archiveVersion");
+static_assert(k_maxArchiveBlockSamples == k_blockPayloadBits / 2 + 1, "The shortest sample is 2 bits");
+
+static u32 CountLeadingZeros(const u64 i_value)
+{
+    FLORAL_ASSERT(i_value != 0);
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanReverse64(&index, i_value);
+    return 63 - (u32)index;
+#else
+    return (u32)__builtin_clzll(i_value);
+#endif
+}
+
+static u64 ByteSwap64(const u64 i_value)
+{
+#if defined(_MSC_VER)
+    return _byteswap_uint64(i_value);
+#else
+    return __builtin_bswap64(i_value);
+#endif
+}
+
+static u32 CountTrailingZeros(const u64 i_value)
+{
+    FLORAL_ASSERT(i_value != 0);
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward64(&index, i_value);
+    return (u32)index;
+#else
+    return (u32)__builtin_ctzll(i_value);
+#endif
+}
+
+// on the encoding hot path, kept inlinable
+union DoubleBitsPun
+{
+    f64 value;
+    u64 bits;
+};
+
+static u64 DoubleBits(const f64 i_value)
+{
+    DoubleBitsPun pun;
+    pun.value = i_value;
+    return pun.bits;
+}
+
+static f64 BitsDouble(const u64 i_bits)
+{
+    DoubleBitsPun pun;
+    pun.bits = i_bits;
+    return pun.value;
+}
+
+u32 ARCComputeChecksum(u8* io_data, const size i_size, u32* io_checksumField)
+{
+    const u32 stored = *io_checksumField;
+    *io_checksumField = 0;
+    const u32 checksum = compute_murmur_aligned32(io_data, i_size, k_checksumSeed);
+    *io_checksumField = stored;
+    return checksum;
+}
+
+// ----------------------------------------------------------------------------
+
+// i_value must fit in i_bitsCount bits, at most 64. The pending bits are those past the last
+// multiple of 64 written, a word is stored as soon as it is complete
+static inline void WriteBits(ARCEncoder* const io_encoder, const u64 i_value, const u32 i_bitsCount)
+{
+    const u32 pendingBits = io_encoder->bitsCount & 63;
+    const u32 bitsCount = io_encoder->bitsCount + i_bitsCount;
+    if (pendingBits + i_bitsCount < 64)
+    {
+        io_encoder->accumulator = (io_encoder->accumulator << i_bitsCount) | i_value;
+    }
+    else
+    {
+        // completed by the high bits of the value, the low ones are left pending. Shifted in two
+        // steps, the pending bits may be none
+        const u32 spareBits = 64 - pendingBits;
+        const u64 word = ((io_encoder->accumulator << 1) << (spareBits - 1)) | (i_value >> (i_bitsCount - spareBits));
+        u64* dst = (u64*)(io_encoder->block + sizeof(ARCBlockHeader)) + bitsCount / 64 - 1;
+        *dst = ByteSwap64(word);
+        io_encoder->accumulator = i_value;
+    }
+    io_encoder->bitsCount = bitsCount;
+}
+
+struct BitReader
+{
+    const u8* data;
+    u32 position;
+    u32 bitsCount;
+};
+
+static u32 ReadBits(BitReader* const io_reader, const u32 i_bitsCount)
+{
+    u32 value = 0;
+    for (u32 i = 0; i < i_bitsCount; i++)
+    {
+        u32 bit = 0;
+        if (io_reader->position < io_reader->bitsCount)
+        {
+            bit = (io_reader->data[io_reader->position >> 3] >> (7 - (io_reader->position & 7))) & 1;
+        }
+        value = (value << 1) | bit;
+        io_reader->position++;
+    }
+    return value;
+}
+
+static u64 ReadWideBits(BitReader* const io_reader, const u32 i_bitsCount)
+{
+    if (i_bitsCount > 32)
+    {
+        const u64 high = ReadBits(io_reader, i_bitsCount - 32);
+        return (high << 32) | ReadBits(io_reader, 32);
+    }
+    return ReadBits(io_reader, i_bitsCount);
+}
+
+void ARCBeginBlock(ARCEncoder* const io_encoder, u8* i_block, const u16 i_series, const u64 i_timestampMs, const f64 i_value)
+{
+    FLORAL_ASSERT(((aptr)i_block & 7) == 0);
+    mem_fill(i_block, 0, k_archiveBlockSize);
+    ARCBlockHeader* header = (ARCBlockHeader*)i_block;
+    header->magic = k_blockMagic;
+    header->series = i_series;
+    header->firstMs = i_timestampMs;
+    header->firstValue = i_value;
+
+    io_encoder->block = i_block;
+    io_encoder->bitsCount = 0;
+    io_encoder->accumulator = 0;
+    io_encoder->samplesCount = 1;
+    io_encoder->prevMs = i_timestampMs;
+    io_encoder->prevDelta = 0;
+    io_encoder->prevValue = DoubleBits(i_value);
+    // no window yet, the first XOR always writes its own
+    io_encoder->prevLeading = 64;
+    io_encoder->prevTrailing = 64;
+}
+
+bool ARCEncodeSample(ARCEncoder* const io_encoder, const u64 i_timestampMs, const f64 i_value)
+{
+    const s64 delta = (s64)(i_timestampMs - io_encoder->prevMs);
+    const s64 deltaOfDelta = delta - io_encoder->prevDelta;
+    if (io_encoder->bitsCount + k_maxSampleBits > k_blockPayloadBits || io_encoder->samplesCount >= 0xffff ||
+        deltaOfDelta < -0x7fffffffll || deltaOfDelta > 0x7fffffffll)
+    {
+        return false;
+    }
+
+    // regular sampling makes most of the deltas of delta 0, a single bit. The timestamp and the
+    // value are assembled first, a sample is then written in a single call most of the time
+    u64 code = 0;
+    u32 codeBits = 0;
+    if (deltaOfDelta == 0)
+    {
+        codeBits = 1;
+    }
+    else if (deltaOfDelta >= -63 && deltaOfDelta <= 64)
+    {
+        code = (0x2 << 7) | (u64)(deltaOfDelta + 63);
+        codeBits = 9;
+    }
+    else if (deltaOfDelta >= -255 && deltaOfDelta <= 256)
+    {
+        code = (0x6 << 9) | (u64)(deltaOfDelta + 255);
+        codeBits = 12;
+    }
+    else if (deltaOfDelta >= -2047 && deltaOfDelta <= 2048)
+    {
+        code = (0xe << 12) | (u64)(deltaOfDelta + 2047);
+        codeBits = 16;
+    }
+    else
+    {
+        code = (0xfull << 32) | (u32)(s32)deltaOfDelta;
+        codeBits = 36;
+    }
+    io_encoder->prevDelta = delta;
+    io_encoder->prevMs = i_timestampMs;
+
+    // close values share their sign, exponent and high mantissa bits, only the differing window
+    // of the XOR is written
+    const u64 bits = DoubleBits(i_value);
+    const u64 xored = bits ^ io_encoder->prevValue;
+    u32 meaningfulBits = 0;
+    u32 trailing = io_encoder->prevTrailing;
+    if (xored == 0)
+    {
+        code <<= 1;
+        codeBits += 1;
+    }
+    else
+    {
+        const u32 leading = CountLeadingZeros(xored);
+        const u32 xoredTrailing = CountTrailingZeros(xored);
+        if (leading >= io_encoder->prevLeading && xoredTrailing >= trailing)
+        {
+            code = (code << 2) | 0x2;
+            codeBits += 2;
+            meaningfulBits = 64 - io_encoder->prevLeading - trailing;
+        }
+        else
+        {
+            trailing = xoredTrailing;
+            meaningfulBits = 64 - leading - trailing;
+            code = (code << 14) | (0x3 << 12) | (leading << 6) | (meaningfulBits - 1);
+            codeBits += 14;
+            io_encoder->prevLeading = leading;
+            io_encoder->prevTrailing = trailing;
+        }
+    }
+    if (codeBits + meaningfulBits <= 64)
+    {
+        WriteBits(io_encoder, (code << meaningfulBits) | (meaningfulBits > 0 ? xored >> trailing : 0), codeBits + meaningfulBits);
+    }
+    else
+    {
+        WriteBits(io_encoder, code, codeBits);
+        WriteBits(io_encoder, xored >> trailing, meaningfulBits);
+    }
+    io_encoder->prevValue = bits;
+    io_encoder->samplesCount++;
+    return true;
+}
+
+void ARCEndBlock(ARCEncoder* const io_encoder)
+{
+    // the pending bits, left aligned in their last bytes
+    const u32 pendingBits = io_encoder->bitsCount & 63;
+    if (pendingBits > 0)
+    {
+        const u64 word = io_encoder->accumulator << (64 - pendingBits);
+        u8* dst = io_encoder->block + sizeof(ARCBlockHeader) + (io_encoder->bitsCount - pendingBits) / 8;
+        for (u32 i = 0; i * 8 < pendingBits; i++)
+        {
+            dst[i] = (u8)(word >> (56 - i * 8));
+        }
+    }
+
+    ARCBlockHeader* header = (ARCBlockHeader*)io_encoder->block;
+    header->samplesCount = (u16)io_encoder->samplesCount;
+    header->bitsCount = io_encoder->bitsCount;
+    header->lastMs = io_encoder->prevMs;
+    header->checksum = ARCComputeChecksum(io_encoder->block, k_archiveBlockSize, &header->checksum);
+}
+
+bool ARCValidateBlock(const u8* i_block)
+{
+    const ARCBlockHeader* header = (const ARCBlockHeader*)i_block;
+    if (header->magic != k_blockMagic || header->samplesCount == 0 || header->bitsCount > k_blockPayloadBits ||
+        header->lastMs < header->firstMs)
+    {
+        return false;
+    }
+
+    alignas(8) u8 block[k_archiveBlockSize];
+    mem_copy(block, i_block, k_archiveBlockSize);
+    ARCBlockHeader* copy = (ARCBlockHeader*)block;
+    return ARCComputeChecksum(block, k_archiveBlockSize, &copy->checksum) == header->checksum;
+}
+
+u32 ARCDecodeBlock(const u8* i_block, u64* o_timestamps, f64* o_values, const u32 i_maxSamples)
+{
+    const ARCBlockHeader* header = (const ARCBlockHeader*)i_block;
+    const u32 samplesCount = math_min((u32)header->samplesCount, i_maxSamples);
+    if (samplesCount == 0)
+    {
+        return 0;
+    }
+
+    BitReader reader = { i_block + sizeof(ARCBlockHeader), 0, header->bitsCount };
+    u64 timestampMs = header->firstMs;
+    s64 delta = 0;
+    u64 value = DoubleBits(header->firstValue);
+    u32 leading = 64;
+    u32 trailing = 64;
+    o_timestamps[0] = timestampMs;
+    o_values[0] = header->firstValue;
+
+    for (u32 i = 1; i < samplesCount; i++)
+    {
+        s64 deltaOfDelta = 0;
+        if (ReadBits(&reader, 1) != 0)
+        {
+            if (ReadBits(&reader, 1) == 0)
+            {
+                deltaOfDelta = (s64)ReadBits(&reader, 7) - 63;
+            }
+            else if (ReadBits(&reader, 1) == 0)
+            {
+                deltaOfDelta = (s64)ReadBits(&reader, 9) - 255;
+            }
+            else if (ReadBits(&reader, 1) == 0)
+            {
+                deltaOfDelta = (s64)ReadBits(&reader, 12) - 2047;
+            }
+            else
+            {
+                deltaOfDelta = (s32)ReadBits(&reader, 32);
+            }
+        }
+        delta += deltaOfDelta;
+        timestampMs += delta;
+
+        if (ReadBits(&reader, 1) != 0)
+        {
+            if (ReadBits(&reader, 1) != 0)
+            {
+                // a corrupted window can only be shorter than what is left after its leading zeros
+                leading = ReadBits(&reader, 6);
+                const u32 windowBits = ReadBits(&reader, 6) + 1;
+                const u32 meaningfulBits = math_min(windowBits, 64 - leading);
+                trailing = 64 - leading - meaningfulBits;
+            }
+            // reusing the window before there is one is a corruption too, nothing is read then
+            if (leading + trailing < 64)
+            {
+                value ^= ReadWideBits(&reader, 64 - leading - trailing) << trailing;
+            }
+        }
+
+        o_timestamps[i] = timestampMs;
+        o_values[i] = BitsDouble(value);
+    }
+    return samplesCount;
+}
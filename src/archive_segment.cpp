@@ -0,0 +1,106 @@
+#include "archive.h"
+
+#include <floral/assert.h>
+#include <floral/misc.h>
+#include <floral/string_utils.h>
+
+// The segment files alone, without the index nor the history: OpenSegment() writes their header,
+// ScanSegments() reads back those of the previous sessions, the tests drive them directly
+
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_segmentMagic = 0x5341574d; // 'MWAS'
+constexpr u32 k_scanBatchBlocks = 32;
+
+static_assert(sizeof(ARCSegmentHeader) == 32, "Segment header layout changed, bump k_archiveVersion");
+
+// ----------------------------------------------------------------------------
+
+u32 ARCGetSegmentHeaderBlocksCount(const u32 i_seriesCount)
+{
+    const size headerSize = sizeof(ARCSegmentHeader) + (size)i_seriesCount * k_maxHistoryNameLength;
+    return (u32)((headerSize + k_archiveBlockSize - 1) / k_archiveBlockSize);
+}
+
+void ARCWriteSegmentHeader(u8* o_buffer, const u64 i_startMs, const const_cstr* i_names, const u32 i_seriesCount)
+{
+    FLORAL_ASSERT(((aptr)o_buffer & 7) == 0);
+    const u32 headerBlocksCount = ARCGetSegmentHeaderBlocksCount(i_seriesCount);
+    mem_fill(o_buffer, 0, headerBlocksCount * k_archiveBlockSize);
+
+    ARCSegmentHeader* header = (ARCSegmentHeader*)o_buffer;
+    header->magic = k_segmentMagic;
+    header->version = k_archiveVersion;
+    header->blockSize = k_archiveBlockSize;
+    header->seriesCount = i_seriesCount;
+    header->startMs = i_startMs;
+    header->headerBlocksCount = headerBlocksCount;
+    c8* names = (c8*)(header + 1);
+    for (u32 i = 0; i < i_seriesCount; i++)
+    {
+        cstr_xcopy(names + i * k_maxHistoryNameLength, k_maxHistoryNameLength, i_names[i]);
+    }
+    header->checksum = ARCComputeChecksum(o_buffer, headerBlocksCount * k_archiveBlockSize, &header->checksum);
+}
+
+bool ARCReadSegmentHeader(file_handle_t* const i_file, arena_t* const i_arena, ARCSegmentFile* o_segment)
+{
+    o_segment->fileSize = file_get_size(*i_file);
+    if (o_segment->fileSize < sizeof(ARCSegmentHeader))
+    {
+        return false;
+    }
+
+    ARCSegmentHeader header;
+    file_read(*i_file, sizeof(header), &header);
+    if (header.magic != k_segmentMagic || header.version != k_archiveVersion || header.blockSize != k_archiveBlockSize ||
+        header.seriesCount > 0xffff || header.headerBlocksCount == 0 ||
+        (size)header.headerBlocksCount * k_archiveBlockSize < sizeof(ARCSegmentHeader) + (size)header.seriesCount * k_maxHistoryNameLength ||
+        o_segment->fileSize < (size)header.headerBlocksCount * k_archiveBlockSize)
+    {
+        return false;
+    }
+
+    const size headerSize = (size)header.headerBlocksCount * k_archiveBlockSize;
+    u8* buffer = arena_push_podarr_aligned(i_arena, u8, headerSize, 8);
+    mem_copy(buffer, &header, sizeof(header));
+    file_read(*i_file, headerSize - sizeof(header), buffer + sizeof(header));
+    if (ARCComputeChecksum(buffer, headerSize, &((ARCSegmentHeader*)buffer)->checksum) != header.checksum)
+    {
+        return false;
+    }
+
+    o_segment->header = header;
+    o_segment->names = (const c8*)(buffer + sizeof(header));
+    return true;
+}
+
+u32 ARCScanSegmentBlocks(file_handle_t* const i_file, const ARCSegmentFile& i_segment, arena_t* const i_arena,
+                         ARCBlockCallback i_callback, voidptr i_data)
+{
+    const ARCSegmentHeader& header = i_segment.header;
+    file_seek(*i_file, (size)header.headerBlocksCount * k_archiveBlockSize);
+
+    // a trailing partial block is what is left of a write interrupted by a crash
+    const size blocksSize = i_segment.fileSize - (size)header.headerBlocksCount * k_archiveBlockSize;
+    const u32 blocksCount = (u32)math_min(blocksSize / k_archiveBlockSize, (size)k_maxSegmentBlocks);
+    u32 droppedCount = blocksSize % k_archiveBlockSize != 0 ? 1 : 0;
+
+    u8* batch = arena_push_podarr_aligned(i_arena, u8, k_scanBatchBlocks * k_archiveBlockSize, 8);
+    for (u32 first = 0; first < blocksCount; first += k_scanBatchBlocks)
+    {
+        const u32 batchCount = math_min(k_scanBatchBlocks, blocksCount - first);
+        file_read(*i_file, batchCount * k_archiveBlockSize, batch);
+        for (u32 i = 0; i < batchCount; i++)
+        {
+            const u8* block = batch + i * k_archiveBlockSize;
+            if (!ARCValidateBlock(block) || ((const ARCBlockHeader*)block)->series >= header.seriesCount)
+            {
+                droppedCount++;
+                continue;
+            }
+            i_callback(i_data, block, first + i);
+        }
+    }
+    return droppedCount;
+}
@@ -26,15 +26,15 @@ void CFGInitialize(linear_allocator_t* i_allocator, file_system_t* const i_fileS
     CFGSetBool(CFGKey::StartOnBoot, OSGetStartOnBoot());
 }
 
-bool CFGGetBool(const CFGKey i_key)
+bool CFGGetBool(const CFGKey i_key, const bool i_default /* = false */)
 {
-    if (s_configs.configs[(u8)i_key].type == CFGValueType::Boolean &&
-        s_configs.configs[(u8)i_key].data != nullptr)
+    // false is stored as a null data, it is still a value which was set
+    if (s_configs.configs[(u8)i_key].type == CFGValueType::Boolean)
     {
         return (bool)s_configs.configs[(u8)i_key].data;
     }
 
-    return false;
+    return i_default;
 }
 
 void CFGSetBool(const CFGKey i_key, const bool i_value)
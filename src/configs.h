@@ -9,6 +9,23 @@ enum class CFGKey : u8
 {
     ShowInTaskBar = 0,
     StartOnBoot,
+
+    // metric providers, enabled unless set to false (see PRVProviderDesc)
+    ProviderNetwork,
+    ProviderDisk,
+    ProviderProcessor,
+    ProviderProcessorCounters,
+    ProviderProcessorTemperature,
+    ProviderMemory,
+    ProviderPressure,
+    ProviderProcesses,
+    ProviderGPUUtilization,
+    ProviderGPUTemperature,
+    ProviderVRAMUtilization,
+
+    MetricsEndpoint,
+    SnapshotStream,
+
     KeysCount
 };
 
@@ -33,5 +50,6 @@ struct CFGDict
 };
 
 void CFGInitialize(linear_allocator_t* i_allocator, file_system_t* const i_fileSystem);
-bool CFGGetBool(const CFGKey i_key);
+// i_default is returned for the keys which were never set
+bool CFGGetBool(const CFGKey i_key, const bool i_default = false);
 void CFGSetBool(const CFGKey i_key, const bool i_value);
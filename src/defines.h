@@ -7,6 +7,8 @@
 #define IDM_TRAY_RESTORE						1
 #define IDM_TRAY_SWITCH_MODE					3
 #define IDM_TRAY_START_ON_BOOT  				4
+#define IDM_TRAY_METRICS_ENDPOINT				5
+#define IDM_TRAY_SNAPSHOT_STREAM				6
 #define IDM_TRAY_EXIT							2
 #define AM_TRAY									WM_APP + 1
 
@@ -0,0 +1,194 @@
+#include "draw_commands.h"
+
+#include <floral/assert.h>
+#include <floral/log.h>
+#include <floral/misc.h>
+#include <floral/string_utils.h>
+
+#include "scripting.h"
+
+static DRWContext s_drawContext;
+
+// ----------------------------------------------------------------------------
+
+// nullptr when the frame is full, the command is then dropped
+static voidptr AppendCommand(const DRWCommandType i_type, const size i_payloadSize)
+{
+    cmdbuff_t* const commands = &s_drawContext.frames[s_drawContext.currentFrame];
+    const size commandSize = (sizeof(DRWCommandHeader) + i_payloadSize + 3) & ~(size)3;
+    const size usedSize = (size)(commands->writePtr - commands->data);
+    if (commandSize > commands->capacity - usedSize || commandSize > 0xffff)
+    {
+        if (!s_drawContext.overflowed)
+        {
+            LOG_WARNING("Too many draw commands in a frame, the ones after the first %d are dropped", s_drawContext.commandsCount);
+            s_drawContext.overflowed = true;
+        }
+        return nullptr;
+    }
+
+    const p8 command = cmdbuff_reserve(commands, commandSize);
+    // the padding is zeroed, frames are compared byte for byte
+    mem_fill(command, 0, commandSize);
+    DRWCommandHeader* const header = (DRWCommandHeader*)command;
+    header->type = i_type;
+    header->size = (u16)commandSize;
+    s_drawContext.commandsCount++;
+    return command + sizeof(DRWCommandHeader);
+}
+
+static s32 ScriptingRecordDrawRect(lua_State* i_vm)
+{
+    const s32 nArgs = lua_gettop(i_vm);
+    FLORAL_ASSERT(nArgs == 6);
+    DRWDrawRect* const command = (DRWDrawRect*)AppendCommand(DRWCommandType::DrawRect, sizeof(DRWDrawRect));
+    if (command)
+    {
+        command->x = (s32)lua_tointeger(i_vm, 1);
+        command->y = (s32)lua_tointeger(i_vm, 2);
+        command->w = (s32)lua_tointeger(i_vm, 3);
+        command->h = (s32)lua_tointeger(i_vm, 4);
+        command->color = (u32)lua_tointeger(i_vm, 5);
+        command->width = (f32)lua_tonumber(i_vm, 6);
+    }
+    return 0;
+}
+
+static s32 ScriptingRecordDrawArc(lua_State* i_vm)
+{
+    const s32 nArgs = lua_gettop(i_vm);
+    FLORAL_ASSERT(nArgs == 8);
+    DRWDrawArc* const command = (DRWDrawArc*)AppendCommand(DRWCommandType::DrawArc, sizeof(DRWDrawArc));
+    if (command)
+    {
+        command->x = (f32)lua_tonumber(i_vm, 1);
+        command->y = (f32)lua_tonumber(i_vm, 2);
+        command->w = (f32)lua_tonumber(i_vm, 3);
+        command->h = (f32)lua_tonumber(i_vm, 4);
+        command->color = (u32)lua_tointeger(i_vm, 5);
+        command->width = (f32)lua_tonumber(i_vm, 6);
+        command->start = (f32)lua_tonumber(i_vm, 7);
+        command->sweep = (f32)lua_tonumber(i_vm, 8);
+    }
+    return 0;
+}
+
+static s32 ScriptingRecordFillRect(lua_State* i_vm)
+{
+    const s32 nArgs = lua_gettop(i_vm);
+    FLORAL_ASSERT(nArgs == 5);
+    DRWFillRect* const command = (DRWFillRect*)AppendCommand(DRWCommandType::FillRect, sizeof(DRWFillRect));
+    if (command)
+    {
+        command->x = (s32)lua_tointeger(i_vm, 1);
+        command->y = (s32)lua_tointeger(i_vm, 2);
+        command->w = (s32)lua_tointeger(i_vm, 3);
+        command->h = (s32)lua_tointeger(i_vm, 4);
+        command->color = (u32)lua_tointeger(i_vm, 5);
+    }
+    return 0;
+}
+
+static s32 ScriptingRecordDrawText(lua_State* i_vm)
+{
+    const s32 nArgs = lua_gettop(i_vm);
+    FLORAL_ASSERT(nArgs == 8);
+    const_cstr str = lua_tostring(i_vm, 6);
+    if (str == nullptr)
+    {
+        return 0;
+    }
+    size strLen = cstr_length(str);
+    if (strLen > k_maxDrawTextLength)
+    {
+        LOG_WARNING("draw_text() is limited to %d bytes, the text is cut", k_maxDrawTextLength);
+        strLen = k_maxDrawTextLength;
+    }
+
+    DRWDrawText* const command = (DRWDrawText*)AppendCommand(DRWCommandType::DrawText, sizeof(DRWDrawText) + strLen);
+    if (command)
+    {
+        command->fontStyle = (s32)lua_tointeger(i_vm, 1);
+        command->x = (s32)lua_tointeger(i_vm, 2);
+        command->y = (s32)lua_tointeger(i_vm, 3);
+        command->w = (s32)lua_tointeger(i_vm, 4);
+        command->h = (s32)lua_tointeger(i_vm, 5);
+        command->textAlign = (u8)lua_tointeger(i_vm, 7);
+        command->lineAlign = (u8)lua_tointeger(i_vm, 8);
+        command->textLength = (u16)strLen;
+        mem_copy(command + 1, str, strLen);
+    }
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+
+void DRWInitialize(linear_allocator_t* const i_allocator)
+{
+    s_drawContext.arena = create_arena(i_allocator, k_drawCommandsCapacity * 2 + SIZE_KB(1));
+    s_drawContext.frames[0] = arena_create_cmdbuff(&s_drawContext.arena, k_drawCommandsCapacity);
+    s_drawContext.frames[1] = arena_create_cmdbuff(&s_drawContext.arena, k_drawCommandsCapacity);
+    s_drawContext.currentFrame = 0;
+    s_drawContext.commandsCount = 0;
+    s_drawContext.overflowed = false;
+    s_drawContext.invalidated = true;
+    s_drawContext.ready = true;
+}
+
+void DRWCleanUp()
+{
+    s_drawContext.ready = false;
+}
+
+void DRWBindScriptingAPIs()
+{
+    SCRRegisterFunc(&ScriptingRecordDrawRect, "draw_rect", nullptr);
+    SCRRegisterFunc(&ScriptingRecordDrawArc, "draw_arc", nullptr);
+    SCRRegisterFunc(&ScriptingRecordFillRect, "fill_rect", nullptr);
+    SCRRegisterFunc(&ScriptingRecordDrawText, "draw_text", nullptr);
+}
+
+void DRWInvalidate()
+{
+    s_drawContext.invalidated = true;
+}
+
+void DRWBeginFrame()
+{
+    FLORAL_ASSERT(s_drawContext.ready);
+    s_drawContext.currentFrame ^= 1;
+    cmdbuff_reset(&s_drawContext.frames[s_drawContext.currentFrame]);
+    s_drawContext.commandsCount = 0;
+    s_drawContext.overflowed = false;
+}
+
+bool DRWEndFrame()
+{
+    const cmdbuff_t& frame = s_drawContext.frames[s_drawContext.currentFrame];
+    const cmdbuff_t& lastFrame = s_drawContext.frames[s_drawContext.currentFrame ^ 1];
+    const size frameSize = (size)(frame.writePtr - frame.data);
+    const size lastFrameSize = (size)(lastFrame.writePtr - lastFrame.data);
+    const bool changed = s_drawContext.invalidated || frameSize != lastFrameSize || mem_compare(frame.data, lastFrame.data, frameSize) != 0;
+    s_drawContext.invalidated = false;
+    return changed;
+}
+
+cmdbuff_t* DRWGetFrameCommands()
+{
+    cmdbuff_t* const commands = &s_drawContext.frames[s_drawContext.currentFrame];
+    commands->readPtr = commands->data;
+    return commands;
+}
+
+const DRWCommandHeader* DRWReadCommand(cmdbuff_t* const io_commands, const_voidptr* o_payload)
+{
+    const DRWCommandHeader* header = cmdbuff_interpret<DRWCommandHeader>(io_commands);
+    if (header == nullptr)
+    {
+        return nullptr;
+    }
+    *o_payload = header + 1;
+    io_commands->readPtr += header->size - sizeof(DRWCommandHeader);
+    FLORAL_ASSERT(io_commands->readPtr <= io_commands->writePtr);
+    return header;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+#include <floral/container.h>
+#include <floral/memory.h>
+
+// The draw calls of the scripts are recorded as compact commands and replayed by the renderer once
+// on_update() has returned, so the VM never waits on rasterization. The commands of the last frame
+// are kept: a frame which records exactly the same commands does not need to be drawn again.
+
+// ----------------------------------------------------------------------------
+
+constexpr size k_drawCommandsCapacity = SIZE_KB(64); // per frame
+constexpr u32 k_maxDrawTextLength = 1024;              // UTF-8 bytes
+
+enum class DRWCommandType : u8
+{
+    DrawRect = 0,
+    DrawArc,
+    FillRect,
+    DrawText
+};
+
+// every command starts with a header, commands are 4 bytes aligned
+struct DRWCommandHeader
+{
+    DRWCommandType type;
+    u8 padding;
+    u16 size; // the header included
+};
+
+struct DRWDrawRect
+{
+    s32 x, y, w, h;
+    u32 color;
+    f32 width;
+};
+
+struct DRWDrawArc
+{
+    f32 x, y, w, h;
+    u32 color;
+    f32 width;
+    f32 start;
+    f32 sweep;
+};
+
+struct DRWFillRect
+{
+    s32 x, y, w, h;
+    u32 color;
+};
+
+struct DRWDrawText
+{
+    s32 fontStyle;
+    s32 x, y, w, h;
+    u8 textAlign;
+    u8 lineAlign;
+    u16 textLength; // followed by the UTF-8 text, not null terminated
+};
+
+struct DRWContext
+{
+    cmdbuff_t frames[2]; // the current one and the last one
+    u32 currentFrame;
+    u32 commandsCount;
+    bool overflowed;
+    bool invalidated; // the last frame is not on screen anymore
+
+    arena_t arena;
+    bool ready;
+};
+
+// ----------------------------------------------------------------------------
+
+void DRWInitialize(linear_allocator_t* const i_allocator);
+void DRWCleanUp();
+void DRWBindScriptingAPIs();
+
+// the next frame is drawn even if its commands do not change, e.g. after the surface is recreated
+void DRWInvalidate();
+void DRWBeginFrame();
+// true when the frame has to be drawn
+bool DRWEndFrame();
+// the commands of the frame, from the first one
+cmdbuff_t* DRWGetFrameCommands();
+// nullptr at the end, o_payload points after the header
+const DRWCommandHeader* DRWReadCommand(cmdbuff_t* const io_commands, const_voidptr* o_payload);
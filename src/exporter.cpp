@@ -0,0 +1,592 @@
+#include "exporter.h"
+
+#include <ws2tcpip.h>
+#include <math.h>
+
+#include <floral/assert.h>
+#include <floral/log.h>
+#include <floral/misc.h>
+#include <floral/string_utils.h>
+#include <floral/thread_context.h>
+
+#include "history.h"
+
+static EXPContext s_exporterContext;
+
+// ----------------------------------------------------------------------------
+
+constexpr const_cstr k_metricPrefix = "monitor_";
+constexpr const_cstr k_counterSuffix = "_total";
+constexpr u32 k_maxValueLength = 32;
+constexpr f64 k_maxExactInteger = 9007199254740992.0; // 2^53
+// "# TYPE " + " counter\n" (the longest type) + " " around the name written twice
+constexpr u32 k_prefixOverhead = 7 + 9 + 1;
+
+static bool IsMetricNameChar(const c8 i_char)
+{
+    return (i_char >= 'a' && i_char <= 'z') || (i_char >= 'A' && i_char <= 'Z') || (i_char >= '0' && i_char <= '9') || i_char == '_';
+}
+
+static u32 WriteMetricText(c8* o_buffer, const_cstr i_text)
+{
+    u32 length = 0;
+    for (const c8* c = i_text; *c; c++)
+    {
+        o_buffer[length++] = *c;
+    }
+    return length;
+}
+
+// "processor_temperature.package" -> "monitor_processor_temperature_package", the counters get
+// the "_total" suffix Prometheus expects of them ("network.sent" -> "monitor_network_sent_total")
+static u32 WriteMetricName(c8* o_buffer, const HSTSeries* i_series)
+{
+    u32 length = WriteMetricText(o_buffer, k_metricPrefix);
+    for (const c8* c = i_series->name; *c; c++)
+    {
+        o_buffer[length++] = IsMetricNameChar(*c) ? *c : '_';
+    }
+    if (i_series->field->counter)
+    {
+        length += WriteMetricText(o_buffer + length, k_counterSuffix);
+    }
+    return length;
+}
+
+static u32 WriteMetricDigits(c8* o_buffer, u64 i_value)
+{
+    c8 digits[20];
+    u32 digitsCount = 0;
+    do
+    {
+        digits[digitsCount++] = (c8)('0' + i_value % 10);
+        i_value /= 10;
+    } while (i_value > 0);
+
+    for (u32 i = 0; i < digitsCount; i++)
+    {
+        o_buffer[i] = digits[digitsCount - 1 - i];
+    }
+    return digitsCount;
+}
+
+static const f64 k_metricPowersOf10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11 };
+
+// i_scaled / 10^i_decimals, without the trailing zeros of the fraction
+static u32 WriteMetricDecimal(c8* o_buffer, u64 i_scaled, u32 i_decimals)
+{
+    while (i_decimals > 0 && i_scaled % 10 == 0)
+    {
+        i_scaled /= 10;
+        i_decimals--;
+    }
+
+    const u64 divisor = (u64)k_metricPowersOf10[i_decimals];
+    u32 length = WriteMetricDigits(o_buffer, i_scaled / divisor);
+    if (i_decimals > 0)
+    {
+        o_buffer[length++] = '.';
+        u64 fraction = i_scaled % divisor;
+        for (u32 i = i_decimals; i > 0; i--)
+        {
+            o_buffer[length + i - 1] = (c8)('0' + fraction % 10);
+            fraction /= 10;
+        }
+        length += i_decimals;
+    }
+    return length;
+}
+
+// the integers are written in full as long as a f64 holds them exactly, the counters among them,
+// the other values get 7 significant digits, as much as a f32 sample holds. The very large or small
+// values get an exponent, the same text as "%.7g" without going through printf
+static u32 FormatMetricValue(c8* o_buffer, const f64 i_value)
+{
+    if (isnan(i_value))
+    {
+        mem_copy(o_buffer, "NaN", 3);
+        return 3;
+    }
+    if (isinf(i_value))
+    {
+        mem_copy(o_buffer, i_value > 0.0 ? "+Inf" : "-Inf", 4);
+        return 4;
+    }
+
+    u32 length = 0;
+    f64 magnitude = i_value;
+    if (magnitude < 0.0)
+    {
+        o_buffer[length++] = '-';
+        magnitude = -magnitude;
+    }
+    if (magnitude == floor(magnitude) && magnitude <= k_maxExactInteger)
+    {
+        return length + WriteMetricDigits(o_buffer + length, (u64)magnitude);
+    }
+    if (magnitude < 1e-4 || magnitude >= 1e9)
+    {
+        // d.dddddde+XX, the mantissa is off by ~1e-13 at most, far below the 7 digits
+        const f64 exponent10 = log10(magnitude);
+        s32 exponent = (s32)floor(exponent10);
+        f64 mantissa = pow(10.0, exponent10 - exponent);
+        if (mantissa < 1.0)
+        {
+            mantissa *= 10.0;
+            exponent--;
+        }
+        u64 scaled = (u64)(mantissa * 1e6 + 0.5);
+        if (scaled >= 10000000)
+        {
+            scaled /= 10;
+            exponent++;
+        }
+        length += WriteMetricDecimal(o_buffer + length, scaled, 6);
+        o_buffer[length++] = 'e';
+        o_buffer[length++] = exponent < 0 ? '-' : '+';
+        const u64 exponentDigits = (u64)(exponent < 0 ? -exponent : exponent);
+        if (exponentDigits < 10)
+        {
+            o_buffer[length++] = '0';
+        }
+        return length + WriteMetricDigits(o_buffer + length, exponentDigits);
+    }
+
+    // the decimals needed for 7 significant digits
+    u32 integerDigits = 0;
+    while (integerDigits < 9 && magnitude >= k_metricPowersOf10[integerDigits + 1])
+    {
+        integerDigits++;
+    }
+    u32 decimals = integerDigits < 6 ? 6 - integerDigits : 0;
+    if (magnitude < 1.0)
+    {
+        // leading zeros of the fraction are not significant
+        for (f64 scaled = magnitude; scaled < 1.0; scaled *= 10.0)
+        {
+            decimals++;
+        }
+    }
+    const u64 scaled = (u64)(magnitude * k_metricPowersOf10[decimals] + 0.5);
+    return length + WriteMetricDecimal(o_buffer + length, scaled, decimals);
+}
+
+size EXPGetMaxBodySize()
+{
+    return s_exporterContext.prefixOffsets[s_exporterContext.seriesCount] + s_exporterContext.seriesCount * (k_maxValueLength + 1);
+}
+
+size EXPRenderMetrics(c8* o_buffer)
+{
+    size length = 0;
+    for (u32 i = 0; i < s_exporterContext.seriesCount; i++)
+    {
+        const HSTSeries* series = HSTGetSeries(i);
+        const HSTWindow window = HSTGetWindowLast(series, 1);
+        u64 timestampMs = 0;
+        f64 value = 0.0;
+        if (window.length == 0 || !HSTReadSample(series, window, 0, &timestampMs, &value))
+        {
+            continue;
+        }
+
+        const u32 prefixOffset = s_exporterContext.prefixOffsets[i];
+        const u32 prefixLength = s_exporterContext.prefixOffsets[i + 1] - prefixOffset;
+        mem_copy(o_buffer + length, s_exporterContext.prefixes + prefixOffset, prefixLength);
+        length += prefixLength;
+        length += FormatMetricValue(o_buffer + length, value);
+        o_buffer[length++] = '\n';
+    }
+    return length;
+}
+
+// ----------------------------------------------------------------------------
+
+static void ResetClient(EXPClient* const io_client)
+{
+    io_client->requestSize = 0;
+    io_client->responseStart = 0;
+    io_client->responseEnd = 0;
+    io_client->sentSize = 0;
+}
+
+static void CloseClient(EXPClient* const io_client)
+{
+    if (io_client->socket != INVALID_SOCKET)
+    {
+        closesocket(io_client->socket);
+        io_client->socket = INVALID_SOCKET;
+    }
+    ResetClient(io_client);
+}
+
+// the body is rendered after the reserved room, the header is then written right before it so that
+// the whole response goes out in one piece
+static void PrepareResponse(EXPClient* const io_client, const bool i_found)
+{
+    c8* const body = (c8*)io_client->response + k_exporterHeaderReserve;
+    size bodySize = 0;
+    if (i_found)
+    {
+        bodySize = EXPRenderMetrics(body);
+    }
+    else
+    {
+        const_cstr notFound = "Not Found, the metrics are at /metrics\n";
+        bodySize = cstr_length(notFound);
+        mem_copy(body, notFound, bodySize);
+    }
+
+    // at most 105 characters, for a 20 digits length
+    c8 header[k_exporterHeaderReserve];
+    u32 headerSize = WriteMetricText(header, i_found ? "HTTP/1.1 200 OK\r\n" : "HTTP/1.1 404 Not Found\r\n");
+    headerSize += WriteMetricText(header + headerSize, "Content-Type: text/plain; version=0.0.4\r\nContent-Length: ");
+    headerSize += WriteMetricDigits(header + headerSize, (u64)bodySize);
+    headerSize += WriteMetricText(header + headerSize, "\r\n\r\n");
+    FLORAL_ASSERT(headerSize < k_exporterHeaderReserve);
+    io_client->responseStart = k_exporterHeaderReserve - headerSize;
+    io_client->responseEnd = k_exporterHeaderReserve + bodySize;
+    io_client->sentSize = 0;
+    mem_copy(io_client->response + io_client->responseStart, header, headerSize);
+}
+
+// false when the client has to be closed
+static bool SendResponse(EXPClient* const io_client)
+{
+    while (io_client->responseStart + io_client->sentSize < io_client->responseEnd)
+    {
+        const size remaining = io_client->responseEnd - io_client->responseStart - io_client->sentSize;
+        const s32 sent = send(io_client->socket, (const c8*)io_client->response + io_client->responseStart + io_client->sentSize, (s32)remaining, 0);
+        if (sent == SOCKET_ERROR)
+        {
+            // FD_WRITE will tell when the rest can go
+            return WSAGetLastError() == WSAEWOULDBLOCK;
+        }
+        io_client->sentSize += (size)sent;
+    }
+    io_client->responseStart = 0;
+    io_client->responseEnd = 0;
+    io_client->sentSize = 0;
+    return true;
+}
+
+// handles the complete requests received so far, false when the client has to be closed
+static bool ProcessRequests(EXPClient* const io_client)
+{
+    // one request at a time, the next one waits for the response to be out
+    while (io_client->responseEnd == 0)
+    {
+        u32 requestEnd = 0;
+        for (u32 i = 3; i < io_client->requestSize && requestEnd == 0; i++)
+        {
+            if (io_client->request[i - 3] == '\r' && io_client->request[i - 2] == '\n' && io_client->request[i - 1] == '\r' && io_client->request[i] == '\n')
+            {
+                requestEnd = i + 1;
+            }
+        }
+        if (requestEnd == 0)
+        {
+            return io_client->requestSize < k_exporterRequestSize;
+        }
+
+        const_cstr get = "GET /metrics";
+        const u32 getLength = (u32)cstr_length(get);
+        const bool found = requestEnd > getLength && mem_compare(io_client->request, get, getLength) == 0 &&
+                           (io_client->request[getLength] == ' ' || io_client->request[getLength] == '?');
+        PrepareResponse(io_client, found);
+
+        // keep what may already be the next request
+        const u32 leftover = io_client->requestSize - requestEnd;
+        for (u32 i = 0; i < leftover; i++)
+        {
+            io_client->request[i] = io_client->request[requestEnd + i];
+        }
+        io_client->requestSize = leftover;
+
+        if (!SendResponse(io_client))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool ReceiveRequests(EXPClient* const io_client)
+{
+    for (;;)
+    {
+        if (io_client->requestSize == k_exporterRequestSize)
+        {
+            return ProcessRequests(io_client);
+        }
+
+        const s32 received = recv(io_client->socket, io_client->request + io_client->requestSize, (s32)(k_exporterRequestSize - io_client->requestSize), 0);
+        if (received == 0)
+        {
+            return false;
+        }
+        if (received == SOCKET_ERROR)
+        {
+            return WSAGetLastError() == WSAEWOULDBLOCK && ProcessRequests(io_client);
+        }
+        io_client->requestSize += (u32)received;
+    }
+}
+
+static void AcceptClients()
+{
+    for (;;)
+    {
+        SOCKET clientSocket = accept(s_exporterContext.listenSocket, nullptr, nullptr);
+        if (clientSocket == INVALID_SOCKET)
+        {
+            return;
+        }
+
+        EXPClient* client = nullptr;
+        for (u32 i = 0; i < k_maxExporterClients && client == nullptr; i++)
+        {
+            if (s_exporterContext.clients[i].socket == INVALID_SOCKET)
+            {
+                client = &s_exporterContext.clients[i];
+            }
+        }
+        if (client == nullptr)
+        {
+            LOG_WARNING("Too many metrics clients, one is dropped");
+            closesocket(clientSocket);
+            continue;
+        }
+
+        const BOOL noDelay = TRUE;
+        setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, (const c8*)&noDelay, sizeof(noDelay));
+        // also makes the socket non-blocking
+        WSAEventSelect(clientSocket, client->event, FD_READ | FD_WRITE | FD_CLOSE);
+        ResetClient(client);
+        client->socket = clientSocket;
+    }
+}
+
+static bool OpenListenSocket()
+{
+    s_exporterContext.listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s_exporterContext.listenSocket == INVALID_SOCKET)
+    {
+        return false;
+    }
+
+    const BOOL exclusive = TRUE;
+    setsockopt(s_exporterContext.listenSocket, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, (const c8*)&exclusive, sizeof(exclusive));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(k_exporterPort);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(s_exporterContext.listenSocket, (const sockaddr*)&address, sizeof(address)) == SOCKET_ERROR ||
+        listen(s_exporterContext.listenSocket, SOMAXCONN) == SOCKET_ERROR)
+    {
+        closesocket(s_exporterContext.listenSocket);
+        s_exporterContext.listenSocket = INVALID_SOCKET;
+        return false;
+    }
+    WSAEventSelect(s_exporterContext.listenSocket, s_exporterContext.listenEvent, FD_ACCEPT);
+    return true;
+}
+
+static void EXPThreadFunc(voidptr i_data)
+{
+    EXPContext* const ctx = (EXPContext*)i_data;
+
+    linear_allocator_t masterAllocator = create_linear_allocator("'exporter' master allocator", SIZE_KB(512));
+
+    thread_context_t threadContext = {
+        .allocator = create_linear_allocator(&masterAllocator, "exporter thread context allocator", SIZE_KB(256))
+    };
+    thread_set_context(&threadContext);
+
+    log_context_t logCtx = create_log_context("exporter", log_level_e::verbose, &masterAllocator);
+    log_set_context(&logCtx);
+
+    windows_logger_t windowsLogger = create_windows_logger(log_level_e::verbose);
+    log_context_add_logger(&logCtx, &windows_logger_log_message_cstr, &windows_logger_log_message_wcstr, &windowsLogger);
+
+    LOG_SCOPE(exporter);
+
+    WSADATA wsaData = {};
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0 || !OpenListenSocket())
+    {
+        LOG_ERROR("Cannot listen on port %d, the metrics endpoint is not available", k_exporterPort);
+        WSACleanup();
+        allocator_destroy(&masterAllocator);
+        return;
+    }
+    LOG_DEBUG("Serving the metrics on http://127.0.0.1:%d/metrics", k_exporterPort);
+
+    // the terminate event first, it wins over any pending network event
+    HANDLE events[2 + k_maxExporterClients] = { ctx->terminateEvent, ctx->listenEvent };
+    for (u32 i = 0; i < k_maxExporterClients; i++)
+    {
+        events[2 + i] = ctx->clients[i].event;
+    }
+
+    bool terminate = false;
+    while (!terminate)
+    {
+        const DWORD result = WaitForMultipleObjects((DWORD)array_length(events), events, FALSE, INFINITE);
+        if (result == WAIT_OBJECT_0 || result == WAIT_FAILED)
+        {
+            terminate = true;
+            continue;
+        }
+
+        WSANETWORKEVENTS networkEvents = {};
+        if (WSAEnumNetworkEvents(ctx->listenSocket, ctx->listenEvent, &networkEvents) == 0 && (networkEvents.lNetworkEvents & FD_ACCEPT))
+        {
+            AcceptClients();
+        }
+
+        // the wait only reports the first signaled event, they are all checked so none starves
+        for (u32 i = 0; i < k_maxExporterClients; i++)
+        {
+            EXPClient* const client = &ctx->clients[i];
+            if (client->socket == INVALID_SOCKET || WSAEnumNetworkEvents(client->socket, client->event, &networkEvents) != 0)
+            {
+                continue;
+            }
+
+            bool keep = (networkEvents.lNetworkEvents & FD_CLOSE) == 0;
+            if (keep && (networkEvents.lNetworkEvents & FD_WRITE) && client->responseEnd > 0)
+            {
+                // reading may have stopped on a full request buffer while the response was going out
+                keep = SendResponse(client) && ReceiveRequests(client);
+            }
+            if (keep && (networkEvents.lNetworkEvents & FD_READ))
+            {
+                keep = ReceiveRequests(client);
+            }
+            if (!keep)
+            {
+                CloseClient(client);
+            }
+        }
+    }
+
+    for (u32 i = 0; i < k_maxExporterClients; i++)
+    {
+        CloseClient(&ctx->clients[i]);
+    }
+    closesocket(ctx->listenSocket);
+    ctx->listenSocket = INVALID_SOCKET;
+    WSACleanup();
+
+    LOG_DEBUG("Metrics endpoint closed.");
+    allocator_destroy(&masterAllocator);
+}
+
+// ----------------------------------------------------------------------------
+
+void EXPInitialize(linear_allocator_t* const i_allocator)
+{
+    LOG_SCOPE(exporter);
+
+    const u32 seriesCount = HSTGetSeriesCount();
+    size prefixesSize = 0;
+    for (u32 i = 0; i < seriesCount; i++)
+    {
+        const HSTSeries* series = HSTGetSeries(i);
+        const size suffixLength = series->field->counter ? cstr_length(k_counterSuffix) : 0;
+        prefixesSize += (cstr_length(k_metricPrefix) + cstr_length(series->name) + suffixLength) * 2 + k_prefixOverhead;
+    }
+    const size maxBodySize = prefixesSize + seriesCount * (k_maxValueLength + 1) + 64;
+    s_exporterContext.responseCapacity = k_exporterHeaderReserve + maxBodySize;
+    s_exporterContext.arena = create_arena(i_allocator, SIZE_KB(4) + prefixesSize + (seriesCount + 1) * sizeof(u32) +
+                                                            k_maxExporterClients * (k_exporterRequestSize + s_exporterContext.responseCapacity + 16));
+
+    // the series never change, neither do their names
+    s_exporterContext.prefixes = arena_push_podarr(&s_exporterContext.arena, c8, prefixesSize);
+    s_exporterContext.prefixOffsets = arena_push_podarr(&s_exporterContext.arena, u32, seriesCount + 1);
+    u32 offset = 0;
+    for (u32 i = 0; i < seriesCount; i++)
+    {
+        s_exporterContext.prefixOffsets[i] = offset;
+        c8* prefix = s_exporterContext.prefixes + offset;
+        mem_copy(prefix, "# TYPE ", 7);
+        u32 length = 7;
+        const HSTSeries* series = HSTGetSeries(i);
+        const u32 nameLength = WriteMetricName(prefix + length, series);
+        length += nameLength;
+        const_cstr type = series->field->counter ? " counter\n" : " gauge\n";
+        const u32 typeLength = (u32)cstr_length(type);
+        mem_copy(prefix + length, type, typeLength);
+        length += typeLength;
+        mem_copy(prefix + length, prefix + 7, nameLength);
+        length += nameLength;
+        prefix[length++] = ' ';
+        offset += length;
+    }
+    s_exporterContext.prefixOffsets[seriesCount] = offset;
+    s_exporterContext.seriesCount = seriesCount;
+
+    for (u32 i = 0; i < k_maxExporterClients; i++)
+    {
+        EXPClient* const client = &s_exporterContext.clients[i];
+        client->socket = INVALID_SOCKET;
+        client->event = WSACreateEvent();
+        client->request = arena_push_podarr(&s_exporterContext.arena, c8, k_exporterRequestSize);
+        client->response = arena_push_podarr_aligned(&s_exporterContext.arena, u8, s_exporterContext.responseCapacity, 16);
+        ResetClient(client);
+    }
+    s_exporterContext.listenSocket = INVALID_SOCKET;
+    s_exporterContext.listenEvent = WSACreateEvent();
+    s_exporterContext.terminateEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    s_exporterContext.running = false;
+
+    s_exporterContext.ready = true;
+}
+
+void EXPCleanUp()
+{
+    FLORAL_ASSERT(s_exporterContext.ready);
+    EXPStop();
+    for (u32 i = 0; i < k_maxExporterClients; i++)
+    {
+        WSACloseEvent(s_exporterContext.clients[i].event);
+    }
+    WSACloseEvent(s_exporterContext.listenEvent);
+    CloseHandle(s_exporterContext.terminateEvent);
+    s_exporterContext.ready = false;
+}
+
+void EXPStart()
+{
+    if (s_exporterContext.running)
+    {
+        return;
+    }
+
+    thread_desc_t threadDesc = {
+        .data = &s_exporterContext,
+        .func = EXPThreadFunc,
+        .priority = thread_priority_e::below_normal,
+        .name = "exporter"
+    };
+    s_exporterContext.thread = create_thread(&threadDesc);
+    thread_start(&s_exporterContext.thread);
+    s_exporterContext.running = true;
+}
+
+void EXPStop()
+{
+    if (!s_exporterContext.running)
+    {
+        return;
+    }
+
+    SetEvent(s_exporterContext.terminateEvent);
+    thread_join(&s_exporterContext.thread);
+    s_exporterContext.running = false;
+}
+
+bool EXPIsRunning()
+{
+    return s_exporterContext.running;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Windows.h>
+#include <winsock2.h>
+
+#include <floral/stdaliases.h>
+#include <floral/memory.h>
+#include <floral/thread.h>
+
+// A small HTTP endpoint on localhost serving the latest sample of every history series in the
+// Prometheus text format, so a local agent can scrape the widget. It has its own thread waiting on
+// the sockets' events, and renders each scrape into a buffer of its client reserved upfront: the
+// metric names are formatted once, a scrape only appends the values.
+
+// ----------------------------------------------------------------------------
+
+constexpr u16 k_exporterPort = 9479;
+constexpr u32 k_maxExporterClients = 4;
+constexpr u32 k_exporterRequestSize = 2048; // a request larger than this is dropped
+constexpr u32 k_exporterHeaderReserve = 128; // room for the response's header, right before its body
+
+struct EXPClient
+{
+    SOCKET socket;
+    WSAEVENT event;
+    c8* request;
+    u32 requestSize;
+    // the response is [responseStart, responseEnd) of 'response'
+    p8 response;
+    size responseStart;
+    size responseEnd;
+    size sentSize;
+};
+
+struct EXPContext
+{
+    // "# TYPE <name> gauge\n<name> " of each series (or counter), back to back
+    c8* prefixes;
+    u32* prefixOffsets; // seriesCount + 1 of them
+    u32 seriesCount;
+    size responseCapacity;
+
+    // owned by the endpoint's thread
+    SOCKET listenSocket;
+    WSAEVENT listenEvent;
+    EXPClient clients[k_maxExporterClients];
+
+    HANDLE terminateEvent;
+    thread_t thread;
+    bool running;
+
+    arena_t arena;
+    bool ready;
+};
+
+// ----------------------------------------------------------------------------
+
+// must come after HSTInitialize(), the endpoint only runs once started
+void EXPInitialize(linear_allocator_t* const i_allocator);
+void EXPCleanUp();
+void EXPStart();
+void EXPStop();
+bool EXPIsRunning();
+
+// renders the latest samples into o_buffer (at least EXPGetMaxBodySize() bytes), returns the size
+size EXPRenderMetrics(c8* o_buffer);
+size EXPGetMaxBodySize();
@@ -77,7 +77,9 @@ void FTInitialize(linear_allocator_t* i_allocator)
 
     thread_desc_t threadDesc = {
         .data = &s_fileTrackerContext,
-        .func = FTThreadFunc
+        .func = FTThreadFunc,
+        .priority = thread_priority_e::lowest,
+        .name = "files_tracker"
     };
     s_fileTrackerContext.terminateEvent = CreateEvent(NULL, FALSE, FALSE, LITERAL("terminateEvent"));
     s_fileTrackerContext.thread = create_thread(&threadDesc);
@@ -3,7 +3,7 @@
 #if defined(FLORAL_PLATFORM_WINDOWS)
 #  include "atomic_windows.inl"
 #elif defined(FLORAL_PLATFORM_LINUX)
-// TODO
+#  include "atomic_linux.inl"
 #else
 // TODO
 #endif
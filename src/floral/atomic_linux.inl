@@ -0,0 +1,20 @@
+///////////////////////////////////////////////////////////////////////////////
+
+// same full barrier semantic as the Interlocked* functions
+
+u32 interlocked_exchange(ATOMIC_TYPE(u32) * io_target, const u32 i_value)
+{
+    return __atomic_exchange_n(io_target, i_value, __ATOMIC_SEQ_CST);
+}
+
+u32 interlocked_decrement(ATOMIC_TYPE(u32) * io_target)
+{
+    return __atomic_sub_fetch(io_target, 1, __ATOMIC_SEQ_CST);
+}
+
+u32 interlocked_compare_exchange(ATOMIC_TYPE(u32) * io_target, const u32 i_exchange, const u32 i_comperand)
+{
+    u32 expected = i_comperand;
+    __atomic_compare_exchange_n(io_target, &expected, i_exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return expected;
+}
@@ -22,7 +22,7 @@
 // cpu
 #if defined(__aarch64__) || defined(__arm__)
 #  define FLORAL_CPU_ARM
-#elif defined(__x86_64__) || defined(__i386__)
+#elif defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
 #  define FLORAL_CPU_INTEL
 #else
 // TODO
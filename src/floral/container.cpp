@@ -8,7 +8,7 @@ cmdbuff_t create_cmdbuff(voidptr i_memory, const size i_size)
 {
     cmdbuff_t cmdBuff;
 
-    cmdBuff.size = i_size;
+    cmdBuff.capacity = i_size;
     cmdBuff.data = (p8)i_memory;
     cmdBuff.writePtr = (p8)i_memory;
     cmdBuff.readPtr = (p8)i_memory;
@@ -25,7 +25,7 @@ void cmdbuff_reset(cmdbuff_t* const io_cmdBuff)
 void cmdbuff_copy(cmdbuff_t* const o_to, const cmdbuff_t* const i_from)
 {
     size cmdSize = (aptr)i_from->writePtr - (aptr)i_from->data;
-    FLORAL_ASSERT(o_to->size - size(o_to->writePtr - o_to->data) >= cmdSize);
+    FLORAL_ASSERT(o_to->capacity - size(o_to->writePtr - o_to->data) >= cmdSize);
     mem_copy(o_to->writePtr, i_from->data, cmdSize);
     o_to->writePtr += cmdSize;
 }
@@ -48,7 +48,7 @@ bool cmdbuff_read(cmdbuff_t* const i_cmdBuff, voidptr o_buffer, const size i_siz
 void cmdbuff_write(cmdbuff_t* const io_cmdBuff, const_voidptr i_buffer, const size i_size)
 {
     p8 wpos = io_cmdBuff->writePtr;
-    FLORAL_ASSERT((size)wpos + i_size <= (aptr)io_cmdBuff->data + io_cmdBuff->size);
+    FLORAL_ASSERT((size)wpos + i_size <= (aptr)io_cmdBuff->data + io_cmdBuff->capacity);
     mem_copy(wpos, i_buffer, i_size);
     io_cmdBuff->writePtr = wpos + i_size;
 }
@@ -56,7 +56,7 @@ void cmdbuff_write(cmdbuff_t* const io_cmdBuff, const_voidptr i_buffer, const si
 p8 cmdbuff_reserve(cmdbuff_t* const io_cmdBuff, const size i_size)
 {
     p8 wpos = io_cmdBuff->writePtr;
-    FLORAL_ASSERT((size)wpos + i_size <= (aptr)io_cmdBuff->data + io_cmdBuff->size);
+    FLORAL_ASSERT((size)wpos + i_size <= (aptr)io_cmdBuff->data + io_cmdBuff->capacity);
     io_cmdBuff->writePtr = wpos + i_size;
     return wpos;
 }
@@ -130,7 +130,7 @@ struct cmdbuff_t
     p8 data;
     p8 writePtr;
     p8 readPtr;
-    size size;
+    size capacity;
 };
 
 cmdbuff_t create_cmdbuff(voidptr i_memory, const size i_size);
@@ -435,11 +435,25 @@ void dll_push_front(dll_t<t_type>* const io_dll, typename dll_t<t_type>::node_t*
     }
 }
 
-template <typename t_node>
-void dll_remove(t_node* const i_node)
+template <typename t_type>
+void dll_remove(dll_t<t_type>* const io_dll, typename dll_t<t_type>::node_t* const i_node)
 {
-    i_node->prev->next = i_node->next;
-    i_node->next->prev = i_node->prev;
+    if (i_node->prev)
+    {
+        i_node->prev->next = i_node->next;
+    }
+    else
+    {
+        io_dll->first = i_node->next;
+    }
+    if (i_node->next)
+    {
+        i_node->next->prev = i_node->prev;
+    }
+    else
+    {
+        io_dll->last = i_node->prev;
+    }
     i_node->prev = nullptr;
     i_node->next = nullptr;
 }
@@ -0,0 +1,575 @@
+#include "delta_stream.h"
+
+#include "assert.h"
+#include "misc.h"
+#include "string_utils.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+static constexpr u32 k_deltaStreamMagic = 0x4d545344; // 'DSTM'
+static constexpr u16 k_deltaStreamVersion = 1;
+static constexpr u32 k_deltaStreamCompressedFlag = 1;
+static constexpr u32 k_deltaStreamMaxBlockSize = SIZE_MB(16);
+static constexpr size k_maxVarintSize = 10;
+
+static constexpr size k_lz4MinMatch = 4;
+static constexpr size k_lz4LastLiterals = 5; // the last bytes of a block are always literals
+static constexpr size k_lz4MatchLimit = 12;  // no match starts in the last bytes of a block
+static constexpr size k_lz4MaxOffset = 65535;
+static constexpr u32 k_lz4EmptySlot = 0xffffffff;
+
+static_assert(sizeof(delta_stream_header_t) == 16, "Stream header layout changed, bump k_deltaStreamVersion");
+static_assert(sizeof(delta_block_header_t) == 12, "Block header layout changed, bump k_deltaStreamVersion");
+
+static p8 write_varint(p8 io_writer, u64 i_value)
+{
+    while (i_value >= 0x80)
+    {
+        *io_writer++ = (u8)(i_value | 0x80);
+        i_value >>= 7;
+    }
+    *io_writer++ = (u8)i_value;
+    return io_writer;
+}
+
+static bool read_varint(p8* io_reader, const p8 i_end, u64* o_value)
+{
+    p8 reader = *io_reader;
+    u64 value = 0;
+    for (u32 shift = 0; shift < 64; shift += 7)
+    {
+        if (reader == i_end)
+        {
+            return false;
+        }
+        const u8 byte = *reader++;
+        value |= (u64)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            *io_reader = reader;
+            *o_value = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+static u64 zigzag_encode(const u64 i_delta)
+{
+    return (i_delta << 1) ^ (u64)((s64)i_delta >> 63);
+}
+
+static u64 zigzag_decode(const u64 i_value)
+{
+    return (i_value >> 1) ^ (0 - (i_value & 1));
+}
+
+// the XOR of two close doubles is in their sign, exponent and high mantissa bits, swapped to the low
+// bytes it makes a short varint
+static u64 byte_swap(const u64 i_value)
+{
+    u64 swapped = 0;
+    for (u32 i = 0; i < 8; i++)
+    {
+        swapped = (swapped << 8) | ((i_value >> (i * 8)) & 0xff);
+    }
+    return swapped;
+}
+
+static size get_bitmap_size(const u32 i_fieldsCount)
+{
+    return (i_fieldsCount + 7) / 8;
+}
+
+static size get_max_snapshot_size(const u32 i_fieldsCount)
+{
+    return k_maxVarintSize + get_bitmap_size(i_fieldsCount) + i_fieldsCount * k_maxVarintSize;
+}
+
+static void reset_encoder_block(delta_encoder_t* const io_encoder)
+{
+    io_encoder->block.length = 0;
+    io_encoder->snapshotsCount = 0;
+    io_encoder->previousTimestamp = 0;
+    mem_fill(io_encoder->previous, 0, io_encoder->desc.fieldsCount * sizeof(u64));
+}
+
+static void write_block(delta_encoder_t* const io_encoder, buffer_t* const io_stream)
+{
+    FLORAL_ASSERT(io_stream->capacity - io_stream->length >= delta_encoder_get_max_block_size(io_encoder));
+
+    const size rawSize = io_encoder->block.length;
+    const_voidptr payload = io_encoder->block.addr;
+    size storedSize = rawSize;
+    if (io_encoder->desc.compressed)
+    {
+        const size compressedSize = lz4_compress(io_encoder->block.addr, rawSize, io_encoder->compressed, io_encoder->hashTable);
+        if (compressedSize < rawSize)
+        {
+            payload = io_encoder->compressed;
+            storedSize = compressedSize;
+        }
+    }
+
+    const delta_block_header_t header = {
+        .rawSize = (u32)rawSize,
+        .storedSize = (u32)storedSize,
+        .snapshotsCount = io_encoder->snapshotsCount
+    };
+    buffer_write_start(*io_stream);
+    buffer_write_pod(&header, delta_block_header_t);
+    buffer_write(payload, storedSize);
+    buffer_write_end(*io_stream);
+
+    reset_encoder_block(io_encoder);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+delta_encoder_t create_delta_encoder(arena_t* const i_arena, const delta_stream_desc_t& i_desc)
+{
+    FLORAL_ASSERT(i_desc.fieldsCount > 0 && i_desc.fieldsCount <= DELTA_STREAM_MAX_FIELDS);
+    FLORAL_ASSERT_MSG(i_desc.blockSize >= get_max_snapshot_size(i_desc.fieldsCount) && i_desc.blockSize <= k_deltaStreamMaxBlockSize,
+                      "The block size cannot hold a snapshot");
+
+    delta_encoder_t encoder = {};
+    encoder.desc = i_desc;
+    encoder.previous = arena_push_podarr(i_arena, u64, i_desc.fieldsCount);
+    encoder.block = arena_create_buffer(i_arena, i_desc.blockSize);
+    if (i_desc.compressed)
+    {
+        encoder.compressed = arena_push_podarr(i_arena, u8, lz4_get_max_compressed_size(i_desc.blockSize));
+        encoder.hashTable = arena_push_podarr(i_arena, u32, LZ4_HASH_TABLE_SIZE);
+    }
+    reset_encoder_block(&encoder);
+    return encoder;
+}
+
+size delta_encoder_get_header_size(const delta_encoder_t* const i_encoder)
+{
+    size headerSize = sizeof(delta_stream_header_t);
+    for (u32 i = 0; i < i_encoder->desc.fieldsCount; i++)
+    {
+        headerSize += 2 + math_min(cstr_length(i_encoder->desc.fields[i].name), (size)DELTA_STREAM_MAX_NAME_LENGTH);
+    }
+    return headerSize;
+}
+
+size delta_encoder_get_max_block_size(const delta_encoder_t* const i_encoder)
+{
+    return sizeof(delta_block_header_t) + lz4_get_max_compressed_size(i_encoder->desc.blockSize);
+}
+
+void delta_encoder_write_header(const delta_encoder_t* const i_encoder, buffer_t* const io_stream)
+{
+    FLORAL_ASSERT(io_stream->capacity - io_stream->length >= delta_encoder_get_header_size(i_encoder));
+
+    const delta_stream_header_t header = {
+        .magic = k_deltaStreamMagic,
+        .version = k_deltaStreamVersion,
+        .fieldsCount = (u16)i_encoder->desc.fieldsCount,
+        .blockSize = i_encoder->desc.blockSize,
+        .flags = i_encoder->desc.compressed ? k_deltaStreamCompressedFlag : 0
+    };
+    buffer_write_start(*io_stream);
+    buffer_write_pod(&header, delta_stream_header_t);
+    for (u32 i = 0; i < i_encoder->desc.fieldsCount; i++)
+    {
+        const delta_field_t& field = i_encoder->desc.fields[i];
+        const u8 type = (u8)field.type;
+        const u8 nameLength = (u8)math_min(cstr_length(field.name), (size)DELTA_STREAM_MAX_NAME_LENGTH);
+        buffer_write_pod(&type, u8);
+        buffer_write_pod(&nameLength, u8);
+        buffer_write(field.name, nameLength);
+    }
+    buffer_write_end(*io_stream);
+}
+
+bool delta_encoder_push(delta_encoder_t* const io_encoder, const u64 i_timestamp, const u64* i_values, buffer_t* const io_stream)
+{
+    const u32 fieldsCount = io_encoder->desc.fieldsCount;
+    const delta_field_t* fields = io_encoder->desc.fields;
+    u64* const previous = io_encoder->previous;
+
+    buffer_write_start(io_encoder->block);
+    writer = write_varint(writer, i_timestamp - io_encoder->previousTimestamp);
+    const p8 bitmap = writer;
+    mem_fill(bitmap, 0, get_bitmap_size(fieldsCount));
+    writer += get_bitmap_size(fieldsCount);
+    for (u32 i = 0; i < fieldsCount; i++)
+    {
+        const u64 value = i_values[i];
+        if (value == previous[i])
+        {
+            continue;
+        }
+
+        bitmap[i >> 3] |= (u8)(1 << (i & 7));
+        if (fields[i].type == delta_field_type_e::float32)
+        {
+            writer = write_varint(writer, value ^ previous[i]);
+        }
+        else if (fields[i].type == delta_field_type_e::float64)
+        {
+            writer = write_varint(writer, byte_swap(value ^ previous[i]));
+        }
+        else
+        {
+            writer = write_varint(writer, zigzag_encode(value - previous[i]));
+        }
+        previous[i] = value;
+    }
+    buffer_write_end(io_encoder->block);
+    io_encoder->previousTimestamp = i_timestamp;
+    io_encoder->snapshotsCount++;
+
+    if (io_encoder->block.capacity - io_encoder->block.length < get_max_snapshot_size(fieldsCount))
+    {
+        write_block(io_encoder, io_stream);
+        return true;
+    }
+    return false;
+}
+
+bool delta_encoder_flush(delta_encoder_t* const io_encoder, buffer_t* const io_stream)
+{
+    if (io_encoder->snapshotsCount == 0)
+    {
+        return false;
+    }
+    write_block(io_encoder, io_stream);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size create_delta_decoder(arena_t* const i_arena, const_buffer_t i_stream, delta_decoder_t* o_decoder)
+{
+    if (i_stream.length < sizeof(delta_stream_header_t))
+    {
+        return 0;
+    }
+
+    delta_stream_header_t header = {};
+    size headerSize = 0;
+    buffer_read_start(i_stream);
+    buffer_read_pod(&header, delta_stream_header_t);
+    if (header.magic != k_deltaStreamMagic || header.version != k_deltaStreamVersion || header.fieldsCount == 0 ||
+        header.fieldsCount > DELTA_STREAM_MAX_FIELDS || header.blockSize > k_deltaStreamMaxBlockSize)
+    {
+        return 0;
+    }
+
+    // the whole schema is checked before anything is allocated
+    const p8 fieldsStart = reader;
+    const p8 end = (p8)i_stream.addr + i_stream.length;
+    for (u32 i = 0; i < header.fieldsCount; i++)
+    {
+        if (end - reader < 2 || reader[0] > (u8)delta_field_type_e::float64 || end - reader - 2 < reader[1])
+        {
+            return 0;
+        }
+        reader += 2 + reader[1];
+    }
+    headerSize = reader - (p8)i_stream.addr;
+
+    reader = fieldsStart;
+    o_decoder->fields = arena_push_podarr(i_arena, delta_field_t, header.fieldsCount);
+    for (u32 i = 0; i < header.fieldsCount; i++)
+    {
+        const u8 type = buffer_get(u8);
+        const u8 nameLength = buffer_get(u8);
+        c8* name = arena_push_podarr(i_arena, c8, nameLength + 1);
+        buffer_read_podarr(name, c8, nameLength);
+        name[nameLength] = 0;
+        o_decoder->fields[i] = {
+            .name = name,
+            .type = (delta_field_type_e)type
+        };
+    }
+    buffer_read_end();
+
+    o_decoder->fieldsCount = header.fieldsCount;
+    o_decoder->blockSize = header.blockSize;
+    o_decoder->previous = arena_push_podarr(i_arena, u64, header.fieldsCount);
+    o_decoder->previousTimestamp = 0;
+    o_decoder->block = arena_create_buffer(i_arena, header.blockSize);
+    o_decoder->blockCursor = 0;
+    o_decoder->snapshotsLeft = 0;
+    return headerSize;
+}
+
+size delta_decoder_load_block(delta_decoder_t* const io_decoder, const_buffer_t i_stream)
+{
+    io_decoder->snapshotsLeft = 0;
+    if (i_stream.length < sizeof(delta_block_header_t))
+    {
+        return 0;
+    }
+
+    delta_block_header_t header = {};
+    size blockSize = 0;
+    buffer_read_start(i_stream);
+    buffer_read_pod(&header, delta_block_header_t);
+    if (header.rawSize > io_decoder->blockSize || header.storedSize > header.rawSize ||
+        i_stream.length - sizeof(delta_block_header_t) < header.storedSize)
+    {
+        return 0;
+    }
+
+    const p8 payload = buffer_get_region(header.storedSize);
+    if (header.storedSize == header.rawSize)
+    {
+        mem_copy(io_decoder->block.addr, payload, header.rawSize);
+    }
+    else if (lz4_decompress(payload, header.storedSize, io_decoder->block.addr, io_decoder->block.capacity) != header.rawSize)
+    {
+        return 0;
+    }
+    blockSize = reader - (p8)i_stream.addr;
+    buffer_read_end();
+
+    io_decoder->block.length = header.rawSize;
+    io_decoder->blockCursor = 0;
+    io_decoder->snapshotsLeft = header.snapshotsCount;
+    io_decoder->previousTimestamp = 0;
+    mem_fill(io_decoder->previous, 0, io_decoder->fieldsCount * sizeof(u64));
+    return blockSize;
+}
+
+bool delta_decoder_next(delta_decoder_t* const io_decoder, u64* o_timestamp, u64* o_values)
+{
+    if (io_decoder->snapshotsLeft == 0)
+    {
+        return false;
+    }
+
+    const u32 fieldsCount = io_decoder->fieldsCount;
+    const delta_field_t* fields = io_decoder->fields;
+    u64* const previous = io_decoder->previous;
+    const size bitmapSize = get_bitmap_size(fieldsCount);
+    u64 timestampDelta = 0;
+    bool valid = true;
+
+    buffer_read_start(io_decoder->block);
+    const p8 end = reader + io_decoder->block.length;
+    reader += io_decoder->blockCursor;
+
+    valid = read_varint(&reader, end, &timestampDelta) && (size)(end - reader) >= bitmapSize;
+    const p8 bitmap = reader;
+    reader += valid ? bitmapSize : 0;
+    for (u32 i = 0; valid && i < fieldsCount; i++)
+    {
+        if ((bitmap[i >> 3] & (1 << (i & 7))) == 0)
+        {
+            continue;
+        }
+
+        u64 delta = 0;
+        valid = read_varint(&reader, end, &delta);
+        if (fields[i].type == delta_field_type_e::float32)
+        {
+            previous[i] ^= delta;
+        }
+        else if (fields[i].type == delta_field_type_e::float64)
+        {
+            previous[i] ^= byte_swap(delta);
+        }
+        else
+        {
+            previous[i] += zigzag_decode(delta);
+        }
+    }
+    io_decoder->blockCursor = reader - (p8)io_decoder->block.addr;
+    buffer_read_end();
+
+    if (!valid)
+    {
+        io_decoder->snapshotsLeft = 0;
+        return false;
+    }
+
+    io_decoder->previousTimestamp += timestampDelta;
+    io_decoder->snapshotsLeft--;
+    *o_timestamp = io_decoder->previousTimestamp;
+    mem_copy(o_values, previous, fieldsCount * sizeof(u64));
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static u32 lz4_read_u32(const u8* i_src)
+{
+    u32 value = 0;
+    mem_copy(&value, i_src, sizeof(u32));
+    return value;
+}
+
+static u32 lz4_hash(const u32 i_sequence)
+{
+    return (i_sequence * 2654435761u) >> (32 - LZ4_HASH_TABLE_BITS);
+}
+
+static p8 lz4_write_length(p8 io_writer, size i_length)
+{
+    while (i_length >= 255)
+    {
+        *io_writer++ = 255;
+        i_length -= 255;
+    }
+    *io_writer++ = (u8)i_length;
+    return io_writer;
+}
+
+static bool lz4_read_length(const u8** io_reader, const u8* i_end, size* io_length)
+{
+    u8 byte = 255;
+    while (byte == 255)
+    {
+        if (*io_reader == i_end)
+        {
+            return false;
+        }
+        byte = *(*io_reader)++;
+        *io_length += byte;
+    }
+    return true;
+}
+
+static p8 lz4_write_literals(p8 io_writer, p8 o_token, const u8* i_literals, const size i_length)
+{
+    *o_token = (u8)(math_min(i_length, (size)15) << 4);
+    if (i_length >= 15)
+    {
+        io_writer = lz4_write_length(io_writer, i_length - 15);
+    }
+    mem_copy(io_writer, i_literals, i_length);
+    return io_writer + i_length;
+}
+
+size lz4_get_max_compressed_size(const size i_srcSize)
+{
+    return i_srcSize + i_srcSize / 255 + 16;
+}
+
+size lz4_compress(const_voidptr i_src, const size i_srcSize, voidptr o_dst, u32* io_hashTable)
+{
+    const u8* src = (const u8*)i_src;
+    p8 writer = (p8)o_dst;
+    size anchor = 0;
+
+    if (i_srcSize > k_lz4MatchLimit)
+    {
+        mem_fill(io_hashTable, 0xff, LZ4_HASH_TABLE_SIZE * sizeof(u32));
+        const size matchLimit = i_srcSize - k_lz4MatchLimit;
+        const size extendLimit = i_srcSize - k_lz4LastLiterals;
+        size position = 0;
+        u32 missesCount = 0;
+        while (position < matchLimit)
+        {
+            const u32 sequence = lz4_read_u32(src + position);
+            const u32 hash = lz4_hash(sequence);
+            const size candidate = io_hashTable[hash];
+            io_hashTable[hash] = (u32)position;
+            if (candidate == k_lz4EmptySlot || position - candidate > k_lz4MaxOffset || lz4_read_u32(src + candidate) != sequence)
+            {
+                // skips faster through data which does not compress
+                position += 1 + (missesCount++ >> 6);
+                continue;
+            }
+
+            size matchLength = k_lz4MinMatch;
+            while (position + matchLength < extendLimit && src[candidate + matchLength] == src[position + matchLength])
+            {
+                matchLength++;
+            }
+
+            p8 token = writer++;
+            writer = lz4_write_literals(writer, token, src + anchor, position - anchor);
+            const size offset = position - candidate;
+            *writer++ = (u8)(offset & 0xff);
+            *writer++ = (u8)(offset >> 8);
+            const size extraLength = matchLength - k_lz4MinMatch;
+            *token |= (u8)math_min(extraLength, (size)15);
+            if (extraLength >= 15)
+            {
+                writer = lz4_write_length(writer, extraLength - 15);
+            }
+
+            position += matchLength;
+            anchor = position;
+            missesCount = 0;
+            if (position < matchLimit)
+            {
+                io_hashTable[lz4_hash(lz4_read_u32(src + position - 2))] = (u32)(position - 2);
+            }
+        }
+    }
+
+    p8 token = writer++;
+    writer = lz4_write_literals(writer, token, src + anchor, i_srcSize - anchor);
+    return writer - (p8)o_dst;
+}
+
+size lz4_decompress(const_voidptr i_src, const size i_srcSize, voidptr o_dst, const size i_dstCapacity)
+{
+    const u8* reader = (const u8*)i_src;
+    const u8* end = reader + i_srcSize;
+    const p8 dst = (p8)o_dst;
+    p8 writer = dst;
+    const p8 dstEnd = dst + i_dstCapacity;
+
+    while (reader < end)
+    {
+        const u8 token = *reader++;
+        size literalsLength = token >> 4;
+        if (literalsLength == 15 && !lz4_read_length(&reader, end, &literalsLength))
+        {
+            return 0;
+        }
+        if ((size)(end - reader) < literalsLength || (size)(dstEnd - writer) < literalsLength)
+        {
+            return 0;
+        }
+        mem_copy(writer, reader, literalsLength);
+        reader += literalsLength;
+        writer += literalsLength;
+        if (reader == end)
+        {
+            break; // the last sequence has no match
+        }
+
+        if (end - reader < 2)
+        {
+            return 0;
+        }
+        const size offset = (size)reader[0] | ((size)reader[1] << 8);
+        reader += 2;
+        size matchLength = token & 15;
+        if (matchLength == 15 && !lz4_read_length(&reader, end, &matchLength))
+        {
+            return 0;
+        }
+        matchLength += k_lz4MinMatch;
+        if (offset == 0 || offset > (size)(writer - dst) || (size)(dstEnd - writer) < matchLength)
+        {
+            return 0;
+        }
+
+        const u8* match = writer - offset;
+        if (offset >= matchLength)
+        {
+            mem_copy(writer, match, matchLength);
+            writer += matchLength;
+        }
+        else
+        {
+            // the match overlaps what it produces, it repeats the last 'offset' bytes
+            for (size i = 0; i < matchLength; i++)
+            {
+                *writer++ = match[i];
+            }
+        }
+    }
+    return writer - dst;
+}
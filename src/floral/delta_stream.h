@@ -0,0 +1,145 @@
+#pragma once
+
+#include "memory.h"
+#include "pods.h"
+#include "stdaliases.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Binary stream of snapshots of a fixed set of numeric fields
+// - the schema (names and types of the fields) is written once, at the start of the stream
+// - a snapshot only carries the fields which changed since the previous one: a bitmap of them, then
+//   zigzag varints of the integer deltas and varints of the XORed float bits (byte swapped for the
+//   doubles, whose XORs are mostly in their high bytes)
+// - snapshots are grouped in blocks, optionally compressed (LZ4 block format). The previous snapshot
+//   is reset at the start of each block, so a block decodes on its own and a reader can join a
+//   stream at any block boundary
+// - values are passed as u64 slots, see delta_stream_pack_f32() and delta_stream_pack_f64()
+
+#define DELTA_STREAM_MAX_FIELDS 1024
+#define DELTA_STREAM_MAX_NAME_LENGTH 255
+
+enum class delta_field_type_e : u8
+{
+    float32 = 0, // bits in the low 32 bits of the slot
+    unsigned64,
+    signed64,
+    float64
+};
+
+struct delta_field_t
+{
+    const_cstr name;
+    delta_field_type_e type;
+};
+
+struct delta_stream_desc_t
+{
+    const delta_field_t* fields;
+    u32 fieldsCount;
+    u32 blockSize; // raw bytes of snapshots per block, a block is emitted once it cannot take one more
+    bool compressed;
+};
+
+struct delta_stream_header_t
+{
+    u32 magic;
+    u16 version;
+    u16 fieldsCount;
+    u32 blockSize;
+    u32 flags;
+};
+
+// followed by 'storedSize' bytes, LZ4 compressed when smaller than 'rawSize'
+struct delta_block_header_t
+{
+    u32 rawSize;
+    u32 storedSize;
+    u32 snapshotsCount;
+};
+
+struct delta_encoder_t
+{
+    delta_stream_desc_t desc;
+    u64* previous;
+    u64 previousTimestamp;
+
+    buffer_t block;
+    u32 snapshotsCount;
+
+    p8 compressed;
+    u32* hashTable;
+};
+
+struct delta_decoder_t
+{
+    delta_field_t* fields;
+    u32 fieldsCount;
+    u32 blockSize;
+    u64* previous;
+    u64 previousTimestamp;
+
+    buffer_t block;
+    size blockCursor;
+    u32 snapshotsLeft;
+};
+
+inline u64 delta_stream_pack_f32(const f32 i_value)
+{
+    u32 bits = 0;
+    mem_copy(&bits, &i_value, sizeof(f32));
+    return bits;
+}
+
+inline f32 delta_stream_unpack_f32(const u64 i_slot)
+{
+    const u32 bits = (u32)i_slot;
+    f32 value = 0.0f;
+    mem_copy(&value, &bits, sizeof(f32));
+    return value;
+}
+
+inline u64 delta_stream_pack_f64(const f64 i_value)
+{
+    u64 bits = 0;
+    mem_copy(&bits, &i_value, sizeof(f64));
+    return bits;
+}
+
+inline f64 delta_stream_unpack_f64(const u64 i_slot)
+{
+    f64 value = 0.0;
+    mem_copy(&value, &i_slot, sizeof(f64));
+    return value;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+// the fields' names are not copied, they must outlive the encoder
+delta_encoder_t create_delta_encoder(arena_t* const i_arena, const delta_stream_desc_t& i_desc);
+size delta_encoder_get_header_size(const delta_encoder_t* const i_encoder);
+// what a single block takes at most in the stream, header included
+size delta_encoder_get_max_block_size(const delta_encoder_t* const i_encoder);
+void delta_encoder_write_header(const delta_encoder_t* const i_encoder, buffer_t* const io_stream);
+// io_stream must have room for a block, returns true when the snapshot filled a block which got
+// written to io_stream
+bool delta_encoder_push(delta_encoder_t* const io_encoder, const u64 i_timestamp, const u64* i_values, buffer_t* const io_stream);
+// writes the snapshots pushed since the last block, returns false when there was none
+bool delta_encoder_flush(delta_encoder_t* const io_encoder, buffer_t* const io_stream);
+
+// reads the schema at the start of i_stream, returns its size or 0 when the stream is not valid or
+// too short to hold it
+size create_delta_decoder(arena_t* const i_arena, const_buffer_t i_stream, delta_decoder_t* o_decoder);
+// loads the block at the start of i_stream, returns its size or 0 when the block is not whole or not
+// valid. The snapshots left in the previous block are dropped
+size delta_decoder_load_block(delta_decoder_t* const io_decoder, const_buffer_t i_stream);
+// next snapshot of the loaded block, false at its end (or when it is corrupted)
+bool delta_decoder_next(delta_decoder_t* const io_decoder, u64* o_timestamp, u64* o_values);
+
+// LZ4 block format, o_dst must hold lz4_get_max_compressed_size(i_srcSize) bytes. io_hashTable
+// has LZ4_HASH_TABLE_SIZE entries, its content does not need to be initialized
+#define LZ4_HASH_TABLE_BITS 12
+#define LZ4_HASH_TABLE_SIZE (1 << LZ4_HASH_TABLE_BITS)
+size lz4_get_max_compressed_size(const size i_srcSize);
+size lz4_compress(const_voidptr i_src, const size i_srcSize, voidptr o_dst, u32* io_hashTable);
+// returns the decompressed size, or 0 when the input is corrupted or does not fit i_dstCapacity
+size lz4_decompress(const_voidptr i_src, const size i_srcSize, voidptr o_dst, const size i_dstCapacity);
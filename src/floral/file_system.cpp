@@ -25,9 +25,11 @@ error_code_e platform_file_ropen(voidptr io_platformFile);
 error_code_e platform_file_wopen(voidptr io_platformFile);
 size platform_file_get_size(voidptr i_platformFile);
 void platform_file_read(voidptr i_platformFile, voidptr io_buffer, const size i_bufferSize);
-void platform_file_write(voidptr i_platformFile, const_voidptr i_buffer, const size i_bufferSize);
+void platform_file_seek(voidptr i_platformFile, const size i_offset);
+bool platform_file_write(voidptr i_platformFile, const_voidptr i_buffer, const size i_bufferSize);
 void platform_file_flush(voidptr i_platformFile);
 void platform_file_close(voidptr i_platformFile);
+bool platform_file_delete(voidptr i_platformFile);
 void platform_make_directories(const tstr& i_baseDir, const tstr& i_subDir, arena_t* const i_arena);
 void debug_platform_dump_file_group(file_group_t* i_fileGroup);
 
@@ -134,6 +136,11 @@ void file_read(const file_handle_t& i_handle, const size i_bufferSize, voidptr i
     platform_file_read(i_handle.platform, io_buffer, i_bufferSize);
 }
 
+void file_seek(const file_handle_t& i_handle, const size i_offset)
+{
+    platform_file_seek(i_handle.platform, i_offset);
+}
+
 void file_close(file_handle_t* const i_handle)
 {
     platform_file_close(i_handle->platform);
@@ -187,15 +194,15 @@ file_handle_t file_wopen(file_group_t* const i_fileGroup, const tstr& i_path)
     return { .platform = platform, .hasErrors = (errCode != error_code_e::success) };
 }
 
-void file_write_all(const file_handle_t& i_handle, const buffer_t* const i_buffer)
+bool file_write_all(const file_handle_t& i_handle, const buffer_t* const i_buffer)
 {
     // TODO: reset file
-    platform_file_write(i_handle.platform, i_buffer->addr, i_buffer->length);
+    return platform_file_write(i_handle.platform, i_buffer->addr, i_buffer->length);
 }
 
-void file_write(const file_handle_t& i_handle, const_voidptr i_buffer, const size i_bufferSize)
+bool file_write(const file_handle_t& i_handle, const_voidptr i_buffer, const size i_bufferSize)
 {
-    platform_file_write(i_handle.platform, i_buffer, i_bufferSize);
+    return platform_file_write(i_handle.platform, i_buffer, i_bufferSize);
 }
 
 void file_flush(const file_handle_t& i_handle)
@@ -218,6 +225,28 @@ bool file_exist(file_group_t* const i_fileGroup, const tstr& i_path)
     return false;
 }
 
+bool file_delete(file_group_t* const i_fileGroup, const tstr& i_path)
+{
+    dll_t<file_t>* const fileList = &i_fileGroup->fileList;
+    const u32 pathHash = tstr_crc32_hash(i_path);
+    dll_t<file_t>::node_t* it = nullptr;
+    dll_for_each(fileList, it)
+    {
+        if (it->data.pathHash == pathHash)
+        {
+            dll_remove(fileList, it);
+            i_fileGroup->fileCount--;
+            return platform_file_delete(it->data.platform);
+        }
+    }
+
+    // temporary use the area as a scratch region, the file is not added to the group
+    scratch_region_t scratch = scratch_begin(&i_fileGroup->arena);
+    const bool deleted = platform_file_delete(platform_arena_push_platform_file(scratch.arena, i_fileGroup->baseDir, i_path));
+    scratch_end(&scratch);
+    return deleted;
+}
+
 void debug_dump_file_group(file_group_t* const i_fileGroup)
 {
     debug_platform_dump_file_group(i_fileGroup);
@@ -225,4 +254,6 @@ void debug_dump_file_group(file_group_t* const i_fileGroup)
 
 #if defined(FLORAL_PLATFORM_WINDOWS)
 #  include "file_system_windows.inl"
+#elif defined(FLORAL_PLATFORM_LINUX)
+#  include "file_system_linux.inl"
 #endif
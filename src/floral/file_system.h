@@ -62,13 +62,18 @@ file_handle_t file_ropen(file_group_t* const i_fileGroup, const tstr& i_path);
 size file_get_size(const file_handle_t& i_handle);
 const_buffer_t file_read_all(const file_handle_t& i_handle, arena_t* const i_arena);
 void file_read(const file_handle_t& i_handle, const size i_bufferSize, voidptr io_buffer);
+// moves the read / write position to i_offset bytes from the beginning of the file
+void file_seek(const file_handle_t& i_handle, const size i_offset);
 void file_close(file_handle_t* const i_handle);
 
 file_handle_t file_wopen(file_group_t* const i_fileGroup, const tstr& i_path);
-void file_write_all(const file_handle_t& i_handle, const buffer_t* const i_buffer);
-void file_write(const file_handle_t& i_handle, const_voidptr i_buffer, const size i_bufferSize);
+// false unless all the bytes were written
+bool file_write_all(const file_handle_t& i_handle, const buffer_t* const i_buffer);
+bool file_write(const file_handle_t& i_handle, const_voidptr i_buffer, const size i_bufferSize);
 void file_flush(const file_handle_t& i_handle);
 
 bool file_exist(file_group_t* const i_fileGroup, const tstr& i_path);
+// the file does not have to be listed in the group, it is looked for in the group's directory
+bool file_delete(file_group_t* const i_fileGroup, const tstr& i_path);
 
 void debug_dump_file_group(file_group_t* const i_fileGroup);
@@ -0,0 +1,268 @@
+#include "log.h"
+#include "misc.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct platform_file_t
+{
+    s32 fd;
+    tstr path;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+tstr path_get_working_directory(arena_t* const i_arena)
+{
+    c8 buffer[4096];
+    if (getcwd(buffer, sizeof(buffer)) == nullptr)
+    {
+        return tstr_literal(".");
+    }
+    return tstr_duplicate(i_arena, buffer);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+voidptr platform_arena_push_platform_file(arena_t* const i_arena, const tstr& i_baseDir, const tstr& i_subPath)
+{
+    platform_file_t* platformFile = arena_push_pod(i_arena, platform_file_t);
+    platformFile->fd = -1;
+    platformFile->path = tstr_printf(i_arena, "%s/%s", i_baseDir.data, i_subPath.data);
+    return platformFile;
+}
+
+void platform_initialize_file_group(file_system_t* i_fileSystem, file_group_t* const io_fileGroup, const tstr& i_subPath)
+{
+    arena_t* const arena = &io_fileGroup->arena;
+    if (i_subPath.length > 0)
+    {
+        io_fileGroup->baseDir = tstr_printf(arena, "%s/%s", i_fileSystem->workingDirectory.data, i_subPath.data);
+    }
+    else
+    {
+        io_fileGroup->baseDir = tstr_duplicate(arena, i_fileSystem->workingDirectory);
+    }
+}
+
+static bool file_name_has_extension(const_cstr i_name, const tstr& i_ext)
+{
+    const size nameLength = strlen(i_name);
+    return nameLength > i_ext.length && i_name[nameLength - i_ext.length - 1] == '.' &&
+           strcmp(i_name + nameLength - i_ext.length, i_ext.data) == 0;
+}
+
+size platform_find_all_files_internal(file_system_t* const i_fileSystem, const tstr& i_subPath, const tstr& i_ext, const tstr& i_remap, dll_t<file_t>* o_fileList, arena_t* const i_arena)
+{
+    size fileCount = 0;
+    scratch_region_t scratch = scratch_begin(&i_fileSystem->arena);
+    tstr absPath = tstr_printf(scratch.arena, "%s/%s", i_fileSystem->workingDirectory.data, i_subPath.data);
+    DIR* dir = opendir(absPath.data);
+    if (dir == nullptr)
+    {
+        scratch_end(&scratch);
+        return 0;
+    }
+
+    // d_type is DT_UNKNOWN on some file systems, stat() tells then
+    struct dirent* entry = nullptr;
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+        {
+            continue;
+        }
+        bool isDirectory = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN)
+        {
+            struct stat entryStat;
+            tstr entryPath = tstr_printf(scratch.arena, "%s/%s", absPath.data, entry->d_name);
+            isDirectory = stat(entryPath.data, &entryStat) == 0 && S_ISDIR(entryStat.st_mode);
+        }
+
+        tstr fileName = tstr_literal(entry->d_name);
+        if (isDirectory)
+        {
+            tstr subPath = path_join(scratch.arena, i_subPath, fileName);
+            tstr remapPath = path_join(scratch.arena, i_remap, fileName);
+            fileCount += platform_find_all_files_internal(i_fileSystem, subPath, i_ext, remapPath, o_fileList, i_arena);
+        }
+        else if (file_name_has_extension(entry->d_name, i_ext))
+        {
+            dll_t<file_t>::node_t* fileNode = arena_push_pod(i_arena, dll_t<file_t>::node_t);
+            tstr remapPath;
+            if (i_remap.length > 0)
+            {
+                remapPath = tstr_printf(i_arena, "%s/%s", i_remap.data, entry->d_name);
+            }
+            else
+            {
+                remapPath = tstr_duplicate(i_arena, entry->d_name);
+            }
+
+            tstr platformPath = path_join(scratch.arena, i_subPath, fileName);
+            fileNode->data.path = remapPath;
+            fileNode->data.pathHash = tstr_crc32_hash(remapPath);
+            fileNode->data.platform = platform_arena_push_platform_file(i_arena, i_fileSystem->workingDirectory, platformPath);
+
+            dll_push_back(o_fileList, fileNode);
+            fileCount++;
+        }
+    }
+    closedir(dir);
+
+    scratch_end(&scratch);
+    return fileCount;
+}
+
+void platform_find_all_files(file_system_t* i_fileSystem, file_group_t* const io_fileGroup, const tstr& i_subPath, const tstr& i_ext, const tstr& i_remap)
+{
+    platform_initialize_file_group(i_fileSystem, io_fileGroup, i_subPath);
+    io_fileGroup->fileCount = platform_find_all_files_internal(i_fileSystem, i_subPath, i_ext, i_remap, &io_fileGroup->fileList, &io_fileGroup->arena);
+}
+
+error_code_e platform_file_ropen(voidptr io_platformFile)
+{
+    platform_file_t* const pf = (platform_file_t*)io_platformFile;
+    pf->fd = open(pf->path.data, O_RDONLY | O_CLOEXEC);
+    if (pf->fd < 0)
+    {
+        return error_code_e::failed_to_open_file;
+    }
+    return error_code_e::success;
+}
+
+error_code_e platform_file_wopen(voidptr io_platformFile)
+{
+    platform_file_t* const pf = (platform_file_t*)io_platformFile;
+    pf->fd = open(pf->path.data, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (pf->fd < 0)
+    {
+        return error_code_e::failed_to_open_file;
+    }
+    return error_code_e::success;
+}
+
+size platform_file_get_size(voidptr i_platformFile)
+{
+    platform_file_t* const pf = (platform_file_t*)i_platformFile;
+    struct stat fileStat;
+    if (fstat(pf->fd, &fileStat) != 0)
+    {
+        return 0;
+    }
+    return (size)fileStat.st_size;
+}
+
+// read() and write() may stop short of the requested size, or be interrupted by a signal
+void platform_file_read(voidptr i_platformFile, voidptr io_buffer, const size i_bufferSize)
+{
+    platform_file_t* const pf = (platform_file_t*)i_platformFile;
+    size bytesRead = 0;
+    while (bytesRead < i_bufferSize)
+    {
+        const ssize result = read(pf->fd, (p8)io_buffer + bytesRead, i_bufferSize - bytesRead);
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (result <= 0)
+        {
+            break;
+        }
+        bytesRead += (size)result;
+    }
+    FLORAL_ASSERT(bytesRead == i_bufferSize);
+}
+
+void platform_file_seek(voidptr i_platformFile, const size i_offset)
+{
+    platform_file_t* const pf = (platform_file_t*)i_platformFile;
+    const off_t position = lseek(pf->fd, (off_t)i_offset, SEEK_SET);
+    FLORAL_ASSERT(position == (off_t)i_offset);
+}
+
+bool platform_file_write(voidptr i_platformFile, const_voidptr i_buffer, const size i_bufferSize)
+{
+    platform_file_t* const pf = (platform_file_t*)i_platformFile;
+    size byteWritten = 0;
+    while (byteWritten < i_bufferSize)
+    {
+        const ssize result = write(pf->fd, (const u8*)i_buffer + byteWritten, i_bufferSize - byteWritten);
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (result <= 0)
+        {
+            return false;
+        }
+        byteWritten += (size)result;
+    }
+    return true;
+}
+
+void platform_file_flush(voidptr i_platformFile)
+{
+    platform_file_t* const pf = (platform_file_t*)i_platformFile;
+    fsync(pf->fd);
+}
+
+void platform_file_close(voidptr i_platformFile)
+{
+    platform_file_t* const pf = (platform_file_t*)i_platformFile;
+    const s32 result = close(pf->fd);
+    pf->fd = -1;
+    FLORAL_ASSERT(result == 0);
+}
+
+bool platform_file_delete(voidptr i_platformFile)
+{
+    platform_file_t* const pf = (platform_file_t*)i_platformFile;
+    return unlink(pf->path.data) == 0;
+}
+
+void platform_make_directories(const tstr& i_baseDir, const tstr& i_subDir, arena_t* const i_arena)
+{
+    scratch_region_t scratch = scratch_begin(i_arena);
+    tstr absDir = i_subDir.length > 0 ? tstr_printf(scratch.arena, "%s/%s", i_baseDir.data, i_subDir.data)
+                                      : tstr_duplicate(scratch.arena, i_baseDir);
+    // the root's '/' is skipped, the parents are made one after the other in the scratch copy
+    c8* const path = (c8*)absDir.data;
+    for (size i = 1; i < absDir.length; i++)
+    {
+        if (path[i] == '/')
+        {
+            path[i] = 0;
+            const s32 result = mkdir(path, 0755);
+            path[i] = '/';
+            if (result != 0 && errno != EEXIST)
+            {
+                break;
+            }
+        }
+    }
+    mkdir(path, 0755);
+    scratch_end(&scratch);
+}
+
+void debug_platform_dump_file_group(file_group_t* i_fileGroup)
+{
+    dll_t<file_t>::node_t* it = nullptr;
+    LOG_DEBUG("Base directory: %s", i_fileGroup->baseDir.data);
+    LOG_DEBUG("File count: %zd", i_fileGroup->fileCount);
+    size idx = 1;
+    dll_for_each(&i_fileGroup->fileList, it)
+    {
+        const platform_file_t* const platform = (const platform_file_t*)it->data.platform;
+        LOG_DEBUG("#%d: %s", idx, it->data.path.data);
+        LOG_DEBUG("=> %s", platform->path.data);
+        idx++;
+    }
+}
@@ -155,7 +155,8 @@ void platform_find_all_files(file_system_t* i_fileSystem, file_group_t* const io
 error_code_e platform_file_ropen(voidptr io_platformFile)
 {
     platform_file_t* const pf = (platform_file_t*)io_platformFile;
-    pf->handle = CreateFile(pf->path.data, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, NULL, NULL);
+    // files still being written by another handle (appended logs, archives) can be read as well
+    pf->handle = CreateFile(pf->path.data, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, NULL, NULL);
     if (pf->handle == INVALID_HANDLE_VALUE)
     {
         FLORAL_ASSERT(false);
@@ -167,7 +168,7 @@ error_code_e platform_file_ropen(voidptr io_platformFile)
 error_code_e platform_file_wopen(voidptr io_platformFile)
 {
     platform_file_t* const pf = (platform_file_t*)io_platformFile;
-    pf->handle = CreateFile(pf->path.data, GENERIC_WRITE, FILE_SHARE_WRITE || FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    pf->handle = CreateFile(pf->path.data, GENERIC_WRITE, FILE_SHARE_WRITE | FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
     if (pf->handle == INVALID_HANDLE_VALUE)
     {
         return error_code_e::failed_to_open_file;
@@ -191,11 +192,21 @@ void platform_file_read(voidptr i_platformFile, voidptr io_buffer, const size i_
     FLORAL_ASSERT(status == TRUE);
 }
 
-void platform_file_write(voidptr i_platformFile, const_voidptr i_buffer, const size i_bufferSize)
+void platform_file_seek(voidptr i_platformFile, const size i_offset)
+{
+    platform_file_t* const pf = (platform_file_t*)i_platformFile;
+    LARGE_INTEGER distance;
+    distance.QuadPart = (LONGLONG)i_offset;
+    BOOL status = SetFilePointerEx(pf->handle, distance, NULL, FILE_BEGIN);
+    FLORAL_ASSERT(status == TRUE);
+}
+
+bool platform_file_write(voidptr i_platformFile, const_voidptr i_buffer, const size i_bufferSize)
 {
     platform_file_t* const pf = (platform_file_t*)i_platformFile;
     DWORD byteWritten = 0;
-    WriteFile(pf->handle, i_buffer, (DWORD)i_bufferSize, &byteWritten, NULL);
+    const BOOL succeeded = WriteFile(pf->handle, i_buffer, (DWORD)i_bufferSize, &byteWritten, NULL);
+    return succeeded && byteWritten == i_bufferSize;
 }
 
 void platform_file_flush(voidptr i_platformFile)
@@ -212,6 +223,12 @@ void platform_file_close(voidptr i_platformFile)
     FLORAL_ASSERT(success);
 }
 
+bool platform_file_delete(voidptr i_platformFile)
+{
+    platform_file_t* const pf = (platform_file_t*)i_platformFile;
+    return DeleteFile(pf->path.data) != FALSE;
+}
+
 void platform_make_directories(const tstr& i_baseDir, const tstr& i_subDir, arena_t* const i_arena)
 {
     scratch_region_t scratch = scratch_begin(i_arena);
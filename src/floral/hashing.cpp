@@ -3,6 +3,8 @@
 #include "assert.h"
 #include "string_utils.h"
 
+#include <string.h>
+
 u32 compute_crc32(const_cstr i_value)
 {
     static constexpr s32 k_CRCWidth = 32;
@@ -70,11 +70,11 @@ void initialize_job_director(job_director_t* const io_jd, const job_director_des
 
     p8 memory = (p8)i_memory;
     auto* const queue = &io_jd->queue;
-    circular_queue_initialize<job_t>(queue, memory, i_desc.maxInflightJobs * sizeof(job_t));
+    circular_queue_initialize<job_t>(queue, memory, i_desc.maxInflightJobs);
 
     memory += i_desc.maxInflightJobs * sizeof(job_t);
     io_jd->chpMtx = create_mutex();
-    io_jd->counterHandlesPool = create_handle_pool<ssize>(memory, i_desc.maxInflightJobs * sizeof(ssize) * 2);
+    io_jd->counterHandlesPool = create_handle_pool<ssize>(memory, i_desc.maxInflightJobs);
 
     memory += i_desc.maxInflightJobs * sizeof(ssize) * 2;
     array_initialize(&io_jd->countersPool, (ssize)i_desc.maxInflightJobs, (voidptr)memory);
@@ -90,7 +90,10 @@ void initialize_job_director(job_director_t* const io_jd, const job_director_des
 
             thread_desc_t desc = {
                 .data = &currentWorker,
-                .func = &worker_func
+                .func = &worker_func,
+                .affinityMask = i_desc.workerAffinityMask,
+                .priority = i_desc.workerPriority,
+                .name = "floral_worker"
             };
 
             initialize_thread(&currentWorker.thread, desc);
@@ -171,3 +174,21 @@ void wait_job(job_director_t* const i_jd, const job_ops_t& i_ops)
         handle_pool_free(counterHandlesPool, i_ops.counterHandle);
     }
 }
+
+bool poll_job(job_director_t* const i_jd, const job_ops_t& i_ops)
+{
+    auto* const countersPool = &i_jd->countersPool;
+    auto* const counterHandlesPool = &i_jd->counterHandlesPool;
+
+    ATOMIC_TYPE(u32)* counter = &(*countersPool)[i_ops.counterHandle];
+    if (interlocked_compare_exchange(counter, 0, 0))
+    {
+        return false;
+    }
+
+    {
+        lock_guard_t guard(&i_jd->chpMtx);
+        handle_pool_free(counterHandlesPool, i_ops.counterHandle);
+    }
+    return true;
+}
@@ -15,6 +15,8 @@ struct job_director_desc_t
 
     u32 workersCount;
     size workerMemorySize;
+    u64 workerAffinityMask; // 0 = workers can run on any cpu
+    thread_priority_e workerPriority;
     void (*workerPrologue)(const u32 i_workerIndex);
     void (*workerEpilogue)(const u32 i_workerIndex);
 };
@@ -68,3 +70,6 @@ void destroy_job_director(job_director_t* const io_jd);
 job_ops_t queue_job(job_director_t* const i_jd, const job_desc_t& i_jobDesc, const u32 i_count = 1);
 error_code_e dispatch_job(job_director_t* const i_jd, const job_desc_t& i_jobDesc);
 void wait_job(job_director_t* const i_jd, const job_ops_t& i_ops);
+// non-blocking version of wait_job(), returns true and releases the job's counter once all of its
+// instances finished. Must not be called again on the same job_ops_t after it returned true.
+bool poll_job(job_director_t* const i_jd, const job_ops_t& i_ops);
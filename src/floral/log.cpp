@@ -339,7 +339,10 @@ void windows_logger_log_message_cstr(voidptr i_ctx, log_level_e i_logLevel, cons
         cstr_snprintf(buffer, bufferCapacity, "%s\r\n", i_msg);
 
         lock_guard_t guard(&logger->mutex);
+#if defined(FLORAL_PLATFORM_WINDOWS)
         OutputDebugStringA(buffer);
+#else
+#endif
         scratch_end(&scratch);
     }
 }
@@ -356,7 +359,10 @@ void windows_logger_log_message_wcstr(voidptr i_ctx, log_level_e i_logLevel, con
         wcstr_snprintf(buffer, bufferCapacity, L"%s\r\n", i_msg);
 
         lock_guard_t guard(&logger->mutex);
+#if defined(FLORAL_PLATFORM_WINDOWS)
         OutputDebugStringW(buffer);
+#else
+#endif
         scratch_end(&scratch);
     }
 }
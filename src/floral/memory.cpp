@@ -3,6 +3,8 @@
 #include "assert.h"
 #include "misc.h"
 
+#include <string.h>
+
 #if defined(FLORAL_PLATFORM_WINDOWS)
 #  include <Windows.h>
 #elif defined(FLORAL_PLATFORM_LINUX)
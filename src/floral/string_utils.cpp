@@ -5,7 +5,9 @@
 #include "misc.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <wchar.h>
 
 // ----------------------------------------------------------------------------
 
@@ -35,7 +37,13 @@ s32 cstr_compare(const_cstr i_a, const_cstr i_b)
 void cstr_concat(cstr o_dest, const size i_destSize, const_cstr i_src)
 {
     // TODO
+#if defined(FLORAL_PLATFORM_WINDOWS)
     strcat_s(o_dest, i_destSize, i_src);
+#else
+    const size destLength = strlen(o_dest);
+    FLORAL_ASSERT(destLength < i_destSize);
+    strncat(o_dest, i_src, i_destSize - destLength - 1);
+#endif
 }
 
 s32 cstr_snprintf(cstr o_buffer, const size i_bufferLength, const_cstr i_fmt, ...)
@@ -98,7 +106,13 @@ s32 wcstr_compare(const_wcstr i_a, const_wcstr i_b)
 void wcstr_concat(wcstr o_dest, const size i_destSize, const_wcstr i_src)
 {
     // TODO
+#if defined(FLORAL_PLATFORM_WINDOWS)
     wcscat_s(o_dest, i_destSize, i_src);
+#else
+    const size destLength = wcslen(o_dest);
+    FLORAL_ASSERT(destLength < i_destSize);
+    wcsncat(o_dest, i_src, i_destSize - destLength - 1);
+#endif
 }
 
 s32 wcstr_snprintf(wcstr o_buffer, const size i_bufferLength, const_wcstr i_fmt, ...)
@@ -116,22 +130,46 @@ s32 wcstr_vsnprintf(wcstr o_buffer, const size i_bufferLength, const_wcstr i_for
     return vswprintf(o_buffer, i_bufferLength, i_format, i_args);
 }
 
+size to_cstr(const_cstr i_input, cstr o_buffer, const size i_bufferLength)
+{
+    // a tstr is already one where tchar is c8
+    cstr_xcopy(o_buffer, i_bufferLength, i_input);
+    return cstr_length(o_buffer);
+}
+
 size to_cstr(const_wcstr i_input, cstr o_buffer, const size i_bufferLength)
 {
+#if defined(FLORAL_PLATFORM_WINDOWS)
     size characterWritten = 0;
     ssize errCode = 0;
     errCode = wcstombs_s(&characterWritten, o_buffer, i_bufferLength, i_input, i_bufferLength - 1);
     FLORAL_ASSERT(errCode >= 0);
     return characterWritten - 1;
+#else
+    // no terminator is written when the output is cut, (size)-1 on a character with no encoding
+    size characterWritten = wcstombs(o_buffer, i_input, i_bufferLength - 1);
+    FLORAL_ASSERT(characterWritten != (size)-1);
+    characterWritten = characterWritten == (size)-1 ? 0 : characterWritten;
+    o_buffer[characterWritten] = 0;
+    return characterWritten;
+#endif
 }
 
 size to_wcstr(const_cstr i_input, wcstr o_buffer, const size i_bufferLength)
 {
+#if defined(FLORAL_PLATFORM_WINDOWS)
     size characterWritten = 0;
     ssize errCode = 0;
     errCode = mbstowcs_s(&characterWritten, o_buffer, i_bufferLength, i_input, i_bufferLength - 1);
     FLORAL_ASSERT(errCode >= 0);
     return characterWritten - 1;
+#else
+    size characterWritten = mbstowcs(o_buffer, i_input, i_bufferLength - 1);
+    FLORAL_ASSERT(characterWritten != (size)-1);
+    characterWritten = characterWritten == (size)-1 ? 0 : characterWritten;
+    o_buffer[characterWritten] = 0;
+    return characterWritten;
+#endif
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -2,6 +2,7 @@
 
 #include "assert.h"
 #include "log.h"
+#include "time.h"
 
 #if defined(FLORAL_PLATFORM_WINDOWS)
 #  include <Windows.h>
@@ -58,5 +59,7 @@ void si_dump()
     LOG_DEBUG("- Layer 1 Data cache size: %zd bytes", s_platformInfo.l1CacheSize);
     LOG_DEBUG("- Layer 1 Data cache line size: %zd bytes", s_platformInfo.l1CacheLineSize);
     LOG_DEBUG("- Layer 1 Data cache associativity: %zd", s_platformInfo.l1Associativity);
+    LOG_DEBUG("- Tick clock: %s @ %.3f MHz", time_is_tsc_clock() ? "invariant TSC" : "OS counter",
+              (f64)time_get_ticks_frequency() / 1000000.0);
 }
 
@@ -0,0 +1,188 @@
+// the aggregators' statistics against a brute force over the same samples: the min / max of the
+// sliding window, monotonic series with more samples per window than the deques hold included,
+// the sketch's quantiles and the moving average
+
+#include "testing.h"
+
+#include "../../aggregator_stats.cpp"
+
+#include "../rng.h"
+
+#include <stdlib.h>
+
+static constexpr u32 k_samplesCount = 8000;
+
+static arena_t s_arena;
+static AGGAggregator s_aggregator;
+static u64 s_timestamps[k_samplesCount];
+static f64 s_values[k_samplesCount];
+
+enum class SeriesShape : u8
+{
+    Random,
+    Increasing,
+    Decreasing,
+    Plateaus
+};
+
+static void GenerateSamples(rng_context_t* io_rng, const SeriesShape i_shape, const u32 i_maxIntervalMs)
+{
+    u64 timestampMs = 1700000000000ull;
+    f64 value = 50.0;
+    for (u32 i = 0; i < k_samplesCount; i++)
+    {
+        timestampMs += 1 + rng_get_u32(io_rng, i_maxIntervalMs);
+        switch (i_shape)
+        {
+        case SeriesShape::Random:
+            value = rng_get_f64(io_rng) * 100.0;
+            break;
+        case SeriesShape::Increasing:
+            value += rng_get_f64(io_rng);
+            break;
+        case SeriesShape::Decreasing:
+            value -= rng_get_f64(io_rng);
+            break;
+        case SeriesShape::Plateaus:
+            value = rng_get_u32(io_rng, 50) == 0 ? rng_get_f64(io_rng) * 100.0 : value;
+            break;
+        }
+        s_timestamps[i] = timestampMs;
+        s_values[i] = value;
+    }
+}
+
+// over the samples up to i_last which are younger than i_windowMs
+static void GetWindowMinMax(const u32 i_last, const u64 i_windowMs, f64* o_min, f64* o_max)
+{
+    *o_min = s_values[i_last];
+    *o_max = s_values[i_last];
+    for (u32 i = i_last; i-- > 0 && s_timestamps[i] + i_windowMs > s_timestamps[i_last];)
+    {
+        *o_min = math_min(*o_min, s_values[i]);
+        *o_max = math_max(*o_max, s_values[i]);
+    }
+}
+
+static s32 CompareValues(const void* i_a, const void* i_b)
+{
+    const f64 a = *(const f64*)i_a;
+    const f64 b = *(const f64*)i_b;
+    return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+// ----------------------------------------------------------------------------
+
+static void TestMinMax()
+{
+    static const SeriesShape k_shapes[] = { SeriesShape::Random, SeriesShape::Increasing, SeriesShape::Decreasing, SeriesShape::Plateaus };
+    static const u64 k_windowsMs[] = { 50, 511, 2000, 30000 };
+    rng_context_t rng = create_rng(17);
+    for (const SeriesShape shape : k_shapes)
+    {
+        GenerateSamples(&rng, shape, 10);
+        for (const u64 windowMs : k_windowsMs)
+        {
+            // a candidate may outlive the window by a bucket, the windows up to 511 ms are exact
+            const u64 bucketMs = GetDequeBucketMs(windowMs);
+            AGGStatsReset(&s_aggregator, 0, 1000.0, windowMs);
+            u32 wrongCount = 0;
+            u32 overflowsCount = 0;
+            for (u32 i = 0; i < k_samplesCount; i++)
+            {
+                AGGStatsAdd(&s_aggregator, s_timestamps[i], s_values[i]);
+                AGGResult result;
+                AGGStatsGetResult(s_aggregator, &result);
+
+                f64 minValue = 0.0;
+                f64 maxValue = 0.0;
+                f64 laggingMin = 0.0;
+                f64 laggingMax = 0.0;
+                GetWindowMinMax(i, windowMs, &minValue, &maxValue);
+                GetWindowMinMax(i, windowMs + bucketMs - 1, &laggingMin, &laggingMax);
+                const bool right = result.minValue <= minValue && result.minValue >= laggingMin && result.maxValue >= maxValue &&
+                                   result.maxValue <= laggingMax;
+                wrongCount += right ? 0 : 1;
+                overflowsCount += s_aggregator.minDeque.count > k_aggregatorDequeCapacity || s_aggregator.maxDeque.count > k_aggregatorDequeCapacity;
+            }
+            TEST_CHECK(wrongCount == 0);
+            TEST_CHECK(overflowsCount == 0);
+            TEST_CHECK(s_aggregator.samplesCount == k_samplesCount);
+        }
+    }
+}
+
+// a single epoch, the sketch sees every sample and is within its relative accuracy of the exact
+// quantiles, negatives and zeros included
+static void TestQuantiles()
+{
+    rng_context_t rng = create_rng(23);
+    AGGStatsReset(&s_aggregator, 0, 1000.0, 1ull << 40);
+    for (u32 i = 0; i < k_samplesCount; i++)
+    {
+        const u32 kind = rng_get_u32(&rng, 10);
+        const f64 magnitude = exp(rng_get_f64(&rng) * 15.0 - 5.0);
+        s_values[i] = kind == 0 ? 0.0 : (kind < 3 ? -magnitude : magnitude);
+        AGGStatsAdd(&s_aggregator, 1000ull * (i + 1), s_values[i]);
+    }
+    qsort(s_values, k_samplesCount, sizeof(f64), &CompareValues);
+
+    static const f64 k_quantiles[] = { 0.0, 0.01, 0.1, 0.25, 0.5, 0.9, 0.95, 0.99, 1.0 };
+    for (const f64 quantile : k_quantiles)
+    {
+        f64 value = 0.0;
+        TEST_CHECK(AGGStatsGetQuantile(s_aggregator, quantile, &value));
+        const f64 expected = s_values[(u32)(quantile * (k_samplesCount - 1))];
+        TEST_CHECK_NEAR(value, expected, fabs(expected) * k_sketchRelativeAccuracy * 1.001);
+    }
+}
+
+// the sketches are between 1 and 2 windows, what came before is forgotten
+static void TestQuantilesEpochs()
+{
+    AGGStatsReset(&s_aggregator, 0, 1000.0, 10000);
+    for (u32 i = 0; i < 100; i++)
+    {
+        AGGStatsAdd(&s_aggregator, 1000ull * i, 1000.0);
+    }
+    for (u32 i = 100; i < 130; i++)
+    {
+        AGGStatsAdd(&s_aggregator, 1000ull * i, 1.0);
+    }
+    f64 value = 0.0;
+    TEST_CHECK(AGGStatsGetQuantile(s_aggregator, 1.0, &value));
+    TEST_CHECK_NEAR(value, 1.0, k_sketchRelativeAccuracy * 1.001);
+}
+
+// the weight of the past halves every half-life, whatever the sampling interval is
+static void TestAverage()
+{
+    AGGStatsReset(&s_aggregator, 0, 1000.0, 10000);
+    AGGResult result;
+    TEST_CHECK(!AGGStatsGetResult(s_aggregator, &result));
+    AGGStatsAdd(&s_aggregator, 5000, 0.0);
+    AGGStatsAdd(&s_aggregator, 6000, 1.0);
+    TEST_CHECK(AGGStatsGetResult(s_aggregator, &result));
+    TEST_CHECK_NEAR(result.average, 0.5, 1e-12);
+    for (u32 i = 1; i <= 4; i++)
+    {
+        AGGStatsAdd(&s_aggregator, 6000 + 250 * i, 1.0);
+    }
+    AGGStatsGetResult(s_aggregator, &result);
+    TEST_CHECK_NEAR(result.average, 0.75, 1e-12);
+    TEST_CHECK(result.samplesCount == 6);
+}
+
+int main()
+{
+    linear_allocator_t* allocator = test_initialize(SIZE_MB(4));
+    s_arena = create_arena(allocator, SIZE_KB(64) + AGGStatsGetMemorySize());
+    AGGStatsAllocate(&s_aggregator, &s_arena);
+
+    TEST_RUN(TestMinMax);
+    TEST_RUN(TestQuantiles);
+    TEST_RUN(TestQuantilesEpochs);
+    TEST_RUN(TestAverage);
+
+    return test_report();
+}
@@ -0,0 +1,130 @@
+// encode and decode throughput of the archive's block codec, for the shapes of series the widget
+// archives, into 1 KB blocks. The best of several runs is kept, a single one is noisy on a busy
+// machine. Prints the timings, returns 0.
+
+#include "testing.h"
+
+#include "../../archive_codec.cpp"
+
+#include "../misc.h"
+#include "../rng.h"
+#include "../time.h"
+
+static constexpr u32 k_samplesCount = 100000;
+static constexpr u32 k_runsCount = 50;
+
+static arena_t s_arena;
+
+enum class SeriesShape : u8
+{
+    Steady,  // regular interval, constant value: most of the gauges most of the time
+    Walk,    // regular interval, f32 random walk: the loads and temperatures
+    Counter, // jittered interval, growing integers: the bytes and packets counters
+    Random,  // jittered interval, any bits: the worst case
+    Count
+};
+
+static const_cstr k_shapeNames[] = { "steady", "f32 walk", "counter", "random" };
+
+static void GenerateSamples(const SeriesShape i_shape, u64* o_timestamps, f64* o_values)
+{
+    rng_context_t rng = create_rng(7);
+    u64 timestampMs = 1700000000000ull;
+    f64 value = 50.0;
+    for (u32 i = 0; i < k_samplesCount; i++)
+    {
+        switch (i_shape)
+        {
+        case SeriesShape::Steady:
+            timestampMs += 1000;
+            break;
+        case SeriesShape::Walk:
+            timestampMs += 1000;
+            value = (f32)(value + rng_get_f64(&rng) - 0.5);
+            break;
+        case SeriesShape::Counter:
+            timestampMs += 990 + rng_get_u32(&rng, 21);
+            value += rng_get_u32(&rng, 1 << 20);
+            break;
+        case SeriesShape::Random:
+        {
+            timestampMs += 990 + rng_get_u32(&rng, 21);
+            const u64 bits = ((u64)rng_get_u32(&rng) << 32) | rng_get_u32(&rng);
+            memcpy(&value, &bits, sizeof(value));
+            break;
+        }
+        default:
+            break;
+        }
+        o_timestamps[i] = timestampMs;
+        o_values[i] = value;
+    }
+}
+
+// the samples as ARCAppend() writes them, a new block whenever one is full
+static u32 EncodeSamples(const u64* i_timestamps, const f64* i_values, u8* o_blocks)
+{
+    ARCEncoder encoder = {};
+    u32 blocksCount = 0;
+    ARCBeginBlock(&encoder, o_blocks, 0, i_timestamps[0], i_values[0]);
+    for (u32 i = 1; i < k_samplesCount; i++)
+    {
+        if (!ARCEncodeSample(&encoder, i_timestamps[i], i_values[i]))
+        {
+            ARCEndBlock(&encoder);
+            blocksCount++;
+            ARCBeginBlock(&encoder, o_blocks + (size)blocksCount * k_archiveBlockSize, 0, i_timestamps[i], i_values[i]);
+        }
+    }
+    ARCEndBlock(&encoder);
+    return blocksCount + 1;
+}
+
+static void BenchmarkShape(const SeriesShape i_shape)
+{
+    scratch_region_t scratch = scratch_begin(&s_arena);
+    u64* timestamps = arena_push_podarr(scratch.arena, u64, k_samplesCount);
+    f64* values = arena_push_podarr(scratch.arena, f64, k_samplesCount);
+    u64* decodedTimestamps = arena_push_podarr(scratch.arena, u64, k_maxArchiveBlockSamples);
+    f64* decodedValues = arena_push_podarr(scratch.arena, f64, k_maxArchiveBlockSamples);
+    // at worst a sample per 114 bits
+    const u32 maxBlocksCount = k_samplesCount / ((k_archiveBlockSize - sizeof(ARCBlockHeader)) * 8 / 114) + 1;
+    u8* blocks = arena_push_podarr_aligned(scratch.arena, u8, (size)maxBlocksCount * k_archiveBlockSize, 8);
+    GenerateSamples(i_shape, timestamps, values);
+
+    f64 encodeMs = 1e30;
+    f64 decodeMs = 1e30;
+    u32 blocksCount = 0;
+    u32 decodedCount = 0;
+    for (u32 run = 0; run < k_runsCount; run++)
+    {
+        const u64 encodeStart = time_get_ticks();
+        blocksCount = EncodeSamples(timestamps, values, blocks);
+        encodeMs = math_min(encodeMs, time_ticks_to_ms(time_get_ticks_serialized() - encodeStart));
+
+        decodedCount = 0;
+        const u64 decodeStart = time_get_ticks();
+        for (u32 i = 0; i < blocksCount; i++)
+        {
+            decodedCount += ARCDecodeBlock(blocks + (size)i * k_archiveBlockSize, decodedTimestamps, decodedValues, k_maxArchiveBlockSamples);
+        }
+        decodeMs = math_min(decodeMs, time_ticks_to_ms(time_get_ticks_serialized() - decodeStart));
+    }
+
+    printf("%-8s: %5.2f bytes per sample, encode %6.1f M samples/s (%5.1f ns per sample), decode %6.1f M samples/s%s\n",
+           k_shapeNames[(u32)i_shape], (f64)blocksCount * k_archiveBlockSize / k_samplesCount, k_samplesCount / (encodeMs * 1000.0),
+           encodeMs * 1e6 / k_samplesCount, k_samplesCount / (decodeMs * 1000.0), decodedCount == k_samplesCount ? "" : ", DECODING FAILED");
+    scratch_end(&scratch);
+}
+
+int main()
+{
+    linear_allocator_t* allocator = test_initialize(SIZE_MB(32));
+    s_arena = create_arena(allocator, SIZE_MB(24));
+
+    for (u32 i = 0; i < (u32)SeriesShape::Count; i++)
+    {
+        BenchmarkShape((SeriesShape)i);
+    }
+    return 0;
+}
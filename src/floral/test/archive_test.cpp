@@ -0,0 +1,348 @@
+// the archive's blocks and segments: samples of several shapes read back bit for bit from full
+// blocks, segments written then scanned back, and segments as a crash or a bad disk leaves them,
+// whose torn or corrupted blocks are dropped and counted while the others are still found. The
+// segments are written to the working directory and deleted afterwards.
+
+#include "testing.h"
+
+#include "../../archive_codec.cpp"
+#include "../../archive_segment.cpp"
+
+#include "../file_system.h"
+#include "../rng.h"
+
+#include <math.h>
+
+static constexpr u32 k_blocksCount = 40; // more than a scan batch
+static constexpr u64 k_startMs = 1700000000000ull;
+
+static const_cstr k_seriesNames[] = { "cpu.load", "memory.physicalLoad", "network.ingress" };
+
+static file_system_t s_fileSystem;
+static file_group_t s_fileGroup;
+static arena_t s_arena;
+
+alignas(8) static u8 s_blocks[k_blocksCount][k_archiveBlockSize];
+static u64 s_timestamps[k_maxArchiveBlockSamples];
+static f64 s_values[k_maxArchiveBlockSamples];
+static u64 s_decodedTimestamps[k_maxArchiveBlockSamples];
+static f64 s_decodedValues[k_maxArchiveBlockSamples];
+
+enum class SeriesShape : u8
+{
+    Steady,    // regular interval, constant value
+    Counter,   // jittered interval, growing integers
+    Walk,      // regular interval, f32 random walk
+    Random,    // any interval up to a second, any bits, NaNs and infinities included
+    Irregular, // bursts and gaps of hours, values repeating in steps
+    Count
+};
+
+static f64 RandomBits(rng_context_t* io_rng)
+{
+    const u64 bits = ((u64)rng_get_u32(io_rng) << 32) | rng_get_u32(io_rng);
+    f64 value = 0.0;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// fills the block until it is full, the samples written are kept in s_timestamps / s_values
+static u32 EncodeBlock(rng_context_t* io_rng, const SeriesShape i_shape, const u16 i_series, u8* o_block)
+{
+    u64 timestampMs = k_startMs + rng_get_u32(io_rng, 100000);
+    f64 value = i_shape == SeriesShape::Random ? RandomBits(io_rng) : rng_get_u32(io_rng, 1000);
+    ARCEncoder encoder = {};
+    ARCBeginBlock(&encoder, o_block, i_series, timestampMs, value);
+    s_timestamps[0] = timestampMs;
+    s_values[0] = value;
+
+    for (u32 count = 1;; count++)
+    {
+        switch (i_shape)
+        {
+        case SeriesShape::Steady:
+            timestampMs += 1000;
+            break;
+        case SeriesShape::Counter:
+            timestampMs += 990 + rng_get_u32(io_rng, 21);
+            value += rng_get_u32(io_rng, 100000);
+            break;
+        case SeriesShape::Walk:
+            timestampMs += 250;
+            value = (f32)(value + rng_get_f64(io_rng) - 0.5);
+            break;
+        case SeriesShape::Random:
+            timestampMs += rng_get_u32(io_rng, 1000);
+            value = RandomBits(io_rng);
+            break;
+        case SeriesShape::Irregular:
+            timestampMs += rng_get_u32(io_rng, 8) == 0 ? rng_get_u32(io_rng, 3600000) : rng_get_u32(io_rng, 3);
+            value = rng_get_u32(io_rng, 4) == 0 ? value * -0.5 : value;
+            break;
+        default:
+            break;
+        }
+        if (!ARCEncodeSample(&encoder, timestampMs, value))
+        {
+            ARCEndBlock(&encoder);
+            return count;
+        }
+        s_timestamps[count] = timestampMs;
+        s_values[count] = value;
+    }
+}
+
+static bool IsDecodedAsEncoded(const u32 i_count)
+{
+    for (u32 i = 0; i < i_count; i++)
+    {
+        if (s_decodedTimestamps[i] != s_timestamps[i] || memcmp(&s_decodedValues[i], &s_values[i], sizeof(f64)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static tstr GetFileName(const u32 i_index)
+{
+    return tstr_printf(&s_arena, LITERAL("archive_test_%u.mwa"), i_index);
+}
+
+// a segment of the three series with as many blocks as given, the last one cut after
+// i_lastBlockSize bytes
+static void WriteSegment(const tstr& i_path, const u32 i_blocksCount, const size i_lastBlockSize)
+{
+    scratch_region_t scratch = scratch_begin(&s_arena);
+    const u32 headerBlocksCount = ARCGetSegmentHeaderBlocksCount(array_length(k_seriesNames));
+    u8* header = arena_push_podarr_aligned(scratch.arena, u8, headerBlocksCount * k_archiveBlockSize, 8);
+    ARCWriteSegmentHeader(header, k_startMs, k_seriesNames, array_length(k_seriesNames));
+
+    file_handle_t file = file_wopen(&s_fileGroup, i_path);
+    file_write(file, header, headerBlocksCount * k_archiveBlockSize);
+    for (u32 i = 0; i < i_blocksCount; i++)
+    {
+        file_write(file, s_blocks[i], i + 1 < i_blocksCount ? k_archiveBlockSize : i_lastBlockSize);
+    }
+    file_flush(file);
+    file_close(&file);
+    scratch_end(&scratch);
+}
+
+struct ScanResult
+{
+    u32 blockIndices[k_blocksCount];
+    u32 blocksCount;
+    u32 mismatchesCount; // blocks which are not those written
+};
+
+static void CollectBlock(voidptr i_data, const u8* i_block, const u32 i_blockIndex)
+{
+    ScanResult* result = (ScanResult*)i_data;
+    const bool known = i_blockIndex < k_blocksCount && memcmp(i_block, s_blocks[i_blockIndex], k_archiveBlockSize) == 0;
+    result->mismatchesCount += known ? 0 : 1;
+    if (result->blocksCount < k_blocksCount)
+    {
+        result->blockIndices[result->blocksCount++] = i_blockIndex;
+    }
+}
+
+// false when the header is rejected, o_droppedCount is what the scan skipped
+static bool ScanSegment(const tstr& i_path, ScanResult* o_result, u32* o_droppedCount)
+{
+    *o_result = {};
+    *o_droppedCount = 0;
+    scratch_region_t scratch = scratch_begin(&s_arena);
+    file_handle_t file = file_ropen(&s_fileGroup, i_path);
+    ARCSegmentFile segment = {};
+    const bool valid = !file.hasErrors && ARCReadSegmentHeader(&file, scratch.arena, &segment);
+    if (valid)
+    {
+        *o_droppedCount = ARCScanSegmentBlocks(&file, segment, scratch.arena, &CollectBlock, o_result);
+    }
+    if (!file.hasErrors)
+    {
+        file_close(&file);
+    }
+    scratch_end(&scratch);
+    return valid;
+}
+
+// ----------------------------------------------------------------------------
+
+static void TestRoundTrip()
+{
+    rng_context_t rng = create_rng(41);
+    for (u32 shape = 0; shape < (u32)SeriesShape::Count; shape++)
+    {
+        u32 wrongCount = 0;
+        u32 notFullCount = 0;
+        for (u32 i = 0; i < 50; i++)
+        {
+            const u32 count = EncodeBlock(&rng, (SeriesShape)shape, (u16)i, s_blocks[0]);
+            const ARCBlockHeader* header = (const ARCBlockHeader*)s_blocks[0];
+            const bool valid = ARCValidateBlock(s_blocks[0]) && header->series == i && header->samplesCount == count &&
+                               header->firstMs == s_timestamps[0] && header->lastMs == s_timestamps[count - 1];
+            const u32 decodedCount = ARCDecodeBlock(s_blocks[0], s_decodedTimestamps, s_decodedValues, k_maxArchiveBlockSamples);
+            wrongCount += valid && decodedCount == count && IsDecodedAsEncoded(count) ? 0 : 1;
+            // a block is closed when the longest sample may not fit anymore
+            notFullCount += header->bitsCount + k_maxSampleBits > k_blockPayloadBits ? 0 : 1;
+        }
+        TEST_CHECK(wrongCount == 0);
+        TEST_CHECK(notFullCount == 0);
+    }
+
+    // the first samples only
+    const u32 count = EncodeBlock(&rng, SeriesShape::Counter, 0, s_blocks[0]);
+    TEST_CHECK(count > 100);
+    TEST_CHECK(ARCDecodeBlock(s_blocks[0], s_decodedTimestamps, s_decodedValues, 100) == 100);
+    TEST_CHECK(IsDecodedAsEncoded(100));
+}
+
+static void TestBlockLimits()
+{
+    // a lone sample, all in the header
+    ARCEncoder encoder = {};
+    ARCBeginBlock(&encoder, s_blocks[0], 2, k_startMs, -0.0);
+    ARCEndBlock(&encoder);
+    TEST_CHECK(ARCValidateBlock(s_blocks[0]));
+    TEST_CHECK(ARCDecodeBlock(s_blocks[0], s_decodedTimestamps, s_decodedValues, k_maxArchiveBlockSamples) == 1);
+    TEST_CHECK(s_decodedTimestamps[0] == k_startMs && signbit(s_decodedValues[0]));
+
+    // a delta of delta past 32 bits starts a new block, what was written is left as it is
+    ARCBeginBlock(&encoder, s_blocks[0], 2, k_startMs, 1.0);
+    TEST_CHECK(ARCEncodeSample(&encoder, k_startMs + 1000, 2.0));
+    TEST_CHECK(!ARCEncodeSample(&encoder, k_startMs + 1000 + (1ull << 32), 3.0));
+    TEST_CHECK(ARCEncodeSample(&encoder, k_startMs + 1000 + 0x7fffffffull, 3.0));
+    ARCEndBlock(&encoder);
+    TEST_CHECK(ARCDecodeBlock(s_blocks[0], s_decodedTimestamps, s_decodedValues, k_maxArchiveBlockSamples) == 3);
+    TEST_CHECK(s_decodedTimestamps[2] == k_startMs + 1000 + 0x7fffffffull && s_decodedValues[2] == 3.0);
+
+    // as many samples as a block can hold, all the same
+    ARCBeginBlock(&encoder, s_blocks[0], 2, k_startMs, 5.0);
+    u32 count = 1;
+    while (ARCEncodeSample(&encoder, k_startMs + 1000ull * count, 5.0))
+    {
+        count++;
+    }
+    ARCEndBlock(&encoder);
+    // 2 bits each, but the first delta and the room kept for the longest sample
+    TEST_CHECK(count <= k_maxArchiveBlockSamples && count > k_maxArchiveBlockSamples - k_maxSampleBits);
+    TEST_CHECK(ARCDecodeBlock(s_blocks[0], s_decodedTimestamps, s_decodedValues, k_maxArchiveBlockSamples) == count);
+    TEST_CHECK(s_decodedTimestamps[count - 1] == k_startMs + 1000ull * (count - 1) && s_decodedValues[count - 1] == 5.0);
+
+    // any bit changed is caught
+    s_blocks[0][k_archiveBlockSize / 2] ^= 0x10;
+    TEST_CHECK(!ARCValidateBlock(s_blocks[0]));
+}
+
+static void TestSegmentRoundTrip()
+{
+    rng_context_t rng = create_rng(43);
+    for (u32 i = 0; i < k_blocksCount; i++)
+    {
+        EncodeBlock(&rng, (SeriesShape)(i % (u32)SeriesShape::Count), (u16)(i % array_length(k_seriesNames)), s_blocks[i]);
+    }
+    const tstr path = GetFileName(0);
+    WriteSegment(path, k_blocksCount, k_archiveBlockSize);
+
+    scratch_region_t scratch = scratch_begin(&s_arena);
+    file_handle_t file = file_ropen(&s_fileGroup, path);
+    TEST_CHECK(!file.hasErrors);
+    ARCSegmentFile segment = {};
+    TEST_CHECK(ARCReadSegmentHeader(&file, scratch.arena, &segment));
+    TEST_CHECK(segment.header.startMs == k_startMs && segment.header.seriesCount == array_length(k_seriesNames));
+    TEST_CHECK(segment.fileSize == (size)(segment.header.headerBlocksCount + k_blocksCount) * k_archiveBlockSize);
+    TEST_CHECK(strcmp(segment.names + 2 * k_maxHistoryNameLength, "network.ingress") == 0);
+
+    ScanResult result = {};
+    TEST_CHECK(ARCScanSegmentBlocks(&file, segment, scratch.arena, &CollectBlock, &result) == 0);
+    TEST_CHECK(result.blocksCount == k_blocksCount && result.mismatchesCount == 0);
+    TEST_CHECK(result.blockIndices[0] == 0 && result.blockIndices[k_blocksCount - 1] == k_blocksCount - 1);
+    file_close(&file);
+    scratch_end(&scratch);
+}
+
+// a crash in the middle of a write leaves a partial block at the end, or a header alone
+static void TestTruncatedSegment()
+{
+    ScanResult result;
+    u32 droppedCount = 0;
+    const tstr path = GetFileName(1);
+    WriteSegment(path, 11, k_archiveBlockSize / 2);
+    TEST_CHECK(ScanSegment(path, &result, &droppedCount));
+    TEST_CHECK(droppedCount == 1);
+    TEST_CHECK(result.blocksCount == 10 && result.mismatchesCount == 0);
+    TEST_CHECK(result.blockIndices[9] == 9);
+
+    WriteSegment(path, 0, 0);
+    TEST_CHECK(ScanSegment(path, &result, &droppedCount));
+    TEST_CHECK(droppedCount == 0 && result.blocksCount == 0);
+
+    // cut in the middle of the names
+    scratch_region_t scratch = scratch_begin(&s_arena);
+    u8* header = arena_push_podarr_aligned(scratch.arena, u8, k_archiveBlockSize, 8);
+    ARCWriteSegmentHeader(header, k_startMs, k_seriesNames, array_length(k_seriesNames));
+    file_handle_t file = file_wopen(&s_fileGroup, path);
+    file_write(file, header, sizeof(ARCSegmentHeader) + 10);
+    file_close(&file);
+    scratch_end(&scratch);
+    TEST_CHECK(!ScanSegment(path, &result, &droppedCount));
+}
+
+static void TestCorruptedSegment()
+{
+    rng_context_t rng = create_rng(47);
+    for (u32 i = 0; i < 12; i++)
+    {
+        EncodeBlock(&rng, SeriesShape::Counter, (u16)(i % array_length(k_seriesNames)), s_blocks[i]);
+    }
+    // a bit flipped in the samples, a header overwritten, a series the segment does not have and a
+    // block which was never written
+    s_blocks[2][600] ^= 0x01;
+    ((ARCBlockHeader*)s_blocks[5])->magic = 0;
+    EncodeBlock(&rng, SeriesShape::Steady, array_length(k_seriesNames), s_blocks[7]);
+    mem_fill(s_blocks[8], 0, k_archiveBlockSize);
+
+    ScanResult result;
+    u32 droppedCount = 0;
+    const tstr path = GetFileName(2);
+    WriteSegment(path, 12, k_archiveBlockSize);
+    TEST_CHECK(ScanSegment(path, &result, &droppedCount));
+    TEST_CHECK(droppedCount == 4);
+    TEST_CHECK(result.blocksCount == 8 && result.mismatchesCount == 0);
+    static const u32 k_keptIndices[] = { 0, 1, 3, 4, 6, 9, 10, 11 };
+    TEST_CHECK(memcmp(result.blockIndices, k_keptIndices, sizeof(k_keptIndices)) == 0);
+
+    // a corrupted header, the whole segment is ignored
+    scratch_region_t scratch = scratch_begin(&s_arena);
+    u8* header = arena_push_podarr_aligned(scratch.arena, u8, k_archiveBlockSize, 8);
+    ARCWriteSegmentHeader(header, k_startMs, k_seriesNames, array_length(k_seriesNames));
+    header[sizeof(ARCSegmentHeader) + 3] ^= 0x20;
+    file_handle_t file = file_wopen(&s_fileGroup, path);
+    file_write(file, header, k_archiveBlockSize);
+    file_write(file, s_blocks[0], k_archiveBlockSize);
+    file_close(&file);
+    scratch_end(&scratch);
+    TEST_CHECK(!ScanSegment(path, &result, &droppedCount));
+}
+
+int main()
+{
+    linear_allocator_t* allocator = test_initialize(SIZE_MB(8));
+    s_arena = create_arena(allocator, SIZE_KB(256));
+    s_fileSystem = create_file_system(allocator);
+    s_fileGroup = create_file_group(&s_fileSystem, tstr_literal(LITERAL("")));
+
+    TEST_RUN(TestRoundTrip);
+    TEST_RUN(TestBlockLimits);
+    TEST_RUN(TestSegmentRoundTrip);
+    TEST_RUN(TestTruncatedSegment);
+    TEST_RUN(TestCorruptedSegment);
+
+    for (u32 i = 0; i < 3; i++)
+    {
+        file_delete(&s_fileGroup, GetFileName(i));
+    }
+    return test_report();
+}
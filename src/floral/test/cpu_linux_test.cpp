@@ -0,0 +1,219 @@
+// /proc/stat parsing of the Linux cpu backend against captured fixtures
+// fixtures are written to a temporary directory procfs::SetRoot() points at
+
+#include "testing.h"
+
+#include "../../monitor/procfs.cpp"
+#include "../../monitor/km_driver.cpp"
+#include "../../monitor/thermal.cpp"
+#include "../../monitor/cpu_frequency.cpp"
+#include "../../monitor/cpu.cpp"
+
+// a 4.x kernel with 2 processors, the first sample
+static const_cstr k_procStatSample0 =
+    "cpu  1000 0 500 8000 100 0 0 0 0 0\n"
+    "cpu0 600 0 250 4000 50 0 0 0 0 0\n"
+    "cpu1 400 0 250 4000 50 0 0 0 0 0\n"
+    "intr 123456 0 0 0\n"
+    "ctxt 987654\n"
+    "btime 1700000000\n";
+
+// 1 s later: cpu0 was busy 75% of the time, cpu1 25%
+static const_cstr k_procStatSample1 =
+    "cpu  1100 0 500 8100 100 0 0 0 0 0\n"
+    "cpu0 660 0 265 4020 55 0 0 0 0 0\n"
+    "cpu1 440 0 235 4080 45 0 0 0 0 0\n"
+    "intr 123999 0 0 0\n"
+    "ctxt 987999\n"
+    "btime 1700000000\n";
+
+// 2.6.11 kernels have no steal / guest columns, irq and softirq are there
+static const_cstr k_procStatOldKernel0 =
+    "cpu  100 0 100 800 0 0 0\n"
+    "cpu0 100 0 100 800 0 0 0\n";
+static const_cstr k_procStatOldKernel1 =
+    "cpu  150 0 150 900 0 0 0\n"
+    "cpu0 150 0 150 900 0 0 0\n";
+
+// a processor went offline: its line disappears, then comes back with counters reset
+static const_cstr k_procStatOffline =
+    "cpu  1100 0 500 8100 100 0 0 0 0 0\n"
+    "cpu0 660 0 265 4020 55 0 0 0 0 0\n";
+static const_cstr k_procStatBackOnline =
+    "cpu  1200 0 500 8200 100 0 0 0 0 0\n"
+    "cpu0 700 0 275 4080 55 0 0 0 0 0\n"
+    "cpu1 10 0 10 80 0 0 0 0 0 0\n";
+
+static c8 s_root[256];
+
+// ----------------------------------------------------------------------------
+
+static void TestUtilization()
+{
+    test_write_file(s_root, "sys/devices/system/cpu/possible", "0-1\n");
+    test_write_file(s_root, "proc/stat", k_procStatSample0);
+    TEST_CHECK(cpu::Initialize(&s_testContext.allocator));
+
+    test_write_file(s_root, "proc/stat", k_procStatSample1);
+    cpu::UpdateOSPerfCounters();
+
+    f32 avgLoad = -1.0f;
+    f32 coreLoads[3] = { -1.0f, -1.0f, -1.0f };
+    u32 coreIds[3] = { 0, 1, 1024 };
+    cpu::ReadProcessorUtilization(&avgLoad, coreLoads, coreIds, 3);
+    // iowait counts as idle: 100 busy jiffies over 200
+    TEST_CHECK_NEAR(avgLoad, 50.0f, 1e-3f);
+    TEST_CHECK_NEAR(coreLoads[0], 75.0f, 1e-3f);
+    TEST_CHECK_NEAR(coreLoads[1], 25.0f, 1e-3f);
+    TEST_CHECK(coreLoads[2] == 0.0f);
+
+    // nothing moved, the load of an idle interval is 0 and not a division by 0
+    cpu::UpdateOSPerfCounters();
+    cpu::ReadProcessorUtilization(&avgLoad, nullptr, nullptr, 0);
+    TEST_CHECK(avgLoad == 0.0f);
+}
+
+static void TestHotplug()
+{
+    test_write_file(s_root, "proc/stat", k_procStatSample1);
+    cpu::UpdateOSPerfCounters();
+    test_write_file(s_root, "proc/stat", k_procStatOffline);
+    cpu::UpdateOSPerfCounters();
+
+    // the counters went backward, the core restarts from them instead of reporting a huge load
+    test_write_file(s_root, "proc/stat", k_procStatBackOnline);
+    cpu::UpdateOSPerfCounters();
+    f32 coreLoads[2] = {};
+    u32 coreIds[2] = { 0, 1 };
+    cpu::ReadProcessorUtilization(nullptr, coreLoads, coreIds, 2);
+    TEST_CHECK_NEAR(coreLoads[0], 50.0f * 100.0f / 110.0f, 1e-3f);
+    TEST_CHECK(coreLoads[1] >= 0.0f && coreLoads[1] <= 100.0f);
+}
+
+static void TestOldKernel()
+{
+    test_write_file(s_root, "proc/stat", k_procStatOldKernel0);
+    cpu::UpdateOSPerfCounters();
+    test_write_file(s_root, "proc/stat", k_procStatOldKernel1);
+    cpu::UpdateOSPerfCounters();
+
+    f32 avgLoad = -1.0f;
+    cpu::ReadProcessorUtilization(&avgLoad, nullptr, nullptr, 0);
+    TEST_CHECK_NEAR(avgLoad, 50.0f, 1e-3f);
+}
+
+static void TestParsers()
+{
+    u64 value = 0;
+    const c8* cursor = procfs::ParseU64("  18446744073709551615 next", &value);
+    TEST_CHECK(value == 18446744073709551615ull);
+    TEST_CHECK(procfs::StartsWith(cursor, " next"));
+
+    s64 signedValue = 0;
+    procfs::ParseS64("\t-42", &signedValue);
+    TEST_CHECK(signedValue == -42);
+
+    cursor = procfs::SkipLine("first line\nsecond");
+    TEST_CHECK(procfs::StartsWith(cursor, "second"));
+    cursor = procfs::SkipLine("no new line");
+    TEST_CHECK(*cursor == 0);
+}
+
+static void TestKeyValues()
+{
+    // same length and same first 8 characters, only the tail tells them apart
+    static const_cstr k_keyNames[] = { "Inactive(file)", "Inactive(anon)", "MemTotal", "Missing" };
+    procfs::Key keys[4];
+    for (u32 i = 0; i < 4; i++)
+    {
+        keys[i] = procfs::MakeKey(k_keyNames[i]);
+    }
+
+    u64 values[4] = { 0, 0, 0, 77 };
+    const u32 foundCount = procfs::ScanKeyValues("MemTotal:       16314708 kB\n"
+                                                 "Inactive(anon):   123456 kB\n"
+                                                 "Inactive(file):  2345678 kB\n",
+                                                 ':', keys, values, 4);
+    TEST_CHECK(foundCount == 3);
+    TEST_CHECK(values[0] == 2345678);
+    TEST_CHECK(values[1] == 123456);
+    TEST_CHECK(values[2] == 16314708);
+    TEST_CHECK(values[3] == 77);
+}
+
+static void TestCounterDelta()
+{
+    TEST_CHECK(procfs::GetCounterDelta(100, 250) == 150);
+    // a reset is not a wrap: nothing is known about what was counted in between
+    TEST_CHECK(procfs::GetCounterDelta(1000, 10) == 0);
+    TEST_CHECK(procfs::GetCounterDelta(0xfffffff0ull, 0x10, 32) == 0x20);
+    TEST_CHECK(procfs::GetCounterDelta(0x1fffffff0ull, 0x10, 32) == 0);
+}
+
+// the per-cpu state and the /proc/stat buffer grow with the processors, past what a fixed arena holds
+static void TestManyProcessors()
+{
+    constexpr u32 k_processorsCount = 1024;
+    c8* const stat = (c8*)malloc(SIZE_KB(128));
+    for (u32 sample = 0; sample < 2; sample++)
+    {
+        size length = (size)cstr_snprintf(stat, SIZE_KB(128), "cpu  0 0 0 0 0 0 0 0 0 0\n");
+        for (u32 i = 0; i < k_processorsCount; i++)
+        {
+            // the last processor is busy half of the second interval
+            const u32 busy = sample == 1 && i == k_processorsCount - 1 ? 50 : 0;
+            length += (size)cstr_snprintf(stat + length, SIZE_KB(128) - length, "cpu%u %u 0 0 %u 0 0 0 0 0 0\n", i, 1000 + busy,
+                                          100000 + sample * 100 - busy);
+        }
+        cstr_snprintf(stat + length, SIZE_KB(128) - length, "intr 0\nctxt 0\n");
+        test_write_file(s_root, "proc/stat", stat);
+        if (sample == 0)
+        {
+            test_write_file(s_root, "sys/devices/system/cpu/possible", "0-1023\n");
+            TEST_CHECK(cpu::Initialize(&s_testContext.allocator));
+        }
+        else
+        {
+            cpu::UpdateOSPerfCounters();
+        }
+    }
+    free(stat);
+    TEST_CHECK(cpu::s_state->arena.marker <= (aptr)cpu::s_state->arena.capacity);
+
+    f32 coreLoads[2] = { -1.0f, -1.0f };
+    u32 coreIds[2] = { 0, k_processorsCount - 1 };
+    cpu::ReadProcessorUtilization(nullptr, coreLoads, coreIds, 2);
+    TEST_CHECK(coreLoads[0] == 0.0f);
+    TEST_CHECK_NEAR(coreLoads[1], 50.0f, 1e-3f);
+}
+
+static void TestProcessorsCount()
+{
+    test_write_file(s_root, "sys/devices/system/cpu/possible", "0-3,8-11\n");
+    TEST_CHECK(procfs::GetProcessorsCount() == 12);
+    test_write_file(s_root, "sys/devices/system/cpu/possible", "0\n");
+    TEST_CHECK(procfs::GetProcessorsCount() == 1);
+}
+
+int main()
+{
+    test_initialize(SIZE_MB(16));
+    if (!test_create_tree(s_root, sizeof(s_root)))
+    {
+        printf("Cannot create the fixtures directory\n");
+        return 1;
+    }
+    procfs::SetRoot(s_root);
+
+    TEST_RUN(TestParsers);
+    TEST_RUN(TestKeyValues);
+    TEST_RUN(TestCounterDelta);
+    TEST_RUN(TestProcessorsCount);
+    TEST_RUN(TestUtilization);
+    TEST_RUN(TestHotplug);
+    TEST_RUN(TestOldKernel);
+    TEST_RUN(TestManyProcessors);
+
+    test_remove_tree(s_root);
+    return test_report();
+}
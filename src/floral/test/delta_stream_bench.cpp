@@ -0,0 +1,105 @@
+// encode and decode throughput of floral's delta stream, for as many double fields as the widget
+// streams, raw and compressed blocks. Prints the timings, returns 0.
+
+#include "testing.h"
+
+#include "../delta_stream.h"
+#include "../misc.h"
+#include "../rng.h"
+#include "../time.h"
+
+static const u32 k_fieldsCounts[] = { 16, 64, 128 };
+static constexpr u32 k_snapshotsCount = 20000;
+static constexpr u32 k_blockSize = 16384;
+static constexpr u32 k_maxFieldsCount = 128;
+
+static arena_t s_arena;
+
+// about a quarter of the series move between two snapshots, as with the widget's sampling rates
+static void GenerateSnapshots(u64* o_snapshots, const u32 i_fieldsCount)
+{
+    rng_context_t rng = create_rng(5);
+    f64 values[k_maxFieldsCount] = {};
+    for (u32 i = 0; i < k_snapshotsCount; i++)
+    {
+        for (u32 j = 0; j < i_fieldsCount; j++)
+        {
+            if (rng_get_u32(&rng, 4) == 0)
+            {
+                // counters grow, the other series wander
+                values[j] = j % 3 == 0 ? values[j] + rng_get_u32(&rng, 65536) : rng_get_f64(&rng) * 100.0;
+            }
+            o_snapshots[(size)i * i_fieldsCount + j] = delta_stream_pack_f64(values[j]);
+        }
+    }
+}
+
+static void BenchmarkStream(const u64* i_snapshots, const u32 i_fieldsCount, const bool i_compressed)
+{
+    scratch_region_t scratch = scratch_begin(&s_arena);
+    delta_field_t* fields = arena_push_podarr(&s_arena, delta_field_t, i_fieldsCount);
+    for (u32 i = 0; i < i_fieldsCount; i++)
+    {
+        fields[i] = { "series", delta_field_type_e::float64 };
+    }
+    const delta_stream_desc_t desc = {
+        .fields = fields,
+        .fieldsCount = i_fieldsCount,
+        .blockSize = k_blockSize,
+        .compressed = i_compressed
+    };
+    delta_encoder_t encoder = create_delta_encoder(&s_arena, desc);
+    const size rawSize = (size)k_snapshotsCount * i_fieldsCount * sizeof(u64);
+    buffer_t stream = arena_create_buffer(&s_arena, rawSize + SIZE_KB(256));
+
+    const u64 encodeStart = time_get_ticks();
+    delta_encoder_write_header(&encoder, &stream);
+    for (u32 i = 0; i < k_snapshotsCount; i++)
+    {
+        delta_encoder_push(&encoder, 1000ull * i, i_snapshots + (size)i * i_fieldsCount, &stream);
+    }
+    delta_encoder_flush(&encoder, &stream);
+    const f64 encodeMs = time_ticks_to_ms(time_get_ticks_serialized() - encodeStart);
+
+    delta_decoder_t decoder = {};
+    u64* values = arena_push_podarr(&s_arena, u64, i_fieldsCount);
+    u64 timestamp = 0;
+    u32 decodedCount = 0;
+    const u64 decodeStart = time_get_ticks();
+    size offset = create_delta_decoder(&s_arena, { stream.addr, stream.length }, &decoder);
+    while (offset < stream.length)
+    {
+        const size blockSize = delta_decoder_load_block(&decoder, { (const u8*)stream.addr + offset, stream.length - offset });
+        if (blockSize == 0)
+        {
+            break;
+        }
+        offset += blockSize;
+        while (delta_decoder_next(&decoder, &timestamp, values))
+        {
+            decodedCount++;
+        }
+    }
+    const f64 decodeMs = time_ticks_to_ms(time_get_ticks_serialized() - decodeStart);
+
+    const f64 rawMB = (f64)rawSize / (1024.0 * 1024.0);
+    printf("%4u fields, %-10s: %6.2f bytes per snapshot, encode %7.1f MB/s (%6.3f us per snapshot), decode %7.1f MB/s%s\n",
+           i_fieldsCount, i_compressed ? "compressed" : "raw", (f64)stream.length / k_snapshotsCount, rawMB / (encodeMs / 1000.0),
+           encodeMs * 1000.0 / k_snapshotsCount, rawMB / (decodeMs / 1000.0), decodedCount == k_snapshotsCount ? "" : ", DECODING FAILED");
+    scratch_end(&scratch);
+}
+
+int main()
+{
+    linear_allocator_t* allocator = test_initialize(SIZE_MB(96));
+    s_arena = create_arena(allocator, SIZE_MB(80));
+    u64* snapshots = arena_push_podarr(&s_arena, u64, (size)k_snapshotsCount * k_maxFieldsCount);
+
+    for (u32 i = 0; i < array_length(k_fieldsCounts); i++)
+    {
+        GenerateSnapshots(snapshots, k_fieldsCounts[i]);
+        BenchmarkStream(snapshots, k_fieldsCounts[i], false);
+        BenchmarkStream(snapshots, k_fieldsCounts[i], true);
+    }
+    return 0;
+}
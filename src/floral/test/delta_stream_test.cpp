@@ -0,0 +1,254 @@
+// round trips of floral's delta stream, every field type and both block formats, then corrupted
+// streams: the decoder has to reject them or stop early, never read or write out of its buffers
+
+#include "testing.h"
+
+#include "../delta_stream.h"
+#include "../misc.h"
+#include "../rng.h"
+
+static const delta_field_t k_fields[] = {
+    { "cpu.load", delta_field_type_e::float32 },
+    { "memory.used", delta_field_type_e::unsigned64 },
+    { "thermal.delta", delta_field_type_e::signed64 },
+    { "network.sent", delta_field_type_e::float64 },
+    { "disk.read", delta_field_type_e::float64 },
+    { "gpu.load", delta_field_type_e::float32 },
+    { "idle", delta_field_type_e::unsigned64 },
+    { "uptime", delta_field_type_e::float64 },
+    { "battery.level", delta_field_type_e::float32 }
+};
+static constexpr u32 k_fieldsCount = array_length(k_fields);
+static constexpr u32 k_snapshotsCount = 5000;
+static constexpr u32 k_blockSize = 4096;
+
+static arena_t s_arena;
+static u64 s_timestamps[k_snapshotsCount];
+static u64 s_snapshots[k_snapshotsCount][k_fieldsCount];
+
+// counters, random walks, fields which never move and the odd floats: NaN, -0, denormals, infinities
+static void GenerateSnapshots()
+{
+    rng_context_t rng = create_rng(7);
+    // -0, the smallest denormal, +-infinity, a NaN with a payload, the largest double
+    static const u64 k_oddBits[] = { 0x8000000000000000ull, 1, 0x7ff0000000000000ull, 0xfff0000000000000ull, 0x7ff8000000000123ull,
+                                     0x7fefffffffffffffull };
+    u64 timestampMs = 1700000000000ull;
+    f32 load = 50.0f;
+    f64 sent = 1e15;
+    for (u32 i = 0; i < k_snapshotsCount; i++)
+    {
+        timestampMs += 1000 + rng_get_u32(&rng, 3);
+        load = math_min(math_max(load + rng_get_f32_range(&rng, -5.0f, 5.0f), 0.0f), 100.0f);
+        sent += (f64)rng_get_u32(&rng, 100000);
+
+        u64* values = s_snapshots[i];
+        values[0] = delta_stream_pack_f32(load);
+        values[1] = 8ull * 1024 * 1024 * 1024 + rng_get_u32(&rng, 4) * 4096ull;
+        values[2] = (u64)(s64)((s32)rng_get_u32(&rng, 21) - 10);
+        values[3] = delta_stream_pack_f64(sent);
+        values[4] = rng_get_u32(&rng, 5) == 0 ? k_oddBits[rng_get_u32(&rng, array_length(k_oddBits))] : delta_stream_pack_f64(rng_get_f64(&rng));
+        values[5] = delta_stream_pack_f32(i % 2 ? -0.0f : 1e-40f);
+        values[6] = i < k_snapshotsCount / 2 ? 0 : ~0ull;
+        values[7] = delta_stream_pack_f64(i * 1.001);
+        values[8] = delta_stream_pack_f32(100.0f);
+        s_timestamps[i] = timestampMs;
+    }
+}
+
+static buffer_t EncodeSnapshots(const bool i_compressed)
+{
+    const delta_stream_desc_t desc = {
+        .fields = k_fields,
+        .fieldsCount = k_fieldsCount,
+        .blockSize = k_blockSize,
+        .compressed = i_compressed
+    };
+    delta_encoder_t encoder = create_delta_encoder(&s_arena, desc);
+    // never more than the raw snapshots, plus the headers
+    buffer_t stream = arena_create_buffer(&s_arena, sizeof(s_snapshots) + SIZE_KB(64));
+    delta_encoder_write_header(&encoder, &stream);
+    for (u32 i = 0; i < k_snapshotsCount; i++)
+    {
+        delta_encoder_push(&encoder, s_timestamps[i], s_snapshots[i], &stream);
+    }
+    TEST_CHECK(delta_encoder_flush(&encoder, &stream));
+    TEST_CHECK(!delta_encoder_flush(&encoder, &stream));
+    return stream;
+}
+
+// the snapshots decoded until the stream or a block is not valid anymore, checked against the
+// encoded ones when i_expected is set
+static u32 DecodeSnapshots(const const_buffer_t& i_stream, const bool i_expected)
+{
+    delta_decoder_t decoder = {};
+    const size headerSize = create_delta_decoder(&s_arena, i_stream, &decoder);
+    if (headerSize == 0)
+    {
+        return 0;
+    }
+
+    u64 values[k_fieldsCount];
+    u64 timestamp = 0;
+    u32 decodedCount = 0;
+    u32 mismatchesCount = 0;
+    size offset = headerSize;
+    while (offset < i_stream.length)
+    {
+        const size blockSize = delta_decoder_load_block(&decoder, { (const u8*)i_stream.addr + offset, i_stream.length - offset });
+        if (blockSize == 0)
+        {
+            break;
+        }
+        offset += blockSize;
+        while (delta_decoder_next(&decoder, &timestamp, values))
+        {
+            if (i_expected && decodedCount < k_snapshotsCount)
+            {
+                const bool same = timestamp == s_timestamps[decodedCount] && mem_compare(values, s_snapshots[decodedCount], sizeof(values)) == 0;
+                mismatchesCount += same ? 0 : 1;
+            }
+            decodedCount++;
+        }
+    }
+    if (i_expected)
+    {
+        TEST_CHECK(offset == i_stream.length);
+        TEST_CHECK(mismatchesCount == 0);
+    }
+    return decodedCount;
+}
+
+// ----------------------------------------------------------------------------
+
+static void TestRoundTrip()
+{
+    for (u32 compressed = 0; compressed < 2; compressed++)
+    {
+        scratch_region_t scratch = scratch_begin(&s_arena);
+        const buffer_t stream = EncodeSnapshots(compressed != 0);
+        TEST_CHECK(DecodeSnapshots({ stream.addr, stream.length }, true) == k_snapshotsCount);
+        printf("  %s: %u bytes, %.2f bytes per snapshot\n", compressed ? "compressed" : "raw", (u32)stream.length,
+               (f64)stream.length / k_snapshotsCount);
+        scratch_end(&scratch);
+    }
+}
+
+static void TestSchema()
+{
+    scratch_region_t scratch = scratch_begin(&s_arena);
+    const buffer_t stream = EncodeSnapshots(true);
+    delta_decoder_t decoder = {};
+    TEST_CHECK(create_delta_decoder(&s_arena, { stream.addr, stream.length }, &decoder) > 0);
+    TEST_CHECK(decoder.fieldsCount == k_fieldsCount);
+    u32 sameFieldsCount = 0;
+    for (u32 i = 0; i < decoder.fieldsCount; i++)
+    {
+        const bool same = decoder.fields[i].type == k_fields[i].type && strcmp(decoder.fields[i].name, k_fields[i].name) == 0;
+        sameFieldsCount += same ? 1 : 0;
+    }
+    TEST_CHECK(sameFieldsCount == k_fieldsCount);
+
+    // the schema is cut short, then its first field has a type from a later version
+    const size headerSize = sizeof(delta_stream_header_t) + 2 + strlen(k_fields[0].name);
+    TEST_CHECK(create_delta_decoder(&s_arena, { stream.addr, headerSize }, &decoder) == 0);
+    u8* bytes = (u8*)stream.addr;
+    bytes[sizeof(delta_stream_header_t)] = (u8)delta_field_type_e::float64 + 1;
+    TEST_CHECK(create_delta_decoder(&s_arena, { stream.addr, stream.length }, &decoder) == 0);
+    bytes[0] ^= 0xff;
+    TEST_CHECK(create_delta_decoder(&s_arena, { stream.addr, stream.length }, &decoder) == 0);
+    scratch_end(&scratch);
+}
+
+static void TestTruncatedBlock()
+{
+    scratch_region_t scratch = scratch_begin(&s_arena);
+    const buffer_t stream = EncodeSnapshots(true);
+    delta_decoder_t decoder = {};
+    const size headerSize = create_delta_decoder(&s_arena, { stream.addr, stream.length }, &decoder);
+    const u8* block = (const u8*)stream.addr + headerSize;
+    delta_block_header_t blockHeader;
+    mem_copy(&blockHeader, block, sizeof(blockHeader));
+    const size blockSize = sizeof(blockHeader) + blockHeader.storedSize;
+    TEST_CHECK(delta_decoder_load_block(&decoder, { block, blockSize }) == blockSize);
+    TEST_CHECK(delta_decoder_load_block(&decoder, { block, blockSize - 1 }) == 0);
+    TEST_CHECK(delta_decoder_load_block(&decoder, { block, sizeof(blockHeader) - 1 }) == 0);
+    // the snapshots of the block which could not be loaded are gone
+    u64 timestamp = 0;
+    u64 values[k_fieldsCount];
+    TEST_CHECK(!delta_decoder_next(&decoder, &timestamp, values));
+    scratch_end(&scratch);
+}
+
+// random bytes of the blocks are flipped, the sizes in the block headers included
+static void TestCorruptedBlocks()
+{
+    rng_context_t rng = create_rng(11);
+    u32 shorterCount = 0;
+    for (u32 compressed = 0; compressed < 2; compressed++)
+    {
+        scratch_region_t scratch = scratch_begin(&s_arena);
+        const buffer_t stream = EncodeSnapshots(compressed != 0);
+        delta_decoder_t decoder = {};
+        const size headerSize = create_delta_decoder(&s_arena, { stream.addr, stream.length }, &decoder);
+        u8* corrupted = arena_push_podarr(&s_arena, u8, stream.length);
+        for (u32 i = 0; i < 500; i++)
+        {
+            mem_copy(corrupted, stream.addr, stream.length);
+            const u32 flipsCount = 1 + rng_get_u32(&rng, 8);
+            for (u32 j = 0; j < flipsCount; j++)
+            {
+                const size offset = headerSize + rng_get_u32(&rng, (u32)(stream.length - headerSize));
+                corrupted[offset] ^= (u8)(1 + rng_get_u32(&rng, 255));
+            }
+            const u32 decodedCount = DecodeSnapshots({ corrupted, stream.length }, false);
+            shorterCount += decodedCount < k_snapshotsCount ? 1 : 0;
+        }
+        scratch_end(&scratch);
+    }
+    // most corruptions change a delta and go unnoticed, only the out of bounds reads matter here
+    printf("  %u corrupted streams decoded partially\n", shorterCount);
+}
+
+static void TestLz4()
+{
+    scratch_region_t scratch = scratch_begin(&s_arena);
+    rng_context_t rng = create_rng(3);
+    constexpr size k_dataSize = SIZE_KB(32);
+    u8* data = arena_push_podarr(&s_arena, u8, k_dataSize);
+    u8* compressed = arena_push_podarr(&s_arena, u8, lz4_get_max_compressed_size(k_dataSize));
+    u8* decompressed = arena_push_podarr(&s_arena, u8, k_dataSize);
+    u32* hashTable = arena_push_podarr(&s_arena, u32, LZ4_HASH_TABLE_SIZE);
+
+    // random, then runs of a few symbols which compress well
+    for (u32 pass = 0; pass < 2; pass++)
+    {
+        for (size i = 0; i < k_dataSize; i++)
+        {
+            data[i] = pass == 0 ? (u8)rng_get_u32(&rng, 256) : (u8)((i / 64) % 3);
+        }
+        const size compressedSize = lz4_compress(data, k_dataSize, compressed, hashTable);
+        TEST_CHECK(compressedSize > 0 && compressedSize <= lz4_get_max_compressed_size(k_dataSize));
+        TEST_CHECK(pass == 0 || compressedSize < k_dataSize / 16);
+        TEST_CHECK(lz4_decompress(compressed, compressedSize, decompressed, k_dataSize) == k_dataSize);
+        TEST_CHECK(mem_compare(data, decompressed, k_dataSize) == 0);
+        TEST_CHECK(lz4_decompress(compressed, compressedSize, decompressed, k_dataSize - 1) == 0);
+        TEST_CHECK(lz4_decompress(compressed, compressedSize - 1, decompressed, k_dataSize) == 0);
+    }
+    scratch_end(&scratch);
+}
+
+int main()
+{
+    linear_allocator_t* allocator = test_initialize(SIZE_MB(16));
+    s_arena = create_arena(allocator, SIZE_MB(8));
+    GenerateSnapshots();
+
+    TEST_RUN(TestRoundTrip);
+    TEST_RUN(TestSchema);
+    TEST_RUN(TestTruncatedBlock);
+    TEST_RUN(TestCorruptedBlocks);
+    TEST_RUN(TestLz4);
+
+    return test_report();
+}
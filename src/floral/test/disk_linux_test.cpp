@@ -0,0 +1,100 @@
+// /proc/diskstats parsing of the Linux disk backend against captured fixtures
+// fixtures are written to a temporary directory procfs::SetRoot() points at
+
+#include "testing.h"
+
+#include "../../monitor/procfs.cpp"
+#include "../../monitor/disk.cpp"
+
+// a disk with 2 partitions, an nvme drive and a few loop devices, 1 s apart
+static const_cstr k_diskStats0 =
+    "   7       0 loop0 100 0 200 10 0 0 0 0 0 10 10 0 0 0 0 0 0\n"
+    "   7       1 loop1 100 0 200 10 0 0 0 0 0 10 10 0 0 0 0 0 0\n"
+    "   8       0 sda 1000 0 8000 500 2000 0 16000 1500 0 1000 2000 0 0 0 0 0 0\n"
+    "   8       1 sda1 900 0 7000 450 1900 0 15000 1400 0 900 1850 0 0 0 0 0 0\n"
+    "   8       2 sda2 100 0 1000 50 100 0 1000 100 0 100 150 0 0 0 0 0 0\n"
+    " 259       0 nvme0n1 5000 0 40000 1000 0 0 0 0 3 2000 1000 0 0 0 0 0 0\n";
+static const_cstr k_diskStats1 =
+    "   7       0 loop0 200 0 400 20 0 0 0 0 0 20 20 0 0 0 0 0 0\n"
+    "   7       1 loop1 100 0 200 10 0 0 0 0 0 10 10 0 0 0 0 0 0\n"
+    "   8       0 sda 1100 0 10048 600 2100 0 18048 1600 0 1500 2400 0 0 0 0 0 0\n"
+    "   8       1 sda1 1000 0 9048 550 2000 0 17048 1500 0 1400 2250 0 0 0 0 0 0\n"
+    "   8       2 sda2 100 0 1000 50 100 0 1000 100 0 100 150 0 0 0 0 0 0\n"
+    " 259       0 nvme0n1 5000 0 40000 1000 0 0 0 0 1 2000 1000 0 0 0 0 0 0\n";
+
+static c8 s_root[256];
+
+// ----------------------------------------------------------------------------
+
+static void TestDevices()
+{
+    test_write_file(s_root, "sys/class/block/sda1/partition", "1\n");
+    test_write_file(s_root, "sys/class/block/sda2/partition", "2\n");
+    test_write_file(s_root, "proc/diskstats", k_diskStats0);
+    TEST_CHECK(disk::Initialize());
+
+    disk::DeviceInfo devices[disk::k_maxDevices];
+    const u32 count = disk::ReadDevices(devices, disk::k_maxDevices);
+    TEST_CHECK(count == 2);
+    TEST_CHECK(count == 2 && strcmp(devices[0].name, "sda") == 0 && strcmp(devices[1].name, "nvme0n1") == 0);
+}
+
+static void TestStats()
+{
+    usleep(10000);
+    test_write_file(s_root, "proc/diskstats", k_diskStats1);
+    disk::Info stats = {};
+    disk::ReadStats(&stats);
+
+    // the partitions and the loop devices are not counted twice
+    TEST_CHECK(stats.readBytes == (8000 + 40000 + 2048) * 512ull);
+    TEST_CHECK(stats.writtenBytes == (16000 + 2048) * 512ull);
+    // 200 requests completed in 200 ms
+    TEST_CHECK_NEAR(stats.latency, 1.0f, 1e-6f);
+
+    disk::DeviceInfo devices[disk::k_maxDevices];
+    const u32 count = disk::ReadDevices(devices, disk::k_maxDevices);
+    TEST_CHECK(count == 2);
+    // the in-flight gauge of nvme0n1 went from 3 to 1, that is not a counter reset
+    TEST_CHECK(count == 2 && devices[1].stats.readBytes == 40000 * 512ull);
+    TEST_CHECK(count == 2 && devices[1].stats.busy == 0.0f);
+}
+
+static void TestManyLoopDevices()
+{
+    // a snap-heavy host: the loop devices do not take the slots of the disks
+    c8 diskStats[SIZE_KB(16)];
+    s32 length = 0;
+    for (u32 i = 0; i < 100; i++)
+    {
+        length += snprintf(diskStats + length, sizeof(diskStats) - length, "   7 %u loop%u 1 0 2 0 0 0 0 0 0 0 0\n", i, i);
+    }
+    snprintf(diskStats + length, sizeof(diskStats) - length, "   8 16 sdb 1 0 2 0 0 0 0 0 0 0 0\n");
+    test_write_file(s_root, "proc/diskstats", diskStats);
+    disk::Info stats = {};
+    disk::ReadStats(&stats);
+
+    disk::DeviceInfo devices[disk::k_maxDevices];
+    const u32 count = disk::ReadDevices(devices, disk::k_maxDevices);
+    TEST_CHECK(count == 1);
+    TEST_CHECK(count == 1 && strcmp(devices[0].name, "sdb") == 0);
+}
+
+int main()
+{
+    test_initialize(SIZE_MB(8));
+    if (!test_create_tree(s_root, sizeof(s_root)))
+    {
+        printf("Cannot create the fixtures directory\n");
+        return 1;
+    }
+    procfs::SetRoot(s_root);
+
+    TEST_RUN(TestDevices);
+    TEST_RUN(TestStats);
+    TEST_RUN(TestManyLoopDevices);
+
+    disk::CleanUp();
+    test_remove_tree(s_root);
+    return test_report();
+}
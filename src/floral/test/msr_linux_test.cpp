@@ -0,0 +1,127 @@
+// MSR reads of the Linux kernel mode driver backend and the APERF / MPERF frequency on top of them
+// /dev/cpu/N/msr are regular files in a temporary directory procfs::SetRoot() points at, each
+// register stored at 'address * 8' the way km_driver_linux.inl expects of a fake device
+
+#include "testing.h"
+
+#include <fcntl.h>
+
+#include "../../monitor/procfs.cpp"
+#include "../../monitor/km_driver.cpp"
+#include "../../monitor/cpu_frequency.cpp"
+
+static constexpr u32 k_processorsCount = 4;
+
+static c8 s_root[256];
+
+// ----------------------------------------------------------------------------
+
+static bool WriteMSR(const u32 i_cpuId, const u32 i_address, const u64 i_value)
+{
+    c8 path[512];
+    snprintf(path, sizeof(path), "%s/dev/cpu/%u/msr", s_root, i_cpuId);
+    const s32 fd = open(path, O_WRONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    const bool written = pwrite(fd, &i_value, sizeof(u64), (off_t)i_address * sizeof(u64)) == sizeof(u64);
+    close(fd);
+    return written;
+}
+
+static void WriteFrequencyCounters(const u32 i_cpuId, const u64 i_aperf, const u64 i_mperf)
+{
+    WriteMSR(i_cpuId, cpu::k_IA32_APERF, i_aperf);
+    WriteMSR(i_cpuId, cpu::k_IA32_MPERF, i_mperf);
+}
+
+static void WriteTree()
+{
+    // 4 possible processors, the msr device of cpu2 cannot be opened (offline, or no permission)
+    test_write_file(s_root, "sys/devices/system/cpu/possible", "0-3\n");
+    for (u32 i = 0; i < k_processorsCount; i++)
+    {
+        if (i != 2)
+        {
+            c8 path[64];
+            snprintf(path, sizeof(path), "dev/cpu/%u/msr", i);
+            test_write_file(s_root, path, "");
+        }
+    }
+}
+
+static void TestReadMSRs()
+{
+    TEST_CHECK(kmdrv::Initialize(&s_testContext.allocator));
+
+    WriteMSR(0, 0x10, 0x1122334455667788ull);
+    WriteMSR(3, 0x10, 42);
+    kmdrv::MSRRead reads[4] = {
+        { .cpuId = 0, .address = 0x10 },
+        { .cpuId = 2, .address = 0x10 },
+        { .cpuId = 3, .address = 0x10 },
+        { .cpuId = k_processorsCount, .address = 0x10 },
+    };
+    TEST_CHECK(kmdrv::ReadMSRs(reads, 4) == 2);
+    TEST_CHECK(reads[0].valid && reads[0].value == 0x1122334455667788ull);
+    TEST_CHECK(!reads[1].valid);
+    TEST_CHECK(reads[2].valid && reads[2].value == 42);
+    TEST_CHECK(!reads[3].valid);
+
+    // past the end of the file: not a register we can read
+    reads[0].address = 0x1000;
+    TEST_CHECK(kmdrv::ReadMSRs(reads, 1) == 0);
+}
+
+static void TestFrequency()
+{
+    cpu::FrequencyInitialize(&s_testContext.allocator, k_processorsCount);
+    for (u32 i = 0; i < k_processorsCount; i++)
+    {
+        WriteFrequencyCounters(i, 1000000, 1000000);
+    }
+    // the first read has nothing to compare to, the counters are valid but there is no frequency yet
+    f32 avgFrequency = -1.0f;
+    TEST_CHECK(cpu::FrequencyReadProcessorFrequency(&avgFrequency, nullptr, nullptr, 0));
+    TEST_CHECK(avgFrequency == 0.0f);
+
+    // cpu0 ran at half the TSC rate while busy, cpu1 at the TSC rate, cpu3's counters were reset
+    WriteFrequencyCounters(0, 1500000, 2000000);
+    WriteFrequencyCounters(1, 2000000, 2000000);
+    WriteFrequencyCounters(3, 10, 10);
+    f32 coreFrequencies[4] = { -1.0f, -1.0f, -1.0f, -1.0f };
+    u32 coreIds[4] = { 0, 1, 2, 3 };
+    TEST_CHECK(cpu::FrequencyReadProcessorFrequency(&avgFrequency, coreFrequencies, coreIds, 4));
+    TEST_CHECK(coreFrequencies[2] == 0.0f);
+    TEST_CHECK(coreFrequencies[3] == 0.0f);
+    if (time_is_tsc_clock())
+    {
+        const f64 tscFrequency = (f64)time_get_ticks_frequency() * 1e-6;
+        TEST_CHECK_NEAR(coreFrequencies[0], tscFrequency * 0.5, 1e-3 * tscFrequency);
+        TEST_CHECK_NEAR(coreFrequencies[1], tscFrequency, 1e-3 * tscFrequency);
+    }
+    else
+    {
+        // APERF over the elapsed time: only the ordering is known
+        TEST_CHECK(coreFrequencies[0] > 0.0f && coreFrequencies[0] < coreFrequencies[1]);
+    }
+}
+
+int main()
+{
+    test_initialize(SIZE_MB(8));
+    if (!test_create_tree(s_root, sizeof(s_root)))
+    {
+        printf("Cannot create the fixtures directory\n");
+        return 1;
+    }
+    procfs::SetRoot(s_root);
+    WriteTree();
+
+    TEST_RUN(TestReadMSRs);
+    TEST_RUN(TestFrequency);
+
+    test_remove_tree(s_root);
+    return test_report();
+}
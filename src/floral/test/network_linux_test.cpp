@@ -0,0 +1,156 @@
+// /proc/net/dev parsing of the Linux network backend against captured fixtures
+// fixtures are written to a temporary directory procfs::SetRoot() points at
+
+#include "testing.h"
+
+#include "../../monitor/procfs.cpp"
+#include "../../monitor/network.cpp"
+
+// a wired and a wireless interface and the loopback, 10 ms apart
+static const_cstr k_netDev0 =
+    "Inter-|   Receive                                                |  Transmit\n"
+    " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n"
+    "    lo:  500000    5000    0    0    0     0          0         0   500000    5000    0    0    0     0       0          0\n"
+    "  eth0: 1000000   10000    0    0    0     0          0       100  2000000   20000    0    0    0     0       0          0\n"
+    " wlan0:   30000     300    0    0    0     0          0         0    40000     400    0    0    0     0       0          0\n";
+static const_cstr k_netDev1 =
+    "Inter-|   Receive                                                |  Transmit\n"
+    " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n"
+    "    lo:  900000    9000    0    0    0     0          0         0   900000    9000    0    0    0     0       0          0\n"
+    "  eth0: 1010000   10010    0    0    0     0          0       100  2004000   20004    0    0    0     0       0          0\n"
+    " wlan0:   31000     310    0    0    0     0          0         0    40000     400    0    0    0     0       0          0\n";
+// wlan0 was unplugged, a VPN tunnel came up with counters of its own
+static const_cstr k_netDev2 =
+    "Inter-|   Receive                                                |  Transmit\n"
+    " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n"
+    "    lo:  900000    9000    0    0    0     0          0         0   900000    9000    0    0    0     0       0          0\n"
+    "  eth0: 1020000   10020    0    0    0     0          0       100  2008000   20008    0    0    0     0       0          0\n"
+    "  tun0: 7000000    7000    0    0    0     0          0         0  8000000    8000    0    0    0     0       0          0\n";
+
+static const_cstr k_netDevHeader =
+    "Inter-|   Receive                                                |  Transmit\n"
+    " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n";
+
+static c8 s_root[256];
+
+static const network::InterfaceInfo* FindInterface(const network::InterfaceInfo* i_interfaces, const u32 i_count, const_cstr i_name)
+{
+    for (u32 i = 0; i < i_count; i++)
+    {
+        if (strcmp(i_interfaces[i].name, i_name) == 0)
+        {
+            return &i_interfaces[i];
+        }
+    }
+    return nullptr;
+}
+
+// ----------------------------------------------------------------------------
+
+static void TestInterfaces()
+{
+    test_write_file(s_root, "proc/net/dev", k_netDev0);
+    TEST_CHECK(network::Initialize());
+
+    network::InterfaceInfo interfaces[network::k_maxInterfaces];
+    const u32 count = network::ReadInterfaces(interfaces, network::k_maxInterfaces);
+    TEST_CHECK(count == 3);
+    const network::InterfaceInfo* loopback = FindInterface(interfaces, count, "lo");
+    TEST_CHECK(loopback != nullptr && loopback->loopback);
+    const network::InterfaceInfo* eth0 = FindInterface(interfaces, count, "eth0");
+    TEST_CHECK(eth0 != nullptr && !eth0->loopback && eth0->stats.receivedBytes == 1000000 && eth0->stats.sentBytes == 2000000);
+}
+
+static void TestRates()
+{
+    usleep(10000);
+    test_write_file(s_root, "proc/net/dev", k_netDev1);
+    f32 ingress = -1.0f;
+    f32 egress = -1.0f;
+    u64 sent = 0;
+    u64 received = 0;
+    network::ReadStats(&ingress, &egress, &sent, &received);
+
+    // the loopback's traffic never leaves the machine, it is not in the aggregate
+    TEST_CHECK(received == 1010000 + 31000);
+    TEST_CHECK(sent == 2004000 + 40000);
+    TEST_CHECK(ingress > 0.0f && egress > 0.0f);
+    // 11000 bytes in, 4000 out over the same interval
+    TEST_CHECK_NEAR(ingress / egress, 11000.0 / 4000.0, 1e-3);
+
+    network::InterfaceInfo interfaces[network::k_maxInterfaces];
+    const u32 count = network::ReadInterfaces(interfaces, network::k_maxInterfaces);
+    const network::InterfaceInfo* wlan0 = FindInterface(interfaces, count, "wlan0");
+    TEST_CHECK(wlan0 != nullptr && wlan0->stats.sentBytesPerSec == 0.0f && wlan0->stats.receivedBytesPerSec > 0.0f);
+}
+
+static void TestHotplug()
+{
+    usleep(10000);
+    test_write_file(s_root, "proc/net/dev", k_netDev2);
+    u64 sent = 0;
+    u64 received = 0;
+    network::ReadStats(nullptr, nullptr, &sent, &received);
+
+    // the new interface's counters are added once, they are not a rate
+    TEST_CHECK(received == 1010000 + 31000 + 10000 + 7000000);
+    TEST_CHECK(sent == 2004000 + 40000 + 4000 + 8000000);
+
+    network::InterfaceInfo interfaces[network::k_maxInterfaces];
+    const u32 count = network::ReadInterfaces(interfaces, network::k_maxInterfaces);
+    TEST_CHECK(count == 3);
+    TEST_CHECK(FindInterface(interfaces, count, "wlan0") == nullptr);
+    const network::InterfaceInfo* tun0 = FindInterface(interfaces, count, "tun0");
+    TEST_CHECK(tun0 != nullptr && tun0->stats.receivedBytesPerSec == 0.0f);
+}
+
+// a container host: hundreds of veth interfaces, more than the slots and than the buffer holds
+static void TestManyInterfaces()
+{
+    network::CleanUp();
+    constexpr u32 k_interfacesCount = 1000;
+    const size netDevCapacity = SIZE_KB(160);
+    c8* const netDev = (c8*)malloc(netDevCapacity);
+    size length = (size)snprintf(netDev, netDevCapacity, "%s", k_netDevHeader);
+    for (u32 i = 0; i < k_interfacesCount; i++)
+    {
+        length += (size)snprintf(netDev + length, netDevCapacity - length,
+                                 "veth%04u: 1000    10    0    0    0     0          0         0     2000    20    0    0    0     0       0          0\n", i);
+    }
+    test_write_file(s_root, "proc/net/dev", netDev);
+    free(netDev);
+    TEST_CHECK(network::Initialize());
+
+    u64 sent = 0;
+    u64 received = 0;
+    network::ReadStats(nullptr, nullptr, &sent, &received);
+    TEST_CHECK(network::s_state.interfacesTruncated);
+    TEST_CHECK(network::s_state.netDevTruncated);
+    // every slot is taken, by whole lines only
+    TEST_CHECK(network::s_state.interfacesCount == network::k_maxSlots);
+    TEST_CHECK(received == 1000ull * network::k_maxSlots);
+    TEST_CHECK(sent == 2000ull * network::k_maxSlots);
+
+    network::InterfaceInfo interfaces[network::k_maxInterfaces];
+    TEST_CHECK(network::ReadInterfaces(interfaces, network::k_maxInterfaces) == network::k_maxInterfaces);
+}
+
+int main()
+{
+    test_initialize(SIZE_MB(4));
+    if (!test_create_tree(s_root, sizeof(s_root)))
+    {
+        printf("Cannot create the fixtures directory\n");
+        return 1;
+    }
+    procfs::SetRoot(s_root);
+
+    TEST_RUN(TestInterfaces);
+    TEST_RUN(TestRates);
+    TEST_RUN(TestHotplug);
+    TEST_RUN(TestManyInterfaces);
+
+    network::CleanUp();
+    test_remove_tree(s_root);
+    return test_report();
+}
@@ -0,0 +1,45 @@
+// the Linux perf_event backend sizes its per-processor groups from the possible processors of a
+// fixture tree. The counters themselves need perf_event_paranoid <= 0, both modes are accepted.
+
+#include "testing.h"
+
+#include "../../monitor/procfs.cpp"
+#include "../../monitor/perf.cpp"
+
+static c8 s_root[256];
+
+// ----------------------------------------------------------------------------
+
+static void TestManyProcessors()
+{
+    test_write_file(s_root, "sys/devices/system/cpu/possible", "0-1023\n");
+    const bool available = perf::Initialize(&s_testContext.allocator);
+    TEST_CHECK(perf::s_state->numProcessors == 1024);
+    TEST_CHECK(perf::s_state->arena.marker <= (aptr)perf::s_state->arena.capacity);
+    TEST_CHECK(available == (perf::GetMode() != perf::Mode::Unavailable));
+
+    // the ids past the possible processors read as zeroes
+    perf::Counters cores[2];
+    u32 coreIds[2] = { 1023, 4096 };
+    mem_fill(cores, 0xff, sizeof(cores));
+    perf::ReadCounters(nullptr, cores, coreIds, 2);
+    TEST_CHECK(cores[1].instructionsPerCycle == 0.0f && cores[1].pageFaultsPerSec == 0.0f);
+    perf::CleanUp();
+    TEST_CHECK(perf::GetMode() == perf::Mode::Unavailable);
+}
+
+int main()
+{
+    test_initialize(SIZE_MB(4));
+    if (!test_create_tree(s_root, sizeof(s_root)))
+    {
+        printf("Cannot create the fixtures directory\n");
+        return 1;
+    }
+    procfs::SetRoot(s_root);
+
+    TEST_RUN(TestManyProcessors);
+
+    test_remove_tree(s_root);
+    return test_report();
+}
@@ -0,0 +1,159 @@
+// cgroup v2 discovery and PSI parsing of the Linux pressure backend against a fake cgroup tree
+// the tree is written to a temporary directory procfs::SetRoot() points at
+
+#include "testing.h"
+
+#include <fcntl.h>
+#include <sys/resource.h>
+
+#include "../../monitor/procfs.cpp"
+#include "../../monitor/pressure.cpp"
+
+static c8 s_root[256];
+static pressure::CgroupInfo s_cgroups[pressure::k_maxCgroups];
+
+// ----------------------------------------------------------------------------
+
+static void MakeCgroup(const_cstr i_root, const_cstr i_path)
+{
+    c8 path[512];
+    snprintf(path, sizeof(path), "%s/%s/cgroup.procs", i_root, i_path);
+    test_write_file(s_root, path, "");
+}
+
+static bool IsTracked(const u32 i_count, const_cstr i_path)
+{
+    for (u32 i = 0; i < i_count; i++)
+    {
+        if (strcmp(s_cgroups[i].path, i_path) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void TestCgroupV1()
+{
+    // a v1 hierarchy has a directory per controller and no cgroup.controllers
+    MakeCgroup("v1", "cpu,cpuacct/user.slice");
+    TEST_CHECK(pressure::Initialize(&s_testContext.allocator, "/v1") == false);
+    TEST_CHECK(pressure::ReadTopCgroups(s_cgroups, pressure::k_maxCgroups) == 0);
+    pressure::CleanUp();
+}
+
+static void TestDeepHierarchy()
+{
+    test_write_file(s_root, "deep/cgroup.controllers", "cpu io memory pids\n");
+    MakeCgroup("deep", "kubepods/burstable/pod1/container1/nested/leaf");
+    test_write_file(s_root, "deep/kubepods/burstable/pod1/cpu.pressure",
+                    "some avg10=12.50 avg60=3.00 avg300=1.00 total=1234\n"
+                    "full avg10=1.00 avg60=0.50 avg300=0.25 total=100\n");
+    TEST_CHECK(pressure::Initialize(&s_testContext.allocator, "/deep"));
+
+    // every level is tracked, and watched: the cgroups created later below the leaf are found
+    u32 count = pressure::ReadTopCgroups(s_cgroups, pressure::k_maxCgroups);
+    TEST_CHECK(count == 6);
+    TEST_CHECK(IsTracked(count, "kubepods/burstable/pod1/container1/nested/leaf"));
+    TEST_CHECK(count > 0 && strcmp(s_cgroups[0].path, "kubepods/burstable/pod1") == 0);
+    TEST_CHECK(count > 0 && s_cgroups[0].pressure == 12.5f && s_cgroups[0].cpu.full.totalUs == 100);
+
+    MakeCgroup("deep", "kubepods/burstable/pod1/container1/nested/leaf/late");
+    pressure::Update();
+    count = pressure::ReadTopCgroups(s_cgroups, pressure::k_maxCgroups);
+    TEST_CHECK(count == 7);
+    TEST_CHECK(IsTracked(count, "kubepods/burstable/pod1/container1/nested/leaf/late"));
+    pressure::CleanUp();
+}
+
+static void TestWideHierarchy()
+{
+    // more cgroups than slots: breadth-first, the shallow ones are tracked before the leaves of
+    // whichever subtree readdir() returns first
+    test_write_file(s_root, "wide/cgroup.controllers", "cpu io memory pids\n");
+    for (u32 i = 0; i < pressure::k_maxCgroups + 64; i++)
+    {
+        c8 path[64];
+        snprintf(path, sizeof(path), "machine.slice/vm%u", i);
+        MakeCgroup("wide", path);
+    }
+    MakeCgroup("wide", "system.slice");
+    MakeCgroup("wide", "user.slice");
+    TEST_CHECK(pressure::Initialize(&s_testContext.allocator, "/wide"));
+
+    const u32 count = pressure::ReadTopCgroups(s_cgroups, pressure::k_maxCgroups);
+    TEST_CHECK(count == pressure::k_maxCgroups);
+    TEST_CHECK(IsTracked(count, "system.slice"));
+    TEST_CHECK(IsTracked(count, "user.slice"));
+    TEST_CHECK(IsTracked(count, "machine.slice"));
+    pressure::CleanUp();
+}
+
+static u32 CountOpenFiles()
+{
+    u32 count = 0;
+    for (s32 fd = 0; fd < 4096; fd++)
+    {
+        count += fcntl(fd, F_GETFD) >= 0 ? 1 : 0;
+    }
+    return count;
+}
+
+// a hard limit the module cannot raise, with room for a few cgroups only: the next ones re-open
+// their files on every update instead of reading as 0
+static void TestFilesLimit()
+{
+    constexpr u32 k_cgroupsCount = 40;
+    constexpr u32 k_keptCgroupsCount = 10;
+    test_write_file(s_root, "limited/cgroup.controllers", "cpu io memory pids\n");
+    for (u32 i = 0; i < k_cgroupsCount; i++)
+    {
+        c8 path[64];
+        c8 content[128];
+        snprintf(path, sizeof(path), "limited/app%02u/memory.pressure", i);
+        snprintf(content, sizeof(content), "some avg10=%u.00 avg60=0.00 avg300=0.00 total=1\n", i + 1);
+        test_write_file(s_root, path, content);
+        snprintf(path, sizeof(path), "limited/app%02u/memory.current", i);
+        test_write_file(s_root, path, "4096\n");
+    }
+
+    // the inotify fd and the system pressure files are opened before the budget is taken
+    const rlim_t filesLimit = CountOpenFiles() + 4 + pressure::k_reservedFilesCount + k_keptCgroupsCount * pressure::k_cgroupFilesCount;
+    struct rlimit limit = { .rlim_cur = filesLimit, .rlim_max = filesLimit };
+    TEST_CHECK(setrlimit(RLIMIT_NOFILE, &limit) == 0);
+    TEST_CHECK(pressure::Initialize(&s_testContext.allocator, "/limited"));
+    TEST_CHECK(pressure::s_state->filesBudget > 0 && pressure::s_state->filesBudget <= k_keptCgroupsCount);
+    TEST_CHECK(pressure::s_state->keptCgroupsCount == pressure::s_state->filesBudget);
+    TEST_CHECK(CountOpenFiles() < filesLimit - pressure::k_reservedFilesCount);
+
+    const u32 count = pressure::ReadTopCgroups(s_cgroups, pressure::k_maxCgroups);
+    TEST_CHECK(count == k_cgroupsCount);
+    u32 readCount = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+        readCount += s_cgroups[i].pressure == (f32)(k_cgroupsCount - i) && s_cgroups[i].memoryCurrent == 4096 ? 1 : 0;
+    }
+    TEST_CHECK(readCount == k_cgroupsCount);
+    pressure::CleanUp();
+    TEST_CHECK(pressure::s_state->keptCgroupsCount == 0);
+}
+
+int main()
+{
+    test_initialize(SIZE_MB(16));
+    if (!test_create_tree(s_root, sizeof(s_root)))
+    {
+        printf("Cannot create the fixtures directory\n");
+        return 1;
+    }
+    procfs::SetRoot(s_root);
+
+    TEST_RUN(TestCgroupV1);
+    TEST_RUN(TestDeepHierarchy);
+    TEST_RUN(TestWideHierarchy);
+    // lowers the hard limit for good, last
+    TEST_RUN(TestFilesLimit);
+
+    test_remove_tree(s_root);
+    return test_report();
+}
@@ -0,0 +1,66 @@
+// scan time of the Linux process backend versus the number of processes, over a fake /proc
+// written to a temporary directory procfs::SetRoot() points at. Prints the timings, returns 0.
+
+#include "testing.h"
+
+#include "../../monitor/procfs.cpp"
+#include "../../monitor/process.cpp"
+
+static const u32 k_processesCounts[] = { 1000, 4000, 16000 };
+static constexpr u32 k_scansCount = 10;
+
+static c8 s_root[256];
+
+// ----------------------------------------------------------------------------
+
+static void WriteProcess(const u32 i_pid)
+{
+    c8 path[64];
+    c8 stat[256];
+    snprintf(path, sizeof(path), "proc/%u/stat", i_pid);
+    snprintf(stat, sizeof(stat), "%u (worker %u) S 1 1 1 0 -1 4194304 0 0 0 0 %u 0 0 0 20 0 2 0 %u 1000000 %u\n",
+             i_pid, i_pid, i_pid % 97, 1000 + i_pid, i_pid);
+    test_write_file(s_root, path, stat);
+}
+
+static void BenchmarkScan(const u32 i_processesCount)
+{
+    process::Initialize(&s_testContext.allocator);
+    f32 totalMs = 0.0f;
+    process::ScanStats stats = {};
+    for (u32 i = 0; i < k_scansCount; i++)
+    {
+        process::Update();
+        process::ReadScanStats(&stats);
+        totalMs += stats.scanMs;
+    }
+
+    printf("%6u processes: %8.3f ms per scan, %u stat files kept open, %u jobs\n", i_processesCount,
+           totalMs / (f32)k_scansCount, stats.cachedFilesCount, stats.jobsCount);
+    process::CleanUp();
+}
+
+int main()
+{
+    // the process module's state is allocated again for each count
+    test_initialize(SIZE_MB(64));
+    if (!test_create_tree(s_root, sizeof(s_root)))
+    {
+        printf("Cannot create the fixtures directory\n");
+        return 1;
+    }
+    procfs::SetRoot(s_root);
+
+    u32 writtenCount = 0;
+    for (u32 i = 0; i < array_length(k_processesCounts); i++)
+    {
+        for (; writtenCount < k_processesCounts[i]; writtenCount++)
+        {
+            WriteProcess(100 + writtenCount);
+        }
+        BenchmarkScan(k_processesCounts[i]);
+    }
+
+    test_remove_tree(s_root);
+    return 0;
+}
@@ -0,0 +1,122 @@
+// /proc/<pid>/stat scanning of the Linux process backend against a fake /proc, with the process
+// running out of fds. The tree is written to a temporary directory procfs::SetRoot() points at.
+
+#include "testing.h"
+
+#include <sys/resource.h>
+
+#include "../../monitor/procfs.cpp"
+#include "../../monitor/process.cpp"
+
+static constexpr u32 k_processesCount = 200;
+// above k_reservedFilesCount: a few stat files are kept open, the others re-opened on every scan
+static constexpr u32 k_filesLimitMargin = 300;
+
+static c8 s_root[256];
+
+// ----------------------------------------------------------------------------
+
+static void WriteProcess(const u32 i_pid, const u32 i_cpuTicks)
+{
+    c8 path[64];
+    c8 stat[256];
+    snprintf(path, sizeof(path), "proc/%u/stat", i_pid);
+    snprintf(stat, sizeof(stat), "%u (worker %u) S 1 1 1 0 -1 4194304 0 0 0 0 %u 0 0 0 20 0 2 0 %u 1000000 %u\n",
+             i_pid, i_pid, i_cpuTicks, 1000 + i_pid, i_pid);
+    test_write_file(s_root, path, stat);
+}
+
+static u32 CountOpenFiles()
+{
+    u32 count = 0;
+    for (s32 fd = 0; fd < 4096; fd++)
+    {
+        count += fcntl(fd, F_GETFD) >= 0 ? 1 : 0;
+    }
+    return count;
+}
+
+static void TestFilesExhausted()
+{
+    for (u32 i = 0; i < k_processesCount; i++)
+    {
+        WriteProcess(100 + i, 10);
+    }
+
+    // a hard limit the module cannot raise
+    const rlim_t filesLimit = CountOpenFiles() + k_filesLimitMargin;
+    struct rlimit limit = { .rlim_cur = filesLimit, .rlim_max = filesLimit };
+    TEST_CHECK(setrlimit(RLIMIT_NOFILE, &limit) == 0);
+    TEST_CHECK(process::Initialize(&s_testContext.allocator));
+
+    process::ScanStats stats = {};
+    process::ReadScanStats(&stats);
+    TEST_CHECK(stats.processesCount == k_processesCount);
+    TEST_CHECK(stats.cachedFilesCount > 0 && stats.cachedFilesCount < k_processesCount);
+    const u32 cachedFilesCount = stats.cachedFilesCount;
+
+    // one fd left: /proc is listed, then the stat files are opened one at a time in its place
+    s32 fillers[4096];
+    u32 fillersCount = 0;
+    while (fillersCount < array_length(fillers))
+    {
+        const s32 fd = dup(0);
+        if (fd < 0)
+        {
+            break;
+        }
+        fillers[fillersCount++] = fd;
+    }
+    close(fillers[--fillersCount]);
+
+    process::Update();
+    process::ReadScanStats(&stats);
+    TEST_CHECK(stats.processesCount == k_processesCount);
+    TEST_CHECK(stats.cachedFilesCount == cachedFilesCount);
+    TEST_CHECK(stats.skippedCount == 0);
+
+    // no fd at all: /proc cannot even be listed, the processes are kept as they were
+    fillers[fillersCount++] = dup(0);
+    process::Update();
+    process::ReadScanStats(&stats);
+    TEST_CHECK(stats.processesCount == k_processesCount);
+    TEST_CHECK(stats.skippedCount == k_processesCount);
+
+    for (u32 i = 0; i < fillersCount; i++)
+    {
+        close(fillers[i]);
+    }
+
+    // the processes not read by the last scan are still tracked and read again
+    for (u32 i = 0; i < k_processesCount; i++)
+    {
+        WriteProcess(100 + i, 20);
+    }
+    process::Update();
+    process::ProcessInfo processes[process::k_maxTopProcesses];
+    const u32 count = process::ReadTopProcesses(processes, process::k_maxTopProcesses, process::SortKey::Memory);
+    TEST_CHECK(count == process::k_maxTopProcesses);
+    TEST_CHECK(count > 0 && processes[0].pid == 100 + k_processesCount - 1);
+    TEST_CHECK(count > 0 && strcmp(processes[0].name, "worker 299") == 0);
+    process::ReadScanStats(&stats);
+    TEST_CHECK(stats.processesCount == k_processesCount && stats.cachedFilesCount == cachedFilesCount);
+    TEST_CHECK(stats.skippedCount == 0);
+
+    process::CleanUp();
+}
+
+int main()
+{
+    test_initialize(SIZE_MB(16));
+    if (!test_create_tree(s_root, sizeof(s_root)))
+    {
+        printf("Cannot create the fixtures directory\n");
+        return 1;
+    }
+    procfs::SetRoot(s_root);
+
+    TEST_RUN(TestFilesExhausted);
+
+    test_remove_tree(s_root);
+    return test_report();
+}
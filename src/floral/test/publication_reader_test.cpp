@@ -0,0 +1,227 @@
+// the published series, written by the real writer (publication_writer.cpp) to a section named after
+// this process and read back through publication_reader.cpp, from this process then from a second
+// one while the writer goes on (Windows only, as the section)
+//   publication_reader_test            runs the writer side and starts the reader side
+//   publication_reader_test <pid>      the reader side, of the section of the process <pid>
+
+#include "testing.h"
+
+#include "../thread.h"
+
+#include <wchar.h>
+
+#include "../../publication_writer.cpp"
+#include "../../publication_reader.cpp"
+
+static const_cstr k_seriesNames[] = { "cpu.load", "cpu" };
+constexpr s64 k_unixOffsetMs = 1700000000000ll;
+constexpr u32 k_concurrentReadsCount = 50000;
+constexpr u32 k_concurrentReadCount = k_publishedHistoryCapacity; // the oldest slot is the next one written
+constexpr u64 k_readerTimeoutMs = 60000;
+
+static wchar_t s_sectionName[64];
+static PUBContext s_writer;
+static PUBReader s_reader;
+
+static void MakeSectionName(const u32 i_processId)
+{
+    swprintf(s_sectionName, array_length(s_sectionName), L"Local\\monitor-widget-metrics-test-%u", i_processId);
+}
+
+// ----------------------------------------------------------------------------
+
+static void TestOpen()
+{
+    TEST_CHECK(!PUBOpenNamedReader(&s_reader, s_sectionName));
+    TEST_CHECK(PUBCreateSection(&s_writer, s_sectionName));
+    // mapped, but nothing was published yet
+    TEST_CHECK(!PUBOpenNamedReader(&s_reader, s_sectionName));
+
+    PUBWriteLayout(s_writer.section, k_seriesNames, array_length(k_seriesNames), k_unixOffsetMs);
+    TEST_CHECK(PUBOpenNamedReader(&s_reader, s_sectionName));
+    TEST_CHECK(PUBGetUnixOffsetMs(s_reader) == k_unixOffsetMs);
+    TEST_CHECK(s_reader.section->header.writerProcessId == GetCurrentProcessId());
+}
+
+static void TestFindSeries()
+{
+    TEST_CHECK(PUBFindSeries(s_reader, "cpu.load") == 0);
+    TEST_CHECK(PUBFindSeries(s_reader, "cpu") == 1);
+    TEST_CHECK(PUBFindSeries(s_reader, "cpu.lo") == -1);
+    // the names past the series count are not published anymore
+    PUBWriteLayout(s_writer.section, k_seriesNames, 1, k_unixOffsetMs);
+    TEST_CHECK(PUBFindSeries(s_reader, "cpu") == -1);
+    PUBWriteLayout(s_writer.section, k_seriesNames, array_length(k_seriesNames), k_unixOffsetMs);
+    TEST_CHECK(PUBFindSeries(s_reader, "cpu") == 1);
+}
+
+static void TestReadHistory()
+{
+    u64 timestampsMs[k_publishedHistoryCapacity + 1];
+    f64 values[k_publishedHistoryCapacity + 1];
+    TEST_CHECK(PUBReadHistory(s_reader, 0, timestampsMs, values, 4) == 0);
+    TEST_CHECK(!PUBReadLatest(s_reader, 0, timestampsMs, values));
+    TEST_CHECK(PUBReadHistory(s_reader, k_maxPublishedSeries, timestampsMs, values, 4) == 0);
+
+    for (u32 i = 0; i < 5; i++)
+    {
+        PUBWriteSample(&s_writer.section->series[0], 1000 + i, i * 0.5);
+    }
+    // the newest ones, oldest first
+    TEST_CHECK(PUBReadHistory(s_reader, 0, timestampsMs, values, 3) == 3);
+    TEST_CHECK(timestampsMs[0] == 1002 && timestampsMs[2] == 1004);
+    TEST_CHECK(values[0] == 1.0 && values[2] == 2.0);
+    TEST_CHECK(PUBReadHistory(s_reader, 0, timestampsMs, values, 10) == 5);
+    TEST_CHECK(timestampsMs[0] == 1000);
+    TEST_CHECK(PUBReadLatest(s_reader, 0, timestampsMs, values));
+    TEST_CHECK(timestampsMs[0] == 1004 && values[0] == 2.0);
+    TEST_CHECK(PUBReadHistory(s_reader, 1, timestampsMs, values, 10) == 0);
+
+    // the ring wrapped, only its capacity is left
+    for (u32 i = 5; i < k_publishedHistoryCapacity + 10; i++)
+    {
+        PUBWriteSample(&s_writer.section->series[0], 1000 + i, i * 0.5);
+    }
+    TEST_CHECK(PUBReadHistory(s_reader, 0, timestampsMs, values, k_publishedHistoryCapacity + 1) == k_publishedHistoryCapacity);
+    TEST_CHECK(timestampsMs[0] == 1010);
+    TEST_CHECK(timestampsMs[k_publishedHistoryCapacity - 1] == 1000 + k_publishedHistoryCapacity + 9);
+    TEST_CHECK(values[k_publishedHistoryCapacity - 1] == (k_publishedHistoryCapacity + 9) * 0.5);
+
+    // a new layout, as on a restart of the widget, empties the series
+    PUBWriteLayout(s_writer.section, k_seriesNames, array_length(k_seriesNames), k_unixOffsetMs);
+    TEST_CHECK(PUBReadHistory(s_reader, 0, timestampsMs, values, 10) == 0);
+}
+
+static void TestSequence()
+{
+    ATOMIC_TYPE(u32) sequence = 6;
+    const u32 sequence0 = BeginPublicationRead(&sequence);
+    TEST_CHECK(sequence0 == 6);
+    TEST_CHECK(EndPublicationRead(&sequence, sequence0));
+    // a whole write happened meanwhile, the sequence is even again but not the same
+    sequence = 8;
+    TEST_CHECK(!EndPublicationRead(&sequence, sequence0));
+    // a write is still going on
+    sequence = 7;
+    TEST_CHECK(!EndPublicationRead(&sequence, sequence0));
+}
+
+// the reader side runs in a second process, this one writes until it exits
+static void TestConcurrentReader()
+{
+    wchar_t programPath[MAX_PATH];
+    wchar_t commandLine[MAX_PATH + 32];
+    GetModuleFileNameW(NULL, programPath, MAX_PATH);
+    swprintf(commandLine, array_length(commandLine), L"\"%ls\" %u", programPath, GetCurrentProcessId());
+
+    STARTUPINFOW startupInfo = { sizeof(STARTUPINFOW) };
+    PROCESS_INFORMATION processInfo = {};
+    const bool started = CreateProcessW(programPath, commandLine, NULL, NULL, FALSE, 0, NULL, NULL, &startupInfo, &processInfo) != FALSE;
+    TEST_CHECK(started);
+    if (!started)
+    {
+        return;
+    }
+
+    const u64 startMs = GetTickCount64();
+    PUBSeries* const series = &s_writer.section->series[0];
+    for (u32 i = 0; WaitForSingleObject(processInfo.hProcess, 0) == WAIT_TIMEOUT; i++)
+    {
+        PUBWriteSample(series, i, i * 0.25);
+        if ((i & 0xffff) == 0 && GetTickCount64() - startMs > k_readerTimeoutMs)
+        {
+            TerminateProcess(processInfo.hProcess, ~0u);
+            break;
+        }
+    }
+
+    DWORD exitCode = ~0u;
+    WaitForSingleObject(processInfo.hProcess, INFINITE);
+    GetExitCodeProcess(processInfo.hProcess, &exitCode);
+    CloseHandle(processInfo.hThread);
+    CloseHandle(processInfo.hProcess);
+    // the number of checks which failed in the reader
+    TEST_CHECK(exitCode == 0);
+    printf("  %u samples written while reading\n", series->count);
+}
+
+// the readers still mapping the section can tell the writer is gone
+static void TestClosed()
+{
+    PUBDestroySection(&s_writer);
+    TEST_CHECK(s_reader.section->header.writerProcessId == 0);
+    TEST_CHECK(s_reader.section->header.layoutSequence % 2 == 0);
+    PUBCloseReader(&s_reader);
+    TEST_CHECK(!PUBOpenNamedReader(&s_reader, s_sectionName));
+}
+
+// ----------------------------------------------------------------------------
+
+// a torn read would mix samples of several writes: the timestamps would not follow each other or a
+// value would not match its timestamp
+static void TestConcurrentWriter()
+{
+    PUBReader reader = {};
+    TEST_CHECK(PUBOpenNamedReader(&reader, s_sectionName));
+    if (reader.section == nullptr)
+    {
+        return;
+    }
+
+    u64 timestampsMs[k_concurrentReadCount];
+    f64 values[k_concurrentReadCount];
+    while (!PUBReadLatest(reader, 0, timestampsMs, values))
+    {
+        thread_sleep(1);
+    }
+
+    u32 tornCount = 0;
+    u32 backwardCount = 0;
+    u64 lastNewestMs = 0;
+    for (u32 j = 0; j < k_concurrentReadsCount; j++)
+    {
+        const u32 count = PUBReadHistory(reader, 0, timestampsMs, values, k_concurrentReadCount);
+        for (u32 i = 0; i < count; i++)
+        {
+            const bool consecutive = i == 0 || timestampsMs[i] == timestampsMs[i - 1] + 1;
+            if (!consecutive || values[i] != timestampsMs[i] * 0.25)
+            {
+                tornCount++;
+                break;
+            }
+        }
+        if (count > 0)
+        {
+            backwardCount += timestampsMs[count - 1] < lastNewestMs ? 1 : 0;
+            lastNewestMs = timestampsMs[count - 1];
+        }
+    }
+
+    TEST_CHECK(tornCount == 0);
+    TEST_CHECK(backwardCount == 0);
+    TEST_CHECK(PUBReadLatest(reader, 0, timestampsMs, values));
+    TEST_CHECK(timestampsMs[0] >= lastNewestMs && values[0] == timestampsMs[0] * 0.25);
+    PUBCloseReader(&reader);
+}
+
+int main(int argc, char** argv)
+{
+    test_initialize(SIZE_MB(4));
+
+    if (argc > 1)
+    {
+        MakeSectionName((u32)strtoul(argv[1], nullptr, 10));
+        TEST_RUN(TestConcurrentWriter);
+        return test_report();
+    }
+
+    MakeSectionName(GetCurrentProcessId());
+    TEST_RUN(TestOpen);
+    TEST_RUN(TestFindSeries);
+    TEST_RUN(TestReadHistory);
+    TEST_RUN(TestSequence);
+    TEST_RUN(TestConcurrentReader);
+    TEST_RUN(TestClosed);
+
+    return test_report();
+}
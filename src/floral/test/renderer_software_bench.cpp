@@ -0,0 +1,172 @@
+// frame times of the software renderer drawing data/main.lua headless, the loop of the widget's
+// --headless on Windows: the real scripts and fonts (res/*.ttf), the metric providers replaced by
+// Lua stubs whose values change every frame so that every frame is recorded and replayed. Prints
+// the timings, returns 0.
+
+#include "testing.h"
+
+#include "../../scripting.cpp"
+#include "../../draw_commands.cpp"
+#include "../../html.cpp"
+#include "../../raster.cpp"
+#include "../../truetype.cpp"
+#include "../../renderer_software.cpp"
+
+#include "../file_system.h"
+#include "../misc.h"
+#include "../time.h"
+
+static constexpr s32 k_taskbarHeight = 48; // as the widget's headless mode
+static constexpr u32 k_framesCount = 2000;
+
+// the globals the widget's providers and aggregators would register
+static const_cstr k_providerStubs = R"(
+local frame = 0
+function get_processor_utilization() frame = frame + 1; return 20 + (frame * 7) % 75 + 0.25 end
+function get_processor_temperature() return 45 + frame % 50 end
+function get_ram_utilization() return { physicalLoad = 40 + frame % 55, virtualLoad = 20 + frame % 30 } end
+function get_network_stats() return { egress = 1000 + frame * 4099, ingress = 14000 + frame * 911 } end
+function get_gpu_utilization() return { graphicsEngineLoad = (frame * 3) % 100 + 0.5 } end
+function get_vram_utilization() return frame % 90 end
+function get_gpu_temperature() return 40 + frame % 45 end
+function add_aggregator() return 1 end
+function get_aggregate() return { average = 20 + frame % 70, p95 = 90 } end
+)";
+
+static file_system_t s_fileSystem;
+static SWRState s_benchSwrState;
+static s32 s_benchWidgetLength = 100;
+
+struct BenchOnInitializeCallContext : SCRClosure
+{
+    s32 PushArgs(lua_State*)
+    {
+        return 0;
+    }
+    void DeserializeReturnValues(lua_State*) {}
+};
+
+struct BenchOnUpdateCallContext : SCRClosure
+{
+    // arguments
+    s32 w;
+    s32 h;
+    // setup
+    s32 PushArgs(lua_State* i_vm)
+    {
+        lua_pushnumber(i_vm, w);
+        lua_pushnumber(i_vm, h);
+        return 2;
+    }
+    void DeserializeReturnValues(lua_State*) {}
+};
+
+static s32 BenchSetUpdateInterval(lua_State*)
+{
+    return 0;
+}
+
+static s32 BenchSetWidgetSize(lua_State* i_vm)
+{
+    s_benchWidgetLength = (s32)lua_tointeger(i_vm, 1);
+    return 0;
+}
+
+static const_buffer_t ReadFont(const_cstr i_path, arena_t* const i_arena)
+{
+    file_group_t fontGroup = file_system_find_all_files(&s_fileSystem, tstr_literal(LITERAL("res")), tstr_literal(LITERAL("ttf")));
+    file_handle_t file = file_ropen(&fontGroup, tstr_literal(i_path));
+    const const_buffer_t data = file_read_all(file, i_arena);
+    file_close(&file);
+    return data;
+}
+
+int main()
+{
+    linear_allocator_t* allocator = test_initialize(SIZE_MB(48));
+    arena_t arena = create_arena(allocator, SIZE_MB(8));
+
+    // the scripts and fonts are found from the repository root
+    c8 rootDir[FLORAL_MAX_PATH_LENGTH];
+    cstr_xcopy(rootDir, FLORAL_MAX_PATH_LENGTH, __FILE__);
+    *strstr(rootDir, "/src/floral/test/") = 0;
+    s_fileSystem = create_file_system(allocator);
+    file_system_set_working_directory(&s_fileSystem, tstr_literal(rootDir));
+
+    const const_buffer_t fonts[] = { ReadFont("fonts.ttf", &arena), ReadFont("icons.ttf", &arena) };
+    if (!SWRInitialize(&s_benchSwrState, fonts, array_length(fonts), allocator))
+    {
+        printf("cannot load the fonts of %s/res\n", rootDir);
+        return 0;
+    }
+    DRWInitialize(allocator);
+
+    SCRInitialize(&s_fileSystem, allocator);
+    SCRAddEntryPoint(tstr_literal(LITERAL("main.lua")));
+    SCRLoadVMThread(tstr_literal(LITERAL("data")));
+    lua_State* const vm = SCRGetContext()->vm;
+    if (luaL_dostring(vm, k_providerStubs) != 0)
+    {
+        printf("cannot load the provider stubs: %s\n", lua_tostring(vm, -1));
+        return 0;
+    }
+    SCRRegisterFunc(&BenchSetUpdateInterval, "set_update_interval", nullptr);
+    SCRRegisterFunc(&BenchSetWidgetSize, "set_widget_size", nullptr);
+    SWRBindScriptingAPIs(&s_benchSwrState);
+    DRWBindScriptingAPIs();
+    BenchOnInitializeCallContext initCtx = {};
+    SCRCallFunc("on_initialize", &initCtx);
+
+    const vec2i resolution(s_benchWidgetLength, k_taskbarHeight);
+    u32* const pixels = arena_push_podarr(&arena, u32, (size)resolution.x * resolution.y);
+    f64* const frameTimes = arena_push_podarr(&arena, f64, k_framesCount);
+    f64* const recordTimes = arena_push_podarr(&arena, f64, k_framesCount);
+    SWRRefresh(&s_benchSwrState, pixels, resolution.x, resolution, 1.0f);
+
+    for (u32 i = 0; i < k_framesCount; i++)
+    {
+        const f64 startMs = time_get_absolute_highres_ms();
+        DRWBeginFrame();
+        BenchOnUpdateCallContext updateCtx = {};
+        updateCtx.w = resolution.x;
+        updateCtx.h = resolution.y;
+        SCRCallFunc("on_update", &updateCtx);
+        DRWEndFrame();
+        recordTimes[i] = time_get_absolute_highres_ms() - startMs;
+
+        if (SWRBeginRender(&s_benchSwrState))
+        {
+            SWRExecuteCommands(&s_benchSwrState, DRWGetFrameCommands());
+            SWREndRender(&s_benchSwrState);
+        }
+        frameTimes[i] = time_get_absolute_highres_ms() - startMs;
+    }
+
+    // the first frame rasterizes the glyphs into the cache, it is reported on its own
+    const f64 firstMs = frameTimes[0];
+    qsort(frameTimes, k_framesCount, sizeof(f64), [](const void* i_a, const void* i_b) {
+        const f64 a = *(const f64*)i_a;
+        const f64 b = *(const f64*)i_b;
+        return a < b ? -1 : (a > b ? 1 : 0);
+    });
+    f64 recordMs = 0.0;
+    for (u32 i = 0; i < k_framesCount; i++)
+    {
+        recordMs += recordTimes[i];
+    }
+    u32 coveredCount = 0;
+    for (s32 i = 0; i < resolution.x * resolution.y; i++)
+    {
+        coveredCount += pixels[i] != 0 ? 1 : 0;
+    }
+
+    printf("%u frames of %d x %d, %u pixels covered by the last one\n", k_framesCount, resolution.x, resolution.y, coveredCount);
+    printf("frame time (ms): first %.4f, min %.4f, median %.4f, p99 %.4f, max %.4f\n", firstMs, frameTimes[0],
+           frameTimes[k_framesCount / 2], frameTimes[(k_framesCount - 1) * 99 / 100], frameTimes[k_framesCount - 1]);
+    printf("of which on_update() records (ms): average %.4f\n", recordMs / k_framesCount);
+
+    DRWCleanUp();
+    SWRCleanUp(&s_benchSwrState);
+    SCRCleanUp();
+    return 0;
+}
@@ -0,0 +1,186 @@
+// the rollup's buckets against a brute force over the same synthetic samples: a bucket fed sample
+// by sample, one merged from the buckets of any split of the stream, and the 1 min / 1 h tiers
+// fed hours of irregular samples as the sampler would
+
+#include "testing.h"
+
+#include "../../rollup_bucket.cpp"
+
+#include "../rng.h"
+
+static constexpr u32 k_samplesCount = 20000;
+
+static arena_t s_arena;
+static u64 s_timestamps[k_samplesCount];
+static f64 s_values[k_samplesCount];
+
+// positive, negative and both, so that a min or a max stuck at the reset's 0 shows
+static void GenerateValues(rng_context_t* io_rng, const u32 i_kind)
+{
+    for (u32 i = 0; i < k_samplesCount; i++)
+    {
+        const f64 value = rng_get_f64(io_rng) * 1000.0;
+        s_values[i] = i_kind == 0 ? value + 1.0 : (i_kind == 1 ? -value - 1.0 : value - 500.0);
+    }
+}
+
+// over the samples [i_first, i_end)
+static void ComputeBucket(const u32 i_first, const u32 i_end, const u64 i_startMs, RLPBucket* o_bucket)
+{
+    *o_bucket = { i_startMs, 0.0, s_values[i_first], s_values[i_first], s_values[i_end - 1], i_end - i_first };
+    for (u32 i = i_first; i < i_end; i++)
+    {
+        o_bucket->sum += s_values[i];
+        o_bucket->minValue = math_min(o_bucket->minValue, s_values[i]);
+        o_bucket->maxValue = math_max(o_bucket->maxValue, s_values[i]);
+    }
+}
+
+static bool IsSameBucket(const RLPBucket& i_a, const RLPBucket& i_b)
+{
+    // the sums may be added in another order
+    const f64 sumError = i_a.sum - i_b.sum;
+    const f64 sumTolerance = 1e-12 * (i_a.count * 1000.0);
+    return i_a.startMs == i_b.startMs && i_a.count == i_b.count && i_a.minValue == i_b.minValue && i_a.maxValue == i_b.maxValue &&
+           i_a.lastValue == i_b.lastValue && sumError <= sumTolerance && -sumError <= sumTolerance;
+}
+
+// ----------------------------------------------------------------------------
+
+static void TestBucketAdd()
+{
+    rng_context_t rng = create_rng(29);
+    for (u32 kind = 0; kind < 3; kind++)
+    {
+        GenerateValues(&rng, kind);
+        RLPBucket bucket;
+        RLPBucketReset(&bucket, 60000);
+        TEST_CHECK(bucket.count == 0 && bucket.startMs == 60000);
+        u32 wrongCount = 0;
+        for (u32 i = 0; i < k_samplesCount; i++)
+        {
+            RLPBucketAdd(&bucket, s_values[i]);
+            // the brute force is quadratic, a few hundred prefixes are enough
+            if (i < 200 || rng_get_u32(&rng, 100) == 0)
+            {
+                RLPBucket expected;
+                ComputeBucket(0, i + 1, 60000, &expected);
+                wrongCount += IsSameBucket(bucket, expected) ? 0 : 1;
+            }
+        }
+        TEST_CHECK(wrongCount == 0);
+    }
+}
+
+// the buckets of consecutive runs of samples merge into the bucket of them all, empty runs included
+static void TestBucketMerge()
+{
+    rng_context_t rng = create_rng(31);
+    for (u32 kind = 0; kind < 3; kind++)
+    {
+        GenerateValues(&rng, kind);
+        u32 wrongCount = 0;
+        for (u32 j = 0; j < 100; j++)
+        {
+            const u32 end = 1 + rng_get_u32(&rng, k_samplesCount);
+            RLPBucket merged;
+            RLPBucketReset(&merged, 0);
+            u32 first = 0;
+            while (first < end)
+            {
+                const u32 runLength = rng_get_u32(&rng, 64);
+                const u32 runEnd = math_min(end, first + runLength);
+                RLPBucket run;
+                RLPBucketReset(&run, 0);
+                for (u32 i = first; i < runEnd; i++)
+                {
+                    RLPBucketAdd(&run, s_values[i]);
+                }
+                RLPBucketMerge(&merged, run);
+                first = runEnd;
+            }
+            RLPBucket expected;
+            ComputeBucket(0, end, 0, &expected);
+            wrongCount += IsSameBucket(merged, expected) ? 0 : 1;
+        }
+        TEST_CHECK(wrongCount == 0);
+    }
+
+    // an empty bucket changes nothing, whichever side it is on
+    RLPBucket bucket;
+    RLPBucket empty;
+    RLPBucketReset(&bucket, 0);
+    RLPBucketReset(&empty, 0);
+    RLPBucketAdd(&bucket, -3.0);
+    RLPBucketMerge(&bucket, empty);
+    TEST_CHECK(bucket.count == 1 && bucket.minValue == -3.0 && bucket.maxValue == -3.0 && bucket.lastValue == -3.0);
+    RLPBucketMerge(&empty, bucket);
+    TEST_CHECK(IsSameBucket(empty, bucket));
+}
+
+// the closed buckets of both tiers hold what a scan of the samples of their time range would
+static void TestTiers()
+{
+    RLPSeries series = {};
+    for (u32 i = 1; i < k_rollupTiersCount; i++)
+    {
+        series.tiers[i].buckets = arena_push_podarr(&s_arena, RLPBucket, k_rollupCapacity[i]);
+    }
+
+    // about 5 hours: bursts, regular sampling and gaps of several minutes
+    rng_context_t rng = create_rng(37);
+    GenerateValues(&rng, 2);
+    u64 timestampMs = 1700000000000ull;
+    for (u32 i = 0; i < k_samplesCount; i++)
+    {
+        const u32 kind = rng_get_u32(&rng, 100);
+        timestampMs += kind < 20 ? rng_get_u32(&rng, 50) : (kind < 99 ? 1000 : 60000 * (1 + rng_get_u32(&rng, 10)));
+        s_timestamps[i] = timestampMs;
+
+        RLPBucket sample;
+        RLPBucketReset(&sample, timestampMs);
+        RLPBucketAdd(&sample, s_values[i]);
+        RLPFeedTier(&series, 1, sample);
+    }
+
+    // a tier is fed the samples of the closed buckets of the tier below
+    u32 fedCount = k_samplesCount;
+    for (u32 tier = 1; tier < k_rollupTiersCount; tier++)
+    {
+        const u64 bucketMs = k_rollupBucketMs[tier];
+        const u32 closedCount = series.tiers[tier].count;
+        TEST_CHECK(closedCount > 2 && closedCount < k_rollupCapacity[tier]);
+        u32 wrongCount = 0;
+        u32 first = 0;
+        for (u32 j = 0; j < closedCount; j++)
+        {
+            // only the buckets with samples are closed, in time order
+            const u64 startMs = s_timestamps[first] - s_timestamps[first] % bucketMs;
+            u32 end = first;
+            while (end < fedCount && s_timestamps[end] < startMs + bucketMs)
+            {
+                end++;
+            }
+            RLPBucket expected;
+            ComputeBucket(first, end, startMs, &expected);
+            wrongCount += IsSameBucket(series.tiers[tier].buckets[j], expected) ? 0 : 1;
+            first = end;
+        }
+        TEST_CHECK(wrongCount == 0);
+        // the open bucket holds the rest
+        TEST_CHECK(series.tiers[tier].open.count == fedCount - first);
+        fedCount = first;
+    }
+}
+
+int main()
+{
+    linear_allocator_t* allocator = test_initialize(SIZE_MB(4));
+    s_arena = create_arena(allocator, SIZE_KB(128));
+
+    TEST_RUN(TestBucketAdd);
+    TEST_RUN(TestBucketMerge);
+    TEST_RUN(TestTiers);
+
+    return test_report();
+}
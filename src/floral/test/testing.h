@@ -0,0 +1,149 @@
+#pragma once
+
+// A minimal harness for the standalone test programs of this folder. The folder is excluded from
+// the app build (see scripts/build_config.py): each <name>_test.cpp has its own main(), includes
+// the sources it tests the same way the unity build does and is linked with floral and Lua. A test
+// program returns the number of checks which failed, so 0 is a pass. The <name>_bench.cpp programs
+// are built the same way, they print timings and return 0.
+// On Linux, scripts/build_tests_linux.py builds floral, Lua and every program here, then runs the tests.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../configs.h"
+#include "../stdaliases.h"
+#include "../memory.h"
+#include "../thread_context.h"
+#include "../log.h"
+
+#if defined(FLORAL_PLATFORM_LINUX)
+#  include <ftw.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+struct test_context_t
+{
+    u32 checksCount;
+    u32 failuresCount;
+
+    linear_allocator_t allocator;
+    thread_context_t threadContext;
+    log_context_t logContext;
+};
+
+static test_context_t s_testContext;
+
+#define TEST_CHECK(expr)                                                          \
+    do                                                                            \
+    {                                                                             \
+        s_testContext.checksCount++;                                              \
+        if (!(expr))                                                              \
+        {                                                                         \
+            s_testContext.failuresCount++;                                        \
+            printf("  FAILED %s:%d: %s\n", __FILE__, __LINE__, #expr);            \
+        }                                                                         \
+    } while (0)
+
+#define TEST_CHECK_NEAR(a, b, eps)                                                \
+    do                                                                            \
+    {                                                                             \
+        s_testContext.checksCount++;                                              \
+        const f64 testA = (f64)(a);                                               \
+        const f64 testB = (f64)(b);                                               \
+        if (testA - testB > (eps) || testB - testA > (eps))                       \
+        {                                                                         \
+            s_testContext.failuresCount++;                                        \
+            printf("  FAILED %s:%d: %s = %g, %s = %g\n", __FILE__, __LINE__, #a, \
+                   testA, #b, testB);                                             \
+        }                                                                         \
+    } while (0)
+
+#define TEST_RUN(fn)               \
+    do                             \
+    {                              \
+        printf("[ RUN  ] %s\n", #fn); \
+        fn();                      \
+    } while (0)
+
+// the thread and log contexts the modules under test expect, as main() sets them up in the app. The
+// root memory comes from the C runtime, floral only reserves pages itself on Windows and Android.
+static inline linear_allocator_t* test_initialize(const size i_bytes)
+{
+#if defined(FLORAL_PLATFORM_WINDOWS)
+    voidptr memory = _aligned_malloc(i_bytes, MEMORY_DEFAULT_MALLOC_ALIGNMENT);
+#else
+    voidptr memory = aligned_alloc(MEMORY_DEFAULT_MALLOC_ALIGNMENT, i_bytes);
+#endif
+    s_testContext.allocator = create_linear_allocator("test allocator", memory, i_bytes);
+    s_testContext.threadContext = {
+        .allocator = create_linear_allocator(&s_testContext.allocator, "test thread context allocator", SIZE_MB(1))
+    };
+    thread_set_context(&s_testContext.threadContext);
+    s_testContext.logContext = create_log_context("test", log_level_e::verbose, &s_testContext.threadContext.allocator);
+    log_set_context(&s_testContext.logContext);
+    return &s_testContext.allocator;
+}
+
+static inline s32 test_report()
+{
+    printf("%u checks, %u failed\n", s_testContext.checksCount, s_testContext.failuresCount);
+    return (s32)s_testContext.failuresCount;
+}
+
+#if defined(FLORAL_PLATFORM_LINUX)
+// fake procfs / sysfs / device trees: a temporary directory the module's root is pointed at
+
+static inline bool test_create_tree(c8* o_root, const size i_rootLength)
+{
+    snprintf(o_root, i_rootLength, "/tmp/floral_test_XXXXXX");
+    return mkdtemp(o_root) != nullptr;
+}
+
+// creates the parent directories, overwrites the file in place so the descriptors already opened
+// on it see the new content, like a pseudo-file re-generated on every read
+static inline bool test_write_file(const_cstr i_root, const_cstr i_path, const_cstr i_content)
+{
+    c8 path[1024];
+    snprintf(path, sizeof(path), "%s/%s", i_root, i_path);
+    for (c8* it = path + strlen(i_root) + 1; *it; it++)
+    {
+        if (*it == '/')
+        {
+            *it = 0;
+            mkdir(path, 0755);
+            *it = '/';
+        }
+    }
+
+    FILE* file = fopen(path, "r+");
+    if (file == nullptr)
+    {
+        file = fopen(path, "w");
+    }
+    if (file == nullptr)
+    {
+        return false;
+    }
+    const size length = strlen(i_content);
+    fwrite(i_content, 1, length, file);
+    fflush(file);
+    const bool truncated = ftruncate(fileno(file), (off_t)length) == 0;
+    fclose(file);
+    return truncated;
+}
+
+static inline s32 test_remove_entry(const char* i_path, const struct stat* i_stat, s32 i_flag, struct FTW* i_ftw)
+{
+    (void)i_stat;
+    (void)i_flag;
+    (void)i_ftw;
+    return remove(i_path);
+}
+
+static inline void test_remove_tree(const_cstr i_root)
+{
+    nftw(i_root, &test_remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+#endif
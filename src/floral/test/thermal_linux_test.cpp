@@ -0,0 +1,133 @@
+// hwmon / thermal zone discovery of the Linux thermal backend against a fake sysfs tree
+// the tree is written to a temporary directory procfs::SetRoot() points at
+
+#include "testing.h"
+
+#include "../../monitor/procfs.cpp"
+#include "../../monitor/thermal.cpp"
+
+// more per-core sensors than the 32 the module once had room for
+static constexpr u32 k_coresCount = 40;
+
+static c8 s_root[256];
+
+// ----------------------------------------------------------------------------
+
+static void WriteHwmonSensor(const_cstr i_attributesDir, const u32 i_sensorId, const_cstr i_label, const s32 i_milliCelsius)
+{
+    c8 path[256];
+    c8 content[64];
+    snprintf(path, sizeof(path), "%s/temp%u_input", i_attributesDir, i_sensorId);
+    snprintf(content, sizeof(content), "%d\n", i_milliCelsius);
+    test_write_file(s_root, path, content);
+    if (i_label != nullptr)
+    {
+        snprintf(path, sizeof(path), "%s/temp%u_label", i_attributesDir, i_sensorId);
+        snprintf(content, sizeof(content), "%s\n", i_label);
+        test_write_file(s_root, path, content);
+    }
+}
+
+static void WriteTree()
+{
+    // the hwmon<N> numbers are not in readdir() order: node 0 is hwmon2, node 1 is hwmon10
+    test_write_file(s_root, "sys/class/hwmon/hwmon10/name", "k10temp\n");
+    WriteHwmonSensor("sys/class/hwmon/hwmon10", 1, "Tctl", 71000);
+    test_write_file(s_root, "sys/class/hwmon/hwmon2/name", "k10temp\n");
+    WriteHwmonSensor("sys/class/hwmon/hwmon2", 1, "Tctl", 52000);
+    WriteHwmonSensor("sys/class/hwmon/hwmon2", 3, "Tccd1", 50000);
+
+    // a thermal zone, discovered through /sys/class/thermal rather than its hwmon chip
+    test_write_file(s_root, "sys/class/hwmon/hwmon3/name", "acpitz\n");
+    WriteHwmonSensor("sys/class/hwmon/hwmon3", 1, nullptr, 40000);
+    test_write_file(s_root, "sys/class/thermal/thermal_zone0/type", "acpitz\n");
+    test_write_file(s_root, "sys/class/thermal/thermal_zone0/temp", "40000\n");
+
+    // a 2.6 kernel layout: the attributes are in the device directory
+    test_write_file(s_root, "sys/class/hwmon/hwmon4/device/name", "nvme\n");
+    WriteHwmonSensor("sys/class/hwmon/hwmon4/device", 1, "Composite", 35000);
+
+    test_write_file(s_root, "sys/class/hwmon/hwmon1/name", "coretemp\n");
+    WriteHwmonSensor("sys/class/hwmon/hwmon1", 1, "Package id 1", 60000);
+    for (u32 i = 0; i < k_coresCount; i++)
+    {
+        c8 label[32];
+        snprintf(label, sizeof(label), "Core %u", i);
+        WriteHwmonSensor("sys/class/hwmon/hwmon1", i + 2, label, 30000 + (s32)i * 100);
+    }
+}
+
+static const thermal::SensorInfo* FindSensor(const thermal::SensorInfo* i_sensors, const u32 i_count, const_cstr i_chip, const u32 i_package)
+{
+    for (u32 i = 0; i < i_count; i++)
+    {
+        if (strcmp(i_sensors[i].chip, i_chip) == 0 && i_sensors[i].package == i_package &&
+            i_sensors[i].kind == thermal::SensorKind::Package)
+        {
+            return &i_sensors[i];
+        }
+    }
+    return nullptr;
+}
+
+static void TestDiscovery()
+{
+    TEST_CHECK(thermal::Initialize(&s_testContext.allocator));
+
+    // coretemp: the package and all its cores, k10temp: 3, nvme: 1, zone: 1
+    thermal::SensorInfo sensors[thermal::k_maxReportedSensors];
+    const u32 count = thermal::ReadSensors(sensors, thermal::k_maxReportedSensors);
+    TEST_CHECK(count == 1 + k_coresCount + 3 + 1 + 1);
+
+    // AMD nodes are numbered in the order of the hwmon<N> numbers
+    const thermal::SensorInfo* node0 = FindSensor(sensors, count, "k10temp", 0);
+    const thermal::SensorInfo* node1 = FindSensor(sensors, count, "k10temp", 1);
+    TEST_CHECK(node0 != nullptr && node0->temperature == 52.0f);
+    TEST_CHECK(node1 != nullptr && node1->temperature == 71.0f);
+
+    u32 zonesCount = 0;
+    u32 drivesCount = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+        zonesCount += sensors[i].kind == thermal::SensorKind::Zone ? 1 : 0;
+        drivesCount += sensors[i].kind == thermal::SensorKind::Drive ? 1 : 0;
+    }
+    TEST_CHECK(zonesCount == 1);
+    TEST_CHECK(drivesCount == 1);
+}
+
+static void TestTemperatures()
+{
+    f32 temp = 0.0f;
+    TEST_CHECK(thermal::ReadCoreTemperature(1, k_coresCount - 1, &temp));
+    TEST_CHECK_NEAR(temp, 30.0f + (k_coresCount - 1) * 0.1f, 1e-3f);
+    TEST_CHECK(!thermal::ReadCoreTemperature(0, 0, &temp));
+
+    // coretemp's package outranks k10temp's Tctl
+    TEST_CHECK(thermal::ReadPackageTemperature(&temp));
+    TEST_CHECK(temp == 60.0f);
+
+    WriteHwmonSensor("sys/class/hwmon/hwmon1", 1, nullptr, 85000);
+    thermal::Update();
+    TEST_CHECK(thermal::ReadPackageTemperature(&temp));
+    TEST_CHECK(temp == 85.0f);
+}
+
+int main()
+{
+    test_initialize(SIZE_MB(8));
+    if (!test_create_tree(s_root, sizeof(s_root)))
+    {
+        printf("Cannot create the fixtures directory\n");
+        return 1;
+    }
+    procfs::SetRoot(s_root);
+    WriteTree();
+
+    TEST_RUN(TestDiscovery);
+    TEST_RUN(TestTemperatures);
+
+    thermal::CleanUp();
+    test_remove_tree(s_root);
+    return test_report();
+}
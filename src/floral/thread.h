@@ -35,10 +35,38 @@ struct thread_platform_data_t
 
 typedef void (*thread_func_t)(voidptr i_data);
 
+enum class thread_priority_e : u8
+{
+	normal = 0,
+	idle,
+	lowest,
+	below_normal,
+	above_normal,
+	highest,
+	time_critical
+};
+
+// only honored on Linux, Windows threads are always scheduled by the OS' default policy
+enum class thread_sched_policy_e : u8
+{
+	other = 0,  // SCHED_OTHER
+	batch,      // SCHED_BATCH
+	idle,       // SCHED_IDLE
+	fifo,       // SCHED_FIFO, needs CAP_SYS_NICE
+	round_robin // SCHED_RR, needs CAP_SYS_NICE
+};
+
+// zero-initialized scheduling fields mean "let the OS decide"
 struct thread_desc_t
 {
 	voidptr data;
 	thread_func_t func;
+
+	u64 affinityMask; // bit N = logical cpu N, 0 = no pinning
+	thread_priority_e priority;
+	thread_sched_policy_e policy;
+	size stackSize;   // in bytes, 0 = OS default
+	const_cstr name;  // debug name, truncated to 15 characters on Linux
 };
 
 struct thread_t
@@ -57,6 +85,12 @@ void thread_sleep(u32 i_durationMs);
 void thread_terminate(s32 i_exitCode);
 str8 thread_get_id_as_str(arena_t* const i_arena);
 
+// apply to the calling thread, useful for threads that are not created by us (e.g. main thread)
+bool thread_set_current_affinity(const u64 i_affinityMask);
+bool thread_set_current_priority(const thread_priority_e i_priority, const thread_sched_policy_e i_policy);
+void thread_set_current_name(const_cstr i_name);
+u32 thread_get_current_cpu();
+
 ///////////////////////////////////////////////////////////////////////////////
 
 #if defined(FLORAL_PLATFORM_WINDOWS)
@@ -1,112 +1,302 @@
 #include "thread.h"
+#include "assert.h"
+#include "misc.h"
+#include "string_utils.h"
 
+#include <sched.h>
 #include <time.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
-namespace floral
-{
 // ----------------------------------------------------------------------------
+
+static s32 to_linux_policy(const thread_sched_policy_e i_policy)
+{
+    switch (i_policy)
+    {
+    case thread_sched_policy_e::batch:
+        return SCHED_BATCH;
+    case thread_sched_policy_e::idle:
+        return SCHED_IDLE;
+    case thread_sched_policy_e::fifo:
+        return SCHED_FIFO;
+    case thread_sched_policy_e::round_robin:
+        return SCHED_RR;
+    case thread_sched_policy_e::other:
+    default:
+        return SCHED_OTHER;
+    }
+}
+
+// real-time policies take a static priority in [min, max], the others only accept 0 and are
+// tuned via the nice value instead
+static s32 to_linux_rt_priority(const s32 i_policy, const thread_priority_e i_priority)
+{
+    const s32 minPrio = sched_get_priority_min(i_policy);
+    const s32 maxPrio = sched_get_priority_max(i_policy);
+    const s32 range = maxPrio - minPrio;
+    switch (i_priority)
+    {
+    case thread_priority_e::idle:
+        return minPrio;
+    case thread_priority_e::lowest:
+        return minPrio + range / 6;
+    case thread_priority_e::below_normal:
+        return minPrio + range / 3;
+    case thread_priority_e::above_normal:
+        return minPrio + range * 2 / 3;
+    case thread_priority_e::highest:
+        return minPrio + range * 5 / 6;
+    case thread_priority_e::time_critical:
+        return maxPrio;
+    case thread_priority_e::normal:
+    default:
+        return minPrio + range / 2;
+    }
+}
+
+static s32 to_linux_nice(const thread_priority_e i_priority)
+{
+    switch (i_priority)
+    {
+    case thread_priority_e::idle:
+        return 19;
+    case thread_priority_e::lowest:
+        return 10;
+    case thread_priority_e::below_normal:
+        return 5;
+    case thread_priority_e::above_normal:
+        return -5;
+    case thread_priority_e::highest:
+        return -10;
+    case thread_priority_e::time_critical:
+        return -20;
+    case thread_priority_e::normal:
+    default:
+        return 0;
+    }
+}
+
+static void to_cpu_set(const u64 i_affinityMask, cpu_set_t* o_cpuSet)
+{
+    CPU_ZERO(o_cpuSet);
+    for (u32 i = 0; i < 64; i++)
+    {
+        if (i_affinityMask & (1ull << i))
+        {
+            CPU_SET(i, o_cpuSet);
+        }
+    }
+}
+
+static void set_thread_name(pthread_t i_thread, const_cstr i_name)
+{
+    // the kernel limits thread names to 16 bytes, including the null-terminator
+    c8 name[16];
+    cstr_xcopy(name, sizeof(name), i_name);
+    name[15] = 0;
+    pthread_setname_np(i_thread, name);
+}
+
 static voidptr thread_func(voidptr i_param)
 {
-	thread_desc_t* desc = (thread_desc_t*)i_param;
-	(*(desc->func))(desc->data);
-	pthread_exit(nullptr);
+    thread_desc_t* desc = (thread_desc_t*)i_param;
+    // the nice value cannot be set through pthread attributes and there is no way to get the tid
+    // of another thread, so apply it from inside. Real-time policies ignore it anyway.
+    const bool isRealtime = (desc->policy == thread_sched_policy_e::fifo || desc->policy == thread_sched_policy_e::round_robin);
+    if (!isRealtime && desc->priority != thread_priority_e::normal)
+    {
+        setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), to_linux_nice(desc->priority));
+    }
+    (*(desc->func))(desc->data);
+    return nullptr;
+}
+
+// ----------------------------------------------------------------------------
+
+void thread_sleep(u32 i_durationMs)
+{
+    timespec ts;
+    ts.tv_sec = i_durationMs / 1000;
+    ts.tv_nsec = (i_durationMs % 1000) * 1000000;
+
+    nanosleep(&ts, &ts);
+}
+
+void thread_terminate(s32 i_exitCode)
+{
+    pthread_exit((voidptr)(aptr)i_exitCode);
+}
+
+str8 thread_get_id_as_str(arena_t* const i_arena)
+{
+    const s64 id = (s64)syscall(SYS_gettid);
+    str8 idStr = str8_printf(i_arena, "thread:%ld", id);
+    return idStr;
 }
 
-void sleep_thread(u32 i_durationMs)
+bool thread_set_current_affinity(const u64 i_affinityMask)
 {
-	timespec ts;
-	ts.tv_sec = i_durationMs / 1000;
-	ts.tv_nsec = (i_durationMs % 1000) * 1000000;
+    cpu_set_t cpuSet;
+    to_cpu_set(i_affinityMask, &cpuSet);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet) == 0;
+}
+
+bool thread_set_current_priority(const thread_priority_e i_priority, const thread_sched_policy_e i_policy)
+{
+    const s32 policy = to_linux_policy(i_policy);
+    sched_param param = {};
+    if (policy == SCHED_FIFO || policy == SCHED_RR)
+    {
+        param.sched_priority = to_linux_rt_priority(policy, i_priority);
+        return pthread_setschedparam(pthread_self(), policy, &param) == 0;
+    }
 
-	nanosleep(&ts, &ts);
+    if (pthread_setschedparam(pthread_self(), policy, &param) != 0)
+    {
+        return false;
+    }
+    // on Linux, the nice value is a per-thread attribute when addressed by tid
+    return setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), to_linux_nice(i_priority)) == 0;
+}
+
+void thread_set_current_name(const_cstr i_name)
+{
+    set_thread_name(pthread_self(), i_name);
 }
 
-void terminate_thread(s32 i_exitCode)
+u32 thread_get_current_cpu()
 {
-	pthread_exit(&i_exitCode);
+    const s32 cpu = sched_getcpu();
+    return cpu >= 0 ? (u32)cpu : 0;
 }
 
 // ----------------------------------------------------------------------------
 
 thread_t create_thread(const thread_desc_t* i_desc)
 {
-	thread_t newThread;
-	newThread.desc = *i_desc;
+    thread_t newThread;
+    initialize_thread(&newThread, *i_desc);
+    return newThread;
+}
 
-	return newThread;
+void initialize_thread(thread_t* const io_thread, const thread_desc_t& i_desc)
+{
+    io_thread->platformData = {};
+    io_thread->desc = i_desc;
 }
 
-void start_thread(thread_t* const io_thread)
+void thread_start(thread_t* const io_thread)
 {
-	pthread_create(&io_thread->platformData.handle, nullptr, thread_func, (voidptr)&(io_thread->desc));
+    const thread_desc_t& desc = io_thread->desc;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+
+    if (desc.stackSize > 0)
+    {
+        pthread_attr_setstacksize(&attr, (size_t)desc.stackSize);
+    }
+
+    if (desc.affinityMask != 0)
+    {
+        cpu_set_t cpuSet;
+        to_cpu_set(desc.affinityMask, &cpuSet);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuSet);
+    }
+
+    const s32 policy = to_linux_policy(desc.policy);
+    const bool isRealtime = (policy == SCHED_FIFO || policy == SCHED_RR);
+    if (desc.policy != thread_sched_policy_e::other)
+    {
+        sched_param param = {};
+        param.sched_priority = isRealtime ? to_linux_rt_priority(policy, desc.priority) : 0;
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, policy);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+
+    s32 result = pthread_create(&io_thread->platformData.handle, &attr, thread_func, (voidptr)&(io_thread->desc));
+    if (result != 0 && desc.policy != thread_sched_policy_e::other)
+    {
+        // most likely EPERM on a real-time policy, fall back to the inherited scheduling
+        pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+        result = pthread_create(&io_thread->platformData.handle, &attr, thread_func, (voidptr)&(io_thread->desc));
+    }
+    FLORAL_ASSERT(result == 0);
+    pthread_attr_destroy(&attr);
+
+    if (desc.name != nullptr)
+    {
+        set_thread_name(io_thread->platformData.handle, desc.name);
+    }
 }
 
-void join_thread(thread_t* const io_thread)
+void thread_join(thread_t* const io_thread)
 {
-	pthread_join(io_thread->platformData.handle, nullptr);
+    pthread_join(io_thread->platformData.handle, nullptr);
+    io_thread->platformData = {};
 }
 
 // ----------------------------------------------------------------------------
 
 mutex_t create_mutex()
 {
-	mutex_t newMutex;
-	pthread_mutex_init(&newMutex.platformData.handle, nullptr);
-	return newMutex;
+    mutex_t newMutex;
+    pthread_mutex_init(&newMutex.platformData.handle, nullptr);
+    return newMutex;
 }
 
-void destroy_mutex(mutex_t* const i_mtx)
+void mutex_destroy(mutex_t* const i_mtx)
 {
-	pthread_mutex_destroy(&i_mtx->platformData.handle);
+    pthread_mutex_destroy(&i_mtx->platformData.handle);
 }
 
-void lock_mutex(mutex_t* const i_mtx)
+void mutex_lock(mutex_t* const i_mtx)
 {
-	pthread_mutex_lock(&i_mtx->platformData.handle);
+    pthread_mutex_lock(&i_mtx->platformData.handle);
 }
 
-void unlock_mutex(mutex_t* const i_mtx)
+void mutex_unlock(mutex_t* const i_mtx)
 {
-	pthread_mutex_unlock(&i_mtx->platformData.handle);
+    pthread_mutex_unlock(&i_mtx->platformData.handle);
 }
 
-condition_variable_t create_condition_variable()
+condition_variable_t create_cv()
 {
-	condition_variable_t newCv;
-	pthread_cond_init(&newCv.platformData.handle, nullptr);
-	return newCv;
+    condition_variable_t newCv;
+    pthread_cond_init(&newCv.platformData.handle, nullptr);
+    return newCv;
 }
 
-void destroy_condition_variable(condition_variable_t* const i_cv)
+void cv_destroy(condition_variable_t* const i_cv)
 {
-	pthread_cond_destroy(&i_cv->platformData.handle);
+    pthread_cond_destroy(&i_cv->platformData.handle);
 }
 
-void wait_for_condition(condition_variable_t* const i_cv, mutex_t* const i_mtx)
+void cv_wait_for(condition_variable_t* const i_cv, mutex_t* const i_mtx)
 {
-	pthread_cond_wait(&i_cv->platformData.handle, &i_mtx->platformData.handle);
+    pthread_cond_wait(&i_cv->platformData.handle, &i_mtx->platformData.handle);
 }
 
-void notify_one(condition_variable_t* const i_cv)
+void cv_notify_one(condition_variable_t* const i_cv)
 {
-	pthread_cond_signal(&i_cv->platformData.handle);
+    pthread_cond_signal(&i_cv->platformData.handle);
 }
 
-void notify_all(condition_variable_t* const i_cv)
+void cv_notify_all(condition_variable_t* const i_cv)
 {
-	pthread_cond_broadcast(&i_cv->platformData.handle);
+    pthread_cond_broadcast(&i_cv->platformData.handle);
 }
 
 lock_guard_t::lock_guard_t(mutex_t* const i_mtx)
-	: mtx(i_mtx)
+    : mtx(i_mtx)
 {
-	lock_mutex(mtx);
+    mutex_lock(mtx);
 }
 
 lock_guard_t::~lock_guard_t()
 {
-	unlock_mutex(mtx);
-}
-
-// ----------------------------------------------------------------------------
+    mutex_unlock(mtx);
 }
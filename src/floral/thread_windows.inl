@@ -1,4 +1,6 @@
 #include "thread.h"
+#include "assert.h"
+#include "misc.h"
 #include "string_utils.h"
 
 // ----------------------------------------------------------------------------
@@ -10,6 +12,43 @@ static DWORD WINAPI thread_func(LPVOID i_param)
     return 0;
 }
 
+static s32 to_windows_priority(const thread_priority_e i_priority)
+{
+    switch (i_priority)
+    {
+    case thread_priority_e::idle:
+        return THREAD_PRIORITY_IDLE;
+    case thread_priority_e::lowest:
+        return THREAD_PRIORITY_LOWEST;
+    case thread_priority_e::below_normal:
+        return THREAD_PRIORITY_BELOW_NORMAL;
+    case thread_priority_e::above_normal:
+        return THREAD_PRIORITY_ABOVE_NORMAL;
+    case thread_priority_e::highest:
+        return THREAD_PRIORITY_HIGHEST;
+    case thread_priority_e::time_critical:
+        return THREAD_PRIORITY_TIME_CRITICAL;
+    case thread_priority_e::normal:
+    default:
+        return THREAD_PRIORITY_NORMAL;
+    }
+}
+
+static void set_thread_name(HANDLE i_thread, const_cstr i_name)
+{
+    // SetThreadDescription is only available from Windows 10 1607, look it up dynamically
+    typedef HRESULT(WINAPI * SetThreadDescription_t)(HANDLE hThread, PCWSTR lpThreadDescription);
+    static SetThreadDescription_t s_setThreadDescription =
+        (SetThreadDescription_t)GetProcAddress(GetModuleHandle(TEXT("kernel32.dll")), "SetThreadDescription");
+
+    if (s_setThreadDescription != nullptr)
+    {
+        c16 name[FLORAL_MAX_NAME_LENGTH];
+        to_wcstr(i_name, name, FLORAL_MAX_NAME_LENGTH);
+        s_setThreadDescription(i_thread, name);
+    }
+}
+
 // ----------------------------------------------------------------------------
 
 void thread_sleep(u32 i_durationMs)
@@ -29,6 +68,27 @@ str8 thread_get_id_as_str(arena_t* const i_arena)
     return idStr;
 }
 
+bool thread_set_current_affinity(const u64 i_affinityMask)
+{
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)i_affinityMask) != 0;
+}
+
+bool thread_set_current_priority(const thread_priority_e i_priority, const thread_sched_policy_e i_policy)
+{
+    MARK_UNUSED(i_policy);
+    return SetThreadPriority(GetCurrentThread(), to_windows_priority(i_priority)) != FALSE;
+}
+
+void thread_set_current_name(const_cstr i_name)
+{
+    set_thread_name(GetCurrentThread(), i_name);
+}
+
+u32 thread_get_current_cpu()
+{
+    return (u32)GetCurrentProcessorNumber();
+}
+
 // ----------------------------------------------------------------------------
 
 thread_t create_thread(const thread_desc_t* i_desc)
@@ -46,9 +106,28 @@ void initialize_thread(thread_t* const io_thread, const thread_desc_t& i_desc)
 
 void thread_start(thread_t* const io_thread)
 {
+    const thread_desc_t& desc = io_thread->desc;
     DWORD id = 0;
-    io_thread->platformData.handle = CreateThread(NULL, 0, &thread_func, (LPVOID)&(io_thread->desc), 0, &id);
+    // start suspended so the scheduling controls are in place before the first instruction runs
+    HANDLE handle = CreateThread(NULL, (SIZE_T)desc.stackSize, &thread_func, (LPVOID)&(io_thread->desc), CREATE_SUSPENDED, &id);
+    FLORAL_ASSERT(handle != NULL);
+
+    if (desc.affinityMask != 0)
+    {
+        SetThreadAffinityMask(handle, (DWORD_PTR)desc.affinityMask);
+    }
+    if (desc.priority != thread_priority_e::normal)
+    {
+        SetThreadPriority(handle, to_windows_priority(desc.priority));
+    }
+    if (desc.name != nullptr)
+    {
+        set_thread_name(handle, desc.name);
+    }
+
+    io_thread->platformData.handle = handle;
     io_thread->platformData.id = id;
+    ResumeThread(handle);
 }
 
 void thread_join(thread_t* const io_thread)
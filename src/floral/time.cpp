@@ -8,6 +8,15 @@
 #  include <time.h>
 #endif
 
+#if defined(FLORAL_CPU_INTEL)
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#  else
+#    include <cpuid.h>
+#    include <x86intrin.h>
+#  endif
+#endif
+
 // ----------------------------------------------------------------------------
 
 #if defined(FLORAL_PLATFORM_WINDOWS)
@@ -29,8 +38,23 @@ typedef linux_time_t platform_time_t;
 // TODO
 #endif
 
+struct tick_clock_t
+{
+    u64 frequency; // ticks per second
+    f64 msPerTick;
+    f64 ticksPerMs;
+    bool useTsc;
+    bool hasRdtscp;
+};
+
+// how long we spin against the reference clock to find the TSC frequency, the reference clock
+// has sub-microsecond resolution so this gives us an error well below 0.01%
+static constexpr f64 k_tscCalibrationMs = 5.0;
+
 static platform_time_t initialize_time();
 static platform_time_t s_platformTime = initialize_time();
+static tick_clock_t initialize_tick_clock();
+static tick_clock_t s_tickClock = initialize_tick_clock();
 
 // ----------------------------------------------------------------------------
 
@@ -118,7 +142,7 @@ timepoint time_get_local_now()
     return timepoint{};
 }
 
-f32 get_time_absolute()
+static timespec get_elapsed_timespec()
 {
     timespec currentTime;
     clock_gettime(CLOCK_MONOTONIC, &currentTime);
@@ -133,10 +157,200 @@ f32 get_time_absolute()
         diff.tv_sec = currentTime.tv_sec - s_platformTime.startTime.tv_sec;
         diff.tv_nsec = currentTime.tv_nsec - s_platformTime.startTime.tv_nsec;
     }
+    return diff;
+}
 
+f32 time_get_absolute_ms()
+{
+    const timespec diff = get_elapsed_timespec();
     f32 diffMillis = diff.tv_sec * 1000.0f + (f32)diff.tv_nsec / 1000000.0f;
     return diffMillis;
 }
+
+f64 time_get_absolute_highres_ms()
+{
+    const timespec diff = get_elapsed_timespec();
+    f64 diffMillis = (f64)diff.tv_sec * 1000.0 + (f64)diff.tv_nsec / 1000000.0;
+    return diffMillis;
+}
 #else
 // TODO
 #endif
+
+// ----------------------------------------------------------------------------
+// tick clock
+
+// the reference clock, also used as the fallback tick source
+#if defined(FLORAL_PLATFORM_WINDOWS)
+static u64 get_os_ticks()
+{
+    LARGE_INTEGER currentTime;
+    QueryPerformanceCounter(&currentTime);
+    return (u64)currentTime.QuadPart;
+}
+
+static u64 get_os_ticks_frequency()
+{
+    return (u64)s_platformTime.perfFreq.QuadPart;
+}
+#elif defined(FLORAL_PLATFORM_LINUX)
+static u64 get_os_ticks()
+{
+    timespec currentTime;
+    clock_gettime(CLOCK_MONOTONIC, &currentTime);
+    return (u64)currentTime.tv_sec * 1000000000ull + (u64)currentTime.tv_nsec;
+}
+
+static u64 get_os_ticks_frequency()
+{
+    return 1000000000ull;
+}
+#else
+// TODO
+#endif
+
+#if defined(FLORAL_CPU_INTEL)
+static void query_cpuid(u32 i_leaf, u32 o_registers[4])
+{
+#  if defined(_MSC_VER)
+    s32 registers[4];
+    __cpuid(registers, (s32)i_leaf);
+    for (u32 i = 0; i < 4; i++)
+    {
+        o_registers[i] = (u32)registers[i];
+    }
+#  else
+    __cpuid(i_leaf, o_registers[0], o_registers[1], o_registers[2], o_registers[3]);
+#  endif
+}
+
+static u64 read_tsc()
+{
+    return __rdtsc();
+}
+
+static u64 read_tscp()
+{
+    u32 aux = 0;
+    return __rdtscp(&aux);
+}
+
+static tick_clock_t initialize_tick_clock()
+{
+    tick_clock_t clock = {};
+    clock.frequency = get_os_ticks_frequency();
+    clock.useTsc = false;
+    clock.hasRdtscp = false;
+
+    // ref: Intel 64 and IA-32 Architectures Software Developer's Manual - Volume 3 - section 18.17.1
+    // the TSC only counts at a constant rate in all ACPI P-, C- and T-states if it is invariant
+    u32 registers[4];
+    query_cpuid(0x80000000, registers);
+    const u32 maxExtLeaf = registers[0];
+    if (maxExtLeaf >= 0x80000007)
+    {
+        query_cpuid(0x80000001, registers);
+        clock.hasRdtscp = (registers[3] & (1u << 27)) != 0;
+
+        query_cpuid(0x80000007, registers);
+        const bool isInvariant = (registers[3] & (1u << 8)) != 0;
+        if (isInvariant)
+        {
+            const u64 refFreq = get_os_ticks_frequency();
+            const u64 refWindow = (u64)(k_tscCalibrationMs * 0.001 * (f64)refFreq);
+
+            const u64 refBegin = get_os_ticks();
+            const u64 tscBegin = read_tsc();
+            u64 refEnd = refBegin;
+            while (refEnd - refBegin < refWindow)
+            {
+                refEnd = get_os_ticks();
+            }
+            const u64 tscEnd = read_tsc();
+
+            const f64 refSeconds = (f64)(refEnd - refBegin) / (f64)refFreq;
+            if (tscEnd > tscBegin && refSeconds > 0.0)
+            {
+                clock.frequency = (u64)((f64)(tscEnd - tscBegin) / refSeconds);
+                clock.useTsc = true;
+            }
+        }
+    }
+
+    clock.msPerTick = 1000.0 / (f64)clock.frequency;
+    clock.ticksPerMs = (f64)clock.frequency / 1000.0;
+    return clock;
+}
+
+u64 time_get_ticks()
+{
+    return s_tickClock.useTsc ? read_tsc() : get_os_ticks();
+}
+
+u64 time_get_ticks_serialized()
+{
+    if (s_tickClock.useTsc)
+    {
+        if (s_tickClock.hasRdtscp)
+        {
+            return read_tscp();
+        }
+        _mm_lfence();
+        return read_tsc();
+    }
+    return get_os_ticks();
+}
+#else
+static tick_clock_t initialize_tick_clock()
+{
+    tick_clock_t clock = {};
+    clock.frequency = get_os_ticks_frequency();
+    clock.msPerTick = 1000.0 / (f64)clock.frequency;
+    clock.ticksPerMs = (f64)clock.frequency / 1000.0;
+    return clock;
+}
+
+u64 time_get_ticks()
+{
+    return get_os_ticks();
+}
+
+u64 time_get_ticks_serialized()
+{
+    return get_os_ticks();
+}
+#endif
+
+u64 time_get_ticks_frequency()
+{
+    return s_tickClock.frequency;
+}
+
+bool time_is_tsc_clock()
+{
+    return s_tickClock.useTsc;
+}
+
+f64 time_ticks_to_ms(const u64 i_ticks)
+{
+    return (f64)i_ticks * s_tickClock.msPerTick;
+}
+
+f64 time_ticks_to_us(const u64 i_ticks)
+{
+    return (f64)i_ticks * s_tickClock.msPerTick * 1000.0;
+}
+
+u64 time_ticks_to_ns(const u64 i_ticks)
+{
+    // split to avoid overflowing the intermediate product for large intervals
+    const u64 freq = s_tickClock.frequency;
+    const u64 seconds = i_ticks / freq;
+    const u64 remainder = i_ticks % freq;
+    return seconds * 1000000000ull + (remainder * 1000000000ull) / freq;
+}
+
+u64 time_ms_to_ticks(const f64 i_ms)
+{
+    return (u64)(i_ms * s_tickClock.ticksPerMs);
+}
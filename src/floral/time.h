@@ -18,3 +18,15 @@ timepoint time_get_system_now();
 timepoint time_get_local_now();
 f32 time_get_absolute_ms();         // milliseconds
 f64 time_get_absolute_highres_ms(); // milliseconds
+
+// Raw monotonic ticks for timestamping hot paths. Backed by the invariant TSC when the cpu has
+// one (calibrated once at startup), by the OS high-resolution counter otherwise. Only the
+// difference between two ticks values is meaningful, convert them with the helpers below.
+u64 time_get_ticks();
+u64 time_get_ticks_serialized(); // waits for prior instructions to retire, use to close a measured region
+u64 time_get_ticks_frequency();  // ticks per second
+bool time_is_tsc_clock();
+f64 time_ticks_to_ms(const u64 i_ticks);
+f64 time_ticks_to_us(const u64 i_ticks);
+u64 time_ticks_to_ns(const u64 i_ticks);
+u64 time_ms_to_ticks(const f64 i_ms);
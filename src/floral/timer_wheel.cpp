@@ -0,0 +1,337 @@
+#include "timer_wheel.h"
+
+#include "assert.h"
+#include "misc.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+// generations are kept within 20 bits so a handle survives a round-trip through a double (Lua)
+static constexpr u32 k_generationMask = 0xfffff;
+
+static timer_handle_t make_handle(const u32 i_index, const u32 i_generation)
+{
+    return ((u64)(i_generation & k_generationMask) << 32) | (u64)(i_index + 1);
+}
+
+static timer_node_t* resolve_handle(const timer_wheel_t* const i_wheel, const timer_handle_t i_handle)
+{
+    const u32 index = (u32)(i_handle & 0xffffffff);
+    if (index == 0 || index > i_wheel->desc.maxTimers)
+    {
+        return nullptr;
+    }
+
+    timer_node_t* const node = &i_wheel->nodes[index - 1];
+    const u32 generation = (u32)(i_handle >> 32);
+    if (!node->active || (node->generation & k_generationMask) != generation)
+    {
+        return nullptr;
+    }
+    return node;
+}
+
+static void list_push(timer_list_t* const io_list, timer_node_t* const i_node)
+{
+    i_node->list = io_list;
+    i_node->prev = nullptr;
+    i_node->next = io_list->first;
+    if (io_list->first)
+    {
+        io_list->first->prev = i_node;
+    }
+    io_list->first = i_node;
+}
+
+static void list_remove(timer_list_t* const io_list, timer_node_t* const i_node)
+{
+    if (i_node->prev)
+    {
+        i_node->prev->next = i_node->next;
+    }
+    else
+    {
+        io_list->first = i_node->next;
+    }
+
+    if (i_node->next)
+    {
+        i_node->next->prev = i_node->prev;
+    }
+    i_node->next = nullptr;
+    i_node->prev = nullptr;
+    i_node->list = nullptr;
+}
+
+static timer_list_t* find_list(timer_wheel_t* const i_wheel, const timer_node_t* const i_node)
+{
+    const u64 current = i_wheel->currentTick;
+    // anything already due goes to the slot being processed, this only happens while cascading
+    const u64 expire = math_max(i_node->deadline, current);
+
+    // a timer lives in the lowest level above which its expiry and the current time agree, that
+    // way the slot is guaranteed to be cascaded before the expiry is reached
+    for (u32 level = 0; level < TIMER_WHEEL_LEVELS; level++)
+    {
+        const u32 upperShift = (level + 1) * TIMER_WHEEL_SLOT_BITS;
+        if ((expire >> upperShift) == (current >> upperShift))
+        {
+            const u32 slot = (u32)((expire >> (level * TIMER_WHEEL_SLOT_BITS)) & (TIMER_WHEEL_SLOTS - 1));
+            return &i_wheel->slots[level][slot];
+        }
+    }
+
+    return &i_wheel->overflow;
+}
+
+static void insert_node(timer_wheel_t* const i_wheel, timer_node_t* const i_node)
+{
+    list_push(find_list(i_wheel, i_node), i_node);
+}
+
+static void free_node(timer_wheel_t* const i_wheel, timer_node_t* const i_node)
+{
+    i_node->active = false;
+    i_node->generation++;
+    i_node->next = i_wheel->freeList;
+    i_wheel->freeList = i_node;
+    i_wheel->activeCount--;
+}
+
+static void cascade(timer_wheel_t* const i_wheel, timer_list_t* const io_list)
+{
+    timer_node_t* it = io_list->first;
+    io_list->first = nullptr;
+    while (it)
+    {
+        timer_node_t* const next = it->next;
+        insert_node(i_wheel, it);
+        it = next;
+    }
+}
+
+static u64 to_ticks(const timer_wheel_t* const i_wheel, const u64 i_ms)
+{
+    return i_ms / i_wheel->desc.resolutionMs;
+}
+
+static u64 to_ticks_ceil(const timer_wheel_t* const i_wheel, const u64 i_ms)
+{
+    return (i_ms + i_wheel->desc.resolutionMs - 1) / i_wheel->desc.resolutionMs;
+}
+
+// ----------------------------------------------------------------------------
+
+size calculate_memory_size_for_timer_wheel(const timer_wheel_desc_t& i_desc)
+{
+    return i_desc.maxTimers * sizeof(timer_node_t);
+}
+
+void initialize_timer_wheel(timer_wheel_t* const io_wheel, const timer_wheel_desc_t& i_desc, const u64 i_nowMs,
+                            voidptr i_memory, const size i_memorySize)
+{
+    FLORAL_ASSERT(i_memorySize >= calculate_memory_size_for_timer_wheel(i_desc));
+    FLORAL_ASSERT(i_desc.resolutionMs > 0);
+    MARK_UNUSED(i_memorySize);
+
+    io_wheel->desc = i_desc;
+    io_wheel->currentTick = i_nowMs / i_desc.resolutionMs;
+    mem_fill(io_wheel->slots, 0, sizeof(io_wheel->slots));
+    io_wheel->overflow.first = nullptr;
+
+    io_wheel->nodes = (timer_node_t*)i_memory;
+    io_wheel->freeList = nullptr;
+    for (s32 i = (s32)i_desc.maxTimers - 1; i >= 0; i--)
+    {
+        timer_node_t* const node = &io_wheel->nodes[i];
+        node->prev = nullptr;
+        node->list = nullptr;
+        node->next = io_wheel->freeList;
+        node->generation = 1;
+        node->active = false;
+        io_wheel->freeList = node;
+    }
+    io_wheel->activeCount = 0;
+}
+
+timer_handle_t timer_wheel_schedule(timer_wheel_t* const i_wheel, const u64 i_delayMs, const u64 i_periodMs,
+                                    timer_callback_t i_callback, voidptr i_data)
+{
+    timer_node_t* const node = i_wheel->freeList;
+    if (node == nullptr)
+    {
+        FLORAL_ASSERT_MSG(false, "timer_wheel_t overflow");
+        return k_invalidTimerHandle;
+    }
+    i_wheel->freeList = node->next;
+    i_wheel->activeCount++;
+
+    node->deadline = i_wheel->currentTick + math_max(to_ticks_ceil(i_wheel, i_delayMs), 1ull);
+    node->period = i_periodMs > 0 ? math_max(to_ticks(i_wheel, i_periodMs), 1ull) : 0;
+    node->callback = i_callback;
+    node->data = i_data;
+    node->active = true;
+    insert_node(i_wheel, node);
+
+    return make_handle((u32)(node - i_wheel->nodes), node->generation);
+}
+
+bool timer_wheel_cancel(timer_wheel_t* const i_wheel, const timer_handle_t i_handle)
+{
+    timer_node_t* const node = resolve_handle(i_wheel, i_handle);
+    if (node == nullptr)
+    {
+        return false;
+    }
+
+    list_remove(node->list, node);
+    free_node(i_wheel, node);
+    return true;
+}
+
+bool timer_wheel_set_period(timer_wheel_t* const i_wheel, const timer_handle_t i_handle, const u64 i_periodMs)
+{
+    timer_node_t* const node = resolve_handle(i_wheel, i_handle);
+    if (node == nullptr || node->period == 0 || i_periodMs == 0)
+    {
+        return false;
+    }
+
+    node->period = math_max(to_ticks(i_wheel, i_periodMs), 1ull);
+    return true;
+}
+
+bool timer_wheel_reschedule(timer_wheel_t* const i_wheel, const timer_handle_t i_handle, const u64 i_delayMs)
+{
+    timer_node_t* const node = resolve_handle(i_wheel, i_handle);
+    if (node == nullptr)
+    {
+        return false;
+    }
+
+    list_remove(node->list, node);
+    node->deadline = i_wheel->currentTick + math_max(to_ticks_ceil(i_wheel, i_delayMs), 1ull);
+    insert_node(i_wheel, node);
+    return true;
+}
+
+bool timer_wheel_is_active(const timer_wheel_t* const i_wheel, const timer_handle_t i_handle)
+{
+    return resolve_handle(i_wheel, i_handle) != nullptr;
+}
+
+u32 timer_wheel_advance(timer_wheel_t* const i_wheel, const u64 i_nowMs)
+{
+    const u64 targetTick = to_ticks(i_wheel, i_nowMs);
+    u32 firedCount = 0;
+
+    while (i_wheel->currentTick < targetTick)
+    {
+        // nothing to do, jump straight to the target
+        if (i_wheel->activeCount == 0)
+        {
+            i_wheel->currentTick = targetTick;
+            break;
+        }
+
+        const u64 tick = ++i_wheel->currentTick;
+
+        // cascade the higher levels whose index just wrapped around
+        for (u32 level = 1; level < TIMER_WHEEL_LEVELS; level++)
+        {
+            const u32 lowerShift = level * TIMER_WHEEL_SLOT_BITS;
+            if ((tick & ((1ull << lowerShift) - 1)) != 0)
+            {
+                break;
+            }
+
+            const u32 slot = (u32)((tick >> lowerShift) & (TIMER_WHEEL_SLOTS - 1));
+            cascade(i_wheel, &i_wheel->slots[level][slot]);
+            if (slot == 0 && level == TIMER_WHEEL_LEVELS - 1)
+            {
+                cascade(i_wheel, &i_wheel->overflow);
+            }
+        }
+
+        // fire, a callback is free to schedule or cancel any timer (including itself) so we
+        // always pop the head of the slot instead of walking the list
+        timer_list_t* const slot = &i_wheel->slots[0][tick & (TIMER_WHEEL_SLOTS - 1)];
+        while (slot->first)
+        {
+            timer_node_t* const node = slot->first;
+            list_remove(slot, node);
+            FLORAL_ASSERT(node->deadline <= tick);
+
+            const timer_handle_t handle = make_handle((u32)(node - i_wheel->nodes), node->generation);
+            const u64 deadlineMs = node->deadline * i_wheel->desc.resolutionMs;
+
+            if (node->period > 0)
+            {
+                // drift-free: re-arm from the deadline, skip the periods we missed entirely
+                u64 nextDeadline = node->deadline + node->period;
+                if (nextDeadline <= targetTick)
+                {
+                    const u64 missed = (targetTick - nextDeadline) / node->period + 1;
+                    nextDeadline += missed * node->period;
+                }
+                node->deadline = nextDeadline;
+                insert_node(i_wheel, node);
+                node->callback(i_wheel, handle, deadlineMs, node->data);
+            }
+            else
+            {
+                timer_callback_t callback = node->callback;
+                voidptr data = node->data;
+                free_node(i_wheel, node);
+                callback(i_wheel, handle, deadlineMs, data);
+            }
+            firedCount++;
+        }
+    }
+
+    return firedCount;
+}
+
+bool timer_wheel_get_next_expiry(const timer_wheel_t* const i_wheel, u64* o_expiryMs)
+{
+    if (i_wheel->activeCount == 0)
+    {
+        return false;
+    }
+
+    const u64 current = i_wheel->currentTick;
+    // levels are ordered: every timer of a level expires before any timer of the levels above, and
+    // inside a level the slots ahead of the current index are ordered as well
+    for (u32 level = 0; level < TIMER_WHEEL_LEVELS; level++)
+    {
+        const u32 shift = level * TIMER_WHEEL_SLOT_BITS;
+        const u32 currentSlot = (u32)((current >> shift) & (TIMER_WHEEL_SLOTS - 1));
+        for (u32 slot = currentSlot + (level == 0 ? 1 : 0); slot < TIMER_WHEEL_SLOTS; slot++)
+        {
+            const timer_node_t* it = i_wheel->slots[level][slot].first;
+            if (it)
+            {
+                u64 earliest = it->deadline;
+                for (; it; it = it->next)
+                {
+                    earliest = math_min(earliest, it->deadline);
+                }
+                *o_expiryMs = math_max(earliest, current + 1) * i_wheel->desc.resolutionMs;
+                return true;
+            }
+        }
+    }
+
+    const timer_node_t* it = i_wheel->overflow.first;
+    if (it)
+    {
+        u64 earliest = it->deadline;
+        for (; it; it = it->next)
+        {
+            earliest = math_min(earliest, it->deadline);
+        }
+        *o_expiryMs = earliest * i_wheel->desc.resolutionMs;
+        return true;
+    }
+
+    return false;
+}
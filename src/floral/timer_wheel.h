@@ -0,0 +1,80 @@
+#pragma once
+
+#include "stdaliases.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Hierarchical hashed timer wheel
+// - O(1) schedule and cancel, expiries are cascaded down one level at a time while advancing
+// - periodic timers are re-armed from their previous deadline, not from the firing time, so they
+//   keep their phase no matter how late the wheel is advanced
+// - not thread-safe, a wheel must be owned by a single thread
+
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+
+typedef u64 timer_handle_t;
+constexpr timer_handle_t k_invalidTimerHandle = 0;
+
+struct timer_wheel_t;
+struct timer_list_t;
+// i_deadlineMs is the scheduled expiry, not the time at which the wheel got advanced
+typedef void (*timer_callback_t)(timer_wheel_t* const i_wheel, const timer_handle_t i_handle, const u64 i_deadlineMs, voidptr i_data);
+
+struct timer_node_t
+{
+    timer_node_t* next;
+    timer_node_t* prev;
+    timer_list_t* list; // the slot the node is currently linked in
+
+    u64 deadline; // in wheel ticks
+    u64 period;   // in wheel ticks, 0 for one-shot timers
+    timer_callback_t callback;
+    voidptr data;
+
+    u32 generation;
+    bool active;
+};
+
+struct timer_list_t
+{
+    timer_node_t* first;
+};
+
+struct timer_wheel_desc_t
+{
+    u32 maxTimers;
+    u32 resolutionMs; // length of a level 0 slot
+};
+
+struct timer_wheel_t
+{
+    timer_wheel_desc_t desc;
+    u64 currentTick;
+
+    timer_list_t slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    timer_list_t overflow; // further than what the highest level can represent
+
+    timer_node_t* nodes;
+    timer_node_t* freeList;
+    u32 activeCount;
+};
+
+size calculate_memory_size_for_timer_wheel(const timer_wheel_desc_t& i_desc);
+void initialize_timer_wheel(timer_wheel_t* const io_wheel, const timer_wheel_desc_t& i_desc, const u64 i_nowMs,
+                            voidptr i_memory, const size i_memorySize);
+
+// i_periodMs == 0 makes a one-shot timer
+timer_handle_t timer_wheel_schedule(timer_wheel_t* const i_wheel, const u64 i_delayMs, const u64 i_periodMs,
+                                    timer_callback_t i_callback, voidptr i_data);
+bool timer_wheel_cancel(timer_wheel_t* const i_wheel, const timer_handle_t i_handle);
+// change the period of a periodic timer, applied after its next expiry
+bool timer_wheel_set_period(timer_wheel_t* const i_wheel, const timer_handle_t i_handle, const u64 i_periodMs);
+// move the next expiry of a timer to i_delayMs from the current wheel time, keeping its period
+bool timer_wheel_reschedule(timer_wheel_t* const i_wheel, const timer_handle_t i_handle, const u64 i_delayMs);
+bool timer_wheel_is_active(const timer_wheel_t* const i_wheel, const timer_handle_t i_handle);
+
+// fire every timer expiring before or at i_nowMs, returns the number of fired callbacks
+u32 timer_wheel_advance(timer_wheel_t* const i_wheel, const u64 i_nowMs);
+// returns false when there is no active timer
+bool timer_wheel_get_next_expiry(const timer_wheel_t* const i_wheel, u64* o_expiryMs);
@@ -326,7 +326,10 @@ vec3f apply_point_transform(const vec3f& i_p, const mat4x4f& i_m);
 
 ///////////////////////////////////////////////////////////////////////////////
 // quaternion
+// GCC does not allow the vec3f view (a member with a constructor) in the anonymous union, the
+// quaternions are left out there: the Linux test programs only need the vectors
 
+#if !defined(__GNUC__) || defined(__clang__)
 struct quaternionf // NOLINT(readability-identifier-naming)
 {
     union
@@ -362,6 +365,7 @@ quaternionf construct_quaternion_axis(const vec3f& i_axis, const f32 i_r);
 quaternionf construct_quaternion_axis_rad(const vec3f& i_axis, const f32 i_r);
 quaternionf construct_quaternion_v2v(const vec3f& i_v0, const vec3f& i_v1);
 mat4x4f to_transform(const quaternionf& i_q);
+#endif
 
 ///////////////////////////////////////////////////////////////////////////////
 // utils
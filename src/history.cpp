@@ -0,0 +1,452 @@
+#include "history.h"
+
+#include <floral/assert.h>
+#include <floral/atomic.h>
+#include <floral/log.h>
+#include <floral/misc.h>
+#include <floral/string_utils.h>
+
+#include "scripting.h"
+
+static HSTContext s_historyContext;
+
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_historyMask = k_historyCapacity - 1;
+// the slot after the newest sample may be in the middle of being rewritten, it is never read
+constexpr u32 k_historyReadableCount = k_historyCapacity - 1;
+
+static_assert((k_historyCapacity & k_historyMask) == 0, "History capacity must be a power of 2");
+
+static bool IsNumericField(const PRVField& i_field)
+{
+    return i_field.type == PRVFieldType::F32 || i_field.type == PRVFieldType::U32 || i_field.type == PRVFieldType::S32 ||
+           i_field.type == PRVFieldType::U64;
+}
+
+// f64 keeps the byte counters exact up to 2^53, an f32 would round them to 2^24
+static f64 ReadNumericField(const PRVField& i_field, const u8* i_record)
+{
+    const u8* data = i_record + i_field.offset;
+    switch (i_field.type)
+    {
+    case PRVFieldType::F32:
+        return *(const f32*)data;
+    case PRVFieldType::U32:
+        return (f64)*(const u32*)data;
+    case PRVFieldType::S32:
+        return (f64)*(const s32*)data;
+    case PRVFieldType::U64:
+        return (f64)*(const u64*)data;
+    default:
+        FLORAL_ASSERT(false);
+        return 0.0;
+    }
+}
+
+static u32 GetOldestReadable(const u32 i_count)
+{
+    return i_count > k_historyReadableCount ? i_count - k_historyReadableCount : 0;
+}
+
+// ----------------------------------------------------------------------------
+
+// the functions shared by all the views have their source as first upvalue
+static const HSTViewSource* GetViewSource(lua_State* i_vm)
+{
+    return (const HSTViewSource*)lua_touserdata(i_vm, lua_upvalueindex(1));
+}
+
+// 1-based, as seen from the scripts
+static bool ReadViewEntry(const HSTView* i_view, const s32 i_index, u64* o_startMs, u64* o_endMs, f64* o_value)
+{
+    if (i_index < 1 || (u32)i_index > i_view->window.length)
+    {
+        return false;
+    }
+    return i_view->source->read(*i_view, (u32)i_index - 1, o_startMs, o_endMs, o_value);
+}
+
+// the methods are the second upvalue
+static s32 ScriptingViewIndex(lua_State* i_vm)
+{
+    const HSTView* view = HSTCheckView(i_vm, GetViewSource(i_vm), 1);
+    if (lua_type(i_vm, 2) == LUA_TNUMBER)
+    {
+        u64 startMs = 0;
+        u64 endMs = 0;
+        f64 value = 0.0;
+        if (ReadViewEntry(view, (s32)lua_tointeger(i_vm, 2), &startMs, &endMs, &value))
+        {
+            lua_pushnumber(i_vm, value);
+        }
+        else
+        {
+            lua_pushnil(i_vm);
+        }
+        return 1;
+    }
+
+    // methods
+    lua_pushvalue(i_vm, 2);
+    lua_rawget(i_vm, lua_upvalueindex(2));
+    return 1;
+}
+
+static s32 ScriptingViewLength(lua_State* i_vm)
+{
+    const HSTView* view = HSTCheckView(i_vm, GetViewSource(i_vm), 1);
+    lua_pushinteger(i_vm, (lua_Integer)view->window.length);
+    return 1;
+}
+
+static s32 ScriptingViewNewIndex(lua_State* i_vm)
+{
+    return luaL_error(i_vm, "%s views are read-only", GetViewSource(i_vm)->kind);
+}
+
+// view:time(i), the time in ms of the i-th entry (its start for a bucket), see get_time_ms()
+static s32 ScriptingViewTime(lua_State* i_vm)
+{
+    const HSTView* view = HSTCheckView(i_vm, GetViewSource(i_vm), 1);
+    u64 startMs = 0;
+    u64 endMs = 0;
+    f64 value = 0.0;
+    if (ReadViewEntry(view, (s32)luaL_checkinteger(i_vm, 2), &startMs, &endMs, &value))
+    {
+        lua_pushnumber(i_vm, (lua_Number)startMs);
+    }
+    else
+    {
+        lua_pushnil(i_vm);
+    }
+    return 1;
+}
+
+// view:last(n), the n newest entries of the view
+static s32 ScriptingViewLast(lua_State* i_vm)
+{
+    const HSTView* view = HSTCheckView(i_vm, GetViewSource(i_vm), 1);
+    const s32 count = (s32)luaL_checkinteger(i_vm, 2);
+    HSTWindow window = view->window;
+    window.length = count > 0 ? math_min((u32)count, window.length) : 0;
+    HSTPushView(i_vm, view->source, view->series, view->tier, window);
+    return 1;
+}
+
+// view:since(t), the entries of the view ending after t (ms), the samples taken at or after t
+static s32 ScriptingViewSince(lua_State* i_vm)
+{
+    const HSTView* view = HSTCheckView(i_vm, GetViewSource(i_vm), 1);
+    const lua_Number sinceMs = luaL_checknumber(i_vm, 2);
+    HSTPushView(i_vm, view->source, view->series, view->tier, HSTNarrowViewWindow(*view, sinceMs > 0 ? (u64)sinceMs : 0));
+    return 1;
+}
+
+static s32 ScriptingViewName(lua_State* i_vm)
+{
+    const HSTView* view = HSTCheckView(i_vm, GetViewSource(i_vm), 1);
+    lua_pushstring(i_vm, s_historyContext.series[view->series].name);
+    return 1;
+}
+
+// ----------------------------------------------------------------------------
+
+// a sample covers the ms it was taken at
+static bool ReadHistoryViewSample(const HSTView& i_view, const u32 i_index, u64* o_startMs, u64* o_endMs, f64* o_value)
+{
+    const bool read = HSTReadSample(&s_historyContext.series[i_view.series], i_view.window, i_index, o_startMs, o_value);
+    *o_endMs = *o_startMs + 1;
+    return read;
+}
+
+static const HSTViewSource k_historyViewSource = { "history", "history_view", &ReadHistoryViewSample };
+
+// view:stats(), min, max and mean of the samples still available, nil when there are none
+static s32 ScriptingViewStats(lua_State* i_vm)
+{
+    const HSTView* view = HSTCheckView(i_vm, &k_historyViewSource, 1);
+    const HSTSeries* series = &s_historyContext.series[view->series];
+    f64 minValue = 0.0;
+    f64 maxValue = 0.0;
+    f64 sum = 0.0;
+    u32 samplesCount = 0;
+    for (u32 i = 0; i < view->window.length; i++)
+    {
+        u64 timestampMs = 0;
+        f64 value = 0.0;
+        if (!HSTReadSample(series, view->window, i, &timestampMs, &value))
+        {
+            continue;
+        }
+
+        minValue = samplesCount == 0 ? value : math_min(minValue, value);
+        maxValue = samplesCount == 0 ? value : math_max(maxValue, value);
+        sum += value;
+        samplesCount++;
+    }
+
+    if (samplesCount == 0)
+    {
+        lua_pushnil(i_vm);
+        return 1;
+    }
+
+    lua_pushnumber(i_vm, minValue);
+    lua_pushnumber(i_vm, maxValue);
+    lua_pushnumber(i_vm, sum / samplesCount);
+    return 3;
+}
+
+// get_history(name), a view over all the samples of the series, nil when there is no such series
+static s32 ScriptingGetHistory(lua_State* i_vm)
+{
+    const HSTSeries* series = HSTFindSeries(luaL_checkstring(i_vm, 1));
+    if (series == nullptr)
+    {
+        lua_pushnil(i_vm);
+        return 1;
+    }
+
+    HSTPushView(i_vm, &k_historyViewSource, (u32)(series - s_historyContext.series), 0, HSTGetWindowAll(series));
+    return 1;
+}
+
+// get_history_series(), the names get_history() accepts
+static s32 ScriptingGetHistorySeries(lua_State* i_vm)
+{
+    lua_createtable(i_vm, (s32)s_historyContext.seriesCount, 0);
+    for (u32 i = 0; i < s_historyContext.seriesCount; i++)
+    {
+        lua_pushstring(i_vm, s_historyContext.series[i].name);
+        lua_rawseti(i_vm, -2, (s32)i + 1);
+    }
+    return 1;
+}
+
+// ----------------------------------------------------------------------------
+
+void HSTInitialize(linear_allocator_t* const i_allocator)
+{
+    LOG_SCOPE(history);
+
+    s_historyContext.seriesCount = 0;
+    for (u32 i = 0; i < PRVGetProvidersCount(); i++)
+    {
+        s_historyContext.firstSeries[i] = s_historyContext.seriesCount;
+        s_historyContext.providerSeriesCount[i] = 0;
+        if (!PRVIsEnabled(i))
+        {
+            continue;
+        }
+
+        const PRVProviderDesc* provider = PRVGetProvider(i);
+        for (u32 j = 0; j < provider->schema->fieldsCount; j++)
+        {
+            const PRVField& field = provider->schema->fields[j];
+            if (!IsNumericField(field))
+            {
+                continue;
+            }
+
+            if (s_historyContext.seriesCount >= k_maxHistorySeries)
+            {
+                LOG_WARNING("Too many series (max: %d), '%s.%s' is not recorded", k_maxHistorySeries, provider->name, field.name);
+                continue;
+            }
+
+            HSTSeries* series = &s_historyContext.series[s_historyContext.seriesCount++];
+            cstr_snprintf(series->name, k_maxHistoryNameLength, "%s.%s", provider->name, field.name);
+            series->field = &field;
+            series->providerIndex = i;
+            series->count = 0;
+            s_historyContext.providerSeriesCount[i]++;
+        }
+    }
+
+    const size ringSize = k_historyCapacity * (sizeof(u64) + sizeof(f64));
+    s_historyContext.arena = create_arena(i_allocator, SIZE_KB(4) + s_historyContext.seriesCount * ringSize);
+    for (u32 i = 0; i < s_historyContext.seriesCount; i++)
+    {
+        HSTSeries* series = &s_historyContext.series[i];
+        series->timestamps = arena_push_podarr(&s_historyContext.arena, u64, k_historyCapacity);
+        series->values = arena_push_podarr(&s_historyContext.arena, f64, k_historyCapacity);
+    }
+
+    s_historyContext.ready = true;
+    LOG_DEBUG("%d series of %d samples", s_historyContext.seriesCount, k_historyCapacity);
+}
+
+void HSTCleanUp()
+{
+    FLORAL_ASSERT(s_historyContext.ready);
+    s_historyContext.ready = false;
+}
+
+void HSTBindScriptingAPIs()
+{
+    lua_State* vm = SCRGetContext()->vm;
+    SCRStackGuard guard(vm);
+
+    static const luaL_Reg k_historyViewMethods[] = {
+        { "stats", &ScriptingViewStats },
+        { nullptr, nullptr }
+    };
+    HSTBindViewMetatable(vm, &k_historyViewSource, k_historyViewMethods);
+
+    SCRRegisterFunc(&ScriptingGetHistory, "get_history", nullptr);
+    SCRRegisterFunc(&ScriptingGetHistorySeries, "get_history_series", nullptr);
+}
+
+void HSTAppend(const u32 i_providerIndex, const u64 i_timestampMs, const u8* i_record)
+{
+    const u32 first = s_historyContext.firstSeries[i_providerIndex];
+    for (u32 i = 0; i < s_historyContext.providerSeriesCount[i_providerIndex]; i++)
+    {
+        HSTSeries* series = &s_historyContext.series[first + i];
+        const u32 count = series->count;
+        const u32 slot = count & k_historyMask;
+        series->timestamps[slot] = i_timestampMs;
+        series->values[slot] = ReadNumericField(*series->field, i_record);
+        // the slot has to be written before the reader can see it
+        interlocked_exchange(&series->count, count + 1);
+    }
+}
+
+u32 HSTGetSeriesCount()
+{
+    return s_historyContext.seriesCount;
+}
+
+const HSTSeries* HSTGetSeries(const u32 i_index)
+{
+    return &s_historyContext.series[i_index];
+}
+
+const HSTSeries* HSTFindSeries(const_cstr i_name)
+{
+    for (u32 i = 0; i < s_historyContext.seriesCount; i++)
+    {
+        if (cstr_compare(s_historyContext.series[i].name, i_name) == 0)
+        {
+            return &s_historyContext.series[i];
+        }
+    }
+    return nullptr;
+}
+
+void HSTGetProviderSeries(const u32 i_providerIndex, u32* o_first, u32* o_count)
+{
+    *o_first = s_historyContext.firstSeries[i_providerIndex];
+    *o_count = s_historyContext.providerSeriesCount[i_providerIndex];
+}
+
+HSTWindow HSTGetWindowAll(const HSTSeries* i_series)
+{
+    const u32 count = i_series->count;
+    return { count, count - GetOldestReadable(count) };
+}
+
+HSTWindow HSTGetWindowLast(const HSTSeries* i_series, const u32 i_count)
+{
+    HSTWindow window = HSTGetWindowAll(i_series);
+    window.length = math_min(window.length, i_count);
+    return window;
+}
+
+HSTWindow HSTGetWindowSince(const HSTSeries* i_series, const u64 i_sinceMs)
+{
+    const HSTView view = { &k_historyViewSource, (u32)(i_series - s_historyContext.series), 0, HSTGetWindowAll(i_series) };
+    return HSTNarrowViewWindow(view, i_sinceMs);
+}
+
+bool HSTReadSample(const HSTSeries* i_series, const HSTWindow& i_window, const u32 i_index, u64* o_timestampMs, f64* o_value)
+{
+    FLORAL_ASSERT(i_index < i_window.length);
+    const u32 sampleIndex = i_window.end - i_window.length + i_index;
+    const u32 slot = sampleIndex & k_historyMask;
+    // volatile so they are not moved after the check below
+    *o_timestampMs = ((const ATOMIC_TYPE(u64)*)i_series->timestamps)[slot];
+    *o_value = ((const ATOMIC_TYPE(f64)*)i_series->values)[slot];
+
+    // checked after the read: if the writer had not reached the slot yet by then, what was read is
+    // the sample we were looking for
+    return i_series->count - sampleIndex <= k_historyReadableCount;
+}
+
+void HSTBindViewMetatable(lua_State* i_vm, const HSTViewSource* i_source, const luaL_Reg* i_methods)
+{
+    SCRStackGuard guard(i_vm);
+    const voidptr source = (voidptr)i_source;
+    luaL_newmetatable(i_vm, i_source->metatableName);
+
+    static const luaL_Reg k_sharedViewMethods[] = {
+        { "time", &ScriptingViewTime },
+        { "last", &ScriptingViewLast },
+        { "since", &ScriptingViewSince },
+        { "name", &ScriptingViewName }
+    };
+    lua_createtable(i_vm, 0, (s32)array_length(k_sharedViewMethods));
+    for (const luaL_Reg& method : k_sharedViewMethods)
+    {
+        lua_pushlightuserdata(i_vm, source);
+        lua_pushcclosure(i_vm, method.func, 1);
+        lua_setfield(i_vm, -2, method.name);
+    }
+    for (const luaL_Reg* method = i_methods; method->name != nullptr; method++)
+    {
+        lua_pushcfunction(i_vm, method->func);
+        lua_setfield(i_vm, -2, method->name);
+    }
+    lua_pushlightuserdata(i_vm, source);
+    lua_insert(i_vm, -2);
+    lua_pushcclosure(i_vm, &ScriptingViewIndex, 2);
+    lua_setfield(i_vm, -2, "__index");
+
+    lua_pushlightuserdata(i_vm, source);
+    lua_pushcclosure(i_vm, &ScriptingViewNewIndex, 1);
+    lua_setfield(i_vm, -2, "__newindex");
+    lua_pushlightuserdata(i_vm, source);
+    lua_pushcclosure(i_vm, &ScriptingViewLength, 1);
+    lua_setfield(i_vm, -2, "__len");
+    lua_pop(i_vm, 1);
+}
+
+void HSTPushView(lua_State* i_vm, const HSTViewSource* i_source, const u32 i_series, const u32 i_tier, const HSTWindow& i_window)
+{
+    HSTView* view = (HSTView*)lua_newuserdata(i_vm, sizeof(HSTView));
+    view->source = i_source;
+    view->series = i_series;
+    view->tier = i_tier;
+    view->window = i_window;
+    luaL_getmetatable(i_vm, i_source->metatableName);
+    lua_setmetatable(i_vm, -2);
+}
+
+HSTView* HSTCheckView(lua_State* i_vm, const HSTViewSource* i_source, const s32 i_index)
+{
+    return (HSTView*)luaL_checkudata(i_vm, i_index, i_source->metatableName);
+}
+
+HSTWindow HSTNarrowViewWindow(const HSTView& i_view, const u64 i_sinceMs)
+{
+    // the entries are in time order, look for the first one that ends after i_sinceMs
+    u32 low = 0;
+    u32 high = i_view.window.length;
+    while (low < high)
+    {
+        const u32 mid = low + (high - low) / 2;
+        u64 startMs = 0;
+        u64 endMs = 0;
+        f64 value = 0.0;
+        if (!i_view.source->read(i_view, mid, &startMs, &endMs, &value) || endMs <= i_sinceMs)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return { i_view.window.end, i_view.window.length - low };
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+#include <floral/memory.h>
+
+#include "provider.h"
+
+struct lua_State;
+struct luaL_Reg;
+
+// Recent samples of every top-level numeric field of the enabled providers, named after them
+// ("network.ingress", "memory.physicalLoad"...). Each series is a fixed-size ring of
+// (timestamp, value) pairs, kept as two parallel arrays, filled by the sampling thread as the
+// tasks run and read from the window's thread without any lock.
+
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_historyCapacity = 512; // samples per series, must be a power of 2
+constexpr u32 k_maxHistorySeries = 128;
+constexpr u32 k_maxHistoryNameLength = 64;
+
+struct HSTSeries
+{
+    c8 name[k_maxHistoryNameLength];
+    const PRVField* field;
+    u32 providerIndex;
+
+    // the writer fills the slot, then publishes it by bumping 'count' (samples ever appended)
+    u64* timestamps; // ms, same clock as SCHGetTimeMs()
+    f64* values;
+    ATOMIC_TYPE(u32) count;
+};
+
+// the samples [end - length, end) of all those ever appended to a series, a window keeps pointing
+// at the same samples while the ring moves on, until they are overwritten
+struct HSTWindow
+{
+    u32 end;
+    u32 length;
+};
+
+struct HSTView;
+
+// what the Lua views of a kind read their entries from: the history samples, the rollup buckets...
+struct HSTViewSource
+{
+    const_cstr kind;
+    const_cstr metatableName;
+    // i_index is 0 for the oldest entry of the view's window, false if it has been overwritten since.
+    // The entry covers [start, end) ms, its value is what 'view[i]' returns
+    bool (*read)(const HSTView& i_view, const u32 i_index, u64* o_startMs, u64* o_endMs, f64* o_value);
+};
+
+// a full userdata holding a window, '#view', 'view[i]' (1 is the oldest entry) and the methods never
+// copy the entries into a table
+struct HSTView
+{
+    const HSTViewSource* source;
+    u32 series;
+    u32 tier; // for the sources which have several
+    HSTWindow window;
+};
+
+struct HSTContext
+{
+    HSTSeries series[k_maxHistorySeries];
+    u32 seriesCount;
+    // the series of a provider are contiguous
+    u32 firstSeries[k_maxProviders];
+    u32 providerSeriesCount[k_maxProviders];
+
+    arena_t arena;
+    bool ready;
+};
+
+// ----------------------------------------------------------------------------
+
+// must come after PRVInitialize()
+void HSTInitialize(linear_allocator_t* const i_allocator);
+void HSTCleanUp();
+void HSTBindScriptingAPIs();
+
+// sampling thread only, i_record is the provider's freshly sampled record
+void HSTAppend(const u32 i_providerIndex, const u64 i_timestampMs, const u8* i_record);
+
+u32 HSTGetSeriesCount();
+const HSTSeries* HSTGetSeries(const u32 i_index);
+const HSTSeries* HSTFindSeries(const_cstr i_name);
+// the series of a provider are [first, first + count)
+void HSTGetProviderSeries(const u32 i_providerIndex, u32* o_first, u32* o_count);
+
+HSTWindow HSTGetWindowAll(const HSTSeries* i_series);
+HSTWindow HSTGetWindowLast(const HSTSeries* i_series, const u32 i_count);
+HSTWindow HSTGetWindowSince(const HSTSeries* i_series, const u64 i_sinceMs);
+// i_index is 0 for the oldest sample of the window, false if it has been overwritten since
+bool HSTReadSample(const HSTSeries* i_series, const HSTWindow& i_window, const u32 i_index, u64* o_timestampMs, f64* o_value);
+
+// the views' metatable: time(i), last(n), since(t) and name() are common to all the sources, the
+// source's own methods come in addition (a null terminated list)
+void HSTBindViewMetatable(lua_State* i_vm, const HSTViewSource* i_source, const luaL_Reg* i_methods);
+void HSTPushView(lua_State* i_vm, const HSTViewSource* i_source, const u32 i_series, const u32 i_tier, const HSTWindow& i_window);
+HSTView* HSTCheckView(lua_State* i_vm, const HSTViewSource* i_source, const s32 i_index);
+// the entries of the window ending after i_sinceMs
+HSTWindow HSTNarrowViewWindow(const HSTView& i_view, const u64 i_sinceMs);
@@ -0,0 +1,176 @@
+#include "html.h"
+
+#include <floral/assert.h>
+#include <floral/misc.h>
+
+static size ParseHTMLTag(const_tcstr i_str, const size i_startIdx, const size i_len,
+                         HTMLElement* const o_elem, arena_t* const i_arena)
+{
+    size endIdx = i_startIdx;
+    size i = i_startIdx;
+    for (; i < i_len; i++)
+    {
+        if ((i_str[i] > 'a' && i_str[i] < 'z') || (i_str[i] > 'A' && i_str[i] < 'Z'))
+        {
+            endIdx = i;
+        }
+        else
+        {
+            break;
+        }
+    }
+    o_elem->tag = tstr_duplicate(i_arena, &i_str[i_startIdx], &i_str[endIdx + 1]);
+    return i - 1;
+}
+
+static size ParseHTMLSingleQuotedText(const_tcstr i_str, const size i_startIdx, const size i_len,
+                                      HTMLElement* const o_elem, arena_t* const i_arena)
+{
+    size startIdx = i_startIdx;
+    size endIdx = i_startIdx;
+    size i = i_startIdx;
+    FLORAL_ASSERT(i_str[i] == '\'');
+
+    i++;
+    startIdx++;
+    for (; i < i_len; i++)
+    {
+        if (i_str[i] == '\'')
+        {
+            break;
+        }
+        else
+        {
+            endIdx = i;
+        }
+    }
+    o_elem->value = tstr_duplicate(i_arena, &i_str[startIdx], &i_str[endIdx + 1]);
+    return i;
+}
+
+static size ParseHTMLInner(const_tcstr i_str, const size i_startIdx, const size i_len,
+                           HTMLElement* const o_elem, arena_t* const i_arena)
+{
+    size startIdx = i_startIdx;
+    size endIdx = i_startIdx;
+    size i = i_startIdx;
+    for (; i < i_len; i++)
+    {
+        if (i_str[i] == '<')
+        {
+            break;
+        }
+        else
+        {
+            endIdx = i;
+        }
+    }
+    o_elem->inner = tstr_duplicate(i_arena, &i_str[startIdx], &i_str[endIdx + 1]);
+    return i - 1;
+}
+
+static size ParseHTMLElement(const_tcstr i_str, const size i_startIdx, const size i_len,
+                             HTMLElement* const o_elem, arena_t* const i_arena)
+{
+    size i = i_startIdx;
+    FLORAL_ASSERT(i_str[i] == '<');
+    i++;
+    i = ParseHTMLTag(i_str, i, i_len, o_elem, i_arena);
+    i++;
+    FLORAL_ASSERT(i_str[i] == '=');
+    i++;
+    i = ParseHTMLSingleQuotedText(i_str, i, i_len, o_elem, i_arena);
+    i++;
+    FLORAL_ASSERT(i_str[i] == '>');
+    i++;
+    i = ParseHTMLInner(i_str, i, i_len, o_elem, i_arena);
+    i++;
+    FLORAL_ASSERT(i_str[i] == '<');
+    i++;
+    FLORAL_ASSERT(i_str[i] == '/');
+    i++;
+    FLORAL_ASSERT(i_str[i] == '>');
+    return i;
+}
+
+static u32 ParseColorCode(const tstr& i_str)
+{
+    u32 colorRGB = 0;
+    FLORAL_ASSERT(i_str.length == 7);
+    for (size i = 1; i < 7; i++)
+    {
+        u8 nibble = 0;
+        if (i_str.data[i] >= LITERAL('0') && i_str.data[i] <= LITERAL('9'))
+        {
+            nibble = u8(i_str.data[i] - LITERAL('0'));
+        }
+        else if (i_str.data[i] >= LITERAL('a') && i_str.data[i] <= LITERAL('f'))
+        {
+            nibble = u8(i_str.data[i] - LITERAL('a') + 10);
+        }
+        else
+        {
+            FLORAL_ASSERT(false);
+        }
+
+        colorRGB <<= 4;
+        colorRGB |= nibble;
+    }
+    u32 colorABGR = ((colorRGB & 0xff0000) >> 16) | (colorRGB & 0xff00) | ((colorRGB & 0xff) << 16);
+    return colorABGR;
+}
+
+HTMLText HTMLParse(const_tcstr i_str, const size i_strLen, arena_t* const i_arena)
+{
+    HTMLText textLine;
+    textLine.rawLength = 0;
+    textLine.rawCapacity = i_strLen;
+    textLine.rawData = arena_push_podarr(i_arena, tchar, i_strLen + 1);
+    textLine.parts = create_dll<HTMLTextPart>();
+    textLine.partsCount = 0;
+
+    textLine.rawData[0] = 0;
+    tchar* raw = textLine.rawData;
+    for (size i = 0; i < i_strLen;)
+    {
+        if (i_str[i] == '<')
+        {
+            HTMLElement elem = {};
+            i = ParseHTMLElement(i_str, i, i_strLen, &elem, i_arena);
+            i++;
+            mem_copy(raw, elem.inner.data, elem.inner.length * sizeof(tchar));
+
+            dll_t<HTMLTextPart>::node_t* partNode = arena_push_pod(i_arena, dll_t<HTMLTextPart>::node_t);
+            partNode->data.startIndex = (s32)(raw - textLine.rawData);
+            partNode->data.length = (s32)elem.inner.length;
+            partNode->data.color = ParseColorCode(elem.value);
+            dll_push_back(&textLine.parts, partNode);
+            textLine.partsCount++;
+
+            raw += elem.inner.length;
+        }
+        else
+        {
+            size i0 = i;
+            do
+            {
+                i++;
+            } while (i < i_strLen && i_str[i] != '<');
+            size len = i - i0;
+            mem_copy(raw, &i_str[i0], len * sizeof(tchar));
+
+            dll_t<HTMLTextPart>::node_t* partNode = arena_push_pod(i_arena, dll_t<HTMLTextPart>::node_t);
+            partNode->data.startIndex = (s32)(raw - textLine.rawData);
+            partNode->data.length = s32(len);
+            partNode->data.color = 0x00ffffff;
+            dll_push_back(&textLine.parts, partNode);
+            textLine.partsCount++;
+
+            raw += len;
+        }
+        *raw = 0;
+    }
+    textLine.rawLength = s32(raw - textLine.rawData);
+
+    return textLine;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <floral/container.h>
+#include <floral/stdaliases.h>
+#include <floral/string_utils.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// Simple HTML tag parser
+
+struct HTMLTextPart
+{
+    s32 startIndex;
+    s32 length;
+    u32 color;
+};
+
+struct HTMLText
+{
+    tcstr rawData;
+    size rawLength;
+    size rawCapacity;
+
+    dll_t<HTMLTextPart> parts;
+    u32 partsCount;
+};
+
+struct HTMLElement
+{
+    tstr tag;
+    tstr value;
+    tstr inner;
+};
+
+HTMLText HTMLParse(const_tcstr i_str, const size i_strLen, arena_t* const i_arena);
@@ -1,6 +1,8 @@
 #include <floral/assert.h>
 #include <floral/log.h>
 #include <floral/memory.h>
+#include <floral/misc.h>
+#include <floral/thread.h>
 #include <floral/thread_context.h>
 #include <floral/system_info.h>
 #include <floral/file_system.h>
@@ -10,14 +12,26 @@
 #include "winapi.h"
 #include "files_tracker.h"
 #include "scripting.h"
+#include "scheduler.h"
+#include "sampler.h"
+#include "provider.h"
+#include "history.h"
+#include "archive.h"
+#include "rollup.h"
+#include "aggregator.h"
+#include "exporter.h"
+#include "publication.h"
+#include "replay.h"
+#include "stream.h"
 
 #include "monitor/km_driver.h"
 #include "monitor/cpu.h"
 #include "monitor/gpu.h"
-#include "monitor/network.h"
+#include "monitor/thermal.h"
 
 #include "configs.h"
 #include "main_dialog.h"
+#include "taskbar_widget.h"
 #include "utils.h"
 
 // This will enable Windows' visual style
@@ -59,22 +73,109 @@ long WINAPI ExceptionHandler(_EXCEPTION_POINTERS* i_exceptionPointer)
 }
 #endif
 
+struct AppArguments
+{
+    RPLMode replayMode;
+    tstr recordingName; // the recording is 'recordings/<name>.mwr'
+    bool softwareRenderer;
+    u32 headlessFrames; // 0 shows the widget
+};
+
+// [--record <name> | --replay <name> [--max-speed]] [--software-renderer] [--headless <frames>]
+static AppArguments ParseArguments(const_wcstr i_cmdLine, arena_t* const i_arena)
+{
+    AppArguments arguments = {};
+    bool maxSpeed = false;
+    bool expectingName = false;
+    bool expectingFrames = false;
+    const_wcstr cursor = i_cmdLine;
+    while (cursor && *cursor)
+    {
+        while (*cursor == L' ')
+        {
+            cursor++;
+        }
+        const_wcstr begin = cursor;
+        while (*cursor && *cursor != L' ')
+        {
+            cursor++;
+        }
+        if (cursor == begin)
+        {
+            break;
+        }
+
+        const tstr argument = tstr_duplicate(i_arena, begin, cursor);
+        if (expectingName)
+        {
+            arguments.recordingName = argument;
+            expectingName = false;
+        }
+        else if (expectingFrames)
+        {
+            u32 frames = 0;
+            for (const_wcstr digit = begin; digit < cursor && *digit >= L'0' && *digit <= L'9'; digit++)
+            {
+                frames = math_min(frames * 10 + (u32)(*digit - L'0'), 1000000u);
+            }
+            arguments.headlessFrames = frames;
+            expectingFrames = false;
+        }
+        else if (tcstr_compare(argument.data, LITERAL("--record")) == 0)
+        {
+            arguments.replayMode = RPLMode::Record;
+            expectingName = true;
+        }
+        else if (tcstr_compare(argument.data, LITERAL("--replay")) == 0)
+        {
+            arguments.replayMode = RPLMode::Replay;
+            expectingName = true;
+        }
+        else if (tcstr_compare(argument.data, LITERAL("--max-speed")) == 0)
+        {
+            maxSpeed = true;
+        }
+        else if (tcstr_compare(argument.data, LITERAL("--software-renderer")) == 0)
+        {
+            arguments.softwareRenderer = true;
+        }
+        else if (tcstr_compare(argument.data, LITERAL("--headless")) == 0)
+        {
+            expectingFrames = true;
+        }
+    }
+
+    if (expectingName)
+    {
+        LOG_WARNING("A recording name is expected after --record / --replay");
+        arguments.replayMode = RPLMode::Off;
+    }
+    if (expectingFrames)
+    {
+        LOG_WARNING("A number of frames is expected after --headless");
+    }
+    if (arguments.replayMode == RPLMode::Replay && maxSpeed)
+    {
+        arguments.replayMode = RPLMode::ReplayMaxSpeed;
+    }
+    return arguments;
+}
+
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine, int nShowCmd)
 {
     MARK_UNUSED(hPrevInstance);
-    MARK_UNUSED(lpCmdLine);
     MARK_UNUSED(nShowCmd);
 #if RETAIL_BUILD
     pxSetUnhandledExceptionFilter(ExceptionHandler);
 #endif
-    HANDLE currentThread = GetCurrentThread();
-    SetThreadAffinityMask(currentThread, 0x1);
+    thread_set_current_affinity(0x1);
+    thread_set_current_name("main");
     // we will dynamically handle the DPI change via WM_DPICHANGED message, by using
     // PROCESS_PER_MONITOR_DPI_AWARE, we enable this message
     pxSetProcessDpiAwareness(PROCESS_PER_MONITOR_DPI_AWARE);
     pxSetPriorityClass(pxGetCurrentProcess(), REALTIME_PRIORITY_CLASS);
 
-    linear_allocator_t masterAllocator = create_linear_allocator("'main' master allocator", SIZE_MB(16));
+    linear_allocator_t masterAllocator = create_linear_allocator("'main' master allocator", SIZE_MB(32));
     thread_context_t threadContext = {
         .allocator = create_linear_allocator(&masterAllocator, "main thread context allocator", SIZE_MB(1))
     };
@@ -106,22 +207,71 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLi
     SCRAddEntryPoint(tstr_literal(LITERAL("main.lua")));
     SCRLoadVMThread(scriptPath);
 
-    kmdrv::Initialize(&masterAllocator);
-    cpu::Initialize(&masterAllocator);
-    gpu::Initialize(&masterAllocator);
-    network::Initialize();
+    PRVRegisterBuiltinProviders();
+    const AppArguments arguments = ParseArguments(lpCmdLine, &arena);
+    RPLInitialize(&masterAllocator, &fileSystem, arguments.replayMode, arguments.recordingName);
+    if (!RPLIsReplaying())
+    {
+        kmdrv::Initialize(&masterAllocator);
+        thermal::Initialize(&masterAllocator);
+        cpu::Initialize(&masterAllocator);
+        gpu::Initialize(&masterAllocator);
+    }
+    // the other sources are owned by their providers, the disabled ones are never initialized
+    PRVInitialize(&masterAllocator);
+    HSTInitialize(&masterAllocator);
+    RLPInitialize(&masterAllocator);
+    AGGInitialize(&masterAllocator);
+    ARCInitialize(&masterAllocator, &fileSystem);
+    PUBInitialize();
+    EXPInitialize(&masterAllocator);
+    STMInitialize(&masterAllocator, &fileSystem);
+    STMSetEnabled(CFGGetBool(CFGKey::SnapshotStream));
+
+    SCHInitialize(&masterAllocator);
+    SMPInitialize(&masterAllocator);
+    SMPStart();
+    if (CFGGetBool(CFGKey::MetricsEndpoint))
+    {
+        EXPStart();
+    }
 
     FTInitialize(&masterAllocator);
     tstr trackingPath = tstr_printf(&arena, LITERAL("%s\\%s"), fileSystem.workingDirectory.data, scriptPath.data);
     FTStart(trackingPath);
 
-    if (!UIMainDialogCreate(hInstance, &masterAllocator))
+    if (arguments.headlessFrames > 0)
     {
-        UTLShowMessage(NULL, UTLSeverity::Error, LITERAL("Failed to create Main Dialog."));
-        return -1;
+        // no window at all, the scripts render into memory and the frame times are logged
+        UIWidgetRunHeadless(hInstance, &masterAllocator, arguments.headlessFrames);
     }
-    UIMainDialogRun(); // main loop is here
-    UIMainDialogCleanUp();
+    else
+    {
+        if (arguments.softwareRenderer)
+        {
+            UIWidgetSetRenderer(UIRenderer::Software);
+        }
+        if (!UIMainDialogCreate(hInstance, &masterAllocator))
+        {
+            UTLShowMessage(NULL, UTLSeverity::Error, LITERAL("Failed to create Main Dialog."));
+            return -1;
+        }
+        UIMainDialogRun(); // main loop is here
+        UIMainDialogCleanUp();
+    }
+
+    EXPCleanUp();
+    SMPStop();
+    SMPCleanUp();
+    STMCleanUp();
+    RPLCleanUp();
+    PUBCleanUp();
+    ARCCleanUp();
+    AGGCleanUp();
+    RLPCleanUp();
+    HSTCleanUp();
+    PRVCleanUp();
+    SCHCleanUp();
 
     FTStop();
     FTCleanUp();
@@ -8,8 +8,10 @@
 
 #include "defines.h"
 #include "configs.h"
+#include "exporter.h"
 #include "winapi.h"
 #include "scripting.h"
+#include "stream.h"
 #include "taskbar_widget.h"
 #include "tray.h"
 #include "utils.h"
@@ -204,6 +206,33 @@ static INT_PTR MainDialogProc(HWND i_hwnd, UINT i_msg, WPARAM i_wParam, LPARAM i
             break;
         }
 
+        case ID_METRICS_ENDPOINT:
+        {
+            const bool metricsEndpoint = !CFGGetBool(CFGKey::MetricsEndpoint);
+            if (metricsEndpoint)
+            {
+                EXPStart();
+            }
+            else
+            {
+                EXPStop();
+            }
+            LOG_VERBOSE("Metrics endpoint: %s", metricsEndpoint ? "true" : "false");
+            CFGSetBool(CFGKey::MetricsEndpoint, metricsEndpoint);
+            dlgResult = TRUE;
+            break;
+        }
+
+        case ID_SNAPSHOT_STREAM:
+        {
+            const bool snapshotStream = !CFGGetBool(CFGKey::SnapshotStream);
+            STMSetEnabled(snapshotStream);
+            LOG_VERBOSE("Snapshot stream: %s", snapshotStream ? "true" : "false");
+            CFGSetBool(CFGKey::SnapshotStream, snapshotStream);
+            dlgResult = TRUE;
+            break;
+        }
+
         case ID_FORCE_CRASH:
         {
             LOG_VERBOSE("Hold on! The application is going to crash!");
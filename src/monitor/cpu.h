@@ -7,11 +7,33 @@ struct linear_allocator_t;
 namespace cpu
 {
 
+// sizes are in bytes, the fields a platform does not have are left to 0
+struct MemoryInfo
+{
+    s32 physicalLoad; // %
+    s32 virtualLoad;  // %, physical memory and swap / page file together
+
+    u64 totalPhysical;
+    u64 availablePhysical; // what can be allocated without swapping, reclaimable caches included
+    u64 cached;
+    u64 buffers;
+    u64 dirty;
+    u64 slab;
+
+    u64 totalSwap;
+    u64 freeSwap;
+    u64 swappedIn; // since boot
+    u64 swappedOut;
+};
+
 bool Initialize(linear_allocator_t* i_allocator);
 void UpdateOSPerfCounters();
 
 void ReadProcessorUtilization(f32* o_avgLoad, f32* o_coreLoads, u32* i_coreIds, u32 i_numCores);
 void ReadMemoryUtilization(s32* o_physical, s32* o_virtual);
+void ReadMemoryInfo(MemoryInfo* o_info);
 void ReadProcessorTemperature(f32* o_packageTemp, f32* o_coreTemps, u32* i_coreIds, u32 i_numCores);
+// effective frequency in MHz, averaged since the previous call
+void ReadProcessorFrequency(f32* o_avgFrequency, f32* o_coreFrequencies, u32* i_coreIds, u32 i_numCores);
 
 } // namespace cpu
@@ -0,0 +1,123 @@
+#include "cpu_frequency.h"
+
+#include "km_driver.h"
+
+#include <floral/memory.h>
+#include <floral/time.h>
+
+namespace cpu
+{
+
+struct FrequencyCounters
+{
+    u64 aperf;
+    u64 mperf;
+    u64 ticks;
+    f32 frequency; // MHz
+    bool valid;
+};
+
+struct FrequencyState
+{
+    FrequencyCounters* counters;
+    kmdrv::MSRRead* reads;
+    u32 numProcessors;
+
+    arena_t arena;
+};
+
+static FrequencyState* s_frequencyState = nullptr;
+
+// ref: Intel 64 and IA-32 Architectures Software Developer's Manual - Volume 4
+// ref: AMD64 Architecture Programmer's Manual - Volume 2 - section 17.3
+constexpr u32 k_IA32_MPERF = 0xe7;
+constexpr u32 k_IA32_APERF = 0xe8;
+
+void FrequencyInitialize(linear_allocator_t* i_allocator, const u32 i_numProcessors)
+{
+    const size arenaSize = SIZE_KB(1) + sizeof(FrequencyState) +
+                           (size)i_numProcessors * (sizeof(FrequencyCounters) + 2 * sizeof(kmdrv::MSRRead));
+    arena_t arena = create_arena(i_allocator, arenaSize);
+    s_frequencyState = arena_push_pod(&arena, FrequencyState);
+    s_frequencyState->arena = arena;
+
+    s_frequencyState->numProcessors = i_numProcessors;
+    s_frequencyState->counters = arena_push_podarr(&s_frequencyState->arena, FrequencyCounters, i_numProcessors);
+    s_frequencyState->reads = arena_push_podarr(&s_frequencyState->arena, kmdrv::MSRRead, i_numProcessors * 2);
+    for (u32 i = 0; i < i_numProcessors; i++)
+    {
+        s_frequencyState->counters[i] = {};
+        // grouped by processor so each one is only visited once
+        s_frequencyState->reads[i * 2] = { .cpuId = i, .address = k_IA32_APERF };
+        s_frequencyState->reads[i * 2 + 1] = { .cpuId = i, .address = k_IA32_MPERF };
+    }
+}
+
+bool FrequencyReadProcessorFrequency(f32* o_avgFrequency, f32* o_coreFrequencies, u32* i_coreIds, u32 i_numCores)
+{
+    const u32 numProcessors = s_frequencyState->numProcessors;
+    const u64 nowTicks = time_get_ticks();
+    if (kmdrv::ReadMSRs(s_frequencyState->reads, numProcessors * 2) == 0)
+    {
+        return false;
+    }
+
+    // MPERF ticks at the TSC rate while the core is not halted and APERF at the actual clock: their
+    // ratio scales the TSC frequency to the average frequency the core ran at while busy. Without
+    // a TSC clock to scale, APERF over the elapsed time is the closest we get (it includes halts).
+    const bool scaleTsc = time_is_tsc_clock();
+    const f64 tscFrequency = (f64)time_get_ticks_frequency();
+
+    f32 totalFrequency = 0.0f;
+    u32 validCount = 0;
+    for (u32 i = 0; i < numProcessors; i++)
+    {
+        const kmdrv::MSRRead& aperfRead = s_frequencyState->reads[i * 2];
+        const kmdrv::MSRRead& mperfRead = s_frequencyState->reads[i * 2 + 1];
+        FrequencyCounters* const counters = &s_frequencyState->counters[i];
+        if (!aperfRead.valid || !mperfRead.valid)
+        {
+            counters->valid = false;
+            continue;
+        }
+
+        // the counters are reset on some power state transitions, skip the sample they went back in
+        if (counters->valid && aperfRead.value >= counters->aperf && mperfRead.value >= counters->mperf)
+        {
+            const u64 deltaAperf = aperfRead.value - counters->aperf;
+            const u64 deltaMperf = mperfRead.value - counters->mperf;
+            if (scaleTsc && deltaMperf > 0)
+            {
+                counters->frequency = (f32)(tscFrequency * ((f64)deltaAperf / (f64)deltaMperf) * 1e-6);
+            }
+            else if (!scaleTsc && nowTicks > counters->ticks)
+            {
+                counters->frequency = (f32)((f64)deltaAperf / (time_ticks_to_ms(nowTicks - counters->ticks) * 1000.0));
+            }
+        }
+
+        counters->aperf = aperfRead.value;
+        counters->mperf = mperfRead.value;
+        counters->ticks = nowTicks;
+        counters->valid = true;
+        totalFrequency += counters->frequency;
+        validCount++;
+    }
+
+    if (o_avgFrequency)
+    {
+        *o_avgFrequency = validCount > 0 ? totalFrequency / (f32)validCount : 0.0f;
+    }
+
+    if (o_coreFrequencies && i_coreIds)
+    {
+        for (u32 i = 0; i < i_numCores; i++)
+        {
+            const u32 cpuId = i_coreIds[i];
+            o_coreFrequencies[i] = cpuId < numProcessors ? s_frequencyState->counters[cpuId].frequency : 0.0f;
+        }
+    }
+    return validCount > 0;
+}
+
+} // namespace cpu
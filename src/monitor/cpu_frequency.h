@@ -0,0 +1,15 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+
+struct linear_allocator_t;
+
+namespace cpu
+{
+
+// effective frequency from the APERF / MPERF counters (both Intel and AMD), read through kmdrv
+void FrequencyInitialize(linear_allocator_t* i_allocator, const u32 i_numProcessors);
+// in MHz, since the previous call. Returns false when the counters cannot be read.
+bool FrequencyReadProcessorFrequency(f32* o_avgFrequency, f32* o_coreFrequencies, u32* i_coreIds, u32 i_numCores);
+
+} // namespace cpu
@@ -3,6 +3,7 @@
 #include "km_driver.h"
 
 #include <floral/memory.h>
+#include <floral/thread_context.h>
 
 namespace cpu
 {
@@ -18,6 +19,7 @@ static IntelState* s_intelState = nullptr;
 
 // ref: Intel 64 and IA-32 Architectures Software Developer's Manual - Volume 4
 constexpr u32 k_MSR_TEMPERATURE_TARGET = 0x1a2;
+constexpr u32 k_IA32_THERM_STATUS = 0x19c;
 constexpr u32 k_IA32_PACKAGE_THERM_STATUS = 0x1b1;
 
 void IntelInitialize(linear_allocator_t* i_allocator)
@@ -39,7 +41,28 @@ void IntelReadProcessorTemperature(f32* o_packageTemp, f32* o_coreTemps, u32* i_
     const s32 digitalReadout = s32((value >> 16) & 0x7f); // in degrees
     const s32 pkgTemp = s_intelState->ptccTemp - digitalReadout;
 
-    *o_packageTemp = (f32)pkgTemp;
+    if (o_packageTemp)
+    {
+        *o_packageTemp = (f32)pkgTemp;
+    }
+
+    if (o_coreTemps && i_coreIds && i_numCores > 0)
+    {
+        // same readout format as the package one, one register per core (shared by its threads)
+        scratch_region_t scratch = thread_scratch_begin();
+        kmdrv::MSRRead* reads = arena_push_podarr(scratch.arena, kmdrv::MSRRead, i_numCores);
+        for (u32 i = 0; i < i_numCores; i++)
+        {
+            reads[i] = { .cpuId = i_coreIds[i], .address = k_IA32_THERM_STATUS };
+        }
+        kmdrv::ReadMSRs(reads, i_numCores);
+        for (u32 i = 0; i < i_numCores; i++)
+        {
+            const s32 coreReadout = s32((reads[i].value >> 16) & 0x7f);
+            o_coreTemps[i] = reads[i].valid ? (f32)(s_intelState->ptccTemp - coreReadout) : 0.0f;
+        }
+        thread_scratch_end(&scratch);
+    }
 }
 
 } // namespace cpu
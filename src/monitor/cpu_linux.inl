@@ -0,0 +1,345 @@
+#include "cpu.h"
+
+#include <unistd.h>
+
+#include <floral/assert.h>
+#include <floral/memory.h>
+#include <floral/misc.h>
+#include <floral/string_utils.h>
+
+#include "cpu_frequency.h"
+#include "procfs.h"
+#include "thermal.h"
+
+namespace cpu
+{
+
+// jiffies spent in each state, in /proc/stat's column order
+struct CpuTimes
+{
+    u64 user;
+    u64 nice;
+    u64 system;
+    u64 idle;
+    u64 iowait;
+    u64 irq;
+    u64 softirq;
+    u64 steal;
+};
+
+// where a logical processor is, to find its core's temperature sensor
+struct CpuTopology
+{
+    u32 package;
+    u32 coreId;
+};
+
+struct CpuLoad
+{
+    CpuTimes prevTimes;
+    f32 load; // in percent, between the last two updates
+    bool online;
+};
+
+enum class MemInfoKey : u32
+{
+    MemTotal = 0,
+    MemFree,
+    MemAvailable,
+    Buffers,
+    Cached,
+    Dirty,
+    Slab,
+    SwapTotal,
+    SwapFree,
+
+    Count
+};
+
+enum class VmStatKey : u32
+{
+    PagesSwappedIn = 0,
+    PagesSwappedOut,
+
+    Count
+};
+
+// in the same order as the enums above
+static const_cstr k_memInfoKeyNames[] = { "MemTotal", "MemFree", "MemAvailable", "Buffers", "Cached", "Dirty", "Slab", "SwapTotal", "SwapFree" };
+static const_cstr k_vmStatKeyNames[] = { "pswpin", "pswpout" };
+static_assert(array_length(k_memInfoKeyNames) == (u32)MemInfoKey::Count, "Missing /proc/meminfo keys");
+static_assert(array_length(k_vmStatKeyNames) == (u32)VmStatKey::Count, "Missing /proc/vmstat keys");
+
+struct State
+{
+    procfs::File statFile;
+    procfs::File memInfoFile;
+    procfs::File vmStatFile;
+    procfs::Key memInfoKeys[(u32)MemInfoKey::Count];
+    procfs::Key vmStatKeys[(u32)VmStatKey::Count];
+
+    s32 numProcessors;
+    u32 pageSize;
+
+    CpuLoad totalLoad;
+    CpuLoad* coreLoads;
+    CpuTopology* topology;
+
+    arena_t arena;
+};
+
+static State* s_state = nullptr;
+
+// ----------------------------------------------------------------------------
+
+// same as the "% Processor Time" of PDH: iowait is time the cpu was idle waiting for I/O, guest
+// time is already accounted in user and nice
+static void UpdateLoad(CpuLoad* const io_load, const CpuTimes& i_times)
+{
+    const CpuTimes& prev = io_load->prevTimes;
+    const u64 busy = i_times.user + i_times.nice + i_times.system + i_times.irq + i_times.softirq + i_times.steal;
+    const u64 idle = i_times.idle + i_times.iowait;
+    const u64 prevBusy = prev.user + prev.nice + prev.system + prev.irq + prev.softirq + prev.steal;
+    const u64 prevIdle = prev.idle + prev.iowait;
+
+    // counters can go backward when a core is hot-plugged, just start over from the new values
+    if (busy >= prevBusy && idle >= prevIdle)
+    {
+        const u64 deltaBusy = busy - prevBusy;
+        const u64 deltaTotal = deltaBusy + (idle - prevIdle);
+        io_load->load = deltaTotal > 0 ? (f32)((f64)deltaBusy * 100.0 / (f64)deltaTotal) : 0.0f;
+    }
+
+    io_load->prevTimes = i_times;
+    io_load->online = true;
+}
+
+static const c8* ParseCpuTimes(const c8* i_cursor, CpuTimes* o_times)
+{
+    // older kernels have less columns, the missing ones are left to 0
+    u64* const fields = (u64*)o_times;
+    const u32 fieldsCount = sizeof(CpuTimes) / sizeof(u64);
+    for (u32 i = 0; i < fieldsCount; i++)
+    {
+        i_cursor = procfs::SkipSpaces(i_cursor);
+        if (*i_cursor < '0' || *i_cursor > '9')
+        {
+            fields[i] = 0;
+            continue;
+        }
+        i_cursor = procfs::ParseU64(i_cursor, &fields[i]);
+    }
+    return procfs::SkipLine(i_cursor);
+}
+
+// ----------------------------------------------------------------------------
+
+bool Initialize(linear_allocator_t* i_allocator)
+{
+    // the per-cpu lines come first and are ~100 bytes each, we never need what follows them
+    // (interrupts, context switches...) so the buffer does not have to hold the whole file.
+    // meminfo and vmstat are both ~50 lines of ~30 bytes on recent kernels, vmstat grows with
+    // each release
+    const s32 numProcessors = procfs::GetProcessorsCount();
+    const size statBufferSize = SIZE_KB(1) + (size)numProcessors * 128;
+    const size memInfoBufferSize = SIZE_KB(4);
+    const size vmStatBufferSize = SIZE_KB(8);
+    arena_t arena = create_arena(i_allocator, SIZE_KB(1) + sizeof(State) + (size)numProcessors * (sizeof(CpuLoad) + sizeof(CpuTopology))
+                                                  + statBufferSize + memInfoBufferSize + vmStatBufferSize);
+    s_state = arena_push_pod(&arena, State);
+    s_state->arena = arena;
+
+    s_state->numProcessors = numProcessors;
+    s_state->pageSize = (u32)sysconf(_SC_PAGESIZE);
+
+    s_state->totalLoad = {};
+    s_state->coreLoads = arena_push_podarr(&s_state->arena, CpuLoad, s_state->numProcessors);
+    s_state->topology = arena_push_podarr(&s_state->arena, CpuTopology, s_state->numProcessors);
+    for (s32 i = 0; i < s_state->numProcessors; i++)
+    {
+        s_state->coreLoads[i] = {};
+
+        c8 path[FLORAL_MAX_PATH_LENGTH];
+        s64 value = 0;
+        cstr_snprintf(path, FLORAL_MAX_PATH_LENGTH, "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", i);
+        s_state->topology[i].package = procfs::ReadS64(path, &value) && value >= 0 ? (u32)value : 0;
+        cstr_snprintf(path, FLORAL_MAX_PATH_LENGTH, "/sys/devices/system/cpu/cpu%d/topology/core_id", i);
+        s_state->topology[i].coreId = procfs::ReadS64(path, &value) && value >= 0 ? (u32)value : (u32)i;
+    }
+
+    if (!procfs::Open(&s_state->statFile, "/proc/stat", &s_state->arena, statBufferSize))
+    {
+        return false;
+    }
+
+    for (u32 i = 0; i < (u32)MemInfoKey::Count; i++)
+    {
+        s_state->memInfoKeys[i] = procfs::MakeKey(k_memInfoKeyNames[i]);
+    }
+    for (u32 i = 0; i < (u32)VmStatKey::Count; i++)
+    {
+        s_state->vmStatKeys[i] = procfs::MakeKey(k_vmStatKeyNames[i]);
+    }
+    procfs::Open(&s_state->memInfoFile, "/proc/meminfo", &s_state->arena, memInfoBufferSize);
+    procfs::Open(&s_state->vmStatFile, "/proc/vmstat", &s_state->arena, vmStatBufferSize);
+
+    FrequencyInitialize(i_allocator, (u32)s_state->numProcessors);
+
+    // prime the counters, the first utilization is then computed against this
+    UpdateOSPerfCounters();
+    return true;
+}
+
+void UpdateOSPerfCounters()
+{
+    if (!procfs::Read(&s_state->statFile))
+    {
+        return;
+    }
+
+    const c8* cursor = s_state->statFile.buffer;
+    while (procfs::StartsWith(cursor, "cpu"))
+    {
+        cursor += 3;
+        CpuTimes times;
+        if (*cursor == ' ')
+        {
+            cursor = ParseCpuTimes(cursor, &times);
+            UpdateLoad(&s_state->totalLoad, times);
+        }
+        else
+        {
+            u64 coreId = 0;
+            cursor = procfs::ParseU64(cursor, &coreId);
+            cursor = ParseCpuTimes(cursor, &times);
+            if (coreId < (u64)s_state->numProcessors)
+            {
+                UpdateLoad(&s_state->coreLoads[coreId], times);
+            }
+        }
+    }
+}
+
+void ReadProcessorUtilization(f32* o_avgLoad, f32* o_coreLoads, u32* i_coreIds, u32 i_numCores)
+{
+    if (o_avgLoad)
+    {
+        *o_avgLoad = s_state->totalLoad.load;
+    }
+
+    if (o_coreLoads && i_coreIds && i_numCores > 0)
+    {
+        for (u32 i = 0; i < i_numCores; i++)
+        {
+            const u32 coreId = i_coreIds[i];
+            o_coreLoads[i] = coreId < (u32)s_state->numProcessors ? s_state->coreLoads[coreId].load : 0.0f;
+        }
+    }
+}
+
+void ReadMemoryUtilization(s32* o_physical, s32* o_virtual)
+{
+    MemoryInfo info;
+    ReadMemoryInfo(&info);
+    if (o_physical)
+    {
+        *o_physical = info.physicalLoad;
+    }
+    if (o_virtual)
+    {
+        *o_virtual = info.virtualLoad;
+    }
+}
+
+void ReadMemoryInfo(MemoryInfo* o_info)
+{
+    *o_info = {};
+
+    u64 memInfo[(u32)MemInfoKey::Count] = {};
+    if (procfs::Read(&s_state->memInfoFile))
+    {
+        procfs::ScanKeyValues(s_state->memInfoFile.buffer, ':', s_state->memInfoKeys, memInfo, (u32)MemInfoKey::Count);
+    }
+
+    u64 vmStat[(u32)VmStatKey::Count] = {};
+    if (procfs::Read(&s_state->vmStatFile))
+    {
+        procfs::ScanKeyValues(s_state->vmStatFile.buffer, ' ', s_state->vmStatKeys, vmStat, (u32)VmStatKey::Count);
+    }
+
+    // /proc/meminfo is in KiB, /proc/vmstat in pages
+    o_info->totalPhysical = memInfo[(u32)MemInfoKey::MemTotal] * 1024;
+    o_info->cached = memInfo[(u32)MemInfoKey::Cached] * 1024;
+    o_info->buffers = memInfo[(u32)MemInfoKey::Buffers] * 1024;
+    o_info->dirty = memInfo[(u32)MemInfoKey::Dirty] * 1024;
+    o_info->slab = memInfo[(u32)MemInfoKey::Slab] * 1024;
+    o_info->totalSwap = memInfo[(u32)MemInfoKey::SwapTotal] * 1024;
+    o_info->freeSwap = memInfo[(u32)MemInfoKey::SwapFree] * 1024;
+    o_info->swappedIn = vmStat[(u32)VmStatKey::PagesSwappedIn] * s_state->pageSize;
+    o_info->swappedOut = vmStat[(u32)VmStatKey::PagesSwappedOut] * s_state->pageSize;
+
+    // MemAvailable only exists since 3.14, free + page cache is what older tools reported
+    if (memInfo[(u32)MemInfoKey::MemAvailable] > 0)
+    {
+        o_info->availablePhysical = memInfo[(u32)MemInfoKey::MemAvailable] * 1024;
+    }
+    else
+    {
+        o_info->availablePhysical = (memInfo[(u32)MemInfoKey::MemFree] + memInfo[(u32)MemInfoKey::Buffers] + memInfo[(u32)MemInfoKey::Cached]) * 1024;
+    }
+    o_info->availablePhysical = math_min(o_info->availablePhysical, o_info->totalPhysical);
+    o_info->freeSwap = math_min(o_info->freeSwap, o_info->totalSwap);
+
+    const u64 usedPhysical = o_info->totalPhysical - o_info->availablePhysical;
+    const u64 totalVirtual = o_info->totalPhysical + o_info->totalSwap;
+    const u64 usedVirtual = usedPhysical + (o_info->totalSwap - o_info->freeSwap);
+    o_info->physicalLoad = o_info->totalPhysical > 0 ? (s32)(usedPhysical * 100 / o_info->totalPhysical) : 0;
+    o_info->virtualLoad = totalVirtual > 0 ? (s32)(usedVirtual * 100 / totalVirtual) : 0;
+}
+
+void ReadProcessorTemperature(f32* o_packageTemp, f32* o_coreTemps, u32* i_coreIds, u32 i_numCores)
+{
+    thermal::Update();
+
+    f32 packageTemp = 0.0f;
+    thermal::ReadPackageTemperature(&packageTemp);
+    if (o_packageTemp)
+    {
+        *o_packageTemp = packageTemp;
+    }
+
+    if (o_coreTemps && i_coreIds)
+    {
+        // hyper-threads share their core's sensor, AMD has none per core so they all get the package's
+        for (u32 i = 0; i < i_numCores; i++)
+        {
+            const u32 cpuId = i_coreIds[i];
+            o_coreTemps[i] = packageTemp;
+            if (cpuId < (u32)s_state->numProcessors)
+            {
+                const CpuTopology& topology = s_state->topology[cpuId];
+                thermal::ReadCoreTemperature(topology.package, topology.coreId, &o_coreTemps[i]);
+            }
+        }
+    }
+}
+
+void ReadProcessorFrequency(f32* o_avgFrequency, f32* o_coreFrequencies, u32* i_coreIds, u32 i_numCores)
+{
+    if (!FrequencyReadProcessorFrequency(o_avgFrequency, o_coreFrequencies, i_coreIds, i_numCores))
+    {
+        if (o_avgFrequency)
+        {
+            *o_avgFrequency = 0.0f;
+        }
+        if (o_coreFrequencies && i_coreIds)
+        {
+            for (u32 i = 0; i < i_numCores; i++)
+            {
+                o_coreFrequencies[i] = 0.0f;
+            }
+        }
+    }
+}
+
+} // namespace cpu
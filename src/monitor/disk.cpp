@@ -0,0 +1,11 @@
+#include "disk.h"
+
+#include <floral/configs.h>
+
+#if defined(FLORAL_PLATFORM_WINDOWS)
+#  include "disk_windows.inl"
+#elif defined(FLORAL_PLATFORM_LINUX)
+#  include "disk_linux.inl"
+#else
+// TODO
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "floral/stdaliases.h"
+
+namespace disk
+{
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_maxDevices = 16;
+constexpr u32 k_maxDeviceNameLength = 32;
+
+struct Info
+{
+    u64 readBytes;
+    u64 writtenBytes;
+    f32 readBytesPerSec;
+    f32 writeBytesPerSec;
+    f32 readsPerSec;
+    f32 writesPerSec;
+    f32 queueDepth; // average number of requests in flight
+    f32 latency;    // average time a request takes to complete (queued + serviced), ms
+    f32 busy;       // % of the time the device had requests in flight
+};
+
+struct DeviceInfo
+{
+    c8 name[k_maxDeviceNameLength];
+    Info stats;
+};
+
+
+bool Initialize();
+void CleanUp();
+// aggregated over all the tracked devices (partitions excluded), also updates the per-device stats
+void ReadStats(Info* o_stats);
+// per-device stats as of the last ReadStats(), returns the number of devices written
+u32 ReadDevices(DeviceInfo* o_devices, const u32 i_maxDevices);
+
+// ----------------------------------------------------------------------------
+} // namespace disk
@@ -0,0 +1,423 @@
+#include "disk.h"
+
+#include <unistd.h>
+
+#include <floral/log.h>
+#include <floral/misc.h>
+#include <floral/string_utils.h>
+#include <floral/time.h>
+
+#include "procfs.h"
+
+namespace disk
+{
+// ----------------------------------------------------------------------------
+
+// whole disks only, the partitions and the loop / ram devices are remembered by name so they are
+// only looked at once. A host with many snaps lists dozens of loop devices.
+constexpr u32 k_maxSlots = 64;
+constexpr u32 k_maxIgnoredNames = 256;
+constexpr u64 k_sectorSize = 512; // /proc/diskstats counts in 512 bytes sectors whatever the device's
+
+enum class Field : u8
+{
+    ReadsCompleted = 0,
+    ReadsMerged,
+    SectorsRead,
+    ReadingMs,
+    WritesCompleted,
+    WritesMerged,
+    SectorsWritten,
+    WritingMs,
+    InFlight, // a gauge, not a counter
+    BusyMs,
+    WeightedMs,
+
+    Count
+};
+
+struct Device
+{
+    DeviceInfo info;
+    // raw values of the kernel counters, they can be 32-bit wide on 32-bit kernels
+    u64 prevFields[(u32)Field::Count];
+    u64 updateTicks;
+    u32 seenUpdate; // the update in which the device was listed for the last time, 0: free slot
+};
+
+struct IgnoredName
+{
+    c8 name[k_maxDeviceNameLength];
+    u32 seenUpdate; // as Device::seenUpdate
+};
+
+struct State
+{
+    procfs::File diskStatsFile;
+
+    Device devices[k_maxSlots];
+    u32 devicesCount;
+    IgnoredName ignoredNames[k_maxIgnoredNames];
+    u32 ignoredNamesCount;
+    u32 updateIndex;
+    bool devicesTruncated; // k_maxSlots was reached, warned once
+
+    Info aggregate;
+
+    c8 diskStatsBuffer[SIZE_KB(16)];
+    bool ready;
+};
+
+static State s_state;
+
+// ----------------------------------------------------------------------------
+
+// i_name is not null-terminated, it points into the /proc/diskstats line
+static bool NameEquals(const_cstr i_storedName, const c8* i_name, const u32 i_nameLength)
+{
+    if (i_storedName[i_nameLength] != 0)
+    {
+        return false;
+    }
+    for (u32 i = 0; i < i_nameLength; i++)
+    {
+        if (i_storedName[i] != i_name[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static Device* FindDevice(const c8* i_name, const u32 i_nameLength, const u32 i_hint)
+{
+    // devices are listed in the same order on each read and fill the slots in that order, the
+    // hint is right most of the time
+    if (i_hint < s_state.devicesCount)
+    {
+        Device* const candidate = &s_state.devices[i_hint];
+        if (candidate->seenUpdate != 0 && NameEquals(candidate->info.name, i_name, i_nameLength))
+        {
+            return candidate;
+        }
+    }
+
+    for (u32 i = 0; i < s_state.devicesCount; i++)
+    {
+        Device* const candidate = &s_state.devices[i];
+        if (candidate->seenUpdate != 0 && NameEquals(candidate->info.name, i_name, i_nameLength))
+        {
+            return candidate;
+        }
+    }
+    return nullptr;
+}
+
+static IgnoredName* FindIgnoredName(const c8* i_name, const u32 i_nameLength)
+{
+    for (u32 i = 0; i < s_state.ignoredNamesCount; i++)
+    {
+        IgnoredName* const candidate = &s_state.ignoredNames[i];
+        if (candidate->seenUpdate != 0 && NameEquals(candidate->name, i_name, i_nameLength))
+        {
+            return candidate;
+        }
+    }
+    return nullptr;
+}
+
+// when the table is full the device is simply looked at again on the next update
+static void AddIgnoredName(const_cstr i_name)
+{
+    IgnoredName* slot = nullptr;
+    for (u32 i = 0; i < s_state.ignoredNamesCount && slot == nullptr; i++)
+    {
+        slot = s_state.ignoredNames[i].seenUpdate == 0 ? &s_state.ignoredNames[i] : nullptr;
+    }
+    if (slot == nullptr && s_state.ignoredNamesCount < k_maxIgnoredNames)
+    {
+        slot = &s_state.ignoredNames[s_state.ignoredNamesCount++];
+    }
+    if (slot != nullptr)
+    {
+        cstr_xcopy(slot->name, k_maxDeviceNameLength, i_name);
+        slot->seenUpdate = s_state.updateIndex;
+    }
+}
+
+static bool IsWholeDisk(const_cstr i_name)
+{
+    // loop and ram disks only mirror files and memory, their traffic is already counted elsewhere
+    if (procfs::StartsWith(i_name, "loop") || procfs::StartsWith(i_name, "ram"))
+    {
+        return false;
+    }
+
+    c8 path[FLORAL_MAX_PATH_LENGTH];
+    c8 resolvedPath[FLORAL_MAX_PATH_LENGTH];
+    cstr_snprintf(path, FLORAL_MAX_PATH_LENGTH, "/sys/class/block/%s/partition", i_name);
+    procfs::ResolvePath(path, resolvedPath, FLORAL_MAX_PATH_LENGTH);
+    return access(resolvedPath, F_OK) != 0;
+}
+
+static Device* AddDevice(const_cstr i_name)
+{
+    Device* slot = nullptr;
+    for (u32 i = 0; i < s_state.devicesCount; i++)
+    {
+        if (s_state.devices[i].seenUpdate == 0)
+        {
+            slot = &s_state.devices[i];
+            break;
+        }
+    }
+    if (slot == nullptr)
+    {
+        if (s_state.devicesCount >= k_maxSlots)
+        {
+            if (!s_state.devicesTruncated)
+            {
+                LOG_WARNING("More than %d disks, '%s' and the next ones are not tracked", k_maxSlots, i_name);
+                s_state.devicesTruncated = true;
+            }
+            return nullptr;
+        }
+        slot = &s_state.devices[s_state.devicesCount++];
+    }
+
+    *slot = {};
+    cstr_xcopy(slot->info.name, k_maxDeviceNameLength, i_name);
+    return slot;
+}
+
+static void UpdateDevices()
+{
+    if (!procfs::Read(&s_state.diskStatsFile))
+    {
+        return;
+    }
+
+    const u64 nowTicks = time_get_ticks();
+    s_state.updateIndex++;
+    if (s_state.updateIndex == 0)
+    {
+        s_state.updateIndex = 1; // 0 is reserved for free slots
+    }
+
+    u64 totalOps = 0;
+    u64 totalOpsMs = 0;
+    const c8* cursor = s_state.diskStatsFile.buffer;
+    u32 deviceIndex = 0; // among the tracked devices listed so far, the hint of the next one
+    while (*cursor != 0)
+    {
+        // "   8       0 sda readsCompleted readsMerged sectorsRead readingMs writesCompleted ..."
+        u64 major = 0;
+        u64 minor = 0;
+        cursor = procfs::ParseU64(cursor, &major);
+        cursor = procfs::ParseU64(cursor, &minor);
+        cursor = procfs::SkipSpaces(cursor);
+        const c8* name = cursor;
+        while (*cursor != ' ' && *cursor != '\n' && *cursor != 0)
+        {
+            cursor++;
+        }
+        const u32 nameLength = (u32)(cursor - name);
+        if (nameLength == 0 || nameLength >= k_maxDeviceNameLength)
+        {
+            cursor = procfs::SkipLine(cursor);
+            continue;
+        }
+
+        // newer kernels append the discard and flush counters, they are not needed
+        u64 fields[(u32)Field::Count];
+        for (u32 i = 0; i < array_length(fields); i++)
+        {
+            cursor = procfs::ParseU64(cursor, &fields[i]);
+        }
+        cursor = procfs::SkipLine(cursor);
+
+        Device* device = FindDevice(name, nameLength, deviceIndex);
+        if (device == nullptr)
+        {
+            IgnoredName* const ignoredName = FindIgnoredName(name, nameLength);
+            if (ignoredName != nullptr)
+            {
+                ignoredName->seenUpdate = s_state.updateIndex;
+                continue;
+            }
+
+            // the partitions and virtual devices never take one of the disks' slots
+            c8 deviceName[k_maxDeviceNameLength];
+            cstr_xcopy(deviceName, nameLength + 1, name);
+            if (!IsWholeDisk(deviceName))
+            {
+                AddIgnoredName(deviceName);
+                continue;
+            }
+            device = AddDevice(deviceName);
+            if (device == nullptr)
+            {
+                continue;
+            }
+
+            // a new device only primes its counters, its first rates come with the next update
+            device->info.stats.readBytes = fields[(u32)Field::SectorsRead] * k_sectorSize;
+            device->info.stats.writtenBytes = fields[(u32)Field::SectorsWritten] * k_sectorSize;
+            s_state.aggregate.readBytes += device->info.stats.readBytes;
+            s_state.aggregate.writtenBytes += device->info.stats.writtenBytes;
+        }
+        else
+        {
+            u64 deltas[(u32)Field::Count];
+            for (u32 i = 0; i < (u32)Field::Count; i++)
+            {
+                // the number of requests queued right now goes down as often as up, it has no delta
+                deltas[i] = i == (u32)Field::InFlight ? 0 : procfs::GetCounterDelta(device->prevFields[i], fields[i], procfs::k_kernelLongBits);
+            }
+
+            Info* const stats = &device->info.stats;
+            const u64 deltaReadBytes = deltas[(u32)Field::SectorsRead] * k_sectorSize;
+            const u64 deltaWrittenBytes = deltas[(u32)Field::SectorsWritten] * k_sectorSize;
+            const u64 deltaOps = deltas[(u32)Field::ReadsCompleted] + deltas[(u32)Field::WritesCompleted];
+            const u64 deltaOpsMs = deltas[(u32)Field::ReadingMs] + deltas[(u32)Field::WritingMs];
+            const f64 deltaTimeMs = time_ticks_to_ms(nowTicks - device->updateTicks);
+            if (deltaTimeMs > 0.0)
+            {
+                const f64 deltaTime = deltaTimeMs * 0.001;
+                stats->readBytesPerSec = (f32)((f64)deltaReadBytes / deltaTime);
+                stats->writeBytesPerSec = (f32)((f64)deltaWrittenBytes / deltaTime);
+                stats->readsPerSec = (f32)((f64)deltas[(u32)Field::ReadsCompleted] / deltaTime);
+                stats->writesPerSec = (f32)((f64)deltas[(u32)Field::WritesCompleted] / deltaTime);
+                // the weighted time grows by the number of requests in flight every ms (Little's law)
+                stats->queueDepth = (f32)((f64)deltas[(u32)Field::WeightedMs] / deltaTimeMs);
+                stats->busy = (f32)math_min((f64)deltas[(u32)Field::BusyMs] * 100.0 / deltaTimeMs, 100.0);
+            }
+            stats->latency = deltaOps > 0 ? (f32)((f64)deltaOpsMs / (f64)deltaOps) : 0.0f;
+            stats->readBytes += deltaReadBytes;
+            stats->writtenBytes += deltaWrittenBytes;
+
+            s_state.aggregate.readBytes += deltaReadBytes;
+            s_state.aggregate.writtenBytes += deltaWrittenBytes;
+            totalOps += deltaOps;
+            totalOpsMs += deltaOpsMs;
+        }
+
+        for (u32 i = 0; i < (u32)Field::Count; i++)
+        {
+            device->prevFields[i] = fields[i];
+        }
+        device->updateTicks = nowTicks;
+        device->seenUpdate = s_state.updateIndex;
+        deviceIndex++;
+    }
+
+    // devices which were not listed have been removed, their slots can be reused
+    Info* const aggregate = &s_state.aggregate;
+    aggregate->readBytesPerSec = 0.0f;
+    aggregate->writeBytesPerSec = 0.0f;
+    aggregate->readsPerSec = 0.0f;
+    aggregate->writesPerSec = 0.0f;
+    aggregate->queueDepth = 0.0f;
+    aggregate->busy = 0.0f;
+    for (u32 i = 0; i < s_state.devicesCount; i++)
+    {
+        Device* const device = &s_state.devices[i];
+        if (device->seenUpdate != s_state.updateIndex)
+        {
+            device->seenUpdate = 0;
+            continue;
+        }
+        const Info& stats = device->info.stats;
+        aggregate->readBytesPerSec += stats.readBytesPerSec;
+        aggregate->writeBytesPerSec += stats.writeBytesPerSec;
+        aggregate->readsPerSec += stats.readsPerSec;
+        aggregate->writesPerSec += stats.writesPerSec;
+        aggregate->queueDepth += stats.queueDepth;
+        // the busiest device is the bottleneck, an average would hide it
+        aggregate->busy = math_max(aggregate->busy, stats.busy);
+    }
+    aggregate->latency = totalOps > 0 ? (f32)((f64)totalOpsMs / (f64)totalOps) : 0.0f;
+    while (s_state.devicesCount > 0 && s_state.devices[s_state.devicesCount - 1].seenUpdate == 0)
+    {
+        s_state.devicesCount--;
+    }
+    for (u32 i = 0; i < s_state.ignoredNamesCount; i++)
+    {
+        IgnoredName* const ignoredName = &s_state.ignoredNames[i];
+        ignoredName->seenUpdate = ignoredName->seenUpdate == s_state.updateIndex ? ignoredName->seenUpdate : 0;
+    }
+    while (s_state.ignoredNamesCount > 0 && s_state.ignoredNames[s_state.ignoredNamesCount - 1].seenUpdate == 0)
+    {
+        s_state.ignoredNamesCount--;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+bool Initialize()
+{
+    LOG_SCOPE(disk);
+
+    s_state.ready = false;
+    s_state.devicesCount = 0;
+    s_state.ignoredNamesCount = 0;
+    s_state.devicesTruncated = false;
+    s_state.updateIndex = 0;
+    s_state.aggregate = {};
+
+    c8 path[FLORAL_MAX_PATH_LENGTH];
+    procfs::ResolvePath("/proc/diskstats", path, FLORAL_MAX_PATH_LENGTH);
+    if (!procfs::Open(&s_state.diskStatsFile, "/proc/diskstats", s_state.diskStatsBuffer, sizeof(s_state.diskStatsBuffer)))
+    {
+        LOG_ERROR("Cannot open '%s'.", path);
+        return false;
+    }
+
+    UpdateDevices();
+    LOG_DEBUG("Available disks:");
+    for (u32 i = 0; i < s_state.devicesCount; i++)
+    {
+        LOG_DEBUG("    %s", s_state.devices[i].info.name);
+    }
+
+    s_state.ready = true;
+    return true;
+}
+
+void CleanUp()
+{
+    if (s_state.ready)
+    {
+        procfs::Close(&s_state.diskStatsFile);
+        s_state.ready = false;
+    }
+}
+
+void ReadStats(Info* o_stats)
+{
+    if (!s_state.ready)
+    {
+        *o_stats = {};
+        return;
+    }
+
+    UpdateDevices();
+    *o_stats = s_state.aggregate;
+}
+
+u32 ReadDevices(DeviceInfo* o_devices, const u32 i_maxDevices)
+{
+    u32 count = 0;
+    for (u32 i = 0; i < s_state.devicesCount && count < i_maxDevices; i++)
+    {
+        const Device& device = s_state.devices[i];
+        if (device.seenUpdate != 0)
+        {
+            o_devices[count++] = device.info;
+        }
+    }
+    return count;
+}
+
+// ----------------------------------------------------------------------------
+} // namespace disk
@@ -0,0 +1,31 @@
+#include "disk.h"
+
+#include <floral/misc.h>
+
+namespace disk
+{
+// ----------------------------------------------------------------------------
+
+bool Initialize()
+{
+    return false;
+}
+
+void CleanUp()
+{
+}
+
+void ReadStats(Info* o_stats)
+{
+    *o_stats = {};
+}
+
+u32 ReadDevices(DeviceInfo* o_devices, const u32 i_maxDevices)
+{
+    MARK_UNUSED(o_devices);
+    MARK_UNUSED(i_maxDevices);
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+} // namespace disk
@@ -1,26 +1,30 @@
 #pragma once
 
-#include <Windows.h>
+#include <floral/stdaliases.h>
 
-#include <floral/memory.h>
+struct linear_allocator_t;
 
 namespace kmdrv
 {
 
-struct State
+// one register to read on one logical processor, 'cpuId' is its index among all the processors of
+// the system: on Windows it goes across processor groups, group 0's processors first
+struct MSRRead
 {
-    HANDLE device;
-    HANDLE pciMutex;
-
-    arena_t arena;
+    u32 cpuId;
+    u32 address;
+    u64 value;
+    bool valid;
 };
 
-extern State* g_state;
-
 bool Initialize(linear_allocator_t* i_allocator);
 bool BeginPCI();
 void EndPCI();
 u32 ReadSMN(u32 i_address);
+// reads on the processor the calling thread is running on
 u64 ReadMSR(u32 i_address);
+// reads all the registers in one pass, keep the reads of a processor next to each other so it is
+// only visited once. Returns the number of valid reads.
+u32 ReadMSRs(MSRRead* io_reads, const u32 i_count);
 
 } // namespace kmdrv
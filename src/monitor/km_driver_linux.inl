@@ -0,0 +1,124 @@
+#include "km_driver.h"
+
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <floral/log.h>
+#include <floral/memory.h>
+#include <floral/misc.h>
+#include <floral/string_utils.h>
+
+#include "procfs.h"
+
+namespace kmdrv
+{
+
+// The msr kernel module exposes each logical processor's MSRs as /dev/cpu/N/msr, a pread() of 8
+// bytes at offset 'address' is a rdmsr executed on that processor. It needs root (or
+// CAP_SYS_RAWIO) and 'modprobe msr'. A regular file can stand for the device (see
+// procfs::SetRoot()), the registers being adjacent there, each value is stored at 'address * 8'.
+
+struct State
+{
+    s32* msrFds; // per logical processor, -1 if it cannot be opened
+    u32* offsetScales; // 1 for the real devices, 8 for the regular files faking them
+    s32 numProcessors;
+
+    arena_t arena;
+};
+
+static State* s_state = nullptr;
+
+// ----------------------------------------------------------------------------
+
+bool Initialize(linear_allocator_t* i_allocator)
+{
+    LOG_SCOPE(kmdrv);
+
+    // the ids go up to the last possible processor, including the offline ones
+    const s32 numProcessors = procfs::GetProcessorsCount();
+    arena_t arena = create_arena(i_allocator, SIZE_KB(1) + sizeof(State) + (size)numProcessors * (sizeof(s32) + sizeof(u32)));
+    s_state = arena_push_pod(&arena, State);
+    s_state->arena = arena;
+
+    s_state->numProcessors = numProcessors;
+    s_state->msrFds = arena_push_podarr(&s_state->arena, s32, s_state->numProcessors);
+    s_state->offsetScales = arena_push_podarr(&s_state->arena, u32, s_state->numProcessors);
+    s32 openedCount = 0;
+    for (s32 i = 0; i < s_state->numProcessors; i++)
+    {
+        c8 devicePath[64];
+        c8 path[FLORAL_MAX_PATH_LENGTH];
+        cstr_snprintf(devicePath, sizeof(devicePath), "/dev/cpu/%d/msr", i);
+        procfs::ResolvePath(devicePath, path, FLORAL_MAX_PATH_LENGTH);
+        s_state->msrFds[i] = open(path, O_RDONLY | O_CLOEXEC);
+        s_state->offsetScales[i] = 1;
+        struct stat fileStat;
+        if (s_state->msrFds[i] >= 0 && fstat(s_state->msrFds[i], &fileStat) == 0 && S_ISREG(fileStat.st_mode))
+        {
+            s_state->offsetScales[i] = sizeof(u64);
+        }
+        openedCount += s_state->msrFds[i] >= 0 ? 1 : 0;
+    }
+
+    if (openedCount == 0)
+    {
+        LOG_ERROR("Cannot open /dev/cpu/*/msr. Is the msr module loaded and are we running as root?");
+        return false;
+    }
+
+    LOG_DEBUG("MSR devices opened for %d / %d processors", openedCount, s_state->numProcessors);
+    return true;
+}
+
+bool BeginPCI()
+{
+    // the SMN index / data registers are shared with the kernel (k10temp, amd_nb) and there is no
+    // lock we could take with it from user space, use the thermal module's sensors instead
+    return false;
+}
+
+void EndPCI()
+{
+}
+
+u32 ReadSMN(u32 i_address)
+{
+    MARK_UNUSED(i_address);
+    return 0;
+}
+
+u64 ReadMSR(u32 i_address)
+{
+    MSRRead read = {
+        .cpuId = (u32)sched_getcpu(),
+        .address = i_address
+    };
+    ReadMSRs(&read, 1);
+    return read.value;
+}
+
+u32 ReadMSRs(MSRRead* io_reads, const u32 i_count)
+{
+    // no need to migrate anywhere, the kernel runs each read on its processor
+    u32 validCount = 0;
+    for (u32 i = 0; i < i_count; i++)
+    {
+        MSRRead* const read = &io_reads[i];
+        read->value = 0;
+        read->valid = false;
+        if (read->cpuId >= (u32)s_state->numProcessors || s_state->msrFds[read->cpuId] < 0)
+        {
+            continue;
+        }
+
+        const off_t offset = (off_t)read->address * s_state->offsetScales[read->cpuId];
+        read->valid = pread(s_state->msrFds[read->cpuId], &read->value, sizeof(u64), offset) == sizeof(u64);
+        validCount += read->valid ? 1 : 0;
+    }
+    return validCount;
+}
+
+} // namespace kmdrv
@@ -2,16 +2,13 @@
 
 #include "floral/stdaliases.h"
 
-// this order of includes is important
-#include <ws2tcpip.h>
-#include <Windows.h>
-#include <iphlpapi.h>
-#include <tchar.h>
-
 namespace network
 {
 // ----------------------------------------------------------------------------
 
+constexpr u32 k_maxInterfaces = 16;
+constexpr u32 k_maxInterfaceNameLength = 32;
+
 struct Info
 {
     u64 sentBytes;
@@ -20,10 +17,20 @@ struct Info
     f32 sentBytesPerSec;
 };
 
+struct InterfaceInfo
+{
+    c8 name[k_maxInterfaceNameLength];
+    Info stats;
+    bool loopback;
+};
+
 
 bool Initialize();
 void CleanUp();
+// aggregated over all the tracked interfaces (loopback excluded), also updates the per-interface stats
 void ReadStats(f32* o_ingress, f32* o_egress, u64* o_sent, u64* o_received);
+// per-interface stats as of the last ReadStats(), returns the number of interfaces written
+u32 ReadInterfaces(InterfaceInfo* o_interfaces, const u32 i_maxInterfaces);
 
 // ----------------------------------------------------------------------------
 } // namespace network
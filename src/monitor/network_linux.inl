@@ -0,0 +1,342 @@
+#include "network.h"
+
+#include <string.h>
+
+#include <floral/assert.h>
+#include <floral/log.h>
+#include <floral/misc.h>
+#include <floral/time.h>
+
+#include "procfs.h"
+
+namespace network
+{
+// ----------------------------------------------------------------------------
+
+// containers and VMs add a veth / tap interface each, all of them count in the aggregate while only
+// the first k_maxInterfaces are reported one by one. A /proc/net/dev line is ~120 bytes.
+constexpr u32 k_maxSlots = 512;
+constexpr size k_netDevBufferSize = 256 + (size)k_maxSlots * 128;
+
+struct Interface
+{
+    InterfaceInfo info;
+    // raw values of the kernel counters, 64-bit on every kernel (see procfs.h)
+    u64 prevReceivedBytes;
+    u64 prevSentBytes;
+    u64 updateTicks;
+    u32 seenUpdate; // the update in which the interface was listed for the last time, 0: free slot
+};
+
+struct State
+{
+    procfs::File netDevFile;
+
+    Interface interfaces[k_maxSlots];
+    u32 interfacesCount;
+    u32 updateIndex;
+    bool interfacesTruncated; // k_maxSlots was reached, warned once
+    bool netDevTruncated; // /proc/net/dev did not fit in the buffer, warned once
+
+    Info aggregate;
+
+    c8 netDevBuffer[k_netDevBufferSize];
+    bool ready;
+};
+
+static State s_state;
+
+// ----------------------------------------------------------------------------
+
+static bool NameEquals(const Interface* i_iface, const c8* i_name, const u32 i_nameLength)
+{
+    if (i_iface->seenUpdate == 0 || i_nameLength >= k_maxInterfaceNameLength || i_iface->info.name[i_nameLength] != 0)
+    {
+        return false;
+    }
+    for (u32 i = 0; i < i_nameLength; i++)
+    {
+        if (i_iface->info.name[i] != i_name[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static Interface* FindInterface(const c8* i_name, const u32 i_nameLength, const u32 i_hint)
+{
+    // interfaces are listed in the same order on each read, the hint is right most of the time
+    if (i_hint < s_state.interfacesCount)
+    {
+        Interface* const candidate = &s_state.interfaces[i_hint];
+        if (NameEquals(candidate, i_name, i_nameLength))
+        {
+            return candidate;
+        }
+    }
+
+    for (u32 i = 0; i < s_state.interfacesCount; i++)
+    {
+        Interface* const candidate = &s_state.interfaces[i];
+        if (NameEquals(candidate, i_name, i_nameLength))
+        {
+            return candidate;
+        }
+    }
+    return nullptr;
+}
+
+static Interface* AddInterface(const c8* i_name, const u32 i_nameLength)
+{
+    Interface* slot = nullptr;
+    for (u32 i = 0; i < s_state.interfacesCount; i++)
+    {
+        if (s_state.interfaces[i].seenUpdate == 0)
+        {
+            slot = &s_state.interfaces[i];
+            break;
+        }
+    }
+    if (slot == nullptr)
+    {
+        if (s_state.interfacesCount >= k_maxSlots)
+        {
+            if (!s_state.interfacesTruncated)
+            {
+                LOG_WARNING("More than %d network interfaces, '%.*s' and the next ones are not tracked", k_maxSlots, (s32)i_nameLength, i_name);
+                s_state.interfacesTruncated = true;
+            }
+            return nullptr;
+        }
+        slot = &s_state.interfaces[s_state.interfacesCount++];
+    }
+
+    *slot = {};
+    const u32 nameLength = math_min(i_nameLength, k_maxInterfaceNameLength - 1);
+    for (u32 i = 0; i < nameLength; i++)
+    {
+        slot->info.name[i] = i_name[i];
+    }
+    slot->info.name[nameLength] = 0;
+    // "lo" is the only loopback a default system has, its traffic never leaves the machine
+    slot->info.loopback = (nameLength == 2 && i_name[0] == 'l' && i_name[1] == 'o');
+    return slot;
+}
+
+static void UpdateInterfaces()
+{
+    if (!procfs::Read(&s_state.netDevFile))
+    {
+        return;
+    }
+
+    // the line cut in the middle would read as an interface with smaller counters
+    if (s_state.netDevFile.length >= s_state.netDevFile.capacity - 1)
+    {
+        c8* const lastNewLine = strrchr(s_state.netDevFile.buffer, '\n');
+        if (lastNewLine)
+        {
+            lastNewLine[1] = 0;
+        }
+        if (!s_state.netDevTruncated)
+        {
+            LOG_WARNING("/proc/net/dev is larger than %d bytes, the interfaces listed last are not tracked", (s32)k_netDevBufferSize);
+            s_state.netDevTruncated = true;
+        }
+    }
+
+    const u64 nowTicks = time_get_ticks();
+    s_state.updateIndex++;
+    if (s_state.updateIndex == 0)
+    {
+        s_state.updateIndex = 1; // 0 is reserved for free slots
+    }
+
+    // the first two lines are the column headers
+    const c8* cursor = procfs::SkipLine(procfs::SkipLine(s_state.netDevFile.buffer));
+    u32 lineIndex = 0;
+    while (*cursor != 0)
+    {
+        // "  eth0: rxBytes rxPackets rxErrs rxDrop rxFifo rxFrame rxCompressed rxMulticast txBytes ..."
+        cursor = procfs::SkipSpaces(cursor);
+        const c8* name = cursor;
+        while (*cursor != ':' && *cursor != '\n' && *cursor != 0)
+        {
+            cursor++;
+        }
+        if (*cursor != ':')
+        {
+            cursor = procfs::SkipLine(cursor);
+            continue;
+        }
+        const u32 nameLength = (u32)(cursor - name);
+        cursor++;
+
+        u64 fields[9];
+        for (u32 i = 0; i < array_length(fields); i++)
+        {
+            cursor = procfs::ParseU64(cursor, &fields[i]);
+        }
+        cursor = procfs::SkipLine(cursor);
+        const u64 receivedBytes = fields[0];
+        const u64 sentBytes = fields[8];
+
+        Interface* iface = FindInterface(name, nameLength, lineIndex);
+        if (iface == nullptr)
+        {
+            iface = AddInterface(name, nameLength);
+            if (iface == nullptr)
+            {
+                lineIndex++;
+                continue;
+            }
+
+            // a new interface only primes its counters, its first rate comes with the next update
+            // so the aggregate does not see a spike of everything it ever transferred
+            if (!iface->info.loopback)
+            {
+                s_state.aggregate.receivedBytes += receivedBytes;
+                s_state.aggregate.sentBytes += sentBytes;
+            }
+            iface->info.stats.receivedBytes = receivedBytes;
+            iface->info.stats.sentBytes = sentBytes;
+        }
+        else
+        {
+            const u64 deltaReceivedBytes = procfs::GetCounterDelta(iface->prevReceivedBytes, receivedBytes);
+            const u64 deltaSentBytes = procfs::GetCounterDelta(iface->prevSentBytes, sentBytes);
+            const f64 deltaTime = time_ticks_to_ms(nowTicks - iface->updateTicks) * 0.001;
+            if (deltaTime > 0.0)
+            {
+                iface->info.stats.receivedBytesPerSec = (f32)((f64)deltaReceivedBytes / deltaTime);
+                iface->info.stats.sentBytesPerSec = (f32)((f64)deltaSentBytes / deltaTime);
+            }
+            iface->info.stats.receivedBytes += deltaReceivedBytes;
+            iface->info.stats.sentBytes += deltaSentBytes;
+            if (!iface->info.loopback)
+            {
+                s_state.aggregate.receivedBytes += deltaReceivedBytes;
+                s_state.aggregate.sentBytes += deltaSentBytes;
+            }
+        }
+
+        iface->prevReceivedBytes = receivedBytes;
+        iface->prevSentBytes = sentBytes;
+        iface->updateTicks = nowTicks;
+        iface->seenUpdate = s_state.updateIndex;
+        lineIndex++;
+    }
+
+    // interfaces which were not listed have been unplugged, their slots can be reused
+    f32 receivedBytesPerSec = 0.0f;
+    f32 sentBytesPerSec = 0.0f;
+    for (u32 i = 0; i < s_state.interfacesCount; i++)
+    {
+        Interface* const iface = &s_state.interfaces[i];
+        if (iface->seenUpdate != s_state.updateIndex)
+        {
+            iface->seenUpdate = 0;
+            continue;
+        }
+        if (!iface->info.loopback)
+        {
+            receivedBytesPerSec += iface->info.stats.receivedBytesPerSec;
+            sentBytesPerSec += iface->info.stats.sentBytesPerSec;
+        }
+    }
+    while (s_state.interfacesCount > 0 && s_state.interfaces[s_state.interfacesCount - 1].seenUpdate == 0)
+    {
+        s_state.interfacesCount--;
+    }
+
+    s_state.aggregate.receivedBytesPerSec = receivedBytesPerSec;
+    s_state.aggregate.sentBytesPerSec = sentBytesPerSec;
+}
+
+// ----------------------------------------------------------------------------
+
+bool Initialize()
+{
+    LOG_SCOPE(network);
+
+    s_state.ready = false;
+    s_state.interfacesCount = 0;
+    s_state.updateIndex = 0;
+    s_state.interfacesTruncated = false;
+    s_state.netDevTruncated = false;
+    s_state.aggregate = {};
+
+    // the buffer is static, the module has no allocator (same as on Windows)
+    c8 path[FLORAL_MAX_PATH_LENGTH];
+    procfs::ResolvePath("/proc/net/dev", path, FLORAL_MAX_PATH_LENGTH);
+    if (!procfs::Open(&s_state.netDevFile, "/proc/net/dev", s_state.netDevBuffer, sizeof(s_state.netDevBuffer)))
+    {
+        LOG_ERROR("Cannot open '%s'.", path);
+        return false;
+    }
+
+    UpdateInterfaces();
+    LOG_DEBUG("Available network interface:");
+    for (u32 i = 0; i < s_state.interfacesCount; i++)
+    {
+        LOG_DEBUG("    %s", s_state.interfaces[i].info.name);
+    }
+
+    s_state.ready = true;
+    LOG_DEBUG("Network Driver initialized.");
+    return true;
+}
+
+void CleanUp()
+{
+    if (s_state.ready)
+    {
+        procfs::Close(&s_state.netDevFile);
+        s_state.ready = false;
+        LOG_VERBOSE("Network Driver destroyed.");
+        return;
+    }
+}
+
+void ReadStats(f32* o_ingress, f32* o_egress, u64* o_sent, u64* o_received)
+{
+    if (!s_state.ready)
+    {
+        return;
+    }
+
+    UpdateInterfaces();
+    if (o_ingress)
+    {
+        *o_ingress = s_state.aggregate.receivedBytesPerSec;
+    }
+    if (o_egress)
+    {
+        *o_egress = s_state.aggregate.sentBytesPerSec;
+    }
+    if (o_sent)
+    {
+        *o_sent = s_state.aggregate.sentBytes;
+    }
+    if (o_received)
+    {
+        *o_received = s_state.aggregate.receivedBytes;
+    }
+}
+
+u32 ReadInterfaces(InterfaceInfo* o_interfaces, const u32 i_maxInterfaces)
+{
+    u32 count = 0;
+    for (u32 i = 0; i < s_state.interfacesCount && count < i_maxInterfaces; i++)
+    {
+        if (s_state.interfaces[i].seenUpdate != 0)
+        {
+            o_interfaces[count++] = s_state.interfaces[i].info;
+        }
+    }
+    return count;
+}
+
+// ----------------------------------------------------------------------------
+} // namespace network
@@ -0,0 +1,144 @@
+#include "network.h"
+
+// this order of includes is important
+#include <ws2tcpip.h>
+#include <Windows.h>
+#include <iphlpapi.h>
+#include <tchar.h>
+
+#include <floral/log.h>
+#include <floral/misc.h>
+#include <floral/time.h>
+
+namespace network
+{
+// ----------------------------------------------------------------------------
+
+struct State
+{
+    u64 receivedBytes;
+    u64 sentBytes;
+    u64 updateTicks;
+
+    NET_LUID interfaceLuid;
+    InterfaceInfo interfaceInfo;
+
+    bool ready;
+};
+
+struct State s_state;
+
+// ----------------------------------------------------------------------------
+
+bool Initialize()
+{
+    LOG_SCOPE(network);
+
+    s_state.ready = false;
+    s_state.interfaceLuid.Value = 0;
+
+    MIB_IF_TABLE2* ifTable = nullptr;
+    DWORD ret = GetIfTable2(&ifTable);
+    if (ret == NO_ERROR)
+    {
+        LOG_DEBUG("Available network interface:");
+        for (size i = 0; i < ifTable->NumEntries; i++)
+        {
+            const MIB_IF_ROW2& row = ifTable->Table[i];
+            if (row.MediaConnectState == MediaConnectStateConnected)
+            {
+                if (row.InterfaceAndOperStatusFlags.HardwareInterface == TRUE && s_state.interfaceLuid.Value == 0)
+                {
+                    s_state.interfaceLuid = row.InterfaceLuid;
+                    s_state.interfaceInfo = {};
+                    WideCharToMultiByte(CP_UTF8, 0, row.Alias, -1, s_state.interfaceInfo.name, k_maxInterfaceNameLength, NULL, NULL);
+                    s_state.interfaceInfo.name[k_maxInterfaceNameLength - 1] = 0;
+                    LOG_DEBUG(TEXT("(*) %s"), row.Alias);
+                }
+                else
+                {
+                    LOG_DEBUG(TEXT("    %s"), row.Alias);
+                }
+            }
+        }
+
+        FreeMibTable(ifTable);
+
+        s_state.ready = true;
+        LOG_DEBUG("Network Driver initialized.");
+        return true;
+    }
+    else
+    {
+        LOG_ERROR("Error when getting network's IfTable.");
+        return false;
+    }
+}
+
+void CleanUp()
+{
+    if (s_state.ready)
+    {
+        s_state.ready = false;
+        LOG_VERBOSE("Network Driver destroyed.");
+        return;
+    }
+}
+
+void ReadStats(f32* o_ingress, f32* o_egress, u64* o_sent, u64* o_received)
+{
+    const u64 nowTicks = time_get_ticks();
+    MIB_IF_ROW2 row = {};
+    row.InterfaceLuid = s_state.interfaceLuid;
+    if (s_state.ready && GetIfEntry2(&row) == NO_ERROR)
+    {
+        u64 receivedBytes = row.InOctets;
+        u64 sentBytes = row.OutOctets;
+        if (s_state.receivedBytes > 0 && s_state.sentBytes > 0)
+        {
+            f64 deltaTime = time_ticks_to_ms(nowTicks - s_state.updateTicks) * 0.001;
+            u64 deltaReceivedBytes = receivedBytes - s_state.receivedBytes;
+            u64 deltaSentBytes = sentBytes - s_state.sentBytes;
+
+            s_state.interfaceInfo.stats.sentBytesPerSec = (f32)((f64)deltaSentBytes / deltaTime);
+            s_state.interfaceInfo.stats.receivedBytesPerSec = (f32)((f64)deltaReceivedBytes / deltaTime);
+            if (o_egress)
+            {
+                *o_egress = s_state.interfaceInfo.stats.sentBytesPerSec;
+            }
+            if (o_ingress)
+            {
+                *o_ingress = s_state.interfaceInfo.stats.receivedBytesPerSec;
+            }
+        }
+        s_state.receivedBytes = receivedBytes;
+        s_state.sentBytes = sentBytes;
+        s_state.interfaceInfo.stats.receivedBytes = receivedBytes;
+        s_state.interfaceInfo.stats.sentBytes = sentBytes;
+
+        if (o_received)
+        {
+            *o_received = receivedBytes;
+        }
+        if (o_sent)
+        {
+            *o_sent = sentBytes;
+        }
+    }
+
+    s_state.updateTicks = nowTicks;
+}
+
+u32 ReadInterfaces(InterfaceInfo* o_interfaces, const u32 i_maxInterfaces)
+{
+    // only the interface picked at initialization is tracked on Windows
+    if (!s_state.ready || s_state.interfaceLuid.Value == 0 || i_maxInterfaces == 0)
+    {
+        return 0;
+    }
+    o_interfaces[0] = s_state.interfaceInfo;
+    return 1;
+}
+
+// ----------------------------------------------------------------------------
+} // namespace network
@@ -0,0 +1,11 @@
+#include "perf.h"
+
+#include <floral/configs.h>
+
+#if defined(FLORAL_PLATFORM_WINDOWS)
+#  include "perf_windows.inl"
+#elif defined(FLORAL_PLATFORM_LINUX)
+#  include "perf_linux.inl"
+#else
+// TODO
+#endif
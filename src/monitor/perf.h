@@ -0,0 +1,41 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+
+struct linear_allocator_t;
+
+// hardware performance counters (perf_event on Linux), they tell how efficiently the cores run
+// where the utilization only tells how long they run
+namespace perf
+{
+// ----------------------------------------------------------------------------
+
+enum class Mode : u8
+{
+    Unavailable = 0,
+    Software, // no access to the PMU (VM, perf_event_paranoid...), only the kernel's software events
+    Hardware
+};
+
+// rates are computed between the last two updates
+struct Counters
+{
+    // hardware mode
+    f32 instructionsPerCycle;
+    f32 cacheMissesPerKiloInstructions; // last level cache
+    f32 branchMissesPerKiloInstructions;
+
+    // both modes
+    f32 contextSwitchesPerSec;
+    f32 pageFaultsPerSec;
+};
+
+bool Initialize(linear_allocator_t* i_allocator);
+void CleanUp();
+Mode GetMode();
+
+void Update();
+void ReadCounters(Counters* o_total, Counters* o_cores, u32* i_coreIds, u32 i_numCores);
+
+// ----------------------------------------------------------------------------
+} // namespace perf
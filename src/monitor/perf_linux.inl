@@ -0,0 +1,306 @@
+#include "perf.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <floral/log.h>
+#include <floral/memory.h>
+#include <floral/misc.h>
+#include <floral/time.h>
+
+#include "procfs.h"
+
+namespace perf
+{
+// ----------------------------------------------------------------------------
+
+enum class Event : u8
+{
+    Cycles = 0,
+    Instructions,
+    CacheMisses,
+    BranchMisses,
+    ContextSwitches,
+    PageFaults,
+
+    Count
+};
+
+struct EventDesc
+{
+    Event event;
+    u32 type;
+    u64 config;
+};
+
+// the first event of each group is its leader, the whole group is scheduled on the PMU at once so
+// the ratios between its counters are consistent
+static const EventDesc k_hardwareEvents[] = {
+    {         Event::Cycles, PERF_TYPE_HARDWARE,        PERF_COUNT_HW_CPU_CYCLES},
+    {   Event::Instructions, PERF_TYPE_HARDWARE,      PERF_COUNT_HW_INSTRUCTIONS},
+    {    Event::CacheMisses, PERF_TYPE_HARDWARE,      PERF_COUNT_HW_CACHE_MISSES},
+    {   Event::BranchMisses, PERF_TYPE_HARDWARE,     PERF_COUNT_HW_BRANCH_MISSES},
+    {Event::ContextSwitches, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    {     Event::PageFaults, PERF_TYPE_SOFTWARE,     PERF_COUNT_SW_PAGE_FAULTS},
+};
+
+// a cpu-clock event opened on a cpu counts the wall time whether it is idle or not, it would tell
+// nothing the elapsed time does not: the context switches lead the group
+static const EventDesc k_softwareEvents[] = {
+    {Event::ContextSwitches, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    {     Event::PageFaults, PERF_TYPE_SOFTWARE,     PERF_COUNT_SW_PAGE_FAULTS},
+};
+
+struct CpuGroup
+{
+    s32 fds[(u32)Event::Count]; // in the order of the mode's events, the first one is the leader
+    u64 prevValues[(u32)Event::Count];
+    u64 prevTimeEnabled;
+    u64 prevTimeRunning;
+    u64 deltas[(u32)Event::Count]; // between the last two updates, indexed by Event
+    Counters counters;
+    bool primed;
+};
+
+struct State
+{
+    Mode mode;
+    const EventDesc* events;
+    u32 eventsCount;
+
+    CpuGroup* groups;
+    s32 numProcessors;
+    u64 updateTicks;
+    Counters total;
+
+    arena_t arena;
+};
+
+static State* s_state = nullptr;
+
+// ----------------------------------------------------------------------------
+
+static s32 OpenEvent(const EventDesc& i_desc, const s32 i_cpuId, const s32 i_groupFd)
+{
+    perf_event_attr attr = {};
+    attr.size = sizeof(perf_event_attr);
+    attr.type = i_desc.type;
+    attr.config = i_desc.config;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.disabled = (i_groupFd < 0) ? 1 : 0; // the group is enabled at once through its leader
+    // system-wide on one cpu: needs perf_event_paranoid <= 0 or CAP_PERFMON
+    return (s32)syscall(__NR_perf_event_open, &attr, -1, i_cpuId, i_groupFd, PERF_FLAG_FD_CLOEXEC);
+}
+
+static void CloseGroup(CpuGroup* const io_group)
+{
+    // members first, the leader last
+    for (s32 i = (s32)Event::Count - 1; i >= 0; i--)
+    {
+        if (io_group->fds[i] >= 0)
+        {
+            close(io_group->fds[i]);
+        }
+        io_group->fds[i] = -1;
+    }
+}
+
+static bool OpenGroup(CpuGroup* const io_group, const s32 i_cpuId, const EventDesc* i_events, const u32 i_eventsCount)
+{
+    *io_group = {};
+    for (u32 i = 0; i < (u32)Event::Count; i++)
+    {
+        io_group->fds[i] = -1;
+    }
+
+    for (u32 i = 0; i < i_eventsCount; i++)
+    {
+        io_group->fds[i] = OpenEvent(i_events[i], i_cpuId, i == 0 ? -1 : io_group->fds[0]);
+        if (io_group->fds[i] < 0)
+        {
+            CloseGroup(io_group);
+            return false;
+        }
+    }
+
+    ioctl(io_group->fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(io_group->fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+}
+
+static bool OpenGroups(const Mode i_mode, const EventDesc* i_events, const u32 i_eventsCount)
+{
+    // offline cpus cannot be opened, the mode is usable as long as one of them can
+    u32 openedCount = 0;
+    for (s32 i = 0; i < s_state->numProcessors; i++)
+    {
+        openedCount += OpenGroup(&s_state->groups[i], i, i_events, i_eventsCount) ? 1 : 0;
+    }
+
+    if (openedCount == 0)
+    {
+        return false;
+    }
+
+    s_state->mode = i_mode;
+    s_state->events = i_events;
+    s_state->eventsCount = i_eventsCount;
+    LOG_DEBUG("perf_event counters opened on %d / %d processors", openedCount, s_state->numProcessors);
+    return true;
+}
+
+static f32 PerKilo(const u64 i_count, const u64 i_instructions)
+{
+    return i_instructions > 0 ? (f32)((f64)i_count * 1000.0 / (f64)i_instructions) : 0.0f;
+}
+
+static void ComputeCounters(Counters* o_counters, const u64* i_deltas, const f64 i_elapsedSecs)
+{
+    const u64 instructions = i_deltas[(u32)Event::Instructions];
+    const u64 cycles = i_deltas[(u32)Event::Cycles];
+    o_counters->instructionsPerCycle = cycles > 0 ? (f32)((f64)instructions / (f64)cycles) : 0.0f;
+    o_counters->cacheMissesPerKiloInstructions = PerKilo(i_deltas[(u32)Event::CacheMisses], instructions);
+    o_counters->branchMissesPerKiloInstructions = PerKilo(i_deltas[(u32)Event::BranchMisses], instructions);
+    if (i_elapsedSecs > 0.0)
+    {
+        o_counters->contextSwitchesPerSec = (f32)((f64)i_deltas[(u32)Event::ContextSwitches] / i_elapsedSecs);
+        o_counters->pageFaultsPerSec = (f32)((f64)i_deltas[(u32)Event::PageFaults] / i_elapsedSecs);
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+bool Initialize(linear_allocator_t* i_allocator)
+{
+    LOG_SCOPE(perf);
+    // one group per possible processor id, the offline ones included, as cpu:: indexes them
+    const s32 numProcessors = procfs::GetProcessorsCount();
+    arena_t arena = create_arena(i_allocator, SIZE_KB(1) + sizeof(State) + (size)numProcessors * sizeof(CpuGroup));
+    s_state = arena_push_pod(&arena, State);
+    s_state->arena = arena;
+
+    s_state->numProcessors = numProcessors;
+    s_state->groups = arena_push_podarr(&s_state->arena, CpuGroup, s_state->numProcessors);
+    s_state->mode = Mode::Unavailable;
+    s_state->events = nullptr;
+    s_state->eventsCount = 0;
+    s_state->total = {};
+
+    if (OpenGroups(Mode::Hardware, k_hardwareEvents, array_length(k_hardwareEvents)))
+    {
+        LOG_DEBUG("Hardware counters available");
+    }
+    else if (OpenGroups(Mode::Software, k_softwareEvents, array_length(k_softwareEvents)))
+    {
+        LOG_WARNING("No access to the hardware counters, falling back to software events");
+    }
+    else
+    {
+        LOG_WARNING("perf_event is not accessible (see /proc/sys/kernel/perf_event_paranoid)");
+        return false;
+    }
+
+    s_state->updateTicks = time_get_ticks();
+    Update();
+    return true;
+}
+
+void CleanUp()
+{
+    if (s_state->mode == Mode::Unavailable)
+    {
+        return;
+    }
+    for (s32 i = 0; i < s_state->numProcessors; i++)
+    {
+        CloseGroup(&s_state->groups[i]);
+    }
+    s_state->mode = Mode::Unavailable;
+}
+
+Mode GetMode()
+{
+    return s_state->mode;
+}
+
+void Update()
+{
+    if (s_state->mode == Mode::Unavailable)
+    {
+        return;
+    }
+
+    const u64 nowTicks = time_get_ticks();
+    const f64 elapsedSecs = time_ticks_to_ms(nowTicks - s_state->updateTicks) * 0.001;
+    s_state->updateTicks = nowTicks;
+
+    u64 totalDeltas[(u32)Event::Count] = {};
+    for (s32 i = 0; i < s_state->numProcessors; i++)
+    {
+        CpuGroup* const group = &s_state->groups[i];
+        if (group->fds[0] < 0)
+        {
+            continue;
+        }
+
+        // PERF_FORMAT_GROUP: the whole group in one read, { nr, time_enabled, time_running, values[nr] }
+        u64 buffer[3 + (u32)Event::Count];
+        const ssize bytesRead = read(group->fds[0], buffer, sizeof(buffer));
+        if (bytesRead < (ssize)(3 * sizeof(u64)) || buffer[0] != s_state->eventsCount)
+        {
+            continue;
+        }
+
+        const u64 timeEnabled = buffer[1];
+        const u64 timeRunning = buffer[2];
+        const u64* values = &buffer[3];
+        if (group->primed)
+        {
+            // with more groups than PMU counters the kernel multiplexes them, extrapolate to the
+            // whole period from the fraction of it the group was actually counting
+            const u64 deltaEnabled = timeEnabled - group->prevTimeEnabled;
+            const u64 deltaRunning = timeRunning - group->prevTimeRunning;
+            const f64 scale = (deltaRunning > 0 && deltaRunning < deltaEnabled) ? (f64)deltaEnabled / (f64)deltaRunning : 1.0;
+            for (u32 e = 0; e < s_state->eventsCount; e++)
+            {
+                const u32 event = (u32)s_state->events[e].event;
+                const u64 delta = values[e] >= group->prevValues[e] ? values[e] - group->prevValues[e] : 0;
+                group->deltas[event] = (u64)((f64)delta * scale);
+                totalDeltas[event] += group->deltas[event];
+            }
+            ComputeCounters(&group->counters, group->deltas, elapsedSecs);
+        }
+
+        for (u32 e = 0; e < s_state->eventsCount; e++)
+        {
+            group->prevValues[e] = values[e];
+        }
+        group->prevTimeEnabled = timeEnabled;
+        group->prevTimeRunning = timeRunning;
+        group->primed = true;
+    }
+
+    ComputeCounters(&s_state->total, totalDeltas, elapsedSecs);
+}
+
+void ReadCounters(Counters* o_total, Counters* o_cores, u32* i_coreIds, u32 i_numCores)
+{
+    if (o_total)
+    {
+        *o_total = s_state->total;
+    }
+
+    if (o_cores && i_coreIds)
+    {
+        for (u32 i = 0; i < i_numCores; i++)
+        {
+            const u32 cpuId = i_coreIds[i];
+            o_cores[i] = cpuId < (u32)s_state->numProcessors ? s_state->groups[cpuId].counters : Counters{};
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+} // namespace perf
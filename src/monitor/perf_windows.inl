@@ -0,0 +1,47 @@
+#include "perf.h"
+
+#include <floral/misc.h>
+
+namespace perf
+{
+// ----------------------------------------------------------------------------
+
+// TODO: the PMU is only reachable through ETW's profiling sources on Windows
+
+bool Initialize(linear_allocator_t* i_allocator)
+{
+    MARK_UNUSED(i_allocator);
+    return false;
+}
+
+void CleanUp()
+{
+}
+
+Mode GetMode()
+{
+    return Mode::Unavailable;
+}
+
+void Update()
+{
+}
+
+void ReadCounters(Counters* o_total, Counters* o_cores, u32* i_coreIds, u32 i_numCores)
+{
+    MARK_UNUSED(i_coreIds);
+    if (o_total)
+    {
+        *o_total = {};
+    }
+    if (o_cores)
+    {
+        for (u32 i = 0; i < i_numCores; i++)
+        {
+            o_cores[i] = {};
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+} // namespace perf
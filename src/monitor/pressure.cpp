@@ -0,0 +1,11 @@
+#include "pressure.h"
+
+#include <floral/configs.h>
+
+#if defined(FLORAL_PLATFORM_WINDOWS)
+#  include "pressure_windows.inl"
+#elif defined(FLORAL_PLATFORM_LINUX)
+#  include "pressure_linux.inl"
+#else
+// TODO
+#endif
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+
+struct linear_allocator_t;
+
+// Pressure Stall Information and cgroup v2 resource usage: how long tasks were stalled waiting for
+// a resource, which the utilization percentages do not tell
+namespace pressure
+{
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_maxCgroups = 1024; // a busy Kubernetes node, each one holds 6 fds within the open files limit
+constexpr u32 k_maxCgroupPathLength = 128;
+constexpr const_cstr k_defaultCgroupRoot = "/sys/fs/cgroup";
+
+// % of the wall time over the last 10s, 60s and 300s
+struct Stall
+{
+    f32 avg10;
+    f32 avg60;
+    f32 avg300;
+    u64 totalUs;
+};
+
+struct Resource
+{
+    Stall some; // at least one task was stalled
+    Stall full; // all the non-idle tasks were stalled at once (not reported for the system's cpu)
+};
+
+struct SystemPressure
+{
+    Resource cpu;
+    Resource memory;
+    Resource io;
+};
+
+struct CgroupInfo
+{
+    c8 path[k_maxCgroupPathLength]; // relative to the cgroup root
+    Resource cpu;
+    Resource memory;
+    Resource io;
+    f32 pressure; // the highest 'some avg10' of the three, what the cgroups are ranked by
+
+    f32 cpuUsage;   // % of one cpu
+    u64 memoryCurrent;
+    f32 ioReadBytesPerSec;
+    f32 ioWriteBytesPerSec;
+};
+
+// the cgroup root is resolved relatively to the procfs root (see procfs::SetRoot())
+bool Initialize(linear_allocator_t* i_allocator, const_cstr i_cgroupRoot);
+void CleanUp();
+
+void Update();
+bool ReadSystemPressure(SystemPressure* o_pressure);
+// the most stalled cgroups first, returns the number of cgroups written
+u32 ReadTopCgroups(CgroupInfo* o_cgroups, const u32 i_maxCgroups);
+
+// ----------------------------------------------------------------------------
+} // namespace pressure
@@ -0,0 +1,705 @@
+#include "pressure.h"
+
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <floral/assert.h>
+#include <floral/log.h>
+#include <floral/memory.h>
+#include <floral/misc.h>
+#include <floral/string_utils.h>
+#include <floral/time.h>
+
+#include "procfs.h"
+
+namespace pressure
+{
+// ----------------------------------------------------------------------------
+
+enum class ResourceType : u8
+{
+    CPU = 0,
+    Memory,
+    IO,
+
+    Count
+};
+
+static const_cstr k_systemPressurePaths[] = { "/proc/pressure/cpu", "/proc/pressure/memory", "/proc/pressure/io" };
+static const_cstr k_cgroupPressureFiles[] = { "cpu.pressure", "memory.pressure", "io.pressure" };
+static_assert(array_length(k_systemPressurePaths) == (u32)ResourceType::Count, "Missing PSI files");
+static_assert(array_length(k_cgroupPressureFiles) == (u32)ResourceType::Count, "Missing PSI files");
+
+// all the files of a cgroup are small and parsed as soon as they are read, every cgroup reads them
+// into the same block
+constexpr size k_pressureBufferSize = 256;
+constexpr size k_cpuStatBufferSize = 512;
+constexpr size k_memoryCurrentBufferSize = 32;
+constexpr size k_ioStatBufferSize = 2048;
+constexpr size k_cgroupBuffersSize = k_pressureBufferSize * (size)ResourceType::Count + k_cpuStatBufferSize
+                                     + k_memoryCurrentBufferSize + k_ioStatBufferSize;
+constexpr u32 k_cgroupFilesCount = (u32)ResourceType::Count + 3;
+// fds left for what is opened after the pressure module (the process module's stat files have their
+// own budget) when the cgroups' files are kept open
+constexpr u32 k_reservedFilesCount = 256;
+
+struct Cgroup
+{
+    CgroupInfo info;
+    s32 watch; // inotify watch descriptor of the cgroup's directory, -1 if none
+
+    procfs::File pressureFiles[(u32)ResourceType::Count];
+    procfs::File cpuStatFile;
+    procfs::File memoryCurrentFile;
+    procfs::File ioStatFile;
+
+    u64 prevUsageUs;
+    u64 prevReadBytes;
+    u64 prevWriteBytes;
+    u64 prevTicks;
+    bool primed;
+    bool active;
+    bool filesKept; // within the open files budget, otherwise the files are re-opened on every update
+};
+
+struct State
+{
+    c8 cgroupRoot[FLORAL_MAX_PATH_LENGTH];
+    s32 inotifyFd;
+    s32 rootWatch;
+
+    procfs::File systemPressureFiles[(u32)ResourceType::Count];
+    SystemPressure systemPressure;
+
+    Cgroup* cgroups;
+    u32 cgroupsCount; // high-water mark of the used slots
+    bool cgroupsTruncated; // k_maxCgroups was reached, warned once
+    c8* buffers;
+
+    u32 filesBudget; // in cgroups, each one holds k_cgroupFilesCount fds
+    u32 keptCgroupsCount;
+    bool filesBudgetReached; // warned once
+
+    procfs::Key cpuStatKeys[1];
+
+    arena_t arena;
+};
+
+static State* s_state = nullptr;
+
+// ----------------------------------------------------------------------------
+
+static f32 ParseDecimal(const c8* i_cursor)
+{
+    // "12.34", PSI always prints two decimals
+    u64 integer = 0;
+    u64 fraction = 0;
+    u64 fractionScale = 1;
+    i_cursor = procfs::ParseU64(i_cursor, &integer);
+    if (*i_cursor == '.')
+    {
+        i_cursor++;
+        while (*i_cursor >= '0' && *i_cursor <= '9')
+        {
+            fraction = fraction * 10 + (u64)(*i_cursor - '0');
+            fractionScale *= 10;
+            i_cursor++;
+        }
+    }
+    return (f32)integer + (f32)fraction / (f32)fractionScale;
+}
+
+static const c8* ParseStall(const c8* i_cursor, Stall* o_stall)
+{
+    // "avg10=0.00 avg60=0.00 avg300=0.00 total=0"
+    while (*i_cursor != 0 && *i_cursor != '\n')
+    {
+        i_cursor = procfs::SkipSpaces(i_cursor);
+        if (procfs::StartsWith(i_cursor, "avg10="))
+        {
+            o_stall->avg10 = ParseDecimal(i_cursor + 6);
+        }
+        else if (procfs::StartsWith(i_cursor, "avg60="))
+        {
+            o_stall->avg60 = ParseDecimal(i_cursor + 6);
+        }
+        else if (procfs::StartsWith(i_cursor, "avg300="))
+        {
+            o_stall->avg300 = ParseDecimal(i_cursor + 7);
+        }
+        else if (procfs::StartsWith(i_cursor, "total="))
+        {
+            procfs::ParseU64(i_cursor + 6, &o_stall->totalUs);
+        }
+
+        while (*i_cursor != 0 && *i_cursor != ' ' && *i_cursor != '\n')
+        {
+            i_cursor++;
+        }
+    }
+    return procfs::SkipLine(i_cursor);
+}
+
+static bool ReadResource(procfs::File* const io_file, Resource* o_resource)
+{
+    *o_resource = {};
+    if (!procfs::Read(io_file))
+    {
+        return false;
+    }
+
+    const c8* cursor = io_file->buffer;
+    while (*cursor != 0)
+    {
+        if (procfs::StartsWith(cursor, "some "))
+        {
+            cursor = ParseStall(cursor + 5, &o_resource->some);
+        }
+        else if (procfs::StartsWith(cursor, "full "))
+        {
+            cursor = ParseStall(cursor + 5, &o_resource->full);
+        }
+        else
+        {
+            cursor = procfs::SkipLine(cursor);
+        }
+    }
+    return true;
+}
+
+static void ParseIOStat(const c8* i_cursor, u64* o_readBytes, u64* o_writeBytes)
+{
+    // one line per device: "8:0 rbytes=1 wbytes=2 rios=3 wios=4 dbytes=0 dios=0"
+    *o_readBytes = 0;
+    *o_writeBytes = 0;
+    while (*i_cursor != 0)
+    {
+        i_cursor = procfs::SkipSpaces(i_cursor);
+        u64 value = 0;
+        if (procfs::StartsWith(i_cursor, "rbytes="))
+        {
+            i_cursor = procfs::ParseU64(i_cursor + 7, &value);
+            *o_readBytes += value;
+        }
+        else if (procfs::StartsWith(i_cursor, "wbytes="))
+        {
+            i_cursor = procfs::ParseU64(i_cursor + 7, &value);
+            *o_writeBytes += value;
+        }
+        while (*i_cursor != 0 && *i_cursor != ' ' && *i_cursor != '\n')
+        {
+            i_cursor++;
+        }
+        if (*i_cursor == '\n')
+        {
+            i_cursor++;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+static void GetCgroupPath(const_cstr i_relativePath, const_cstr i_file, cstr o_path)
+{
+    if (i_relativePath[0] == 0)
+    {
+        cstr_snprintf(o_path, FLORAL_MAX_PATH_LENGTH, "%s/%s", s_state->cgroupRoot, i_file);
+    }
+    else
+    {
+        cstr_snprintf(o_path, FLORAL_MAX_PATH_LENGTH, "%s/%s/%s", s_state->cgroupRoot, i_relativePath, i_file);
+    }
+}
+
+static Cgroup* FindCgroup(const_cstr i_relativePath)
+{
+    for (u32 i = 0; i < s_state->cgroupsCount; i++)
+    {
+        Cgroup* const cgroup = &s_state->cgroups[i];
+        if (cgroup->active && cstr_compare(cgroup->info.path, i_relativePath) == 0)
+        {
+            return cgroup;
+        }
+    }
+    return nullptr;
+}
+
+static Cgroup* FindCgroupByWatch(const s32 i_watch)
+{
+    for (u32 i = 0; i < s_state->cgroupsCount; i++)
+    {
+        Cgroup* const cgroup = &s_state->cgroups[i];
+        if (cgroup->active && cgroup->watch == i_watch)
+        {
+            return cgroup;
+        }
+    }
+    return nullptr;
+}
+
+// any of them can be missing (controller not enabled, PSI disabled...), they then read as 0
+static void OpenCgroupFiles(Cgroup* const io_cgroup)
+{
+    const_cstr relativePath = io_cgroup->info.path;
+    c8 path[FLORAL_MAX_PATH_LENGTH];
+    c8* buffer = s_state->buffers;
+    for (u32 i = 0; i < (u32)ResourceType::Count; i++)
+    {
+        GetCgroupPath(relativePath, k_cgroupPressureFiles[i], path);
+        procfs::Open(&io_cgroup->pressureFiles[i], path, buffer, k_pressureBufferSize);
+        buffer += k_pressureBufferSize;
+    }
+    GetCgroupPath(relativePath, "cpu.stat", path);
+    procfs::Open(&io_cgroup->cpuStatFile, path, buffer, k_cpuStatBufferSize);
+    buffer += k_cpuStatBufferSize;
+    GetCgroupPath(relativePath, "memory.current", path);
+    procfs::Open(&io_cgroup->memoryCurrentFile, path, buffer, k_memoryCurrentBufferSize);
+    buffer += k_memoryCurrentBufferSize;
+    GetCgroupPath(relativePath, "io.stat", path);
+    procfs::Open(&io_cgroup->ioStatFile, path, buffer, k_ioStatBufferSize);
+}
+
+static void CloseCgroupFiles(Cgroup* const io_cgroup)
+{
+    for (u32 i = 0; i < (u32)ResourceType::Count; i++)
+    {
+        procfs::Close(&io_cgroup->pressureFiles[i]);
+    }
+    procfs::Close(&io_cgroup->cpuStatFile);
+    procfs::Close(&io_cgroup->memoryCurrentFile);
+    procfs::Close(&io_cgroup->ioStatFile);
+}
+
+static void RemoveCgroup(Cgroup* const io_cgroup)
+{
+    CloseCgroupFiles(io_cgroup);
+    s_state->keptCgroupsCount -= io_cgroup->filesKept ? 1 : 0;
+    io_cgroup->filesKept = false;
+    // the kernel drops the watch by itself when the directory is removed, this is for the rescans
+    if (io_cgroup->watch >= 0)
+    {
+        inotify_rm_watch(s_state->inotifyFd, io_cgroup->watch);
+    }
+    io_cgroup->watch = -1;
+    io_cgroup->active = false;
+
+    while (s_state->cgroupsCount > 0 && !s_state->cgroups[s_state->cgroupsCount - 1].active)
+    {
+        s_state->cgroupsCount--;
+    }
+}
+
+// returns the index of the new slot, -1 if the cgroup was already tracked or there is no room left
+static s32 AddCgroup(const_cstr i_relativePath)
+{
+    if (FindCgroup(i_relativePath) != nullptr)
+    {
+        return -1;
+    }
+
+    s32 slot = -1;
+    for (u32 i = 0; i < k_maxCgroups; i++)
+    {
+        if (!s_state->cgroups[i].active)
+        {
+            slot = (s32)i;
+            s_state->cgroupsCount = math_max(s_state->cgroupsCount, i + 1);
+            break;
+        }
+    }
+    if (slot < 0)
+    {
+        if (!s_state->cgroupsTruncated)
+        {
+            LOG_WARNING("More than %d cgroups, '%s' and the next ones are not tracked", k_maxCgroups, i_relativePath);
+            s_state->cgroupsTruncated = true;
+        }
+        return -1;
+    }
+
+    Cgroup* const cgroup = &s_state->cgroups[slot];
+    *cgroup = {};
+    cgroup->watch = -1;
+    cstr_xcopy(cgroup->info.path, k_maxCgroupPathLength, i_relativePath);
+    for (u32 i = 0; i < (u32)ResourceType::Count; i++)
+    {
+        cgroup->pressureFiles[i].fd = -1;
+    }
+    cgroup->cpuStatFile.fd = -1;
+    cgroup->memoryCurrentFile.fd = -1;
+    cgroup->ioStatFile.fd = -1;
+
+    // past the budget, the files are opened on every update rather than failing with EMFILE and
+    // reading as a missing controller
+    cgroup->filesKept = s_state->keptCgroupsCount < s_state->filesBudget;
+    if (cgroup->filesKept)
+    {
+        OpenCgroupFiles(cgroup);
+        s_state->keptCgroupsCount++;
+    }
+    else if (!s_state->filesBudgetReached)
+    {
+        LOG_WARNING("The open files limit leaves room for %d cgroups, '%s' and the next ones re-open their files on every update",
+                    s_state->filesBudget, i_relativePath);
+        s_state->filesBudgetReached = true;
+    }
+
+    cgroup->active = true;
+    return slot;
+}
+
+// watches the directory and adds its children, they may have been created before the watch was.
+// The slots of the children added are appended to io_queue.
+static void WatchCgroup(const_cstr i_relativePath, u32* io_queue, u32* io_queueLength)
+{
+    c8 path[FLORAL_MAX_PATH_LENGTH];
+    c8 resolvedPath[FLORAL_MAX_PATH_LENGTH];
+    GetCgroupPath(i_relativePath, "", path);
+    procfs::ResolvePath(path, resolvedPath, FLORAL_MAX_PATH_LENGTH);
+
+    const s32 watch = inotify_add_watch(s_state->inotifyFd, resolvedPath, IN_CREATE | IN_DELETE | IN_ONLYDIR);
+    if (i_relativePath[0] == 0)
+    {
+        s_state->rootWatch = watch;
+    }
+    else
+    {
+        FindCgroup(i_relativePath)->watch = watch;
+    }
+
+    DIR* dir = opendir(resolvedPath);
+    if (dir == nullptr)
+    {
+        return;
+    }
+
+    struct dirent* entry = nullptr;
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        if (entry->d_type != DT_DIR || entry->d_name[0] == '.')
+        {
+            continue;
+        }
+
+        c8 childPath[k_maxCgroupPathLength];
+        const s32 length = i_relativePath[0] == 0
+                               ? cstr_snprintf(childPath, k_maxCgroupPathLength, "%s", entry->d_name)
+                               : cstr_snprintf(childPath, k_maxCgroupPathLength, "%s/%s", i_relativePath, entry->d_name);
+        if (length < 0 || length >= (s32)k_maxCgroupPathLength)
+        {
+            LOG_WARNING("The path of a cgroup in '%s' is too long, it is not tracked", i_relativePath);
+            continue;
+        }
+
+        const s32 slot = AddCgroup(childPath);
+        if (slot >= 0)
+        {
+            io_queue[(*io_queueLength)++] = (u32)slot;
+        }
+    }
+    closedir(dir);
+}
+
+// breadth-first from a watched cgroup (or the root): past k_maxCgroups the deepest cgroups are the
+// ones left out, rather than everything after the first large subtree
+static void DiscoverCgroups(const_cstr i_relativePath)
+{
+    // each slot is queued at most once, when it is added
+    u32 queue[k_maxCgroups];
+    u32 queueLength = 0;
+    WatchCgroup(i_relativePath, queue, &queueLength);
+    for (u32 i = 0; i < queueLength; i++)
+    {
+        c8 path[k_maxCgroupPathLength];
+        cstr_xcopy(path, k_maxCgroupPathLength, s_state->cgroups[queue[i]].info.path);
+        WatchCgroup(path, queue, &queueLength);
+    }
+}
+
+static void Rescan()
+{
+    for (u32 i = 0; i < s_state->cgroupsCount; i++)
+    {
+        if (s_state->cgroups[i].active)
+        {
+            RemoveCgroup(&s_state->cgroups[i]);
+        }
+    }
+    if (s_state->rootWatch >= 0)
+    {
+        inotify_rm_watch(s_state->inotifyFd, s_state->rootWatch);
+        s_state->rootWatch = -1;
+    }
+    DiscoverCgroups("");
+}
+
+static void ProcessCgroupEvents()
+{
+    if (s_state->inotifyFd < 0)
+    {
+        return;
+    }
+
+    alignas(inotify_event) c8 buffer[4096];
+    while (true)
+    {
+        const ssize length = read(s_state->inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0)
+        {
+            break; // EAGAIN, nothing more to process
+        }
+
+        for (ssize offset = 0; offset < length;)
+        {
+            const inotify_event* event = (const inotify_event*)(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                LOG_WARNING("cgroup events overflowed, rescanning the hierarchy");
+                Rescan();
+                return;
+            }
+            if (!(event->mask & IN_ISDIR) || event->len == 0)
+            {
+                continue;
+            }
+
+            const_cstr parentPath = "";
+            if (event->wd != s_state->rootWatch)
+            {
+                const Cgroup* parent = FindCgroupByWatch(event->wd);
+                if (parent == nullptr)
+                {
+                    continue;
+                }
+                parentPath = parent->info.path;
+            }
+
+            c8 childPath[k_maxCgroupPathLength];
+            const s32 length = parentPath[0] == 0
+                                   ? cstr_snprintf(childPath, k_maxCgroupPathLength, "%s", event->name)
+                                   : cstr_snprintf(childPath, k_maxCgroupPathLength, "%s/%s", parentPath, event->name);
+            if (length < 0 || length >= (s32)k_maxCgroupPathLength)
+            {
+                continue;
+            }
+
+            if (event->mask & IN_CREATE)
+            {
+                // its children can be created before its watch is added
+                if (AddCgroup(childPath) >= 0)
+                {
+                    DiscoverCgroups(childPath);
+                }
+            }
+            else if (event->mask & IN_DELETE)
+            {
+                Cgroup* const cgroup = FindCgroup(childPath);
+                if (cgroup)
+                {
+                    RemoveCgroup(cgroup);
+                }
+            }
+        }
+    }
+}
+
+static void UpdateCgroup(Cgroup* const io_cgroup, const u64 i_nowTicks)
+{
+    if (!io_cgroup->filesKept)
+    {
+        OpenCgroupFiles(io_cgroup);
+    }
+
+    CgroupInfo* const info = &io_cgroup->info;
+    Resource* const resources[] = { &info->cpu, &info->memory, &info->io };
+    info->pressure = 0.0f;
+    for (u32 i = 0; i < (u32)ResourceType::Count; i++)
+    {
+        ReadResource(&io_cgroup->pressureFiles[i], resources[i]);
+        info->pressure = math_max(info->pressure, resources[i]->some.avg10);
+    }
+
+    u64 usageUs = 0;
+    if (procfs::Read(&io_cgroup->cpuStatFile))
+    {
+        procfs::ScanKeyValues(io_cgroup->cpuStatFile.buffer, ' ', s_state->cpuStatKeys, &usageUs, 1);
+    }
+    info->memoryCurrent = 0;
+    if (procfs::Read(&io_cgroup->memoryCurrentFile))
+    {
+        procfs::ParseU64(io_cgroup->memoryCurrentFile.buffer, &info->memoryCurrent);
+    }
+    u64 readBytes = 0;
+    u64 writeBytes = 0;
+    if (procfs::Read(&io_cgroup->ioStatFile))
+    {
+        ParseIOStat(io_cgroup->ioStatFile.buffer, &readBytes, &writeBytes);
+    }
+    if (!io_cgroup->filesKept)
+    {
+        CloseCgroupFiles(io_cgroup);
+    }
+
+    if (io_cgroup->primed && i_nowTicks > io_cgroup->prevTicks)
+    {
+        const f64 elapsedUs = time_ticks_to_us(i_nowTicks - io_cgroup->prevTicks);
+        const f64 elapsedSecs = elapsedUs * 1e-6;
+        // the counters only go back when a cgroup is re-created with the same name
+        info->cpuUsage = usageUs >= io_cgroup->prevUsageUs ? (f32)((f64)(usageUs - io_cgroup->prevUsageUs) * 100.0 / elapsedUs) : 0.0f;
+        info->ioReadBytesPerSec = readBytes >= io_cgroup->prevReadBytes ? (f32)((f64)(readBytes - io_cgroup->prevReadBytes) / elapsedSecs) : 0.0f;
+        info->ioWriteBytesPerSec = writeBytes >= io_cgroup->prevWriteBytes ? (f32)((f64)(writeBytes - io_cgroup->prevWriteBytes) / elapsedSecs) : 0.0f;
+    }
+
+    io_cgroup->prevUsageUs = usageUs;
+    io_cgroup->prevReadBytes = readBytes;
+    io_cgroup->prevWriteBytes = writeBytes;
+    io_cgroup->prevTicks = i_nowTicks;
+    io_cgroup->primed = true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool Initialize(linear_allocator_t* i_allocator, const_cstr i_cgroupRoot)
+{
+    LOG_SCOPE(pressure);
+    arena_t arena = create_arena(i_allocator, SIZE_KB(16) + k_cgroupBuffersSize + k_maxCgroups * sizeof(Cgroup));
+    s_state = arena_push_pod(&arena, State);
+    s_state->arena = arena;
+
+    cstr_xcopy(s_state->cgroupRoot, FLORAL_MAX_PATH_LENGTH, i_cgroupRoot);
+    s_state->cpuStatKeys[0] = procfs::MakeKey("usage_usec");
+    s_state->systemPressure = {};
+    s_state->rootWatch = -1;
+
+    bool hasSystemPressure = false;
+    for (u32 i = 0; i < (u32)ResourceType::Count; i++)
+    {
+        hasSystemPressure |= procfs::Open(&s_state->systemPressureFiles[i], k_systemPressurePaths[i], &s_state->arena, k_pressureBufferSize);
+    }
+    if (!hasSystemPressure)
+    {
+        LOG_WARNING("No PSI in /proc/pressure, is the kernel built with CONFIG_PSI?");
+    }
+
+    s_state->cgroups = arena_push_podarr(&s_state->arena, Cgroup, k_maxCgroups);
+    s_state->cgroupsCount = 0;
+    s_state->cgroupsTruncated = false;
+    s_state->buffers = (c8*)arena_push(&s_state->arena, k_cgroupBuffersSize);
+    // initialized before the process module, the limit is raised here first
+    s_state->filesBudget = procfs::ReserveFiles(k_maxCgroups * k_cgroupFilesCount, k_reservedFilesCount) / k_cgroupFilesCount;
+    s_state->keptCgroupsCount = 0;
+    s_state->filesBudgetReached = false;
+    for (u32 i = 0; i < k_maxCgroups; i++)
+    {
+        s_state->cgroups[i] = {};
+        s_state->cgroups[i].watch = -1;
+    }
+
+    // the v1 hierarchies have one tree per controller and none of the files read here
+    c8 path[FLORAL_MAX_PATH_LENGTH];
+    c8 resolvedPath[FLORAL_MAX_PATH_LENGTH];
+    GetCgroupPath("", "cgroup.controllers", path);
+    procfs::ResolvePath(path, resolvedPath, FLORAL_MAX_PATH_LENGTH);
+    s_state->inotifyFd = -1;
+    if (access(resolvedPath, F_OK) != 0)
+    {
+        LOG_WARNING("'%s' is not a cgroup v2 hierarchy, only the system pressure is tracked", s_state->cgroupRoot);
+    }
+    else
+    {
+        s_state->inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (s_state->inotifyFd < 0)
+        {
+            LOG_WARNING("inotify is not available, cgroups created after start up will not be tracked");
+        }
+        DiscoverCgroups("");
+        LOG_DEBUG("Tracking %d cgroups under '%s'", s_state->cgroupsCount, s_state->cgroupRoot);
+    }
+
+    Update();
+    return hasSystemPressure || s_state->cgroupsCount > 0;
+}
+
+void CleanUp()
+{
+    for (u32 i = 0; i < s_state->cgroupsCount; i++)
+    {
+        if (s_state->cgroups[i].active)
+        {
+            RemoveCgroup(&s_state->cgroups[i]);
+        }
+    }
+    for (u32 i = 0; i < (u32)ResourceType::Count; i++)
+    {
+        procfs::Close(&s_state->systemPressureFiles[i]);
+    }
+    if (s_state->inotifyFd >= 0)
+    {
+        close(s_state->inotifyFd);
+    }
+    s_state->inotifyFd = -1;
+}
+
+void Update()
+{
+    Resource* const systemResources[] = { &s_state->systemPressure.cpu, &s_state->systemPressure.memory, &s_state->systemPressure.io };
+    for (u32 i = 0; i < (u32)ResourceType::Count; i++)
+    {
+        ReadResource(&s_state->systemPressureFiles[i], systemResources[i]);
+    }
+
+    ProcessCgroupEvents();
+    const u64 nowTicks = time_get_ticks();
+    for (u32 i = 0; i < s_state->cgroupsCount; i++)
+    {
+        if (s_state->cgroups[i].active)
+        {
+            UpdateCgroup(&s_state->cgroups[i], nowTicks);
+        }
+    }
+}
+
+bool ReadSystemPressure(SystemPressure* o_pressure)
+{
+    *o_pressure = s_state->systemPressure;
+    return s_state->systemPressureFiles[0].fd >= 0;
+}
+
+u32 ReadTopCgroups(CgroupInfo* o_cgroups, const u32 i_maxCgroups)
+{
+    // insertion into the sorted output, N is small
+    u32 count = 0;
+    for (u32 i = 0; i < s_state->cgroupsCount; i++)
+    {
+        const Cgroup& cgroup = s_state->cgroups[i];
+        if (!cgroup.active)
+        {
+            continue;
+        }
+
+        u32 position = count;
+        while (position > 0 && o_cgroups[position - 1].pressure < cgroup.info.pressure)
+        {
+            position--;
+        }
+        if (position >= i_maxCgroups)
+        {
+            continue;
+        }
+
+        const u32 last = math_min(count, i_maxCgroups - 1);
+        for (u32 j = last; j > position; j--)
+        {
+            o_cgroups[j] = o_cgroups[j - 1];
+        }
+        o_cgroups[position] = cgroup.info;
+        count = math_min(count + 1, i_maxCgroups);
+    }
+    return count;
+}
+
+// ----------------------------------------------------------------------------
+} // namespace pressure
@@ -0,0 +1,40 @@
+#include "pressure.h"
+
+#include <floral/misc.h>
+
+namespace pressure
+{
+// ----------------------------------------------------------------------------
+
+// neither PSI nor cgroups on Windows, the closest would be the job objects' accounting
+
+bool Initialize(linear_allocator_t* i_allocator, const_cstr i_cgroupRoot)
+{
+    MARK_UNUSED(i_allocator);
+    MARK_UNUSED(i_cgroupRoot);
+    return false;
+}
+
+void CleanUp()
+{
+}
+
+void Update()
+{
+}
+
+bool ReadSystemPressure(SystemPressure* o_pressure)
+{
+    *o_pressure = {};
+    return false;
+}
+
+u32 ReadTopCgroups(CgroupInfo* o_cgroups, const u32 i_maxCgroups)
+{
+    MARK_UNUSED(o_cgroups);
+    MARK_UNUSED(i_maxCgroups);
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+} // namespace pressure
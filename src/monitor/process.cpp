@@ -0,0 +1,11 @@
+#include "process.h"
+
+#include <floral/configs.h>
+
+#if defined(FLORAL_PLATFORM_WINDOWS)
+#  include "process_windows.inl"
+#elif defined(FLORAL_PLATFORM_LINUX)
+#  include "process_linux.inl"
+#else
+// TODO
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+
+struct linear_allocator_t;
+
+// per-process cpu and memory usage, only the heaviest processes are kept for the readers
+namespace process
+{
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_maxTopProcesses = 16;
+constexpr u32 k_maxProcessNameLength = 16; // the kernel truncates the command names to 15 characters
+
+enum class SortKey : u8
+{
+    CPU = 0,
+    Memory,
+
+    Count
+};
+
+struct ProcessInfo
+{
+    u32 pid;
+    c8 name[k_maxProcessNameLength];
+    f32 cpuUsage; // % of one cpu
+    u64 residentBytes;
+    u32 threadsCount;
+};
+
+// how long the last scan took and over how many processes, to keep an eye on its cost
+struct ScanStats
+{
+    u32 processesCount;
+    u32 cachedFilesCount; // processes whose stat file is kept open between the scans
+    u32 skippedCount;     // processes kept but not read by the last scan, there were no fds left
+    u32 jobsCount;
+    f32 scanMs;
+};
+
+bool Initialize(linear_allocator_t* i_allocator);
+void CleanUp();
+
+void Update();
+// the heaviest processes first, returns the number of processes written
+u32 ReadTopProcesses(ProcessInfo* o_processes, const u32 i_maxProcesses, const SortKey i_sortKey);
+void ReadScanStats(ScanStats* o_stats);
+
+// ----------------------------------------------------------------------------
+} // namespace process
@@ -0,0 +1,575 @@
+#include "process.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <floral/assert.h>
+#include <floral/job.h>
+#include <floral/log.h>
+#include <floral/memory.h>
+#include <floral/misc.h>
+#include <floral/string_utils.h>
+#include <floral/time.h>
+
+#include "procfs.h"
+
+namespace process
+{
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_maxProcesses = 16384;
+constexpr u32 k_hashCapacity = k_maxProcesses * 2; // power of two, at most half full
+constexpr u32 k_hashMask = k_hashCapacity - 1;
+constexpr u32 k_emptyHashSlot = 0; // pid 0 (the idle task) is never listed in /proc
+
+// below this many processes per worker, waking the workers costs more than it saves
+constexpr u32 k_minProcessesPerJob = 512;
+constexpr u32 k_maxWorkers = 4;
+constexpr u32 k_maxJobs = k_maxWorkers + 1; // the scanning thread takes a range too
+// fds left for what is opened after the process module (the other providers, the scripts' files...)
+// when the stat files are kept open
+constexpr u32 k_reservedFilesCount = 256;
+constexpr size k_statBufferSize = 1024;
+
+struct Process
+{
+    ProcessInfo info;
+    s32 fd;           // /proc/<pid>/stat, -1 when it is re-opened on every scan
+    bool cacheFile;   // decided when the process is first seen, depending on the fd budget
+    bool primed;
+    bool alive;       // false once its stat file cannot be read anymore
+    bool skipped;     // not read by the last scan, it could not open its stat file (out of fds)
+    u64 startTime;    // ticks since boot, a pid reused by a new process gets another one
+    u64 prevCpuTicks; // utime + stime
+    u32 seenScan;     // the scan in which the process was listed for the last time, 0: free slot
+};
+
+struct ScanJob
+{
+    const u32* slotIndices; // of the processes to read, in /proc order (increasing pids)
+    u32 slotsCount;
+    u32 jobsCount;
+    f64 elapsedSecs;
+};
+
+struct State
+{
+    Process* processes;
+    u32 processesCount; // high-water mark of the used slots
+    u32* freeSlots;
+    u32 freeSlotsCount;
+
+    // open addressing over the pids, linear probing, values are indices in 'processes'
+    u32* hashPids;
+    u32* hashSlots;
+
+    u32* scanSlots; // slot of each process listed by the current scan
+    u32 scanIndex;
+    u64 scanTicks;
+    f64 clockTicksPerSec;
+    u64 pageSize;
+
+    u32 filesBudget;
+    u32 cachedFilesCount;
+
+    job_director_t jobDirector;
+    u32 workersCount;
+
+    ScanStats stats;
+    bool overflowReported;
+
+    arena_t arena;
+};
+
+static State* s_state = nullptr;
+
+// ----------------------------------------------------------------------------
+
+static u32 HashPid(const u32 i_pid)
+{
+    return (i_pid * 2654435761u) & k_hashMask;
+}
+
+static u32 FindSlot(const u32 i_pid)
+{
+    for (u32 h = HashPid(i_pid); s_state->hashPids[h] != k_emptyHashSlot; h = (h + 1) & k_hashMask)
+    {
+        if (s_state->hashPids[h] == i_pid)
+        {
+            return s_state->hashSlots[h];
+        }
+    }
+    return k_maxProcesses;
+}
+
+static void InsertSlot(const u32 i_pid, const u32 i_slot)
+{
+    u32 h = HashPid(i_pid);
+    while (s_state->hashPids[h] != k_emptyHashSlot)
+    {
+        h = (h + 1) & k_hashMask;
+    }
+    s_state->hashPids[h] = i_pid;
+    s_state->hashSlots[h] = i_slot;
+}
+
+static void EraseSlot(const u32 i_pid)
+{
+    u32 h = HashPid(i_pid);
+    while (s_state->hashPids[h] != i_pid)
+    {
+        if (s_state->hashPids[h] == k_emptyHashSlot)
+        {
+            return;
+        }
+        h = (h + 1) & k_hashMask;
+    }
+
+    // backward shift: move up the entries of the cluster which would not be found past the hole
+    u32 hole = h;
+    for (u32 next = (hole + 1) & k_hashMask; s_state->hashPids[next] != k_emptyHashSlot; next = (next + 1) & k_hashMask)
+    {
+        const u32 home = HashPid(s_state->hashPids[next]);
+        const bool reachable = (hole <= next) ? (home > hole && home <= next) : (home > hole || home <= next);
+        if (!reachable)
+        {
+            s_state->hashPids[hole] = s_state->hashPids[next];
+            s_state->hashSlots[hole] = s_state->hashSlots[next];
+            hole = next;
+        }
+    }
+    s_state->hashPids[hole] = k_emptyHashSlot;
+}
+
+static u32 AddProcess(const u32 i_pid)
+{
+    u32 slot = k_maxProcesses;
+    if (s_state->freeSlotsCount > 0)
+    {
+        slot = s_state->freeSlots[--s_state->freeSlotsCount];
+    }
+    else if (s_state->processesCount < k_maxProcesses)
+    {
+        slot = s_state->processesCount++;
+    }
+    else
+    {
+        return k_maxProcesses;
+    }
+
+    Process* const process = &s_state->processes[slot];
+    *process = {};
+    process->info.pid = i_pid;
+    process->fd = -1;
+    process->alive = true;
+    process->cacheFile = s_state->cachedFilesCount < s_state->filesBudget;
+    s_state->cachedFilesCount += process->cacheFile ? 1 : 0;
+    InsertSlot(i_pid, slot);
+    return slot;
+}
+
+static void RemoveProcess(const u32 i_slot)
+{
+    Process* const process = &s_state->processes[i_slot];
+    if (process->fd >= 0)
+    {
+        close(process->fd);
+    }
+    s_state->cachedFilesCount -= process->cacheFile ? 1 : 0;
+    EraseSlot(process->info.pid);
+    *process = {};
+    process->fd = -1;
+    s_state->freeSlots[s_state->freeSlotsCount++] = i_slot;
+}
+
+// "pid (comm) state ppid pgrp session tty_nr tpgid flags minflt cminflt majflt cmajflt utime stime
+// cutime cstime priority nice num_threads itrealvalue starttime vsize rss ...", see proc(5)
+static bool ParseStat(const c8* i_buffer, const ssize i_length, Process* const io_process, u64* o_cpuTicks)
+{
+    // the command name can hold spaces and parentheses, it ends at the last ')'
+    const c8* nameBegin = i_buffer;
+    while (nameBegin < i_buffer + i_length && *nameBegin != '(')
+    {
+        nameBegin++;
+    }
+    const c8* nameEnd = i_buffer + i_length - 1;
+    while (nameEnd > nameBegin && *nameEnd != ')')
+    {
+        nameEnd--;
+    }
+    if (nameEnd <= nameBegin)
+    {
+        return false;
+    }
+
+    const u32 nameLength = math_min((u32)(nameEnd - nameBegin - 1), k_maxProcessNameLength - 1);
+    for (u32 i = 0; i < nameLength; i++)
+    {
+        io_process->info.name[i] = nameBegin[1 + i];
+    }
+    io_process->info.name[nameLength] = 0;
+
+    // ") S " then the numeric fields from ppid (4th) on
+    const c8* cursor = procfs::SkipSpaces(nameEnd + 1);
+    cursor++;
+    s64 fields[25] = {};
+    for (u32 i = 4; i < array_length(fields); i++)
+    {
+        cursor = procfs::ParseS64(cursor, &fields[i]);
+    }
+
+    *o_cpuTicks = (u64)(fields[14] + fields[15]);
+    io_process->info.threadsCount = (u32)fields[20];
+    io_process->info.residentBytes = (u64)fields[24] * s_state->pageSize;
+    const u64 startTime = (u64)fields[22];
+    if (startTime != io_process->startTime)
+    {
+        // not the process we knew, the pid has been reused since the last scan
+        io_process->startTime = startTime;
+        io_process->primed = false;
+    }
+    return true;
+}
+
+static void ReadProcess(Process* const io_process, const f64 i_elapsedSecs)
+{
+    c8 buffer[k_statBufferSize];
+    io_process->skipped = false;
+    s32 fd = io_process->fd;
+    if (fd < 0)
+    {
+        c8 path[64];
+        cstr_snprintf(path, sizeof(path), "/proc/%u/stat", io_process->info.pid);
+        c8 resolvedPath[FLORAL_MAX_PATH_LENGTH];
+        procfs::ResolvePath(path, resolvedPath, FLORAL_MAX_PATH_LENGTH);
+        fd = open(resolvedPath, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            // out of fds, the process is still there: it is not updated this round and its next
+            // cpu usage would span two intervals
+            if (errno == EMFILE || errno == ENFILE)
+            {
+                io_process->primed = false;
+                io_process->skipped = true;
+                return;
+            }
+            io_process->alive = false;
+            return;
+        }
+    }
+
+    const ssize length = pread(fd, buffer, sizeof(buffer) - 1, 0);
+    if (io_process->cacheFile)
+    {
+        io_process->fd = fd;
+    }
+    else
+    {
+        close(fd);
+    }
+
+    buffer[length > 0 ? length : 0] = 0;
+    u64 cpuTicks = 0;
+    // reading the stat of a process which exited fails with ESRCH
+    if (length <= 0 || !ParseStat(buffer, length, io_process, &cpuTicks))
+    {
+        io_process->alive = false;
+        return;
+    }
+
+    if (io_process->primed && i_elapsedSecs > 0.0)
+    {
+        const u64 deltaTicks = cpuTicks >= io_process->prevCpuTicks ? cpuTicks - io_process->prevCpuTicks : 0;
+        io_process->info.cpuUsage = (f32)((f64)deltaTicks / s_state->clockTicksPerSec / i_elapsedSecs * 100.0);
+    }
+    else
+    {
+        io_process->info.cpuUsage = 0.0f;
+    }
+    io_process->prevCpuTicks = cpuTicks;
+    io_process->primed = true;
+}
+
+// each job reads one contiguous range of the listed pids, the processes are not shared between jobs
+static error_code_e ScanRange(job_director_t* const i_jd, const u32 i_jobIndex, voidptr i_input, voidptr i_output)
+{
+    MARK_UNUSED(i_jd);
+    MARK_UNUSED(i_output);
+    const ScanJob* job = (const ScanJob*)i_input;
+    const u32 first = (u32)((u64)job->slotsCount * i_jobIndex / job->jobsCount);
+    const u32 last = (u32)((u64)job->slotsCount * (i_jobIndex + 1) / job->jobsCount);
+    for (u32 i = first; i < last; i++)
+    {
+        ReadProcess(&s_state->processes[job->slotIndices[i]], job->elapsedSecs);
+    }
+    return error_code_e::success;
+}
+
+// false when /proc cannot be listed (out of fds...), nothing is known about the processes then
+static bool ListProcesses(u32* o_count)
+{
+    c8 resolvedDir[FLORAL_MAX_PATH_LENGTH];
+    procfs::ResolvePath("/proc", resolvedDir, FLORAL_MAX_PATH_LENGTH);
+    DIR* dir = opendir(resolvedDir);
+    if (dir == nullptr)
+    {
+        return false;
+    }
+
+    u32 count = 0;
+    struct dirent* entry = nullptr;
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9')
+        {
+            continue;
+        }
+
+        u64 pid = 0;
+        procfs::ParseU64(entry->d_name, &pid);
+        u32 slot = FindSlot((u32)pid);
+        if (slot == k_maxProcesses)
+        {
+            slot = AddProcess((u32)pid);
+            if (slot == k_maxProcesses)
+            {
+                if (!s_state->overflowReported)
+                {
+                    LOG_WARNING("More than %d processes, the extra ones are not tracked", k_maxProcesses);
+                    s_state->overflowReported = true;
+                }
+                continue;
+            }
+        }
+
+        s_state->processes[slot].seenScan = s_state->scanIndex;
+        s_state->scanSlots[count++] = slot;
+    }
+    closedir(dir);
+    *o_count = count;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool Initialize(linear_allocator_t* i_allocator)
+{
+    LOG_SCOPE(process);
+
+    job_director_desc_t jdDesc = {
+        .maxInflightJobs = 32,
+        .disableWorkers = false,
+        .workersCount = math_min((u32)sysconf(_SC_NPROCESSORS_ONLN) / 2, k_maxWorkers),
+        .workerMemorySize = 0,
+        .workerAffinityMask = 0,
+        .workerPriority = thread_priority_e::below_normal,
+        .workerPrologue = nullptr,
+        .workerEpilogue = nullptr
+    };
+    jdDesc.disableWorkers = jdDesc.workersCount == 0;
+    const size jdMemorySize = calculate_memory_size_for_job_director(jdDesc);
+
+    arena_t arena = create_arena(i_allocator, SIZE_KB(4) + jdMemorySize + k_maxProcesses * (sizeof(Process) + sizeof(u32) * 2)
+                                                  + k_hashCapacity * sizeof(u32) * 2);
+    s_state = arena_push_pod(&arena, State);
+    s_state->arena = arena;
+
+    s_state->processes = arena_push_podarr(&s_state->arena, Process, k_maxProcesses);
+    s_state->freeSlots = arena_push_podarr(&s_state->arena, u32, k_maxProcesses);
+    s_state->scanSlots = arena_push_podarr(&s_state->arena, u32, k_maxProcesses);
+    s_state->hashPids = arena_push_podarr(&s_state->arena, u32, k_hashCapacity);
+    s_state->hashSlots = arena_push_podarr(&s_state->arena, u32, k_hashCapacity);
+    for (u32 i = 0; i < k_hashCapacity; i++)
+    {
+        s_state->hashPids[i] = k_emptyHashSlot;
+    }
+    s_state->processesCount = 0;
+    s_state->freeSlotsCount = 0;
+    s_state->scanIndex = 0;
+    s_state->stats = {};
+    s_state->overflowReported = false;
+    s_state->clockTicksPerSec = (f64)sysconf(_SC_CLK_TCK);
+    s_state->pageSize = (u64)sysconf(_SC_PAGESIZE);
+
+    // keeping the stat files open saves an open() / close() per process and per scan, raise the
+    // soft limit as far as allowed and keep some room for the rest of the application
+    s_state->filesBudget = procfs::ReserveFiles(k_maxProcesses, k_reservedFilesCount);
+    s_state->cachedFilesCount = 0;
+
+    s_state->workersCount = jdDesc.workersCount;
+    initialize_job_director(&s_state->jobDirector, jdDesc, arena_push(&s_state->arena, jdMemorySize), jdMemorySize);
+
+    s_state->scanTicks = time_get_ticks();
+    Update();
+    LOG_DEBUG("%d processes, %d stat files kept open, %d scanning workers", s_state->stats.processesCount,
+              s_state->cachedFilesCount, s_state->workersCount);
+    return s_state->stats.processesCount > 0;
+}
+
+void CleanUp()
+{
+    destroy_job_director(&s_state->jobDirector);
+    for (u32 i = 0; i < s_state->processesCount; i++)
+    {
+        if (s_state->processes[i].seenScan != 0)
+        {
+            RemoveProcess(i);
+        }
+    }
+    s_state->processesCount = 0;
+}
+
+void Update()
+{
+    const u64 beginTicks = time_get_ticks();
+    const f64 elapsedSecs = time_ticks_to_ms(beginTicks - s_state->scanTicks) * 0.001;
+    s_state->scanTicks = beginTicks;
+    s_state->scanIndex++;
+    if (s_state->scanIndex == 0)
+    {
+        s_state->scanIndex = 1; // 0 is reserved for free slots
+    }
+
+    u32 listedCount = 0;
+    if (!ListProcesses(&listedCount))
+    {
+        // every process would look gone, keep them as they were until /proc can be listed again
+        s_state->stats.skippedCount = s_state->stats.processesCount;
+        s_state->stats.scanMs = (f32)time_ticks_to_ms(time_get_ticks() - beginTicks);
+        return;
+    }
+    ScanJob job = {
+        .slotIndices = s_state->scanSlots,
+        .slotsCount = listedCount,
+        .jobsCount = math_max(math_min(listedCount / k_minProcessesPerJob, s_state->workersCount + 1), 1u),
+        .elapsedSecs = elapsedSecs
+    };
+    FLORAL_ASSERT(job.jobsCount <= k_maxJobs);
+
+    if (job.jobsCount > 1)
+    {
+        job_desc_t jobDesc = {
+            .executor = &ScanRange,
+            .input = &job,
+            .output = nullptr
+        };
+        // wait_job() runs the queued ranges too while the workers are busy with the others
+        const job_ops_t ops = queue_job(&s_state->jobDirector, jobDesc, job.jobsCount);
+        wait_job(&s_state->jobDirector, ops);
+    }
+    else
+    {
+        ScanRange(&s_state->jobDirector, 0, &job, nullptr);
+    }
+
+    // processes which were not listed or could not be read have exited
+    u32 skippedCount = 0;
+    for (u32 i = 0; i < s_state->processesCount; i++)
+    {
+        const Process& process = s_state->processes[i];
+        if (process.seenScan != 0 && (process.seenScan != s_state->scanIndex || !process.alive))
+        {
+            RemoveProcess(i);
+            continue;
+        }
+        skippedCount += process.seenScan != 0 && process.skipped ? 1 : 0;
+    }
+
+    s_state->stats.processesCount = listedCount;
+    s_state->stats.cachedFilesCount = s_state->cachedFilesCount;
+    s_state->stats.skippedCount = skippedCount;
+    s_state->stats.jobsCount = job.jobsCount;
+    s_state->stats.scanMs = (f32)time_ticks_to_ms(time_get_ticks() - beginTicks);
+}
+
+static f32 GetSortValue(const ProcessInfo& i_info, const SortKey i_sortKey)
+{
+    return i_sortKey == SortKey::CPU ? i_info.cpuUsage : (f32)i_info.residentBytes;
+}
+
+static void SiftDown(const Process** io_heap, const u32 i_count, u32 i_index, const SortKey i_sortKey)
+{
+    // min-heap, the lightest of the kept processes is at the root
+    while (true)
+    {
+        const u32 left = i_index * 2 + 1;
+        const u32 right = left + 1;
+        u32 smallest = i_index;
+        if (left < i_count && GetSortValue(io_heap[left]->info, i_sortKey) < GetSortValue(io_heap[smallest]->info, i_sortKey))
+        {
+            smallest = left;
+        }
+        if (right < i_count && GetSortValue(io_heap[right]->info, i_sortKey) < GetSortValue(io_heap[smallest]->info, i_sortKey))
+        {
+            smallest = right;
+        }
+        if (smallest == i_index)
+        {
+            return;
+        }
+        const Process* tmp = io_heap[i_index];
+        io_heap[i_index] = io_heap[smallest];
+        io_heap[smallest] = tmp;
+        i_index = smallest;
+    }
+}
+
+u32 ReadTopProcesses(ProcessInfo* o_processes, const u32 i_maxProcesses, const SortKey i_sortKey)
+{
+    // bounded heap of the N heaviest processes: O(processes * log(N))
+    const Process* heap[k_maxTopProcesses];
+    const u32 maxCount = math_min(i_maxProcesses, k_maxTopProcesses);
+    u32 count = 0;
+    for (u32 i = 0; i < s_state->processesCount && maxCount > 0; i++)
+    {
+        const Process* process = &s_state->processes[i];
+        if (process->seenScan == 0 || !process->primed)
+        {
+            continue;
+        }
+
+        if (count < maxCount)
+        {
+            heap[count++] = process;
+            if (count == maxCount)
+            {
+                for (s32 j = (s32)count / 2 - 1; j >= 0; j--)
+                {
+                    SiftDown(heap, count, (u32)j, i_sortKey);
+                }
+            }
+        }
+        else if (GetSortValue(process->info, i_sortKey) > GetSortValue(heap[0]->info, i_sortKey))
+        {
+            heap[0] = process;
+            SiftDown(heap, count, 0, i_sortKey);
+        }
+    }
+
+    if (count < maxCount)
+    {
+        for (s32 j = (s32)count / 2 - 1; j >= 0; j--)
+        {
+            SiftDown(heap, count, (u32)j, i_sortKey);
+        }
+    }
+
+    // popping the root gives the lightest first, fill the output from its end
+    for (u32 remaining = count; remaining > 0; remaining--)
+    {
+        o_processes[remaining - 1] = heap[0]->info;
+        heap[0] = heap[remaining - 1];
+        SiftDown(heap, remaining - 1, 0, i_sortKey);
+    }
+    return count;
+}
+
+void ReadScanStats(ScanStats* o_stats)
+{
+    *o_stats = s_state->stats;
+}
+
+// ----------------------------------------------------------------------------
+} // namespace process
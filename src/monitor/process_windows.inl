@@ -0,0 +1,37 @@
+#include "process.h"
+
+#include <floral/misc.h>
+
+namespace process
+{
+// ----------------------------------------------------------------------------
+
+bool Initialize(linear_allocator_t* i_allocator)
+{
+    MARK_UNUSED(i_allocator);
+    return false;
+}
+
+void CleanUp()
+{
+}
+
+void Update()
+{
+}
+
+u32 ReadTopProcesses(ProcessInfo* o_processes, const u32 i_maxProcesses, const SortKey i_sortKey)
+{
+    MARK_UNUSED(o_processes);
+    MARK_UNUSED(i_maxProcesses);
+    MARK_UNUSED(i_sortKey);
+    return 0;
+}
+
+void ReadScanStats(ScanStats* o_stats)
+{
+    *o_stats = {};
+}
+
+// ----------------------------------------------------------------------------
+} // namespace process
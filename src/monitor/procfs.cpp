@@ -0,0 +1,357 @@
+#include "procfs.h"
+
+#include <floral/configs.h>
+
+#if defined(FLORAL_PLATFORM_LINUX)
+
+#  include <dirent.h>
+#  include <fcntl.h>
+#  include <sys/resource.h>
+#  include <unistd.h>
+
+#  include <floral/assert.h>
+#  include <floral/log.h>
+#  include <floral/misc.h>
+#  include <floral/string_utils.h>
+
+namespace procfs
+{
+
+static c8 s_root[FLORAL_MAX_PATH_LENGTH] = {};
+
+void SetRoot(const_cstr i_root)
+{
+    cstr_xcopy(s_root, FLORAL_MAX_PATH_LENGTH, i_root ? i_root : "");
+}
+
+const_cstr GetRoot()
+{
+    return s_root;
+}
+
+size ResolvePath(const_cstr i_path, cstr o_buffer, const size i_bufferLength)
+{
+    const s32 length = cstr_snprintf(o_buffer, i_bufferLength, "%s%s", s_root, i_path);
+    return length > 0 ? (size)length : 0;
+}
+
+bool Open(File* const o_file, const_cstr i_path, arena_t* const i_arena, const size i_capacity)
+{
+    FLORAL_ASSERT(i_capacity > 1);
+    if (!Open(o_file, i_path, (c8*)nullptr, 0))
+    {
+        return false;
+    }
+
+    o_file->buffer = (c8*)arena_push(i_arena, i_capacity);
+    o_file->capacity = i_capacity;
+    o_file->buffer[0] = 0;
+    return true;
+}
+
+bool Open(File* const o_file, const_cstr i_path, c8* const i_buffer, const size i_capacity)
+{
+    c8 path[FLORAL_MAX_PATH_LENGTH];
+    ResolvePath(i_path, path, FLORAL_MAX_PATH_LENGTH);
+
+    o_file->fd = open(path, O_RDONLY | O_CLOEXEC);
+    o_file->buffer = i_buffer;
+    o_file->capacity = i_capacity;
+    o_file->length = 0;
+    if (o_file->fd < 0)
+    {
+        o_file->buffer = nullptr;
+        o_file->capacity = 0;
+        return false;
+    }
+
+    if (i_buffer)
+    {
+        i_buffer[0] = 0;
+    }
+    return true;
+}
+
+void Close(File* const io_file)
+{
+    if (io_file->fd >= 0)
+    {
+        close(io_file->fd);
+    }
+    io_file->fd = -1;
+}
+
+bool Read(File* const io_file)
+{
+    if (io_file->fd < 0)
+    {
+        return false;
+    }
+
+    // pseudo-files are generated on read, a single pread from 0 returns a consistent view as long
+    // as it fits in the buffer, keep reading only for the rare ones bigger than a page
+    size length = 0;
+    while (length < io_file->capacity - 1)
+    {
+        const ssize bytesRead = pread(io_file->fd, io_file->buffer + length, io_file->capacity - 1 - length, (off_t)length);
+        if (bytesRead <= 0)
+        {
+            break;
+        }
+        length += (size)bytesRead;
+    }
+
+    io_file->buffer[length] = 0;
+    io_file->length = length;
+    return length > 0;
+}
+
+bool ReadText(const_cstr i_path, cstr o_buffer, const size i_bufferLength)
+{
+    FLORAL_ASSERT(i_bufferLength > 1);
+    File file;
+    if (!Open(&file, i_path, o_buffer, i_bufferLength))
+    {
+        o_buffer[0] = 0;
+        return false;
+    }
+
+    const bool result = Read(&file);
+    Close(&file);
+    while (file.length > 0 && (o_buffer[file.length - 1] == '\n' || o_buffer[file.length - 1] == ' '))
+    {
+        o_buffer[--file.length] = 0;
+    }
+    return result;
+}
+
+bool ReadS64(const_cstr i_path, s64* o_value)
+{
+    c8 buffer[32];
+    if (!ReadText(i_path, buffer, sizeof(buffer)))
+    {
+        return false;
+    }
+    ParseS64(buffer, o_value);
+    return true;
+}
+
+s32 GetProcessorsCount()
+{
+    // a list of ranges, "0-3,8-11", the last number is the highest processor id
+    c8 buffer[256];
+    if (ReadText("/sys/devices/system/cpu/possible", buffer, sizeof(buffer)))
+    {
+        u64 lastId = 0;
+        bool parsed = false;
+        const c8* cursor = buffer;
+        while (*cursor >= '0' && *cursor <= '9')
+        {
+            cursor = ParseU64(cursor, &lastId);
+            parsed = true;
+            if (*cursor == '-' || *cursor == ',')
+            {
+                cursor++;
+            }
+        }
+        if (parsed)
+        {
+            return (s32)lastId + 1;
+        }
+    }
+    return (s32)sysconf(_SC_NPROCESSORS_CONF);
+}
+
+// the fds the application holds so far, the providers initialized before the caller keep theirs open
+static u32 CountOpenFiles()
+{
+    DIR* dir = opendir("/proc/self/fd");
+    if (dir == nullptr)
+    {
+        return 0;
+    }
+
+    u32 count = 0;
+    struct dirent* entry = nullptr;
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        count += entry->d_name[0] != '.' ? 1 : 0;
+    }
+    closedir(dir);
+    return count > 0 ? count - 1 : 0; // the directory's own fd
+}
+
+u32 ReserveFiles(const u32 i_wanted, const u32 i_reserved)
+{
+    struct rlimit filesLimit;
+    if (getrlimit(RLIMIT_NOFILE, &filesLimit) != 0)
+    {
+        return 0;
+    }
+
+    const rlim_t openedCount = (rlim_t)CountOpenFiles();
+    const rlim_t wanted = openedCount + (rlim_t)i_wanted + (rlim_t)i_reserved;
+    if (filesLimit.rlim_cur < wanted && filesLimit.rlim_cur < filesLimit.rlim_max)
+    {
+        const rlim_t prevLimit = filesLimit.rlim_cur;
+        filesLimit.rlim_cur = math_min(wanted, filesLimit.rlim_max);
+        if (setrlimit(RLIMIT_NOFILE, &filesLimit) == 0)
+        {
+            LOG_INFO("Raised the open files limit from %llu to %llu", (unsigned long long)prevLimit,
+                     (unsigned long long)filesLimit.rlim_cur);
+        }
+        getrlimit(RLIMIT_NOFILE, &filesLimit);
+    }
+    if (filesLimit.rlim_cur <= openedCount + i_reserved)
+    {
+        return 0;
+    }
+    return (u32)math_min(filesLimit.rlim_cur - openedCount - i_reserved, (rlim_t)i_wanted);
+}
+
+const c8* SkipSpaces(const c8* i_cursor)
+{
+    while (*i_cursor == ' ' || *i_cursor == '\t')
+    {
+        i_cursor++;
+    }
+    return i_cursor;
+}
+
+const c8* SkipLine(const c8* i_cursor)
+{
+    while (*i_cursor != 0 && *i_cursor != '\n')
+    {
+        i_cursor++;
+    }
+    return *i_cursor == '\n' ? i_cursor + 1 : i_cursor;
+}
+
+const c8* ParseU64(const c8* i_cursor, u64* o_value)
+{
+    i_cursor = SkipSpaces(i_cursor);
+    u64 value = 0;
+    while (*i_cursor >= '0' && *i_cursor <= '9')
+    {
+        value = value * 10 + (u64)(*i_cursor - '0');
+        i_cursor++;
+    }
+    *o_value = value;
+    return i_cursor;
+}
+
+const c8* ParseS64(const c8* i_cursor, s64* o_value)
+{
+    i_cursor = SkipSpaces(i_cursor);
+    const bool negative = (*i_cursor == '-');
+    if (negative)
+    {
+        i_cursor++;
+    }
+
+    u64 value = 0;
+    i_cursor = ParseU64(i_cursor, &value);
+    *o_value = negative ? -(s64)value : (s64)value;
+    return i_cursor;
+}
+
+bool StartsWith(const c8* i_cursor, const_cstr i_prefix)
+{
+    while (*i_prefix != 0)
+    {
+        if (*i_cursor != *i_prefix)
+        {
+            return false;
+        }
+        i_cursor++;
+        i_prefix++;
+    }
+    return true;
+}
+
+u64 GetCounterDelta(const u64 i_prev, const u64 i_curr, const u32 i_counterBits)
+{
+    if (i_curr >= i_prev)
+    {
+        return i_curr - i_prev;
+    }
+
+    if (i_counterBits < 64 && i_prev < (1ull << i_counterBits))
+    {
+        return i_curr + (1ull << i_counterBits) - i_prev;
+    }
+    return 0;
+}
+
+Key MakeKey(const_cstr i_name)
+{
+    Key key = {};
+    key.name = i_name;
+    while (i_name[key.length] != 0)
+    {
+        if (key.length < 8)
+        {
+            key.tag |= (u64)(u8)i_name[key.length] << (key.length * 8);
+        }
+        key.length++;
+    }
+    return key;
+}
+
+// the first 8 characters are already known to match
+static bool MatchesKeyTail(const c8* i_cursor, const Key& i_key)
+{
+    for (u32 i = 8; i < i_key.length; i++)
+    {
+        if (i_cursor[i] != i_key.name[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+u32 ScanKeyValues(const c8* i_cursor, const c8 i_separator, const Key* i_keys, u64* o_values, const u32 i_keysCount)
+{
+    FLORAL_ASSERT(i_keysCount <= 64);
+    const u64 allFoundMask = i_keysCount < 64 ? ((1ull << i_keysCount) - 1) : ~0ull;
+    u64 foundMask = 0;
+    while (*i_cursor != 0 && foundMask != allFoundMask)
+    {
+        u64 tag = 0;
+        u32 length = 0;
+        while (i_cursor[length] != i_separator && i_cursor[length] != '\n' && i_cursor[length] != 0)
+        {
+            if (length < 8)
+            {
+                tag |= (u64)(u8)i_cursor[length] << (length * 8);
+            }
+            length++;
+        }
+
+        if (i_cursor[length] == i_separator)
+        {
+            for (u32 i = 0; i < i_keysCount; i++)
+            {
+                if (i_keys[i].tag == tag && i_keys[i].length == length && MatchesKeyTail(i_cursor, i_keys[i]))
+                {
+                    ParseU64(i_cursor + length + 1, &o_values[i]);
+                    foundMask |= 1ull << i;
+                    break;
+                }
+            }
+        }
+        i_cursor = SkipLine(i_cursor + length);
+    }
+
+    u32 foundCount = 0;
+    for (u32 i = 0; i < i_keysCount; i++)
+    {
+        foundCount += (u32)((foundMask >> i) & 1);
+    }
+    return foundCount;
+}
+
+} // namespace procfs
+
+#endif // FLORAL_PLATFORM_LINUX
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+#include <floral/memory.h>
+
+// Linux only: helpers to read procfs / sysfs pseudo-files without allocating on every sample.
+// A file is opened once and re-read from offset 0 with pread() into a buffer owned by its reader.
+
+namespace procfs
+{
+
+struct File
+{
+    s32 fd;
+    c8* buffer;
+    size capacity;
+    size length;
+};
+
+// every path given to procfs is resolved relatively to this root, it is empty by default (the
+// real filesystem), point it at a captured tree to replay fixtures
+void SetRoot(const_cstr i_root);
+const_cstr GetRoot();
+size ResolvePath(const_cstr i_path, cstr o_buffer, const size i_bufferLength);
+
+bool Open(File* const o_file, const_cstr i_path, arena_t* const i_arena, const size i_capacity);
+bool Open(File* const o_file, const_cstr i_path, c8* const i_buffer, const size i_capacity);
+void Close(File* const io_file);
+// reads the whole file again, the content is always null-terminated and truncated to capacity - 1
+bool Read(File* const io_file);
+
+// one-shot reads for the files only looked at once (discovery, topology), the trailing new line
+// is stripped
+bool ReadText(const_cstr i_path, cstr o_buffer, const size i_bufferLength);
+bool ReadS64(const_cstr i_path, s64* o_value);
+// the processors which can ever be online, from /sys/devices/system/cpu/possible ("0-N") so it
+// follows the root, sysconf(_SC_NPROCESSORS_CONF) when the file cannot be read
+s32 GetProcessorsCount();
+// for the providers keeping many files open: raises the soft RLIMIT_NOFILE as far as the hard one
+// allows to fit i_wanted more descriptors, i_reserved are left to the rest of the application.
+// Returns how many of the i_wanted can be kept open.
+u32 ReserveFiles(const u32 i_wanted, const u32 i_reserved);
+
+// zero-allocation scanners, all of them stop at the end of the null-terminated buffer
+const c8* SkipSpaces(const c8* i_cursor);
+const c8* SkipLine(const c8* i_cursor);
+const c8* ParseU64(const c8* i_cursor, u64* o_value);
+const c8* ParseS64(const c8* i_cursor, s64* o_value);
+bool StartsWith(const c8* i_cursor, const_cstr i_prefix);
+
+// the width of the kernel's 'unsigned long' counters (/proc/diskstats...), a 64-bit process
+// implies a 64-bit kernel. /proc/net/dev is 64-bit on every kernel since 2.6.36.
+constexpr u32 k_kernelLongBits = sizeof(long) * 8;
+
+// a counter going backward wrapped around only if it is narrower than 64 bits, otherwise it was
+// reset (interface re-created, device hot-plugged...) and the delta is 0
+u64 GetCounterDelta(const u64 i_prev, const u64 i_curr, const u32 i_counterBits = 64);
+
+// a key of a "key<separator> value" file (/proc/meminfo, /proc/vmstat...), its first 8 characters
+// are packed in 'tag' so most lines are rejected with a couple of integer compares, the rest of the
+// name is only compared when they match
+struct Key
+{
+    u64 tag;
+    u32 length;
+    const_cstr name; // must outlive the key
+};
+
+Key MakeKey(const_cstr i_name);
+// single pass over the lines, o_values[i] receives the first number after i_keys[i] and is left
+// untouched when the key is not there. Stops as soon as every key has been found.
+u32 ScanKeyValues(const c8* i_cursor, const c8 i_separator, const Key* i_keys, u64* o_values, const u32 i_keysCount);
+
+} // namespace procfs
@@ -0,0 +1,11 @@
+#include "thermal.h"
+
+#include <floral/configs.h>
+
+#if defined(FLORAL_PLATFORM_WINDOWS)
+#  include "thermal_windows.inl"
+#elif defined(FLORAL_PLATFORM_LINUX)
+#  include "thermal_linux.inl"
+#else
+// TODO
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+
+struct linear_allocator_t;
+
+// temperature sensors exposed by the OS (hwmon and thermal zones on Linux), on Windows the CPU
+// temperatures are read by the cpu module through the kernel mode driver instead
+namespace thermal
+{
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_maxReportedSensors = 128; // listed to the scripts, all of them are tracked
+constexpr u32 k_maxChipNameLength = 16;
+constexpr u32 k_maxLabelLength = 32;
+
+enum class SensorKind : u8
+{
+    Package = 0, // a whole CPU package (coretemp's 'Package id N', k10temp's 'Tctl' / 'Tdie')
+    Core,        // a single physical core, 'index' is its core id in the package
+    Drive,       // nvme
+    Zone,        // ACPI / platform thermal zone
+    Other
+};
+
+struct SensorInfo
+{
+    c8 chip[k_maxChipNameLength];
+    c8 label[k_maxLabelLength];
+    SensorKind kind;
+    u32 package; // physical package id of the Package / Core sensors
+    u32 index;
+    f32 temperature; // C
+};
+
+bool Initialize(linear_allocator_t* i_allocator);
+void CleanUp();
+
+// reads all the sensors again, the Read* functions below return the values of the last update
+void Update();
+
+// returns the number of sensors written
+u32 ReadSensors(SensorInfo* o_sensors, const u32 i_maxSensors);
+// hottest of the packages, false if there is no sensor for it
+bool ReadPackageTemperature(f32* o_temp);
+bool ReadCoreTemperature(const u32 i_package, const u32 i_coreId, f32* o_temp);
+
+// ----------------------------------------------------------------------------
+} // namespace thermal
@@ -0,0 +1,494 @@
+#include "thermal.h"
+
+#include <dirent.h>
+
+#include <floral/assert.h>
+#include <floral/log.h>
+#include <floral/memory.h>
+#include <floral/misc.h>
+#include <floral/string_utils.h>
+
+#include "procfs.h"
+
+namespace thermal
+{
+// ----------------------------------------------------------------------------
+
+// when several kinds of sensors measure the packages, only the most accurate kind is used
+enum class PackageRank : u8
+{
+    None = 0,
+    PlatformZone, // x86_pkg_temp thermal zone
+    Tctl,         // k10temp control temperature, offset on some Ryzen parts
+    Tdie,
+    Coretemp
+};
+
+struct Sensor
+{
+    SensorInfo info;
+    PackageRank rank;
+    procfs::File inputFile;
+    c8 buffer[24]; // "-12345\n" millidegrees
+};
+
+// hwmon<N> directories, in the order of N
+constexpr u32 k_maxHwmonChips = 256;
+
+struct State
+{
+    Sensor* sensors;
+    u32 sensorsCount;
+    u32 sensorsCapacity; // as many as were counted before the discovery
+    bool truncated;
+    PackageRank packageRank; // best rank among the sensors
+
+    arena_t arena;
+};
+
+static State* s_state = nullptr;
+
+// ----------------------------------------------------------------------------
+
+static bool ParseIndex(const_cstr i_str, const_cstr i_prefix, u32* o_index)
+{
+    if (!procfs::StartsWith(i_str, i_prefix))
+    {
+        return false;
+    }
+    const c8* cursor = i_str + cstr_length(i_prefix);
+    if (*cursor < '0' || *cursor > '9')
+    {
+        return false;
+    }
+    u64 index = 0;
+    procfs::ParseU64(cursor, &index);
+    *o_index = (u32)index;
+    return true;
+}
+
+static Sensor* AddSensor(const_cstr i_inputPath, const_cstr i_chip, const_cstr i_label)
+{
+    // only when sensors appeared between the count and the discovery
+    if (s_state->sensorsCount >= s_state->sensorsCapacity)
+    {
+        if (!s_state->truncated)
+        {
+            LOG_WARNING("More temperature sensors than counted, '%s' and the next ones are ignored", i_inputPath);
+            s_state->truncated = true;
+        }
+        return nullptr;
+    }
+
+    Sensor* const sensor = &s_state->sensors[s_state->sensorsCount];
+    *sensor = {};
+    if (!procfs::Open(&sensor->inputFile, i_inputPath, sensor->buffer, sizeof(sensor->buffer)))
+    {
+        return nullptr;
+    }
+
+    cstr_xcopy(sensor->info.chip, k_maxChipNameLength, i_chip);
+    cstr_xcopy(sensor->info.label, k_maxLabelLength, i_label);
+    sensor->info.kind = SensorKind::Other;
+    s_state->sensorsCount++;
+    return sensor;
+}
+
+static void ClassifyHwmonSensor(Sensor* const io_sensor, const u32 i_chipPackage)
+{
+    SensorInfo* const info = &io_sensor->info;
+    u32 index = 0;
+    if (cstr_compare(info->chip, "coretemp") == 0)
+    {
+        // one coretemp chip per package: "Package id N", "Core N"...
+        if (ParseIndex(info->label, "Package id ", &index))
+        {
+            info->kind = SensorKind::Package;
+            info->package = index;
+            io_sensor->rank = PackageRank::Coretemp;
+        }
+        else if (ParseIndex(info->label, "Core ", &index))
+        {
+            info->kind = SensorKind::Core;
+            info->package = i_chipPackage;
+            info->index = index;
+        }
+    }
+    else if (cstr_compare(info->chip, "k10temp") == 0 || cstr_compare(info->chip, "zenpower") == 0)
+    {
+        // one k10temp chip per node, there are no per-core sensors only per-CCD ones (Tccd1...)
+        info->package = i_chipPackage;
+        if (cstr_compare(info->label, "Tdie") == 0)
+        {
+            info->kind = SensorKind::Package;
+            io_sensor->rank = PackageRank::Tdie;
+        }
+        else if (cstr_compare(info->label, "Tctl") == 0)
+        {
+            info->kind = SensorKind::Package;
+            io_sensor->rank = PackageRank::Tctl;
+        }
+    }
+    else if (cstr_compare(info->chip, "nvme") == 0)
+    {
+        info->kind = SensorKind::Drive;
+    }
+}
+
+static bool IsTemperatureInput(const_cstr i_name, u32* o_sensorId)
+{
+    // temp<N>_input
+    if (!ParseIndex(i_name, "temp", o_sensorId))
+    {
+        return false;
+    }
+    const c8* suffix = i_name + 4;
+    while (*suffix >= '0' && *suffix <= '9')
+    {
+        suffix++;
+    }
+    return cstr_compare(suffix, "_input") == 0;
+}
+
+// the attributes were in the device directory before 3.x kernels, false for the chips we skip
+static bool FindChipAttributes(const_cstr i_chipDir, cstr o_attributesDir, cstr o_chip)
+{
+    c8 path[FLORAL_MAX_PATH_LENGTH];
+    cstr_snprintf(o_attributesDir, FLORAL_MAX_PATH_LENGTH, "%s", i_chipDir);
+    cstr_snprintf(path, FLORAL_MAX_PATH_LENGTH, "%s/name", i_chipDir);
+    if (!procfs::ReadText(path, o_chip, k_maxChipNameLength))
+    {
+        cstr_snprintf(o_attributesDir, FLORAL_MAX_PATH_LENGTH, "%s/device", i_chipDir);
+        cstr_snprintf(path, FLORAL_MAX_PATH_LENGTH, "%s/name", o_attributesDir);
+        if (!procfs::ReadText(path, o_chip, k_maxChipNameLength))
+        {
+            return false;
+        }
+    }
+
+    // acpitz registers a hwmon chip for each of its thermal zones, they are discovered as zones
+    return cstr_compare(o_chip, "acpitz") != 0;
+}
+
+static u32 CountHwmonChipSensors(const_cstr i_chipDir)
+{
+    c8 attributesDir[FLORAL_MAX_PATH_LENGTH];
+    c8 chip[k_maxChipNameLength];
+    if (!FindChipAttributes(i_chipDir, attributesDir, chip))
+    {
+        return 0;
+    }
+
+    c8 resolvedDir[FLORAL_MAX_PATH_LENGTH];
+    procfs::ResolvePath(attributesDir, resolvedDir, FLORAL_MAX_PATH_LENGTH);
+    DIR* dir = opendir(resolvedDir);
+    if (dir == nullptr)
+    {
+        return 0;
+    }
+
+    u32 count = 0;
+    struct dirent* entry = nullptr;
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        u32 sensorId = 0;
+        count += IsTemperatureInput(entry->d_name, &sensorId) ? 1 : 0;
+    }
+    closedir(dir);
+    return count;
+}
+
+static void DiscoverHwmonChip(const_cstr i_chipDir, u32* io_amdNodesCount)
+{
+    c8 path[FLORAL_MAX_PATH_LENGTH];
+    c8 chip[k_maxChipNameLength];
+    c8 attributesDir[FLORAL_MAX_PATH_LENGTH];
+    if (!FindChipAttributes(i_chipDir, attributesDir, chip))
+    {
+        return;
+    }
+
+    c8 resolvedDir[FLORAL_MAX_PATH_LENGTH];
+    procfs::ResolvePath(attributesDir, resolvedDir, FLORAL_MAX_PATH_LENGTH);
+    DIR* dir = opendir(resolvedDir);
+    if (dir == nullptr)
+    {
+        return;
+    }
+
+    const u32 firstSensor = s_state->sensorsCount;
+    u32 chipPackage = 0;
+    bool hasPackage = false;
+    struct dirent* entry = nullptr;
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        u32 sensorId = 0;
+        if (!IsTemperatureInput(entry->d_name, &sensorId))
+        {
+            continue;
+        }
+
+        c8 label[k_maxLabelLength];
+        cstr_snprintf(path, FLORAL_MAX_PATH_LENGTH, "%s/temp%u_label", attributesDir, sensorId);
+        if (!procfs::ReadText(path, label, k_maxLabelLength))
+        {
+            cstr_snprintf(label, k_maxLabelLength, "temp%u", sensorId);
+        }
+
+        cstr_snprintf(path, FLORAL_MAX_PATH_LENGTH, "%s/%s", attributesDir, entry->d_name);
+        Sensor* const sensor = AddSensor(path, chip, label);
+        if (sensor && ParseIndex(label, "Package id ", &chipPackage))
+        {
+            hasPackage = true;
+        }
+    }
+    closedir(dir);
+
+    // the per-core sensors get the package of their chip, which can be listed after them
+    if (!hasPackage && (cstr_compare(chip, "k10temp") == 0 || cstr_compare(chip, "zenpower") == 0))
+    {
+        chipPackage = (*io_amdNodesCount)++;
+    }
+    for (u32 i = firstSensor; i < s_state->sensorsCount; i++)
+    {
+        ClassifyHwmonSensor(&s_state->sensors[i], chipPackage);
+    }
+}
+
+// the ids of the hwmon<N> directories sorted: readdir() order is arbitrary and the AMD nodes are
+// numbered in the order their chips are discovered
+static u32 ListHwmonChips(u32* o_chipIds, const u32 i_maxChips)
+{
+    c8 resolvedDir[FLORAL_MAX_PATH_LENGTH];
+    procfs::ResolvePath("/sys/class/hwmon", resolvedDir, FLORAL_MAX_PATH_LENGTH);
+    DIR* dir = opendir(resolvedDir);
+    if (dir == nullptr)
+    {
+        return 0;
+    }
+
+    u32 count = 0;
+    bool truncated = false;
+    struct dirent* entry = nullptr;
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        u32 chipId = 0;
+        if (!ParseIndex(entry->d_name, "hwmon", &chipId))
+        {
+            continue;
+        }
+        if (count >= i_maxChips)
+        {
+            truncated = true;
+            continue;
+        }
+
+        u32 i = count++;
+        for (; i > 0 && o_chipIds[i - 1] > chipId; i--)
+        {
+            o_chipIds[i] = o_chipIds[i - 1];
+        }
+        o_chipIds[i] = chipId;
+    }
+    closedir(dir);
+
+    if (truncated)
+    {
+        LOG_WARNING("More than %d hwmon chips, the last ones are ignored", i_maxChips);
+    }
+    return count;
+}
+
+static void DiscoverHwmon(const u32* i_chipIds, const u32 i_chipsCount)
+{
+    u32 amdNodesCount = 0;
+    for (u32 i = 0; i < i_chipsCount; i++)
+    {
+        c8 chipDir[FLORAL_MAX_PATH_LENGTH];
+        cstr_snprintf(chipDir, FLORAL_MAX_PATH_LENGTH, "/sys/class/hwmon/hwmon%u", i_chipIds[i]);
+        DiscoverHwmonChip(chipDir, &amdNodesCount);
+    }
+}
+
+static u32 CountThermalZones()
+{
+    c8 resolvedDir[FLORAL_MAX_PATH_LENGTH];
+    procfs::ResolvePath("/sys/class/thermal", resolvedDir, FLORAL_MAX_PATH_LENGTH);
+    DIR* dir = opendir(resolvedDir);
+    if (dir == nullptr)
+    {
+        return 0;
+    }
+
+    u32 count = 0;
+    struct dirent* entry = nullptr;
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        u32 zoneId = 0;
+        count += ParseIndex(entry->d_name, "thermal_zone", &zoneId) ? 1 : 0;
+    }
+    closedir(dir);
+    return count;
+}
+
+static void DiscoverThermalZones()
+{
+    c8 resolvedDir[FLORAL_MAX_PATH_LENGTH];
+    procfs::ResolvePath("/sys/class/thermal", resolvedDir, FLORAL_MAX_PATH_LENGTH);
+    DIR* dir = opendir(resolvedDir);
+    if (dir == nullptr)
+    {
+        return;
+    }
+
+    struct dirent* entry = nullptr;
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        u32 zoneId = 0;
+        if (!ParseIndex(entry->d_name, "thermal_zone", &zoneId))
+        {
+            continue;
+        }
+
+        c8 path[FLORAL_MAX_PATH_LENGTH];
+        c8 type[k_maxChipNameLength];
+        cstr_snprintf(path, FLORAL_MAX_PATH_LENGTH, "/sys/class/thermal/%s/type", entry->d_name);
+        if (!procfs::ReadText(path, type, k_maxChipNameLength))
+        {
+            continue;
+        }
+
+        cstr_snprintf(path, FLORAL_MAX_PATH_LENGTH, "/sys/class/thermal/%s/temp", entry->d_name);
+        Sensor* const sensor = AddSensor(path, type, entry->d_name);
+        if (sensor == nullptr)
+        {
+            continue;
+        }
+
+        sensor->info.index = zoneId;
+        if (cstr_compare(type, "x86_pkg_temp") == 0)
+        {
+            sensor->info.kind = SensorKind::Package;
+            sensor->rank = PackageRank::PlatformZone;
+        }
+        else
+        {
+            sensor->info.kind = SensorKind::Zone;
+        }
+    }
+    closedir(dir);
+}
+
+// ----------------------------------------------------------------------------
+
+bool Initialize(linear_allocator_t* i_allocator)
+{
+    LOG_SCOPE(thermal);
+    // a dual-socket server has a coretemp input per core, count them all before sizing the array
+    u32 chipIds[k_maxHwmonChips];
+    const u32 chipsCount = ListHwmonChips(chipIds, k_maxHwmonChips);
+    u32 sensorsCapacity = CountThermalZones();
+    for (u32 i = 0; i < chipsCount; i++)
+    {
+        c8 chipDir[FLORAL_MAX_PATH_LENGTH];
+        cstr_snprintf(chipDir, FLORAL_MAX_PATH_LENGTH, "/sys/class/hwmon/hwmon%u", chipIds[i]);
+        sensorsCapacity += CountHwmonChipSensors(chipDir);
+    }
+
+    arena_t arena = create_arena(i_allocator, SIZE_KB(1) + sizeof(State) + (size)sensorsCapacity * sizeof(Sensor));
+    s_state = arena_push_pod(&arena, State);
+    s_state->arena = arena;
+    s_state->sensors = arena_push_podarr(&s_state->arena, Sensor, math_max(sensorsCapacity, 1u));
+    s_state->sensorsCount = 0;
+    s_state->sensorsCapacity = sensorsCapacity;
+    s_state->truncated = false;
+
+    DiscoverHwmon(chipIds, chipsCount);
+    DiscoverThermalZones();
+
+    s_state->packageRank = PackageRank::None;
+    for (u32 i = 0; i < s_state->sensorsCount; i++)
+    {
+        s_state->packageRank = math_max(s_state->packageRank, s_state->sensors[i].rank);
+    }
+
+    Update();
+    LOG_DEBUG("Temperature sensors:");
+    for (u32 i = 0; i < s_state->sensorsCount; i++)
+    {
+        const SensorInfo& info = s_state->sensors[i].info;
+        LOG_DEBUG("    %s / %s: %.1f C", info.chip, info.label, info.temperature);
+    }
+    return s_state->sensorsCount > 0;
+}
+
+void CleanUp()
+{
+    for (u32 i = 0; i < s_state->sensorsCount; i++)
+    {
+        procfs::Close(&s_state->sensors[i].inputFile);
+    }
+    s_state->sensorsCount = 0;
+}
+
+void Update()
+{
+    for (u32 i = 0; i < s_state->sensorsCount; i++)
+    {
+        Sensor* const sensor = &s_state->sensors[i];
+        // a sensor can fail to read while its device is suspended (nvme...), keep its last value
+        if (procfs::Read(&sensor->inputFile))
+        {
+            s64 milliCelsius = 0;
+            procfs::ParseS64(sensor->buffer, &milliCelsius);
+            sensor->info.temperature = (f32)milliCelsius / 1000.0f;
+        }
+    }
+}
+
+u32 ReadSensors(SensorInfo* o_sensors, const u32 i_maxSensors)
+{
+    const u32 count = math_min(s_state->sensorsCount, i_maxSensors);
+    for (u32 i = 0; i < count; i++)
+    {
+        o_sensors[i] = s_state->sensors[i].info;
+    }
+    return count;
+}
+
+bool ReadPackageTemperature(f32* o_temp)
+{
+    if (s_state->packageRank == PackageRank::None)
+    {
+        return false;
+    }
+
+    f32 temp = -273.15f;
+    for (u32 i = 0; i < s_state->sensorsCount; i++)
+    {
+        const Sensor& sensor = s_state->sensors[i];
+        if (sensor.rank == s_state->packageRank)
+        {
+            temp = math_max(temp, sensor.info.temperature);
+        }
+    }
+    *o_temp = temp;
+    return true;
+}
+
+bool ReadCoreTemperature(const u32 i_package, const u32 i_coreId, f32* o_temp)
+{
+    for (u32 i = 0; i < s_state->sensorsCount; i++)
+    {
+        const SensorInfo& info = s_state->sensors[i].info;
+        if (info.kind == SensorKind::Core && info.package == i_package && info.index == i_coreId)
+        {
+            *o_temp = info.temperature;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+} // namespace thermal
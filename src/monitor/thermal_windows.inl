@@ -0,0 +1,47 @@
+#include "thermal.h"
+
+#include <floral/misc.h>
+
+namespace thermal
+{
+// ----------------------------------------------------------------------------
+
+// nothing to discover, CPU temperatures come from the MSR / SMN reads of cpu_intel and cpu_amd
+
+bool Initialize(linear_allocator_t* i_allocator)
+{
+    MARK_UNUSED(i_allocator);
+    return true;
+}
+
+void CleanUp()
+{
+}
+
+void Update()
+{
+}
+
+u32 ReadSensors(SensorInfo* o_sensors, const u32 i_maxSensors)
+{
+    MARK_UNUSED(o_sensors);
+    MARK_UNUSED(i_maxSensors);
+    return 0;
+}
+
+bool ReadPackageTemperature(f32* o_temp)
+{
+    MARK_UNUSED(o_temp);
+    return false;
+}
+
+bool ReadCoreTemperature(const u32 i_package, const u32 i_coreId, f32* o_temp)
+{
+    MARK_UNUSED(i_package);
+    MARK_UNUSED(i_coreId);
+    MARK_UNUSED(o_temp);
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+} // namespace thermal
@@ -0,0 +1,357 @@
+#include "provider.h"
+
+#include <floral/assert.h>
+#include <floral/log.h>
+#include <floral/string_utils.h>
+
+#include "sampler.h"
+#include "scripting.h"
+
+static PRVContext s_providerContext;
+
+// ----------------------------------------------------------------------------
+
+// scripts polling every frame can pass the table they got the last time, it is then refilled
+// instead of creating a new one for the GC to collect
+static void PushReusableTable(lua_State* i_vm, const s32 i_arraySize, const s32 i_hashSize)
+{
+    if (lua_gettop(i_vm) >= 1 && lua_istable(i_vm, 1))
+    {
+        lua_settop(i_vm, 1);
+    }
+    else
+    {
+        lua_createtable(i_vm, i_arraySize, i_hashSize);
+    }
+}
+
+// pushes the i-th (1-based) element of the array on top of the stack, creating it if needed
+static void PushReusableArrayElement(lua_State* i_vm, const s32 i_index, const s32 i_hashSize)
+{
+    lua_rawgeti(i_vm, -1, i_index);
+    if (!lua_istable(i_vm, -1))
+    {
+        lua_pop(i_vm, 1);
+        lua_createtable(i_vm, 0, i_hashSize);
+        lua_pushvalue(i_vm, -1);
+        lua_rawseti(i_vm, -3, i_index);
+    }
+}
+
+// same as PushReusableArrayElement() for the field 'i_key' of the table
+static void PushReusableField(lua_State* i_vm, const_cstr i_key, const s32 i_hashSize)
+{
+    lua_getfield(i_vm, -1, i_key);
+    if (!lua_istable(i_vm, -1))
+    {
+        lua_pop(i_vm, 1);
+        lua_createtable(i_vm, 0, i_hashSize);
+        lua_pushvalue(i_vm, -1);
+        lua_setfield(i_vm, -3, i_key);
+    }
+}
+
+// drops the elements left from a previous, longer, fill of the array
+static void TrimReusableArray(lua_State* i_vm, const s32 i_size)
+{
+    for (s32 i = i_size + 1; ; i++)
+    {
+        lua_rawgeti(i_vm, -1, i);
+        const bool isNil = lua_isnil(i_vm, -1);
+        lua_pop(i_vm, 1);
+        if (isNil)
+        {
+            break;
+        }
+        lua_pushnil(i_vm);
+        lua_rawseti(i_vm, -2, i);
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+static void PushScalar(lua_State* i_vm, const PRVField& i_field, const u8* i_record)
+{
+    const u8* data = i_record + i_field.offset;
+    switch (i_field.type)
+    {
+    case PRVFieldType::F32:
+        lua_pushnumber(i_vm, *(const f32*)data);
+        break;
+    case PRVFieldType::U32:
+        lua_pushnumber(i_vm, *(const u32*)data);
+        break;
+    case PRVFieldType::S32:
+        lua_pushnumber(i_vm, *(const s32*)data);
+        break;
+    case PRVFieldType::U64:
+        lua_pushnumber(i_vm, (f64)*(const u64*)data);
+        break;
+    case PRVFieldType::Bool:
+        lua_pushboolean(i_vm, *(const bool*)data);
+        break;
+    case PRVFieldType::String:
+        lua_pushstring(i_vm, (const_cstr)data);
+        break;
+    case PRVFieldType::Enum:
+        // a value the names do not cover (a newer source, a corrupted record) reads as nil
+        if (*data < i_field.enumNamesCount)
+        {
+            lua_pushstring(i_vm, i_field.enumNames[*data]);
+        }
+        else
+        {
+            lua_pushnil(i_vm);
+        }
+        break;
+    default:
+        FLORAL_ASSERT(false);
+        lua_pushnil(i_vm);
+        break;
+    }
+}
+
+static void FillArray(lua_State* i_vm, const PRVField& i_field, const u8* i_record);
+
+// sets the fields of the table on top of the stack
+static void FillTable(lua_State* i_vm, const PRVSchema& i_schema, const u8* i_record)
+{
+    for (u32 i = 0; i < i_schema.fieldsCount; i++)
+    {
+        const PRVField& field = i_schema.fields[i];
+        if (field.type == PRVFieldType::Record)
+        {
+            PushReusableField(i_vm, field.name, (s32)field.schema->fieldsCount);
+            FillTable(i_vm, *field.schema, i_record + field.offset);
+            lua_pop(i_vm, 1);
+        }
+        else if (field.type == PRVFieldType::Array)
+        {
+            PushReusableField(i_vm, field.name, 0);
+            FillArray(i_vm, field, i_record);
+            lua_pop(i_vm, 1);
+        }
+        else
+        {
+            lua_pushstring(i_vm, field.name);
+            PushScalar(i_vm, field, i_record);
+            lua_settable(i_vm, -3);
+        }
+    }
+}
+
+// sets the elements of the array on top of the stack
+static void FillArray(lua_State* i_vm, const PRVField& i_field, const u8* i_record)
+{
+    const u32 count = *(const u32*)(i_record + i_field.countOffset);
+    const u8* element = i_record + i_field.offset;
+    for (u32 i = 0; i < count; i++)
+    {
+        PushReusableArrayElement(i_vm, (s32)i + 1, (s32)i_field.schema->fieldsCount);
+        FillTable(i_vm, *i_field.schema, element);
+        lua_pop(i_vm, 1);
+        element += i_field.stride;
+    }
+    TrimReusableArray(i_vm, (s32)count);
+}
+
+static s32 ScriptingGetMetric(lua_State* i_vm)
+{
+    const PRVAccessorBinding* binding = (const PRVAccessorBinding*)lua_touserdata(i_vm, lua_upvalueindex(1));
+    const PRVAccessor* accessor = binding->accessor;
+    const u8* record = SMPAcquireSnapshot()->records + s_providerContext.recordOffsets[binding->providerIndex];
+
+    if (accessor->field == nullptr)
+    {
+        const PRVSchema* schema = accessor->schema ? accessor->schema : s_providerContext.providers[binding->providerIndex]->schema;
+        PushReusableTable(i_vm, 0, (s32)schema->fieldsCount);
+        FillTable(i_vm, *schema, record);
+        return 1;
+    }
+
+    const PRVField& field = *accessor->field;
+    if (field.type == PRVFieldType::Record)
+    {
+        PushReusableTable(i_vm, 0, (s32)field.schema->fieldsCount);
+        FillTable(i_vm, *field.schema, record + field.offset);
+    }
+    else if (field.type == PRVFieldType::Array)
+    {
+        PushReusableTable(i_vm, (s32)*(const u32*)(record + field.countOffset), 0);
+        FillArray(i_vm, field, record);
+    }
+    else
+    {
+        PushScalar(i_vm, field, record);
+    }
+    return 1;
+}
+
+// the accessors of a disabled provider stay callable, the scripts get nil instead of an error
+static s32 ScriptingGetDisabledMetric(lua_State* i_vm)
+{
+    lua_pushnil(i_vm);
+    return 1;
+}
+
+// { { name, enabled }, ... }
+static s32 ScriptingGetProviders(lua_State* i_vm)
+{
+    lua_createtable(i_vm, (s32)s_providerContext.providersCount, 0);
+    for (u32 i = 0; i < s_providerContext.providersCount; i++)
+    {
+        lua_createtable(i_vm, 0, 2);
+        lua_pushstring(i_vm, "name");
+        lua_pushstring(i_vm, s_providerContext.providers[i]->name);
+        lua_settable(i_vm, -3);
+
+        lua_pushstring(i_vm, "enabled");
+        lua_pushboolean(i_vm, s_providerContext.enabled[i]);
+        lua_settable(i_vm, -3);
+        lua_rawseti(i_vm, -2, (s32)i + 1);
+    }
+    return 1;
+}
+
+// set_provider_enabled(name, enabled), saved in the configs and applied on the next start
+static s32 ScriptingSetProviderEnabled(lua_State* i_vm)
+{
+    const_cstr name = luaL_checkstring(i_vm, 1);
+    const bool enabled = lua_toboolean(i_vm, 2) != 0;
+    for (u32 i = 0; i < s_providerContext.providersCount; i++)
+    {
+        if (cstr_compare(s_providerContext.providers[i]->name, name) == 0)
+        {
+            CFGSetBool(s_providerContext.providers[i]->configKey, enabled);
+            lua_pushboolean(i_vm, true);
+            return 1;
+        }
+    }
+    lua_pushboolean(i_vm, false);
+    return 1;
+}
+
+// ----------------------------------------------------------------------------
+
+void PRVRegister(const PRVProviderDesc* i_desc)
+{
+    FLORAL_ASSERT(!s_providerContext.ready);
+    FLORAL_ASSERT(s_providerContext.providersCount < k_maxProviders);
+    s_providerContext.overridden[s_providerContext.providersCount] = false;
+    s_providerContext.providers[s_providerContext.providersCount++] = i_desc;
+}
+
+void PRVOverride(const u32 i_index, const PRVProviderDesc* i_desc, const bool i_enabled)
+{
+    FLORAL_ASSERT(!s_providerContext.ready);
+    FLORAL_ASSERT(i_index < s_providerContext.providersCount);
+    FLORAL_ASSERT(i_desc->recordSize == s_providerContext.providers[i_index]->recordSize);
+    s_providerContext.providers[i_index] = i_desc;
+    s_providerContext.enabled[i_index] = i_enabled;
+    s_providerContext.overridden[i_index] = true;
+}
+
+void PRVInitialize(linear_allocator_t* const i_allocator)
+{
+    LOG_SCOPE(provider);
+
+    size recordsSize = 0;
+    for (u32 i = 0; i < s_providerContext.providersCount; i++)
+    {
+        const PRVProviderDesc* desc = s_providerContext.providers[i];
+        if (!s_providerContext.overridden[i])
+        {
+            s_providerContext.enabled[i] = CFGGetBool(desc->configKey, true);
+        }
+        s_providerContext.recordOffsets[i] = 0;
+        if (!s_providerContext.enabled[i])
+        {
+            LOG_DEBUG("'%s' is disabled", desc->name);
+            continue;
+        }
+
+        if (desc->initialize && !desc->initialize(i_allocator))
+        {
+            // still sampled, its record then tells the scripts what is missing
+            LOG_WARNING("'%s' failed to initialize", desc->name);
+        }
+
+        // records are copied as a whole, keep each of them aligned for its widest field
+        recordsSize = (recordsSize + 7) & ~(size)7;
+        s_providerContext.recordOffsets[i] = recordsSize;
+        recordsSize += desc->recordSize;
+    }
+    s_providerContext.recordsSize = recordsSize;
+    s_providerContext.bindingsCount = 0;
+
+    s_providerContext.ready = true;
+    LOG_DEBUG("%d metric providers registered, %d bytes of records", s_providerContext.providersCount, (u32)recordsSize);
+}
+
+void PRVCleanUp()
+{
+    FLORAL_ASSERT(s_providerContext.ready);
+    for (u32 i = 0; i < s_providerContext.providersCount; i++)
+    {
+        if (s_providerContext.enabled[i] && s_providerContext.providers[i]->cleanUp)
+        {
+            s_providerContext.providers[i]->cleanUp();
+        }
+    }
+    s_providerContext.ready = false;
+}
+
+void PRVBindScriptingAPIs()
+{
+    // the VM is re-created on reload, the bindings can be re-generated in place
+    s_providerContext.bindingsCount = 0;
+    for (u32 i = 0; i < s_providerContext.providersCount; i++)
+    {
+        const PRVProviderDesc* desc = s_providerContext.providers[i];
+        if (!s_providerContext.enabled[i])
+        {
+            for (u32 j = 0; j < desc->accessorsCount; j++)
+            {
+                SCRRegisterFunc(&ScriptingGetDisabledMetric, desc->accessors[j].luaName, nullptr);
+            }
+            continue;
+        }
+
+        for (u32 j = 0; j < desc->accessorsCount; j++)
+        {
+            FLORAL_ASSERT(s_providerContext.bindingsCount < k_maxProviderAccessors);
+            PRVAccessorBinding* binding = &s_providerContext.bindings[s_providerContext.bindingsCount++];
+            binding->accessor = &desc->accessors[j];
+            binding->providerIndex = i;
+            SCRRegisterFunc(&ScriptingGetMetric, binding->accessor->luaName, binding);
+        }
+    }
+
+    SCRRegisterFunc(&ScriptingGetProviders, "get_providers", nullptr);
+    SCRRegisterFunc(&ScriptingSetProviderEnabled, "set_provider_enabled", nullptr);
+}
+
+u32 PRVGetProvidersCount()
+{
+    return s_providerContext.providersCount;
+}
+
+const PRVProviderDesc* PRVGetProvider(const u32 i_index)
+{
+    return s_providerContext.providers[i_index];
+}
+
+bool PRVIsEnabled(const u32 i_index)
+{
+    return s_providerContext.enabled[i_index];
+}
+
+size PRVGetRecordsSize()
+{
+    return s_providerContext.recordsSize;
+}
+
+size PRVGetRecordOffset(const u32 i_index)
+{
+    return s_providerContext.recordOffsets[i_index];
+}
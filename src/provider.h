@@ -0,0 +1,136 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <floral/stdaliases.h>
+#include <floral/memory.h>
+#include <floral/misc.h>
+
+#include "configs.h"
+
+// A metric provider samples one source into a plain record, its schema tells where each field of
+// the record is and what it is called. The registry lays the records of the enabled providers out
+// in the sampler's snapshots and generates their Lua accessors from the schemas: nothing has to be
+// hand-written outside of the provider's description to expose a new metric.
+
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_maxProviders = 32;
+constexpr u32 k_maxProviderAccessors = 64;
+
+enum class PRVFieldType : u8
+{
+    F32 = 0,
+    U32,
+    S32,
+    U64,
+    Bool,
+    String, // inline c8 array
+    Enum,   // u8 based enum class, exposed as the name of its value
+    Record, // nested table
+    Array   // array of records, the count is another u32 field of the record
+};
+
+struct PRVSchema;
+
+struct PRVField
+{
+    const_cstr name;
+    PRVFieldType type;
+    u32 offset;
+    const PRVSchema* schema; // Record and Array only
+    u32 countOffset;         // Array only
+    u32 stride;              // Array only
+    const const_cstr* enumNames; // Enum only, indexed by the value
+    u32 enumNamesCount;
+    bool counter; // U64 only, a running total which only goes up, rather than a level
+};
+
+struct PRVSchema
+{
+    const PRVField* fields;
+    u32 fieldsCount;
+};
+
+// a Lua function, returning either a single field (a number for the scalars) or a table made of
+// 'schema', the provider's whole schema when both are null
+struct PRVAccessor
+{
+    const_cstr luaName;
+    const PRVField* field;
+    const PRVSchema* schema;
+};
+
+struct PRVProviderDesc
+{
+    const_cstr name;
+    CFGKey configKey;
+
+    u32 recordSize;
+    const PRVSchema* schema;
+    const PRVAccessor* accessors;
+    u32 accessorsCount;
+
+    // sampling task, see SMPTask
+    u32 intervalMs;
+    u32 minIntervalMs;
+    u32 maxIntervalMs;
+    f32 threshold;
+
+    // optional, for the providers owning their source
+    bool (*initialize)(linear_allocator_t* i_allocator);
+    void (*cleanUp)();
+    // refreshes the record, which still holds the previous sample, returns the task's signal
+    f32 (*sample)(voidptr io_record, const f32 i_elapsedSecs);
+};
+
+struct PRVAccessorBinding
+{
+    const PRVAccessor* accessor;
+    u32 providerIndex;
+};
+
+struct PRVContext
+{
+    const PRVProviderDesc* providers[k_maxProviders];
+    bool enabled[k_maxProviders];
+    bool overridden[k_maxProviders]; // 'enabled' was forced, the configs are ignored
+    size recordOffsets[k_maxProviders];
+    u32 providersCount;
+    size recordsSize;
+
+    PRVAccessorBinding bindings[k_maxProviderAccessors];
+    u32 bindingsCount;
+
+    bool ready;
+};
+
+#define PRV_FIELD(record, member, name, type)                   { name, PRVFieldType::type, (u32)offsetof(record, member), nullptr, 0, 0, nullptr, 0, false }
+#define PRV_COUNTER_FIELD(record, member, name)                 { name, PRVFieldType::U64, (u32)offsetof(record, member), nullptr, 0, 0, nullptr, 0, true }
+#define PRV_ENUM_FIELD(record, member, name, enumNames)         { name, PRVFieldType::Enum, (u32)offsetof(record, member), nullptr, 0, 0, enumNames, array_length(enumNames), false }
+#define PRV_RECORD_FIELD(record, member, name, schema)          { name, PRVFieldType::Record, (u32)offsetof(record, member), &schema, 0, 0, nullptr, 0, false }
+#define PRV_ARRAY_FIELD(record, member, countMember, name, schema)                                                        \
+    { name, PRVFieldType::Array, (u32)offsetof(record, member), &schema, (u32)offsetof(record, countMember), \
+      (u32)sizeof(((record*)nullptr)->member[0]), nullptr, 0, false }
+#define PRV_SCHEMA(fields)                                      { fields, array_length(fields) }
+
+// ----------------------------------------------------------------------------
+
+// registration order is the sampling order, must be done before PRVInitialize()
+void PRVRegister(const PRVProviderDesc* i_desc);
+void PRVRegisterBuiltinProviders();
+// swaps a registered provider for another one with the same name and record (e.g. a replay), forcing
+// whether it is enabled, must be done before PRVInitialize()
+void PRVOverride(const u32 i_index, const PRVProviderDesc* i_desc, const bool i_enabled);
+
+// initializes the enabled providers, the disabled ones are never touched again
+void PRVInitialize(linear_allocator_t* const i_allocator);
+void PRVCleanUp();
+void PRVBindScriptingAPIs();
+
+u32 PRVGetProvidersCount();
+const PRVProviderDesc* PRVGetProvider(const u32 i_index);
+bool PRVIsEnabled(const u32 i_index);
+// the records of all the enabled providers, back to back
+size PRVGetRecordsSize();
+size PRVGetRecordOffset(const u32 i_index);
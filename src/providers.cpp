@@ -0,0 +1,686 @@
+#include "provider.h"
+
+#include "monitor/cpu.h"
+#include "monitor/disk.h"
+#include "monitor/gpu.h"
+#include "monitor/network.h"
+#include "monitor/perf.h"
+#include "monitor/pressure.h"
+#include "monitor/process.h"
+#include "monitor/thermal.h"
+
+// The built-in providers. The kernel driver, cpu and gpu modules are shared by several of them and
+// are initialized up front, the other sources belong to a single provider which initializes them.
+// Sampling rates: fast moving counters are sampled more often than the ones which barely change,
+// temperatures are also the most expensive to read as they go through the kernel driver.
+
+// ----------------------------------------------------------------------------
+// network
+
+struct NetworkRecord
+{
+    f32 ingress;
+    f32 egress;
+    u64 sentBytes;
+    u64 receivedBytes;
+    network::InterfaceInfo interfaces[network::k_maxInterfaces];
+    u32 interfacesCount;
+};
+
+static const PRVField k_interfaceFields[] = {
+    PRV_FIELD(network::InterfaceInfo, name, "name", String),
+    PRV_FIELD(network::InterfaceInfo, loopback, "loopback", Bool),
+    PRV_COUNTER_FIELD(network::InterfaceInfo, stats.sentBytes, "sent"),
+    PRV_COUNTER_FIELD(network::InterfaceInfo, stats.receivedBytes, "received"),
+    PRV_FIELD(network::InterfaceInfo, stats.sentBytesPerSec, "egress", F32),
+    PRV_FIELD(network::InterfaceInfo, stats.receivedBytesPerSec, "ingress", F32),
+};
+static const PRVSchema k_interfaceSchema = PRV_SCHEMA(k_interfaceFields);
+
+static const PRVField k_networkFields[] = {
+    PRV_COUNTER_FIELD(NetworkRecord, sentBytes, "sent"),
+    PRV_COUNTER_FIELD(NetworkRecord, receivedBytes, "received"),
+    PRV_FIELD(NetworkRecord, egress, "egress", F32),
+    PRV_FIELD(NetworkRecord, ingress, "ingress", F32),
+    PRV_ARRAY_FIELD(NetworkRecord, interfaces, interfacesCount, "interfaces", k_interfaceSchema),
+};
+static const PRVSchema k_networkSchema = PRV_SCHEMA(k_networkFields);
+
+// the aggregate only, the interfaces have their own accessor
+static const PRVField k_networkStatsFields[] = {
+    PRV_COUNTER_FIELD(NetworkRecord, sentBytes, "sent"),
+    PRV_COUNTER_FIELD(NetworkRecord, receivedBytes, "received"),
+    PRV_FIELD(NetworkRecord, egress, "egress", F32),
+    PRV_FIELD(NetworkRecord, ingress, "ingress", F32),
+};
+static const PRVSchema k_networkStatsSchema = PRV_SCHEMA(k_networkStatsFields);
+static const PRVField k_networkInterfacesField =
+    PRV_ARRAY_FIELD(NetworkRecord, interfaces, interfacesCount, "interfaces", k_interfaceSchema);
+
+static const PRVAccessor k_networkAccessors[] = {
+    {     "get_network_stats",                    nullptr, &k_networkStatsSchema},
+    {"get_network_interfaces", &k_networkInterfacesField,                nullptr},
+};
+
+static bool InitializeNetwork(linear_allocator_t* i_allocator)
+{
+    MARK_UNUSED(i_allocator);
+    return network::Initialize();
+}
+
+static f32 SampleNetwork(voidptr io_record, const f32 i_elapsedSecs)
+{
+    MARK_UNUSED(i_elapsedSecs);
+    NetworkRecord* const record = (NetworkRecord*)io_record;
+    network::ReadStats(&record->ingress, &record->egress, &record->sentBytes, &record->receivedBytes);
+    record->interfacesCount = network::ReadInterfaces(record->interfaces, network::k_maxInterfaces);
+    return (record->ingress + record->egress) / 1024.0f; // KB/s
+}
+
+static const PRVProviderDesc k_networkProvider = {
+    .name = "network",
+    .configKey = CFGKey::ProviderNetwork,
+    .recordSize = sizeof(NetworkRecord),
+    .schema = &k_networkSchema,
+    .accessors = k_networkAccessors,
+    .accessorsCount = array_length(k_networkAccessors),
+    .intervalMs = 250,
+    .minIntervalMs = 100,
+    .maxIntervalMs = 2000,
+    .threshold = 32.0f,
+    .initialize = &InitializeNetwork,
+    .cleanUp = &network::CleanUp,
+    .sample = &SampleNetwork
+};
+
+// ----------------------------------------------------------------------------
+// disk
+
+struct DiskRecord
+{
+    disk::Info stats;
+    disk::DeviceInfo devices[disk::k_maxDevices];
+    u32 devicesCount;
+};
+
+#define DISK_INFO_FIELDS(record, member)                                 \
+    PRV_COUNTER_FIELD(record, member.readBytes, "read"),                 \
+    PRV_COUNTER_FIELD(record, member.writtenBytes, "written"),           \
+    PRV_FIELD(record, member.readBytesPerSec, "readBytesPerSec", F32),   \
+    PRV_FIELD(record, member.writeBytesPerSec, "writeBytesPerSec", F32), \
+    PRV_FIELD(record, member.readsPerSec, "readsPerSec", F32),           \
+    PRV_FIELD(record, member.writesPerSec, "writesPerSec", F32),         \
+    PRV_FIELD(record, member.queueDepth, "queueDepth", F32),             \
+    PRV_FIELD(record, member.latency, "latency", F32),                   \
+    PRV_FIELD(record, member.busy, "busy", F32)
+
+static const PRVField k_diskDeviceFields[] = {
+    PRV_FIELD(disk::DeviceInfo, name, "name", String),
+    DISK_INFO_FIELDS(disk::DeviceInfo, stats),
+};
+static const PRVSchema k_diskDeviceSchema = PRV_SCHEMA(k_diskDeviceFields);
+
+// the totals over all the disks, and the per-disk stats in 'devices'
+static const PRVField k_diskFields[] = {
+    DISK_INFO_FIELDS(DiskRecord, stats),
+    PRV_ARRAY_FIELD(DiskRecord, devices, devicesCount, "devices", k_diskDeviceSchema),
+};
+static const PRVSchema k_diskSchema = PRV_SCHEMA(k_diskFields);
+
+static const PRVAccessor k_diskAccessors[] = {
+    {"get_disk_stats", nullptr, nullptr},
+};
+
+static bool InitializeDisk(linear_allocator_t* i_allocator)
+{
+    MARK_UNUSED(i_allocator);
+    return disk::Initialize();
+}
+
+static f32 SampleDisk(voidptr io_record, const f32 i_elapsedSecs)
+{
+    MARK_UNUSED(i_elapsedSecs);
+    DiskRecord* const record = (DiskRecord*)io_record;
+    disk::ReadStats(&record->stats);
+    record->devicesCount = disk::ReadDevices(record->devices, disk::k_maxDevices);
+    return (record->stats.readBytesPerSec + record->stats.writeBytesPerSec) / 1024.0f; // KB/s
+}
+
+static const PRVProviderDesc k_diskProvider = {
+    .name = "disk",
+    .configKey = CFGKey::ProviderDisk,
+    .recordSize = sizeof(DiskRecord),
+    .schema = &k_diskSchema,
+    .accessors = k_diskAccessors,
+    .accessorsCount = array_length(k_diskAccessors),
+    .intervalMs = 1000,
+    .minIntervalMs = 250,
+    .maxIntervalMs = 4000,
+    .threshold = 256.0f,
+    .initialize = &InitializeDisk,
+    .cleanUp = &disk::CleanUp,
+    .sample = &SampleDisk
+};
+
+// ----------------------------------------------------------------------------
+// processor
+
+struct ProcessorRecord
+{
+    f32 load;
+    f32 frequency; // MHz
+};
+
+static const PRVField k_processorFields[] = {
+    PRV_FIELD(ProcessorRecord, load, "load", F32),
+    PRV_FIELD(ProcessorRecord, frequency, "frequency", F32),
+};
+static const PRVSchema k_processorSchema = PRV_SCHEMA(k_processorFields);
+
+static const PRVAccessor k_processorAccessors[] = {
+    {"get_processor_utilization", &k_processorFields[0], nullptr},
+    {  "get_processor_frequency", &k_processorFields[1], nullptr},
+};
+
+static f32 SampleProcessor(voidptr io_record, const f32 i_elapsedSecs)
+{
+    MARK_UNUSED(i_elapsedSecs);
+    ProcessorRecord* const record = (ProcessorRecord*)io_record;
+    cpu::UpdateOSPerfCounters();
+    cpu::ReadProcessorUtilization(&record->load, nullptr, nullptr, 0);
+    cpu::ReadProcessorFrequency(&record->frequency, nullptr, nullptr, 0);
+    return record->load; // %
+}
+
+static const PRVProviderDesc k_processorProvider = {
+    .name = "processor",
+    .configKey = CFGKey::ProviderProcessor,
+    .recordSize = sizeof(ProcessorRecord),
+    .schema = &k_processorSchema,
+    .accessors = k_processorAccessors,
+    .accessorsCount = array_length(k_processorAccessors),
+    .intervalMs = 1000,
+    .minIntervalMs = 250,
+    .maxIntervalMs = 4000,
+    .threshold = 5.0f,
+    .initialize = nullptr,
+    .cleanUp = nullptr,
+    .sample = &SampleProcessor
+};
+
+// ----------------------------------------------------------------------------
+// processor counters
+
+struct ProcessorCountersRecord
+{
+    perf::Mode mode;
+    perf::Counters counters;
+};
+
+static const const_cstr k_perfModeNames[] = { "unavailable", "software", "hardware" };
+
+static const PRVField k_processorCountersFields[] = {
+    PRV_ENUM_FIELD(ProcessorCountersRecord, mode, "mode", k_perfModeNames),
+    PRV_FIELD(ProcessorCountersRecord, counters.instructionsPerCycle, "ipc", F32),
+    PRV_FIELD(ProcessorCountersRecord, counters.cacheMissesPerKiloInstructions, "cacheMissesPerKiloInstructions", F32),
+    PRV_FIELD(ProcessorCountersRecord, counters.branchMissesPerKiloInstructions, "branchMissesPerKiloInstructions", F32),
+    PRV_FIELD(ProcessorCountersRecord, counters.contextSwitchesPerSec, "contextSwitchesPerSec", F32),
+    PRV_FIELD(ProcessorCountersRecord, counters.pageFaultsPerSec, "pageFaultsPerSec", F32),
+};
+static const PRVSchema k_processorCountersSchema = PRV_SCHEMA(k_processorCountersFields);
+
+static const PRVAccessor k_processorCountersAccessors[] = {
+    {"get_processor_counters", nullptr, nullptr},
+};
+
+static f32 SampleProcessorCounters(voidptr io_record, const f32 i_elapsedSecs)
+{
+    MARK_UNUSED(i_elapsedSecs);
+    ProcessorCountersRecord* const record = (ProcessorCountersRecord*)io_record;
+    perf::Update();
+    perf::ReadCounters(&record->counters, nullptr, nullptr, 0);
+    record->mode = perf::GetMode();
+    // without hardware counters the signal stays flat and the task backs off to its slowest rate
+    return record->counters.instructionsPerCycle;
+}
+
+static const PRVProviderDesc k_processorCountersProvider = {
+    .name = "processor_counters",
+    .configKey = CFGKey::ProviderProcessorCounters,
+    .recordSize = sizeof(ProcessorCountersRecord),
+    .schema = &k_processorCountersSchema,
+    .accessors = k_processorCountersAccessors,
+    .accessorsCount = array_length(k_processorCountersAccessors),
+    .intervalMs = 1000,
+    .minIntervalMs = 500,
+    .maxIntervalMs = 4000,
+    .threshold = 0.1f,
+    .initialize = &perf::Initialize,
+    .cleanUp = &perf::CleanUp,
+    .sample = &SampleProcessorCounters
+};
+
+// ----------------------------------------------------------------------------
+// processor temperature
+
+struct ProcessorTemperatureRecord
+{
+    f32 packageTemp;
+    thermal::SensorInfo sensors[thermal::k_maxReportedSensors];
+    u32 sensorsCount;
+};
+
+static const const_cstr k_sensorKindNames[] = { "package", "core", "drive", "zone", "other" };
+
+static const PRVField k_sensorFields[] = {
+    PRV_FIELD(thermal::SensorInfo, chip, "chip", String),
+    PRV_FIELD(thermal::SensorInfo, label, "label", String),
+    PRV_ENUM_FIELD(thermal::SensorInfo, kind, "kind", k_sensorKindNames),
+    PRV_FIELD(thermal::SensorInfo, package, "package", U32),
+    PRV_FIELD(thermal::SensorInfo, index, "index", U32),
+    PRV_FIELD(thermal::SensorInfo, temperature, "temperature", F32),
+};
+static const PRVSchema k_sensorSchema = PRV_SCHEMA(k_sensorFields);
+
+static const PRVField k_processorTemperatureFields[] = {
+    PRV_FIELD(ProcessorTemperatureRecord, packageTemp, "package", F32),
+    PRV_ARRAY_FIELD(ProcessorTemperatureRecord, sensors, sensorsCount, "sensors", k_sensorSchema),
+};
+static const PRVSchema k_processorTemperatureSchema = PRV_SCHEMA(k_processorTemperatureFields);
+
+static const PRVAccessor k_processorTemperatureAccessors[] = {
+    {"get_processor_temperature", &k_processorTemperatureFields[0], nullptr},
+    {  "get_temperature_sensors", &k_processorTemperatureFields[1], nullptr},
+};
+
+static f32 SampleProcessorTemperature(voidptr io_record, const f32 i_elapsedSecs)
+{
+    MARK_UNUSED(i_elapsedSecs);
+    ProcessorTemperatureRecord* const record = (ProcessorTemperatureRecord*)io_record;
+    cpu::ReadProcessorTemperature(&record->packageTemp, nullptr, nullptr, 0);
+    record->sensorsCount = thermal::ReadSensors(record->sensors, thermal::k_maxReportedSensors);
+    return record->packageTemp; // C
+}
+
+static const PRVProviderDesc k_processorTemperatureProvider = {
+    .name = "processor_temperature",
+    .configKey = CFGKey::ProviderProcessorTemperature,
+    .recordSize = sizeof(ProcessorTemperatureRecord),
+    .schema = &k_processorTemperatureSchema,
+    .accessors = k_processorTemperatureAccessors,
+    .accessorsCount = array_length(k_processorTemperatureAccessors),
+    .intervalMs = 5000,
+    .minIntervalMs = 1000,
+    .maxIntervalMs = 10000,
+    .threshold = 2.0f,
+    .initialize = nullptr,
+    .cleanUp = nullptr,
+    .sample = &SampleProcessorTemperature
+};
+
+// ----------------------------------------------------------------------------
+// memory
+
+struct MemoryRecord
+{
+    cpu::MemoryInfo memory;
+    f32 swapInRate; // bytes/s
+    f32 swapOutRate;
+};
+
+static const PRVField k_memoryFields[] = {
+    PRV_FIELD(MemoryRecord, memory.physicalLoad, "physicalLoad", S32),
+    PRV_FIELD(MemoryRecord, memory.virtualLoad, "virtualLoad", S32),
+    PRV_FIELD(MemoryRecord, memory.totalPhysical, "total", U64),
+    PRV_FIELD(MemoryRecord, memory.availablePhysical, "available", U64),
+    PRV_FIELD(MemoryRecord, memory.cached, "cached", U64),
+    PRV_FIELD(MemoryRecord, memory.buffers, "buffers", U64),
+    PRV_FIELD(MemoryRecord, memory.dirty, "dirty", U64),
+    PRV_FIELD(MemoryRecord, memory.slab, "slab", U64),
+    PRV_FIELD(MemoryRecord, memory.totalSwap, "swapTotal", U64),
+    PRV_FIELD(MemoryRecord, memory.freeSwap, "swapFree", U64),
+    PRV_COUNTER_FIELD(MemoryRecord, memory.swappedIn, "swappedIn"),
+    PRV_COUNTER_FIELD(MemoryRecord, memory.swappedOut, "swappedOut"),
+    PRV_FIELD(MemoryRecord, swapInRate, "swapInRate", F32),
+    PRV_FIELD(MemoryRecord, swapOutRate, "swapOutRate", F32),
+};
+static const PRVSchema k_memorySchema = PRV_SCHEMA(k_memoryFields);
+
+static const PRVField k_ramUtilizationFields[] = {
+    PRV_FIELD(MemoryRecord, memory.physicalLoad, "physicalLoad", S32),
+    PRV_FIELD(MemoryRecord, memory.virtualLoad, "virtualLoad", S32),
+};
+static const PRVSchema k_ramUtilizationSchema = PRV_SCHEMA(k_ramUtilizationFields);
+
+static const PRVAccessor k_memoryAccessors[] = {
+    {"get_ram_utilization", nullptr, &k_ramUtilizationSchema},
+    {    "get_memory_info", nullptr,                 nullptr},
+};
+
+static f32 SampleMemory(voidptr io_record, const f32 i_elapsedSecs)
+{
+    MemoryRecord* const record = (MemoryRecord*)io_record;
+    cpu::MemoryInfo memory;
+    cpu::ReadMemoryInfo(&memory);
+
+    // swap traffic is what tells memory pressure apart from a merely full page cache
+    if (i_elapsedSecs > 0.0f)
+    {
+        const u64 swappedIn = memory.swappedIn > record->memory.swappedIn ? memory.swappedIn - record->memory.swappedIn : 0;
+        const u64 swappedOut = memory.swappedOut > record->memory.swappedOut ? memory.swappedOut - record->memory.swappedOut : 0;
+        record->swapInRate = (f32)swappedIn / i_elapsedSecs;
+        record->swapOutRate = (f32)swappedOut / i_elapsedSecs;
+    }
+
+    record->memory = memory;
+    return (f32)memory.physicalLoad; // %
+}
+
+static const PRVProviderDesc k_memoryProvider = {
+    .name = "memory",
+    .configKey = CFGKey::ProviderMemory,
+    .recordSize = sizeof(MemoryRecord),
+    .schema = &k_memorySchema,
+    .accessors = k_memoryAccessors,
+    .accessorsCount = array_length(k_memoryAccessors),
+    .intervalMs = 1000,
+    .minIntervalMs = 500,
+    .maxIntervalMs = 5000,
+    .threshold = 1.0f,
+    .initialize = nullptr,
+    .cleanUp = nullptr,
+    .sample = &SampleMemory
+};
+
+// ----------------------------------------------------------------------------
+// pressure
+
+constexpr u32 k_maxTopCgroups = 8;
+
+struct PressureRecord
+{
+    pressure::SystemPressure system;
+    pressure::CgroupInfo cgroups[k_maxTopCgroups];
+    u32 cgroupsCount;
+};
+
+static const PRVField k_stallFields[] = {
+    PRV_FIELD(pressure::Stall, avg10, "avg10", F32),
+    PRV_FIELD(pressure::Stall, avg60, "avg60", F32),
+    PRV_FIELD(pressure::Stall, avg300, "avg300", F32),
+    PRV_COUNTER_FIELD(pressure::Stall, totalUs, "total"),
+};
+static const PRVSchema k_stallSchema = PRV_SCHEMA(k_stallFields);
+
+static const PRVField k_resourceFields[] = {
+    PRV_RECORD_FIELD(pressure::Resource, some, "some", k_stallSchema),
+    PRV_RECORD_FIELD(pressure::Resource, full, "full", k_stallSchema),
+};
+static const PRVSchema k_resourceSchema = PRV_SCHEMA(k_resourceFields);
+
+static const PRVField k_systemPressureFields[] = {
+    PRV_RECORD_FIELD(pressure::SystemPressure, cpu, "cpu", k_resourceSchema),
+    PRV_RECORD_FIELD(pressure::SystemPressure, memory, "memory", k_resourceSchema),
+    PRV_RECORD_FIELD(pressure::SystemPressure, io, "io", k_resourceSchema),
+};
+static const PRVSchema k_systemPressureSchema = PRV_SCHEMA(k_systemPressureFields);
+
+static const PRVField k_cgroupFields[] = {
+    PRV_FIELD(pressure::CgroupInfo, path, "path", String),
+    PRV_FIELD(pressure::CgroupInfo, pressure, "pressure", F32),
+    PRV_FIELD(pressure::CgroupInfo, cpuUsage, "cpuUsage", F32),
+    PRV_FIELD(pressure::CgroupInfo, memoryCurrent, "memoryCurrent", U64),
+    PRV_FIELD(pressure::CgroupInfo, ioReadBytesPerSec, "ioReadBytesPerSec", F32),
+    PRV_FIELD(pressure::CgroupInfo, ioWriteBytesPerSec, "ioWriteBytesPerSec", F32),
+    PRV_RECORD_FIELD(pressure::CgroupInfo, cpu, "cpu", k_resourceSchema),
+    PRV_RECORD_FIELD(pressure::CgroupInfo, memory, "memory", k_resourceSchema),
+    PRV_RECORD_FIELD(pressure::CgroupInfo, io, "io", k_resourceSchema),
+};
+static const PRVSchema k_cgroupSchema = PRV_SCHEMA(k_cgroupFields);
+
+static const PRVField k_pressureFields[] = {
+    PRV_RECORD_FIELD(PressureRecord, system, "system", k_systemPressureSchema),
+    PRV_ARRAY_FIELD(PressureRecord, cgroups, cgroupsCount, "cgroups", k_cgroupSchema),
+};
+static const PRVSchema k_pressureSchema = PRV_SCHEMA(k_pressureFields);
+
+static const PRVAccessor k_pressureAccessors[] = {
+    {"get_system_pressure", &k_pressureFields[0], nullptr},
+    {    "get_top_cgroups", &k_pressureFields[1], nullptr},
+};
+
+static bool InitializePressure(linear_allocator_t* i_allocator)
+{
+    return pressure::Initialize(i_allocator, pressure::k_defaultCgroupRoot);
+}
+
+static f32 SamplePressure(voidptr io_record, const f32 i_elapsedSecs)
+{
+    MARK_UNUSED(i_elapsedSecs);
+    PressureRecord* const record = (PressureRecord*)io_record;
+    pressure::Update();
+    pressure::ReadSystemPressure(&record->system);
+    record->cgroupsCount = pressure::ReadTopCgroups(record->cgroups, k_maxTopCgroups);
+    const pressure::SystemPressure& system = record->system;
+    return math_max(system.cpu.some.avg10, math_max(system.memory.some.avg10, system.io.some.avg10)); // %
+}
+
+static const PRVProviderDesc k_pressureProvider = {
+    .name = "pressure",
+    .configKey = CFGKey::ProviderPressure,
+    .recordSize = sizeof(PressureRecord),
+    .schema = &k_pressureSchema,
+    .accessors = k_pressureAccessors,
+    .accessorsCount = array_length(k_pressureAccessors),
+    .intervalMs = 2000,
+    .minIntervalMs = 1000,
+    .maxIntervalMs = 10000,
+    .threshold = 5.0f,
+    .initialize = &InitializePressure,
+    .cleanUp = &pressure::CleanUp,
+    .sample = &SamplePressure
+};
+
+// ----------------------------------------------------------------------------
+// processes
+
+struct ProcessesRecord
+{
+    process::ProcessInfo byCpu[process::k_maxTopProcesses];
+    u32 byCpuCount;
+    process::ProcessInfo byMemory[process::k_maxTopProcesses];
+    u32 byMemoryCount;
+    process::ScanStats scan;
+};
+
+static const PRVField k_processFields[] = {
+    PRV_FIELD(process::ProcessInfo, pid, "pid", U32),
+    PRV_FIELD(process::ProcessInfo, name, "name", String),
+    PRV_FIELD(process::ProcessInfo, cpuUsage, "cpuUsage", F32),
+    PRV_FIELD(process::ProcessInfo, residentBytes, "residentBytes", U64),
+    PRV_FIELD(process::ProcessInfo, threadsCount, "threads", U32),
+};
+static const PRVSchema k_processSchema = PRV_SCHEMA(k_processFields);
+
+// the scan's own cost comes along so it can be watched
+static const PRVField k_processesFields[] = {
+    PRV_ARRAY_FIELD(ProcessesRecord, byCpu, byCpuCount, "cpu", k_processSchema),
+    PRV_ARRAY_FIELD(ProcessesRecord, byMemory, byMemoryCount, "memory", k_processSchema),
+    PRV_FIELD(ProcessesRecord, scan.processesCount, "processesCount", U32),
+    PRV_FIELD(ProcessesRecord, scan.cachedFilesCount, "cachedFilesCount", U32),
+    PRV_FIELD(ProcessesRecord, scan.skippedCount, "skippedCount", U32),
+    PRV_FIELD(ProcessesRecord, scan.jobsCount, "jobsCount", U32),
+    PRV_FIELD(ProcessesRecord, scan.scanMs, "scanMs", F32),
+};
+static const PRVSchema k_processesSchema = PRV_SCHEMA(k_processesFields);
+
+static const PRVAccessor k_processesAccessors[] = {
+    {"get_top_processes", nullptr, nullptr},
+};
+
+static f32 SampleProcesses(voidptr io_record, const f32 i_elapsedSecs)
+{
+    MARK_UNUSED(i_elapsedSecs);
+    ProcessesRecord* const record = (ProcessesRecord*)io_record;
+    process::Update();
+    record->byCpuCount = process::ReadTopProcesses(record->byCpu, process::k_maxTopProcesses, process::SortKey::CPU);
+    record->byMemoryCount = process::ReadTopProcesses(record->byMemory, process::k_maxTopProcesses, process::SortKey::Memory);
+    process::ReadScanStats(&record->scan);
+    return record->byCpuCount > 0 ? record->byCpu[0].cpuUsage : 0.0f; // % of one cpu used by the heaviest process
+}
+
+static const PRVProviderDesc k_processesProvider = {
+    .name = "processes",
+    .configKey = CFGKey::ProviderProcesses,
+    .recordSize = sizeof(ProcessesRecord),
+    .schema = &k_processesSchema,
+    .accessors = k_processesAccessors,
+    .accessorsCount = array_length(k_processesAccessors),
+    .intervalMs = 2000,
+    .minIntervalMs = 1000,
+    .maxIntervalMs = 10000,
+    .threshold = 10.0f,
+    .initialize = &process::Initialize,
+    .cleanUp = &process::CleanUp,
+    .sample = &SampleProcesses
+};
+
+// ----------------------------------------------------------------------------
+// gpu
+
+struct GPUUtilizationRecord
+{
+    u32 engineLoad;
+    u32 framebufferLoad;
+    u32 videoLoad;
+    u32 busLoad;
+};
+
+static const PRVField k_gpuUtilizationFields[] = {
+    PRV_FIELD(GPUUtilizationRecord, engineLoad, "graphicsEngineLoad", U32),
+    PRV_FIELD(GPUUtilizationRecord, framebufferLoad, "framebufferLoad", U32),
+    PRV_FIELD(GPUUtilizationRecord, videoLoad, "videoLoad", U32),
+    PRV_FIELD(GPUUtilizationRecord, busLoad, "busLoad", U32),
+};
+static const PRVSchema k_gpuUtilizationSchema = PRV_SCHEMA(k_gpuUtilizationFields);
+
+static const PRVAccessor k_gpuUtilizationAccessors[] = {
+    {"get_gpu_utilization", nullptr, nullptr},
+};
+
+static f32 SampleGPUUtilization(voidptr io_record, const f32 i_elapsedSecs)
+{
+    MARK_UNUSED(i_elapsedSecs);
+    GPUUtilizationRecord* const record = (GPUUtilizationRecord*)io_record;
+    gpu::ReadUtilization(&record->engineLoad, &record->framebufferLoad, &record->videoLoad, &record->busLoad);
+    return (f32)record->engineLoad; // %
+}
+
+static const PRVProviderDesc k_gpuUtilizationProvider = {
+    .name = "gpu_utilization",
+    .configKey = CFGKey::ProviderGPUUtilization,
+    .recordSize = sizeof(GPUUtilizationRecord),
+    .schema = &k_gpuUtilizationSchema,
+    .accessors = k_gpuUtilizationAccessors,
+    .accessorsCount = array_length(k_gpuUtilizationAccessors),
+    .intervalMs = 1000,
+    .minIntervalMs = 250,
+    .maxIntervalMs = 4000,
+    .threshold = 5.0f,
+    .initialize = nullptr,
+    .cleanUp = nullptr,
+    .sample = &SampleGPUUtilization
+};
+
+struct GPUTemperatureRecord
+{
+    f32 temperature;
+};
+
+static const PRVField k_gpuTemperatureFields[] = {
+    PRV_FIELD(GPUTemperatureRecord, temperature, "temperature", F32),
+};
+static const PRVSchema k_gpuTemperatureSchema = PRV_SCHEMA(k_gpuTemperatureFields);
+
+static const PRVAccessor k_gpuTemperatureAccessors[] = {
+    {"get_gpu_temperature", &k_gpuTemperatureFields[0], nullptr},
+};
+
+static f32 SampleGPUTemperature(voidptr io_record, const f32 i_elapsedSecs)
+{
+    MARK_UNUSED(i_elapsedSecs);
+    GPUTemperatureRecord* const record = (GPUTemperatureRecord*)io_record;
+    gpu::ReadTemperature(&record->temperature);
+    return record->temperature; // C
+}
+
+static const PRVProviderDesc k_gpuTemperatureProvider = {
+    .name = "gpu_temperature",
+    .configKey = CFGKey::ProviderGPUTemperature,
+    .recordSize = sizeof(GPUTemperatureRecord),
+    .schema = &k_gpuTemperatureSchema,
+    .accessors = k_gpuTemperatureAccessors,
+    .accessorsCount = array_length(k_gpuTemperatureAccessors),
+    .intervalMs = 5000,
+    .minIntervalMs = 1000,
+    .maxIntervalMs = 10000,
+    .threshold = 2.0f,
+    .initialize = nullptr,
+    .cleanUp = nullptr,
+    .sample = &SampleGPUTemperature
+};
+
+struct VRAMUtilizationRecord
+{
+    u32 load;
+};
+
+static const PRVField k_vramUtilizationFields[] = {
+    PRV_FIELD(VRAMUtilizationRecord, load, "load", U32),
+};
+static const PRVSchema k_vramUtilizationSchema = PRV_SCHEMA(k_vramUtilizationFields);
+
+static const PRVAccessor k_vramUtilizationAccessors[] = {
+    {"get_vram_utilization", &k_vramUtilizationFields[0], nullptr},
+};
+
+static f32 SampleVRAMUtilization(voidptr io_record, const f32 i_elapsedSecs)
+{
+    MARK_UNUSED(i_elapsedSecs);
+    VRAMUtilizationRecord* const record = (VRAMUtilizationRecord*)io_record;
+    gpu::ReadVRAMUtilization(&record->load);
+    return (f32)record->load; // %
+}
+
+static const PRVProviderDesc k_vramUtilizationProvider = {
+    .name = "vram_utilization",
+    .configKey = CFGKey::ProviderVRAMUtilization,
+    .recordSize = sizeof(VRAMUtilizationRecord),
+    .schema = &k_vramUtilizationSchema,
+    .accessors = k_vramUtilizationAccessors,
+    .accessorsCount = array_length(k_vramUtilizationAccessors),
+    .intervalMs = 1000,
+    .minIntervalMs = 500,
+    .maxIntervalMs = 5000,
+    .threshold = 1.0f,
+    .initialize = nullptr,
+    .cleanUp = nullptr,
+    .sample = &SampleVRAMUtilization
+};
+
+// ----------------------------------------------------------------------------
+
+void PRVRegisterBuiltinProviders()
+{
+    PRVRegister(&k_networkProvider);
+    PRVRegister(&k_diskProvider);
+    PRVRegister(&k_processorProvider);
+    PRVRegister(&k_processorCountersProvider);
+    PRVRegister(&k_processorTemperatureProvider);
+    PRVRegister(&k_memoryProvider);
+    PRVRegister(&k_pressureProvider);
+    PRVRegister(&k_processesProvider);
+    PRVRegister(&k_gpuUtilizationProvider);
+    PRVRegister(&k_gpuTemperatureProvider);
+    PRVRegister(&k_vramUtilizationProvider);
+}
@@ -0,0 +1,78 @@
+#include "publication.h"
+
+#include <floral/assert.h>
+#include <floral/log.h>
+#include <floral/misc.h>
+#include <floral/time.h>
+
+#include "archive.h"
+#include "history.h"
+
+static PUBContext s_publicationContext;
+
+// ----------------------------------------------------------------------------
+
+void PUBInitialize()
+{
+    LOG_SCOPE(publication);
+    s_publicationContext.ready = false;
+
+    if (!PUBCreateSection(&s_publicationContext, PUB_SECTION_NAME))
+    {
+        LOG_WARNING("Cannot create the shared memory section, the metrics will not be published");
+        return;
+    }
+
+    const u32 seriesCount = math_min(HSTGetSeriesCount(), k_maxPublishedSeries);
+    if (seriesCount < HSTGetSeriesCount())
+    {
+        LOG_WARNING("Only the first %d series out of %d are published", seriesCount, HSTGetSeriesCount());
+    }
+    const_cstr names[k_maxPublishedSeries];
+    for (u32 i = 0; i < seriesCount; i++)
+    {
+        names[i] = HSTGetSeries(i)->name;
+    }
+    PUBWriteLayout(s_publicationContext.section, names, seriesCount, (s64)ARCGetUnixTimeMs() - (s64)time_ticks_to_ms(time_get_ticks()));
+
+    s_publicationContext.seriesCount = seriesCount;
+    s_publicationContext.ready = true;
+    LOG_DEBUG("Publishing %d series, %d KB of shared memory", seriesCount, (u32)(sizeof(PUBSection) / 1024));
+}
+
+void PUBCleanUp()
+{
+    if (!s_publicationContext.ready)
+    {
+        return;
+    }
+
+    PUBDestroySection(&s_publicationContext);
+    s_publicationContext.ready = false;
+}
+
+void PUBAppend(const u32 i_providerIndex)
+{
+    if (!s_publicationContext.ready)
+    {
+        return;
+    }
+
+    u32 firstSeries = 0;
+    u32 seriesCount = 0;
+    HSTGetProviderSeries(i_providerIndex, &firstSeries, &seriesCount);
+    const u32 lastSeries = math_min(firstSeries + seriesCount, s_publicationContext.seriesCount);
+    for (u32 i = firstSeries; i < lastSeries; i++)
+    {
+        const HSTSeries* series = HSTGetSeries(i);
+        const HSTWindow window = HSTGetWindowLast(series, 1);
+        u64 timestampMs = 0;
+        f64 value = 0.0;
+        if (window.length == 0 || !HSTReadSample(series, window, 0, &timestampMs, &value))
+        {
+            continue;
+        }
+
+        PUBWriteSample(&s_publicationContext.section->series[i], timestampMs, value);
+    }
+}
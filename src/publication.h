@@ -0,0 +1,75 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <floral/stdaliases.h>
+#include <floral/memory.h>
+
+// The history series published in a named shared memory section so that other local tools can read
+// the same numbers without collecting them again: the latest samples of each series, as a ring,
+// behind a sequence lock the readers check without any syscall or lock (see publication_reader.h).
+// The layout below is the contract with the readers, any change to it must bump k_publicationVersion.
+
+// ----------------------------------------------------------------------------
+
+#define PUB_SECTION_NAME L"Local\\monitor-widget-metrics"
+
+constexpr u32 k_publicationMagic = 0x4255504d; // 'MPUB'
+constexpr u32 k_publicationVersion = 2;
+constexpr u32 k_maxPublishedSeries = 128;
+constexpr u32 k_publishedHistoryCapacity = 256; // samples per series, must be a power of 2
+constexpr u32 k_maxPublishedNameLength = 64;
+
+// the sequences are odd while being written, a reader retries until it sees the same even value
+// before and after reading
+struct PUBSectionHeader
+{
+    u32 magic;
+    u32 version;
+    u32 sectionSize;
+    ATOMIC_TYPE(u32) layoutSequence; // covers the fields below and the names of the series
+    u32 seriesCount;
+    u32 historyCapacity;
+    u32 writerProcessId;
+    u32 reserved;
+    s64 unixOffsetMs; // unix time of a sample is its timestamp plus this
+};
+
+struct PUBSeries
+{
+    c8 name[k_maxPublishedNameLength];
+    ATOMIC_TYPE(u32) sequence; // covers the samples
+    u32 count;                 // samples ever published, the newest one is at (count - 1) modulo the capacity
+    u64 timestamps[k_publishedHistoryCapacity]; // ms, monotonic
+    f64 values[k_publishedHistoryCapacity];
+};
+
+struct PUBSection
+{
+    PUBSectionHeader header;
+    PUBSeries series[k_maxPublishedSeries];
+};
+
+struct PUBContext
+{
+    HANDLE mapping;
+    PUBSection* section;
+    u32 seriesCount;
+    bool ready;
+};
+
+// ----------------------------------------------------------------------------
+
+// must come after HSTInitialize() and ARCInitialize(), the series are the history ones
+void PUBInitialize();
+void PUBCleanUp();
+
+// sampling thread only, right after HSTAppend()
+void PUBAppend(const u32 i_providerIndex);
+
+// the section alone, without the history (publication_writer.cpp)
+bool PUBCreateSection(PUBContext* o_context, const wchar_t* i_name);
+void PUBDestroySection(PUBContext* io_context);
+// (re)starts the publication, the series past i_seriesCount are not published anymore
+void PUBWriteLayout(PUBSection* io_section, const const_cstr* i_names, const u32 i_seriesCount, const s64 i_unixOffsetMs);
+void PUBWriteSample(PUBSeries* io_series, const u64 i_timestampMs, const f64 i_value);
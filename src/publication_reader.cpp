@@ -0,0 +1,145 @@
+#include "publication_reader.h"
+
+// ----------------------------------------------------------------------------
+
+// waits for the writer to be out of the protected fields, returns the sequence to check afterwards
+static u32 BeginPublicationRead(const ATOMIC_TYPE(u32)* i_sequence)
+{
+    u32 sequence = *i_sequence;
+    while (sequence & 1)
+    {
+        YieldProcessor();
+        sequence = *i_sequence;
+    }
+    MemoryBarrier();
+    return sequence;
+}
+
+// false if the writer went through the protected fields meanwhile, the read has to be redone
+static bool EndPublicationRead(const ATOMIC_TYPE(u32)* i_sequence, const u32 i_sequence0)
+{
+    MemoryBarrier();
+    return *i_sequence == i_sequence0;
+}
+
+static bool IsSameSeriesName(const c8* i_published, const_cstr i_name)
+{
+    for (u32 i = 0; i < k_maxPublishedNameLength; i++)
+    {
+        if (i_published[i] != i_name[i])
+        {
+            return false;
+        }
+        if (i_name[i] == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+
+bool PUBOpenReader(PUBReader* o_reader)
+{
+    return PUBOpenNamedReader(o_reader, PUB_SECTION_NAME);
+}
+
+bool PUBOpenNamedReader(PUBReader* o_reader, const wchar_t* i_name)
+{
+    o_reader->section = nullptr;
+    o_reader->mapping = OpenFileMappingW(FILE_MAP_READ, FALSE, i_name);
+    if (o_reader->mapping == NULL)
+    {
+        return false;
+    }
+
+    o_reader->section = (const PUBSection*)MapViewOfFile(o_reader->mapping, FILE_MAP_READ, 0, 0, sizeof(PUBSection));
+    const PUBSectionHeader* header = o_reader->section ? &o_reader->section->header : nullptr;
+    if (header == nullptr || header->magic != k_publicationMagic || header->version != k_publicationVersion ||
+        header->sectionSize != sizeof(PUBSection))
+    {
+        PUBCloseReader(o_reader);
+        return false;
+    }
+    return true;
+}
+
+void PUBCloseReader(PUBReader* io_reader)
+{
+    if (io_reader->section)
+    {
+        UnmapViewOfFile(io_reader->section);
+        io_reader->section = nullptr;
+    }
+    if (io_reader->mapping)
+    {
+        CloseHandle(io_reader->mapping);
+        io_reader->mapping = NULL;
+    }
+}
+
+s32 PUBFindSeries(const PUBReader& i_reader, const_cstr i_name)
+{
+    const PUBSectionHeader& header = i_reader.section->header;
+    s32 found = -1;
+    u32 sequence = 0;
+    do
+    {
+        sequence = BeginPublicationRead(&header.layoutSequence);
+        found = -1;
+        const u32 seriesCount = header.seriesCount < k_maxPublishedSeries ? header.seriesCount : k_maxPublishedSeries;
+        for (u32 i = 0; i < seriesCount && found < 0; i++)
+        {
+            if (IsSameSeriesName(i_reader.section->series[i].name, i_name))
+            {
+                found = (s32)i;
+            }
+        }
+    } while (!EndPublicationRead(&header.layoutSequence, sequence));
+    return found;
+}
+
+bool PUBReadLatest(const PUBReader& i_reader, const u32 i_series, u64* o_timestampMs, f64* o_value)
+{
+    return PUBReadHistory(i_reader, i_series, o_timestampMs, o_value, 1) == 1;
+}
+
+u32 PUBReadHistory(const PUBReader& i_reader, const u32 i_series, u64* o_timestampsMs, f64* o_values, const u32 i_maxCount)
+{
+    if (i_series >= k_maxPublishedSeries)
+    {
+        return 0;
+    }
+
+    const PUBSeries& series = i_reader.section->series[i_series];
+    u32 readCount = 0;
+    u32 sequence = 0;
+    do
+    {
+        sequence = BeginPublicationRead(&series.sequence);
+        const u32 count = series.count;
+        readCount = count < k_publishedHistoryCapacity ? count : k_publishedHistoryCapacity;
+        readCount = readCount < i_maxCount ? readCount : i_maxCount;
+        for (u32 i = 0; i < readCount; i++)
+        {
+            const u32 slot = (count - readCount + i) & (k_publishedHistoryCapacity - 1);
+            o_timestampsMs[i] = series.timestamps[slot];
+            o_values[i] = series.values[slot];
+        }
+    } while (!EndPublicationRead(&series.sequence, sequence));
+    return readCount;
+}
+
+s64 PUBGetUnixOffsetMs(const PUBReader& i_reader)
+{
+    const PUBSectionHeader& header = i_reader.section->header;
+    s64 offsetMs = 0;
+    u32 sequence = 0;
+    do
+    {
+        sequence = BeginPublicationRead(&header.layoutSequence);
+        offsetMs = header.unixOffsetMs;
+    } while (!EndPublicationRead(&header.layoutSequence, sequence));
+    return offsetMs;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "publication.h"
+
+// Reading the published series from another process. It only depends on publication.h and Windows:
+// tools can take these two files (and floral/stdaliases.h) as they are.
+// Nothing is copied out of the section but the samples asked for, and nothing but opening and closing
+// the reader is a syscall.
+
+// ----------------------------------------------------------------------------
+
+struct PUBReader
+{
+    HANDLE mapping;
+    const PUBSection* section;
+};
+
+// false if the widget is not running, or publishes another version
+bool PUBOpenReader(PUBReader* o_reader);
+// same, for a section published under another name than PUB_SECTION_NAME
+bool PUBOpenNamedReader(PUBReader* o_reader, const wchar_t* i_name);
+void PUBCloseReader(PUBReader* io_reader);
+
+// -1 when the series is not published
+s32 PUBFindSeries(const PUBReader& i_reader, const_cstr i_name);
+// false until the series has a sample
+bool PUBReadLatest(const PUBReader& i_reader, const u32 i_series, u64* o_timestampMs, f64* o_value);
+// the newest samples, oldest first, returns how many were read
+u32 PUBReadHistory(const PUBReader& i_reader, const u32 i_series, u64* o_timestampsMs, f64* o_values, const u32 i_maxCount);
+// same clock as the samples' timestamps
+s64 PUBGetUnixOffsetMs(const PUBReader& i_reader);
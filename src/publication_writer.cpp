@@ -0,0 +1,106 @@
+#include "publication.h"
+
+#include <floral/assert.h>
+#include <floral/atomic.h>
+#include <floral/log.h>
+#include <floral/misc.h>
+#include <floral/string_utils.h>
+
+// The writer side of the section alone, without the history: PUBInitialize() / PUBAppend() feed it,
+// the tests drive it directly under a name of their own
+
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_publishedHistoryMask = k_publishedHistoryCapacity - 1;
+
+static_assert((k_publishedHistoryCapacity & k_publishedHistoryMask) == 0, "The published history capacity must be a power of 2");
+static_assert(sizeof(PUBSectionHeader) == 40, "Section header layout changed, bump k_publicationVersion");
+static_assert(sizeof(PUBSeries) == 3144, "Series layout changed, bump k_publicationVersion");
+
+// ----------------------------------------------------------------------------
+
+bool PUBCreateSection(PUBContext* o_context, const wchar_t* i_name)
+{
+    const u64 sectionSize = sizeof(PUBSection);
+    o_context->section = nullptr;
+    o_context->mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)(sectionSize >> 32), (DWORD)sectionSize, i_name);
+    if (o_context->mapping == NULL)
+    {
+        return false;
+    }
+    if (GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        // a reader kept the section of a previous run alive, it is taken over
+        LOG_DEBUG("The shared memory section already exists");
+    }
+
+    o_context->section = (PUBSection*)MapViewOfFile(o_context->mapping, FILE_MAP_WRITE, 0, 0, sectionSize);
+    if (o_context->section == nullptr)
+    {
+        CloseHandle(o_context->mapping);
+        o_context->mapping = NULL;
+        return false;
+    }
+    return true;
+}
+
+void PUBDestroySection(PUBContext* io_context)
+{
+    // the readers can tell the samples will not move anymore
+    PUBSectionHeader* const header = &io_context->section->header;
+    const u32 layoutSequence = header->layoutSequence;
+    interlocked_exchange(&header->layoutSequence, layoutSequence + 1);
+    header->writerProcessId = 0;
+    interlocked_exchange(&header->layoutSequence, layoutSequence + 2);
+
+    UnmapViewOfFile(io_context->section);
+    CloseHandle(io_context->mapping);
+    io_context->section = nullptr;
+    io_context->mapping = NULL;
+}
+
+void PUBWriteLayout(PUBSection* io_section, const const_cstr* i_names, const u32 i_seriesCount, const s64 i_unixOffsetMs)
+{
+    FLORAL_ASSERT(i_seriesCount <= k_maxPublishedSeries);
+
+    // the sequences carry on from the previous run, so that a reader in the middle of a read still
+    // sees them move
+    PUBSectionHeader* const header = &io_section->header;
+    const u32 layoutSequence = (header->layoutSequence + 1) | 1;
+    interlocked_exchange(&header->layoutSequence, layoutSequence);
+
+    for (u32 i = 0; i < k_maxPublishedSeries; i++)
+    {
+        PUBSeries* const series = &io_section->series[i];
+        const u32 sequence = (series->sequence + 1) | 1;
+        interlocked_exchange(&series->sequence, sequence);
+        mem_fill(series->name, 0, k_maxPublishedNameLength);
+        if (i < i_seriesCount)
+        {
+            cstr_xcopy(series->name, k_maxPublishedNameLength, i_names[i]);
+        }
+        series->count = 0;
+        interlocked_exchange(&series->sequence, sequence + 1);
+    }
+
+    header->magic = k_publicationMagic;
+    header->version = k_publicationVersion;
+    header->sectionSize = (u32)sizeof(PUBSection);
+    header->seriesCount = i_seriesCount;
+    header->historyCapacity = k_publishedHistoryCapacity;
+    header->writerProcessId = GetCurrentProcessId();
+    header->reserved = 0;
+    header->unixOffsetMs = i_unixOffsetMs;
+    interlocked_exchange(&header->layoutSequence, layoutSequence + 1);
+}
+
+void PUBWriteSample(PUBSeries* io_series, const u64 i_timestampMs, const f64 i_value)
+{
+    const u32 sequence = io_series->sequence;
+    interlocked_exchange(&io_series->sequence, sequence + 1);
+    const u32 slot = io_series->count & k_publishedHistoryMask;
+    io_series->timestamps[slot] = i_timestampMs;
+    io_series->values[slot] = i_value;
+    io_series->count++;
+    interlocked_exchange(&io_series->sequence, sequence + 2);
+}
@@ -0,0 +1,438 @@
+#include "raster.h"
+
+#include <floral/assert.h>
+#include <floral/misc.h>
+
+#include <immintrin.h>
+
+// ----------------------------------------------------------------------------
+
+// a * b / 255, rounded, exact for all a, b in [0, 255]
+static u32 MulDiv255(const u32 i_a, const u32 i_b)
+{
+    const u32 x = i_a * i_b + 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+// same on 8 x u16 lanes
+static __m128i MulDiv255x8(const __m128i i_a, const __m128i i_b)
+{
+    const __m128i x = _mm_add_epi16(_mm_mullo_epi16(i_a, i_b), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// premultiplied source over: src * coverage + dst * (1 - srcAlpha * coverage)
+static u32 BlendPixel(const u32 i_dst, const u32 i_pixel, const u32 i_coverage)
+{
+    const u32 inverseAlpha = 255 - MulDiv255(i_pixel >> 24, i_coverage);
+    u32 result = 0;
+    for (u32 shift = 0; shift < 32; shift += 8)
+    {
+        const u32 channel = MulDiv255((i_pixel >> shift) & 0xff, i_coverage) + MulDiv255((i_dst >> shift) & 0xff, inverseAlpha);
+        result |= math_min(channel, 255u) << shift;
+    }
+    return result;
+}
+
+// 4 pixels, i_pixel16 is the source pixel widened to u16 twice, i_coverage4 one byte per pixel
+static __m128i BlendPixels4(const __m128i i_dst, const __m128i i_pixel16, const u32 i_coverage4)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i coverage = _mm_cvtsi32_si128((s32)i_coverage4);
+    coverage = _mm_unpacklo_epi8(coverage, coverage);
+    coverage = _mm_unpacklo_epi16(coverage, coverage); // each coverage byte 4 times
+    const __m128i srcLo = MulDiv255x8(i_pixel16, _mm_unpacklo_epi8(coverage, zero));
+    const __m128i srcHi = MulDiv255x8(i_pixel16, _mm_unpackhi_epi8(coverage, zero));
+
+    // the alpha is the last lane of each pixel
+    const __m128i max = _mm_set1_epi16(255);
+    const __m128i inverseAlphaLo = _mm_sub_epi16(max, _mm_shufflehi_epi16(_mm_shufflelo_epi16(srcLo, 0xff), 0xff));
+    const __m128i inverseAlphaHi = _mm_sub_epi16(max, _mm_shufflehi_epi16(_mm_shufflelo_epi16(srcHi, 0xff), 0xff));
+    const __m128i dstLo = MulDiv255x8(_mm_unpacklo_epi8(i_dst, zero), inverseAlphaLo);
+    const __m128i dstHi = MulDiv255x8(_mm_unpackhi_epi8(i_dst, zero), inverseAlphaHi);
+    return _mm_packus_epi16(_mm_add_epi16(srcLo, dstLo), _mm_add_epi16(srcHi, dstHi));
+}
+
+static void StoreSpan(u32* o_pixels, const s32 i_count, const u32 i_pixel)
+{
+    const __m128i pixel4 = _mm_set1_epi32((s32)i_pixel);
+    s32 i = 0;
+    for (; i + 4 <= i_count; i += 4)
+    {
+        _mm_storeu_si128((__m128i*)(o_pixels + i), pixel4);
+    }
+    for (; i < i_count; i++)
+    {
+        o_pixels[i] = i_pixel;
+    }
+}
+
+static u32 ToCoverage(const f32 i_coverage)
+{
+    return (u32)(math_clamp(0.0f, i_coverage, 1.0f) * 255.0f + 0.5f);
+}
+
+static void AccumulateLine(f32* io_cells, const s32 i_width, const s32 i_height, vec2f i_from, vec2f i_to)
+{
+    if (mathf_abs(i_from.y - i_to.y) <= 1e-6f)
+    {
+        return;
+    }
+
+    f32 direction = 1.0f;
+    if (i_from.y > i_to.y)
+    {
+        const vec2f from = i_from;
+        i_from = i_to;
+        i_to = from;
+        direction = -1.0f;
+    }
+
+    const f32 dxdy = (i_to.x - i_from.x) / (i_to.y - i_from.y);
+    const f32 minX = math_min(i_from.x, i_to.x);
+    const f32 maxX = math_max(i_from.x, i_to.x);
+    const s32 rowEnd = math_min((s32)mathf_ceil(i_to.y), i_height);
+    f32 x = i_from.x;
+    for (s32 row = (s32)i_from.y; row < rowEnd; row++)
+    {
+        f32* const cells = io_cells + (size)row * i_width;
+        const f32 dy = math_min((f32)(row + 1), i_to.y) - math_max((f32)row, i_from.y);
+        const f32 nextX = math_clamp(minX, x + dxdy * dy, maxX);
+        const f32 d = dy * direction;
+        const f32 left = math_min(x, nextX);
+        const f32 right = math_max(x, nextX);
+        const f32 leftFloor = mathf_floor(left);
+        const f32 rightCeil = mathf_ceil(right);
+        const s32 leftCell = (s32)leftFloor;
+        const s32 rightCell = (s32)rightCeil;
+
+        if (rightCell <= leftCell + 1)
+        {
+            // the edge stays within a cell, its area is split at its mean x
+            const f32 meanFraction = 0.5f * (x + nextX) - leftFloor;
+            cells[leftCell] += d - d * meanFraction;
+            cells[leftCell + 1] += d * meanFraction;
+        }
+        else
+        {
+            const f32 slope = 1.0f / (right - left);
+            const f32 leftFraction = left - leftFloor;
+            const f32 rightFraction = right - rightCeil + 1.0f;
+            const f32 firstArea = 0.5f * slope * (1.0f - leftFraction) * (1.0f - leftFraction);
+            const f32 lastArea = 0.5f * slope * rightFraction * rightFraction;
+            cells[leftCell] += d * firstArea;
+            if (rightCell == leftCell + 2)
+            {
+                cells[leftCell + 1] += d * (1.0f - firstArea - lastArea);
+            }
+            else
+            {
+                const f32 secondArea = slope * (1.5f - leftFraction);
+                cells[leftCell + 1] += d * (secondArea - firstArea);
+                for (s32 cell = leftCell + 2; cell < rightCell - 1; cell++)
+                {
+                    cells[cell] += d * slope;
+                }
+                const f32 beforeLastArea = secondArea + (f32)(rightCell - leftCell - 3) * slope;
+                cells[rightCell - 1] += d * (1.0f - beforeLastArea - lastArea);
+            }
+            cells[rightCell] += d * lastArea;
+        }
+        x = nextX;
+    }
+}
+
+// prefix sum of the cells' areas, 4 cells at a time
+static void AccumulateRow(const f32* i_cells, u8* o_coverage, const s32 i_width)
+{
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    __m128 offset = _mm_setzero_ps();
+    s32 i = 0;
+    for (; i + 4 <= i_width; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(i_cells + i);
+        x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4)));
+        x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 8)));
+        x = _mm_add_ps(x, offset);
+        const __m128 coverage = _mm_min_ps(_mm_and_ps(x, absMask), one);
+        const __m128i coverage32 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(coverage, scale), half));
+        const __m128i coverage16 = _mm_packs_epi32(coverage32, coverage32);
+        const u32 coverage4 = (u32)_mm_cvtsi128_si32(_mm_packus_epi16(coverage16, coverage16));
+        o_coverage[i] = (u8)coverage4;
+        o_coverage[i + 1] = (u8)(coverage4 >> 8);
+        o_coverage[i + 2] = (u8)(coverage4 >> 16);
+        o_coverage[i + 3] = (u8)(coverage4 >> 24);
+        offset = _mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+
+    f32 accumulation = _mm_cvtss_f32(offset);
+    for (; i < i_width; i++)
+    {
+        accumulation += i_cells[i];
+        o_coverage[i] = (u8)ToCoverage(mathf_abs(accumulation));
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+u32 RSTPremultiply(const u32 i_rgba)
+{
+    const u32 alpha = i_rgba & 0xff;
+    const u32 red = MulDiv255(i_rgba >> 24, alpha);
+    const u32 green = MulDiv255((i_rgba >> 16) & 0xff, alpha);
+    const u32 blue = MulDiv255((i_rgba >> 8) & 0xff, alpha);
+    return (alpha << 24) | (red << 16) | (green << 8) | blue;
+}
+
+void RSTClear(const RSTSurface& i_surface, const u32 i_pixel)
+{
+    for (s32 row = 0; row < i_surface.height; row++)
+    {
+        StoreSpan(i_surface.pixels + (ssize)row * i_surface.stride, i_surface.width, i_pixel);
+    }
+}
+
+void RSTFillSpan(u32* io_pixels, const s32 i_count, const u32 i_pixel)
+{
+    const u32 alpha = i_pixel >> 24;
+    if (alpha == 0xff)
+    {
+        StoreSpan(io_pixels, i_count, i_pixel);
+        return;
+    }
+    if (i_pixel == 0)
+    {
+        return;
+    }
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i pixel4 = _mm_set1_epi32((s32)i_pixel);
+    const __m128i inverseAlpha = _mm_set1_epi16((s16)(255 - alpha));
+    s32 i = 0;
+    for (; i + 4 <= i_count; i += 4)
+    {
+        const __m128i dst = _mm_loadu_si128((const __m128i*)(io_pixels + i));
+        const __m128i dstLo = MulDiv255x8(_mm_unpacklo_epi8(dst, zero), inverseAlpha);
+        const __m128i dstHi = MulDiv255x8(_mm_unpackhi_epi8(dst, zero), inverseAlpha);
+        _mm_storeu_si128((__m128i*)(io_pixels + i), _mm_adds_epu8(_mm_packus_epi16(dstLo, dstHi), pixel4));
+    }
+    for (; i < i_count; i++)
+    {
+        io_pixels[i] = BlendPixel(io_pixels[i], i_pixel, 255);
+    }
+}
+
+void RSTBlendSpan(u32* io_pixels, const u8* i_coverage, const s32 i_count, const u32 i_pixel)
+{
+    const __m128i pixel16 = _mm_unpacklo_epi8(_mm_set1_epi32((s32)i_pixel), _mm_setzero_si128());
+    const bool opaque = (i_pixel >> 24) == 0xff;
+    s32 i = 0;
+    for (; i + 4 <= i_count; i += 4)
+    {
+        const u32 coverage4 = (u32)i_coverage[i] | ((u32)i_coverage[i + 1] << 8) | ((u32)i_coverage[i + 2] << 16) |
+                              ((u32)i_coverage[i + 3] << 24);
+        if (coverage4 == 0)
+        {
+            continue;
+        }
+        if (coverage4 == 0xffffffff && opaque)
+        {
+            _mm_storeu_si128((__m128i*)(io_pixels + i), _mm_set1_epi32((s32)i_pixel));
+            continue;
+        }
+        const __m128i dst = _mm_loadu_si128((const __m128i*)(io_pixels + i));
+        _mm_storeu_si128((__m128i*)(io_pixels + i), BlendPixels4(dst, pixel16, coverage4));
+    }
+    for (; i < i_count; i++)
+    {
+        if (i_coverage[i] != 0)
+        {
+            io_pixels[i] = BlendPixel(io_pixels[i], i_pixel, i_coverage[i]);
+        }
+    }
+}
+
+void RSTFillRect(const RSTSurface& i_surface, const f32 i_x, const f32 i_y, const f32 i_w, const f32 i_h, const u32 i_pixel)
+{
+    const f32 x0 = math_max(i_x, 0.0f);
+    const f32 y0 = math_max(i_y, 0.0f);
+    const f32 x1 = math_min(i_x + i_w, (f32)i_surface.width);
+    const f32 y1 = math_min(i_y + i_h, (f32)i_surface.height);
+    if (x0 >= x1 || y0 >= y1 || i_pixel == 0)
+    {
+        return;
+    }
+
+    const s32 firstColumn = (s32)x0;
+    const s32 lastColumn = (s32)mathf_ceil(x1) - 1;
+    const f32 leftCoverage = math_min((f32)(firstColumn + 1), x1) - x0;
+    const f32 rightCoverage = x1 - (f32)lastColumn;
+    for (s32 row = (s32)y0; row < (s32)mathf_ceil(y1); row++)
+    {
+        u32* const pixels = i_surface.pixels + (ssize)row * i_surface.stride;
+        const f32 rowCoverage = math_min((f32)(row + 1), y1) - math_max((f32)row, y0);
+        const u32 leftPixelCoverage = ToCoverage(leftCoverage * rowCoverage);
+        if (leftPixelCoverage > 0)
+        {
+            pixels[firstColumn] = BlendPixel(pixels[firstColumn], i_pixel, leftPixelCoverage);
+        }
+        if (lastColumn == firstColumn)
+        {
+            continue;
+        }
+
+        // the inner span of a partially covered row is filled with the color scaled down
+        const u32 rowPixelCoverage = ToCoverage(rowCoverage);
+        const u32 rowPixel = rowPixelCoverage == 255 ? i_pixel : BlendPixel(0, i_pixel, rowPixelCoverage);
+        RSTFillSpan(pixels + firstColumn + 1, lastColumn - firstColumn - 1, rowPixel);
+
+        const u32 rightPixelCoverage = ToCoverage(rightCoverage * rowCoverage);
+        if (rightPixelCoverage > 0)
+        {
+            pixels[lastColumn] = BlendPixel(pixels[lastColumn], i_pixel, rightPixelCoverage);
+        }
+    }
+}
+
+RSTPath RSTCreatePath(arena_t* const i_arena, const u32 i_pointsCapacity, const u32 i_contoursCapacity)
+{
+    RSTPath path = {};
+    path.points = arena_push_podarr(i_arena, vec2f, i_pointsCapacity);
+    path.contourEnds = arena_push_podarr(i_arena, u32, i_contoursCapacity);
+    path.pointsCapacity = i_pointsCapacity;
+    path.contoursCapacity = i_contoursCapacity;
+    return path;
+}
+
+void RSTResetPath(RSTPath* const io_path)
+{
+    io_path->pointsCount = 0;
+    io_path->contoursCount = 0;
+    io_path->overflowed = false;
+}
+
+bool RSTAddPoint(RSTPath* const io_path, const vec2f& i_point)
+{
+    if (io_path->pointsCount == io_path->pointsCapacity)
+    {
+        io_path->overflowed = true;
+        return false;
+    }
+    io_path->points[io_path->pointsCount++] = i_point;
+    return true;
+}
+
+void RSTCloseContour(RSTPath* const io_path)
+{
+    const u32 start = io_path->contoursCount > 0 ? io_path->contourEnds[io_path->contoursCount - 1] : 0;
+    if (io_path->pointsCount - start < 3)
+    {
+        // nothing to fill
+        io_path->pointsCount = start;
+        return;
+    }
+    if (io_path->contoursCount == io_path->contoursCapacity)
+    {
+        io_path->overflowed = true;
+        return;
+    }
+    io_path->contourEnds[io_path->contoursCount++] = io_path->pointsCount;
+}
+
+bool RSTRasterizePath(const RSTPath& i_path, arena_t* const i_arena, RSTMask* o_mask)
+{
+    if (i_path.overflowed || i_path.contoursCount == 0)
+    {
+        return false;
+    }
+
+    const u32 pointsCount = i_path.contourEnds[i_path.contoursCount - 1];
+    vec2f minPoint = i_path.points[0];
+    vec2f maxPoint = i_path.points[0];
+    for (u32 i = 1; i < pointsCount; i++)
+    {
+        minPoint.x = math_min(minPoint.x, i_path.points[i].x);
+        minPoint.y = math_min(minPoint.y, i_path.points[i].y);
+        maxPoint.x = math_max(maxPoint.x, i_path.points[i].x);
+        maxPoint.y = math_max(maxPoint.y, i_path.points[i].y);
+    }
+
+    // 2 more columns: an edge on the right border spills its area over the next cell
+    const s32 left = (s32)mathf_floor(minPoint.x);
+    const s32 top = (s32)mathf_floor(minPoint.y);
+    const s32 width = (s32)mathf_ceil(maxPoint.x) - left + 2;
+    const s32 height = (s32)mathf_ceil(maxPoint.y) - top;
+    if (height <= 0)
+    {
+        return false;
+    }
+    // the mask and its cells, a stray outline must not exhaust the arena
+    const size cellsCount = (size)width * (size)height;
+    if (cellsCount * (sizeof(f32) + sizeof(u8)) + 32 > i_arena->capacity - (size)i_arena->marker)
+    {
+        return false;
+    }
+
+    o_mask->coverage = arena_push_podarr(i_arena, u8, cellsCount);
+    o_mask->x = left;
+    o_mask->y = top;
+    o_mask->width = width;
+    o_mask->height = height;
+
+    scratch_region_t scratch = scratch_begin(i_arena);
+    f32* const cells = arena_push_podarr_aligned(scratch.arena, f32, cellsCount, 16);
+    mem_fill(cells, 0, cellsCount * sizeof(f32));
+    const vec2f origin((f32)left, (f32)top);
+    u32 start = 0;
+    for (u32 c = 0; c < i_path.contoursCount; c++)
+    {
+        const u32 end = i_path.contourEnds[c];
+        for (u32 i = start; i < end; i++)
+        {
+            const vec2f& from = i_path.points[i];
+            const vec2f& to = i_path.points[i + 1 < end ? i + 1 : start];
+            AccumulateLine(cells, width, height, vec2f(from.x - origin.x, from.y - origin.y), vec2f(to.x - origin.x, to.y - origin.y));
+        }
+        start = end;
+    }
+    for (s32 row = 0; row < height; row++)
+    {
+        AccumulateRow(cells + (size)row * width, o_mask->coverage + (size)row * width, width);
+    }
+    scratch_end(&scratch);
+    return true;
+}
+
+void RSTBlendMask(const RSTSurface& i_surface, const RSTMask& i_mask, const s32 i_x, const s32 i_y, const u32 i_pixel)
+{
+    const s32 left = i_mask.x + i_x;
+    const s32 top = i_mask.y + i_y;
+    const s32 x0 = math_max(left, 0);
+    const s32 y0 = math_max(top, 0);
+    const s32 x1 = math_min(left + i_mask.width, i_surface.width);
+    const s32 y1 = math_min(top + i_mask.height, i_surface.height);
+    if (x0 >= x1 || y0 >= y1 || i_pixel == 0)
+    {
+        return;
+    }
+
+    for (s32 row = y0; row < y1; row++)
+    {
+        RSTBlendSpan(i_surface.pixels + (ssize)row * i_surface.stride + x0,
+                     i_mask.coverage + (size)(row - top) * i_mask.width + (x0 - left), x1 - x0, i_pixel);
+    }
+}
+
+void RSTFillPath(const RSTSurface& i_surface, const RSTPath& i_path, const u32 i_pixel, arena_t* const i_scratchArena)
+{
+    scratch_region_t scratch = scratch_begin(i_scratchArena);
+    RSTMask mask = {};
+    if (RSTRasterizePath(i_path, scratch.arena, &mask))
+    {
+        RSTBlendMask(i_surface, mask, 0, 0, i_pixel);
+    }
+    scratch_end(&scratch);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+#include <floral/memory.h>
+#include <floral/vector_math.h>
+
+// CPU rasterization into 32-bit premultiplied BGRA pixels, the layout of the widget's DIB section and
+// of what UpdateLayeredWindow() expects. Shapes are rasterized into 8-bit coverage masks (signed
+// area accumulation, anti-aliased), masks and solid spans are blended 4 pixels at a time with SSE.
+// Nothing here depends on the OS.
+
+// ----------------------------------------------------------------------------
+
+struct RSTSurface
+{
+    u32* pixels; // the top row
+    s32 width;
+    s32 height;
+    s32 stride; // in pixels, negative for bottom-up buffers
+};
+
+// coverage of the pixels [x, x + width) x [y, y + height)
+struct RSTMask
+{
+    u8* coverage;
+    s32 x;
+    s32 y;
+    s32 width;
+    s32 height;
+};
+
+// closed polygons, in pixels
+struct RSTPath
+{
+    vec2f* points;
+    u32* contourEnds; // one past the last point of each contour
+    u32 pointsCount;
+    u32 contoursCount;
+    u32 pointsCapacity;
+    u32 contoursCapacity;
+    bool overflowed;
+};
+
+// ----------------------------------------------------------------------------
+
+// 0xRRGGBBAA, as passed from the scripts, to a premultiplied BGRA pixel
+u32 RSTPremultiply(const u32 i_rgba);
+
+void RSTClear(const RSTSurface& i_surface, const u32 i_pixel);
+void RSTFillSpan(u32* io_pixels, const s32 i_count, const u32 i_pixel);
+void RSTBlendSpan(u32* io_pixels, const u8* i_coverage, const s32 i_count, const u32 i_pixel);
+// anti-aliased on fractional edges
+void RSTFillRect(const RSTSurface& i_surface, const f32 i_x, const f32 i_y, const f32 i_w, const f32 i_h, const u32 i_pixel);
+
+RSTPath RSTCreatePath(arena_t* const i_arena, const u32 i_pointsCapacity, const u32 i_contoursCapacity);
+void RSTResetPath(RSTPath* const io_path);
+// false once the path is full, a full path is not rasterized
+bool RSTAddPoint(RSTPath* const io_path, const vec2f& i_point);
+void RSTCloseContour(RSTPath* const io_path);
+
+// the mask is allocated from i_arena, false when the path is empty or full, or the mask does not fit
+bool RSTRasterizePath(const RSTPath& i_path, arena_t* const i_arena, RSTMask* o_mask);
+// blends the mask moved by (i_x, i_y)
+void RSTBlendMask(const RSTSurface& i_surface, const RSTMask& i_mask, const s32 i_x, const s32 i_y, const u32 i_pixel);
+void RSTFillPath(const RSTSurface& i_surface, const RSTPath& i_path, const u32 i_pixel, arena_t* const i_scratchArena);
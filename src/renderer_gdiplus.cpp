@@ -7,6 +7,7 @@
 #include <resource.h>
 
 #include "gdiapi.h"
+#include "html.h"
 #include "utils.h"
 #include "scripting.h"
 
@@ -17,60 +18,38 @@ void DrawHTMLString(RNDState* i_gdiState, const gdiapi::Font* const i_font,
 
 // ----------------------------------------------------------------------------
 
-static s32 ScriptingDrawRect(lua_State* i_vm)
+static void GdiplusDrawRect(RNDState* const i_gdiState, const DRWDrawRect& i_command)
 {
-    RNDState* const gdiState = (RNDState* const)lua_touserdata(i_vm, lua_upvalueindex(1));
-    const s32 nArgs = lua_gettop(i_vm);
-    FLORAL_ASSERT(nArgs == 6);
-    s32 x = (s32)lua_tointeger(i_vm, 1);
-    s32 y = (s32)lua_tointeger(i_vm, 2);
-    s32 w = (s32)lua_tointeger(i_vm, 3);
-    s32 h = (s32)lua_tointeger(i_vm, 4);
-    const u32 color = (u32)lua_tointeger(i_vm, 5);
-    f32 width = (f32)lua_tonumber(i_vm, 6);
-
-    const f32 dpiScale = (f32)gdiState->dpiScale;
-    const f32 fx = (f32)x * dpiScale;
-    const f32 fy = (f32)y * dpiScale;
-    const f32 fw = (f32)w * dpiScale;
-    const f32 fh = (f32)h * dpiScale;
-    width = width * dpiScale;
+    const u32 color = i_command.color;
+    const f32 dpiScale = (f32)i_gdiState->dpiScale;
+    const f32 fx = (f32)i_command.x * dpiScale;
+    const f32 fy = (f32)i_command.y * dpiScale;
+    const f32 fw = (f32)i_command.w * dpiScale;
+    const f32 fh = (f32)i_command.h * dpiScale;
+    const f32 width = i_command.width * dpiScale;
 
     Gdiplus::Pen pen(Gdiplus::Color(BYTE(color & 0xff),
                                     BYTE((color & 0xff000000) >> 24),
                                     BYTE((color & 0xff0000) >> 16),
                                     BYTE((color & 0xff00) >> 8)),
                      width);
-    gdiState->graphics->DrawRectangle(&pen, fx, fy, fw, fh);
-
-    return 0;
+    i_gdiState->graphics->DrawRectangle(&pen, fx, fy, fw, fh);
 }
 
-static s32 ScriptingDrawArc(lua_State* i_vm)
+static void GdiplusDrawArc(RNDState* const i_gdiState, const DRWDrawArc& i_command)
 {
-    RNDState* const gdiState = (RNDState* const)lua_touserdata(i_vm, lua_upvalueindex(1));
-    const s32 nArgs = lua_gettop(i_vm);
-    FLORAL_ASSERT(nArgs == 8);
-    f32 x = (f32)lua_tonumber(i_vm, 1);
-    f32 y = (f32)lua_tonumber(i_vm, 2);
-    f32 w = (f32)lua_tonumber(i_vm, 3);
-    f32 h = (f32)lua_tonumber(i_vm, 4);
-    const u32 color = (u32)lua_tointeger(i_vm, 5);
-    f32 width = (f32)lua_tonumber(i_vm, 6);
-    f32 start = (f32)lua_tonumber(i_vm, 7);
-    f32 sweep = (f32)lua_tonumber(i_vm, 8);
-
-    x *= gdiState->dpiScale;
-    y *= gdiState->dpiScale;
-    w *= gdiState->dpiScale;
-    h *= gdiState->dpiScale;
-    width *= gdiState->dpiScale;
+    const u32 color = i_command.color;
+    const f32 x = i_command.x * i_gdiState->dpiScale;
+    const f32 y = i_command.y * i_gdiState->dpiScale;
+    const f32 w = i_command.w * i_gdiState->dpiScale;
+    const f32 h = i_command.h * i_gdiState->dpiScale;
+    const f32 width = i_command.width * i_gdiState->dpiScale;
     const f32 halfWidth = width * 0.5f;
 
-    if (gdiState->debugDrawLayout)
+    if (i_gdiState->debugDrawLayout)
     {
         Gdiplus::Pen pen(Gdiplus::Color::Red, 1);
-        gdiState->graphics->DrawRectangle(&pen, x, y, w, h);
+        i_gdiState->graphics->DrawRectangle(&pen, x, y, w, h);
     }
 
     Gdiplus::Pen pen(Gdiplus::Color(BYTE(color & 0xff),
@@ -80,34 +59,23 @@ static s32 ScriptingDrawArc(lua_State* i_vm)
                      width);
     pen.SetAlignment(Gdiplus::PenAlignment::PenAlignmentCenter);
     // workaround because PenAlignmentInset doesn't work with DrawArc
-    gdiState->graphics->DrawArc(&pen, x + halfWidth, y + halfWidth, w - width, h - width, start, sweep);
-    return 0;
+    i_gdiState->graphics->DrawArc(&pen, x + halfWidth, y + halfWidth, w - width, h - width, i_command.start, i_command.sweep);
 }
 
-static s32 ScriptingFillRect(lua_State* i_vm)
+static void GdiplusFillRect(RNDState* const i_gdiState, const DRWFillRect& i_command)
 {
-    RNDState* const gdiState = (RNDState* const)lua_touserdata(i_vm, lua_upvalueindex(1));
-    const s32 nArgs = lua_gettop(i_vm);
-    FLORAL_ASSERT(nArgs == 5);
-    s32 x = (s32)lua_tointeger(i_vm, 1);
-    s32 y = (s32)lua_tointeger(i_vm, 2);
-    s32 w = (s32)lua_tointeger(i_vm, 3);
-    s32 h = (s32)lua_tointeger(i_vm, 4);
-    const u32 color = (u32)lua_tointeger(i_vm, 5);
-
-    const f32 dpiScale = (f32)gdiState->dpiScale;
-    const f32 fx = (f32)x * dpiScale;
-    const f32 fy = (f32)y * dpiScale;
-    const f32 fw = (f32)w * dpiScale;
-    const f32 fh = (f32)h * dpiScale;
+    const u32 color = i_command.color;
+    const f32 dpiScale = (f32)i_gdiState->dpiScale;
+    const f32 fx = (f32)i_command.x * dpiScale;
+    const f32 fy = (f32)i_command.y * dpiScale;
+    const f32 fw = (f32)i_command.w * dpiScale;
+    const f32 fh = (f32)i_command.h * dpiScale;
 
     Gdiplus::SolidBrush brush(Gdiplus::Color(BYTE(color & 0xff),
                                              BYTE((color & 0xff000000) >> 24),
                                              BYTE((color & 0xff0000) >> 16),
                                              BYTE((color & 0xff00) >> 8)));
-    gdiState->graphics->FillRectangle(&brush, fx, fy, fw, fh);
-
-    return 0;
+    i_gdiState->graphics->FillRectangle(&brush, fx, fy, fw, fh);
 }
 
 static s32 ScriptingLoadFont(lua_State* i_vm)
@@ -135,26 +103,14 @@ static s32 ScriptingLoadFont(lua_State* i_vm)
     return 1;
 }
 
-static s32 ScriptingDrawText(lua_State* i_vm)
+static void GdiplusDrawText(RNDState* const i_gdiState, const DRWDrawText& i_command)
 {
-    RNDState* const gdiState = (RNDState* const)lua_touserdata(i_vm, lua_upvalueindex(1));
-    gdiapi::Graphics* g = gdiState->graphics;
+    scratch_region_t scratch = scratch_begin(&i_gdiState->arena);
 
-    scratch_region_t scratch = scratch_begin(&gdiState->arena);
-
-    const s32 nArgs = lua_gettop(i_vm);
-    FLORAL_ASSERT(nArgs == 8);
-
-    const s32 fontStyleHandle = (s32)lua_tointeger(i_vm, 1);
-    const s32 x = (s32)lua_tointeger(i_vm, 2);
-    const s32 y = (s32)lua_tointeger(i_vm, 3);
-    const s32 w = (s32)lua_tointeger(i_vm, 4);
-    const s32 h = (s32)lua_tointeger(i_vm, 5);
-    const_cstr str = lua_tostring(i_vm, 6);
-    const size strLen = cstr_length(str);
-    const s32 textAlign = (s32)lua_tointeger(i_vm, 7);
-    const s32 lineAlign = (s32)lua_tointeger(i_vm, 8);
-    const f32 dpiScale = (f32)gdiState->dpiScale;
+    const s32 fontStyleHandle = i_command.fontStyle;
+    const_cstr str = (const_cstr)(&i_command + 1);
+    const s32 strLen = (s32)i_command.textLength;
+    const f32 dpiScale = (f32)i_gdiState->dpiScale;
 
     FLORAL_ASSERT(fontStyleHandle >= 0);
 
@@ -164,12 +120,11 @@ static s32 ScriptingDrawText(lua_State* i_vm)
     tstr[written] = 0;
 
     HTMLText textLine = HTMLParse(tstr, tstrLen, scratch.arena);
-    const gdiapi::Font* font = &gdiState->fontStylesPool[fontStyleHandle];
-    const Gdiplus::RectF textRect((f32)x * dpiScale, (f32)y * dpiScale, (f32)w * dpiScale, (f32)h * dpiScale);
-    DrawHTMLString(gdiState, font, textRect, &textLine, textAlign, lineAlign, scratch.arena);
+    const gdiapi::Font* font = &i_gdiState->fontStylesPool[fontStyleHandle];
+    const Gdiplus::RectF textRect((f32)i_command.x * dpiScale, (f32)i_command.y * dpiScale, (f32)i_command.w * dpiScale, (f32)i_command.h * dpiScale);
+    DrawHTMLString(i_gdiState, font, textRect, &textLine, (s32)i_command.textAlign, (s32)i_command.lineAlign, scratch.arena);
 
     scratch_end(&scratch);
-    return 0;
 }
 
 static s32 ScriptingDebugSetLayoutDraw(lua_State* i_vm)
@@ -178,6 +133,8 @@ static s32 ScriptingDebugSetLayoutDraw(lua_State* i_vm)
     const s32 nArgs = lua_gettop(i_vm);
     FLORAL_ASSERT(nArgs == 1);
     gdiState->debugDrawLayout = (bool)lua_toboolean(i_vm, 1);
+    // the layout boxes are not part of the recorded commands
+    DRWInvalidate();
     return 0;
 }
 
@@ -316,11 +273,8 @@ bool RNDInitialize(RNDState* const io_gdiState, HINSTANCE i_appInstance, HDC i_h
 void RNDBindScriptingAPIs(RNDState* const i_gdiState)
 {
     RNDState& state = *i_gdiState;
-    SCRRegisterFunc(&ScriptingDrawRect, "draw_rect", &state);
-    SCRRegisterFunc(&ScriptingDrawArc, "draw_arc", &state);
-    SCRRegisterFunc(&ScriptingFillRect, "fill_rect", &state);
+    // the draw calls are recorded by the draw commands module and replayed by RNDExecuteCommands
     SCRRegisterFunc(&ScriptingLoadFont, "load_font", &state);
-    SCRRegisterFunc(&ScriptingDrawText, "draw_text", &state);
 
     SCRRegisterFunc(&ScriptingDebugSetLayoutDraw, "debug_set_layout_draw", &state);
 }
@@ -427,3 +381,31 @@ void RNDEndRender(RNDState* const i_gdiState)
     FLORAL_ASSERT(i_gdiState->graphicsReady);
     i_gdiState->graphics->Flush(Gdiplus::FlushIntention::FlushIntentionSync);
 }
+
+void RNDExecuteCommands(RNDState* const i_gdiState, cmdbuff_t* const io_commands)
+{
+    const_voidptr payload = nullptr;
+    const DRWCommandHeader* header = DRWReadCommand(io_commands, &payload);
+    while (header)
+    {
+        switch (header->type)
+        {
+        case DRWCommandType::DrawRect:
+            GdiplusDrawRect(i_gdiState, *(const DRWDrawRect*)payload);
+            break;
+        case DRWCommandType::DrawArc:
+            GdiplusDrawArc(i_gdiState, *(const DRWDrawArc*)payload);
+            break;
+        case DRWCommandType::FillRect:
+            GdiplusFillRect(i_gdiState, *(const DRWFillRect*)payload);
+            break;
+        case DRWCommandType::DrawText:
+            GdiplusDrawText(i_gdiState, *(const DRWDrawText*)payload);
+            break;
+        default:
+            FLORAL_ASSERT(false);
+            break;
+        }
+        header = DRWReadCommand(io_commands, &payload);
+    }
+}
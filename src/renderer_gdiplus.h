@@ -8,6 +8,8 @@
 #include <floral/vector_math.h>
 #include <floral/string_utils.h>
 
+#include "draw_commands.h"
+
 namespace gdiapi
 {
 class Graphics;
@@ -52,3 +54,5 @@ void RNDRefresh(RNDState* i_gdiState, HDC i_hdc, const vec2i& i_resolution, cons
 void RNDCleanUp(RNDState* const i_gdiState);
 bool RNDBeginRender(RNDState* const i_gdiState);
 void RNDEndRender(RNDState* const i_gdiState);
+// replays the recorded draw commands between RNDBeginRender and RNDEndRender
+void RNDExecuteCommands(RNDState* const i_gdiState, cmdbuff_t* const io_commands);
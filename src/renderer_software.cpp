@@ -0,0 +1,572 @@
+#include "renderer_software.h"
+
+#include <floral/log.h>
+#include <floral/misc.h>
+#include <floral/string_utils.h>
+
+#include "html.h"
+#include "scripting.h"
+
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_swrPathPointsCapacity = 8192;
+constexpr u32 k_swrPathContoursCapacity = 512;
+constexpr u32 k_maxArcSegments = 256;
+constexpr f32 k_arcTolerance = 0.1f; // pixels
+
+// 0xRRGGBBAA, as passed from the scripts
+static u32 ToSurfacePixel(const u32 i_color)
+{
+    return RSTPremultiply(i_color);
+}
+
+// the colors parsed from the text markup are 0xBBGGRR
+static u32 ToSurfacePixelFromBGR(const u32 i_color)
+{
+    return 0xff000000 | ((i_color & 0xff) << 16) | (i_color & 0xff00) | ((i_color >> 16) & 0xff);
+}
+
+static void StrokeRect(const RSTSurface& i_surface, const f32 i_x, const f32 i_y, const f32 i_w, const f32 i_h, const f32 i_width,
+                       const u32 i_pixel)
+{
+    // the pen is centered on the edges, as GDI+ does
+    const f32 halfWidth = i_width * 0.5f;
+    RSTFillRect(i_surface, i_x - halfWidth, i_y - halfWidth, i_w + i_width, i_width, i_pixel);
+    RSTFillRect(i_surface, i_x - halfWidth, i_y + i_h - halfWidth, i_w + i_width, i_width, i_pixel);
+    if (i_h > i_width)
+    {
+        RSTFillRect(i_surface, i_x - halfWidth, i_y + halfWidth, i_width, i_h - i_width, i_pixel);
+        RSTFillRect(i_surface, i_x + i_w - halfWidth, i_y + halfWidth, i_width, i_h - i_width, i_pixel);
+    }
+}
+
+// distance from the center to the ellipse along the ray at i_angle
+static f32 GetEllipseRadius(const f32 i_rx, const f32 i_ry, const f32 i_angle)
+{
+    const f32 x = i_ry * mathf_cos(i_angle);
+    const f32 y = i_rx * mathf_sin(i_angle);
+    const f32 length = mathf_sqrt(x * x + y * y);
+    return length > 0.0f ? i_rx * i_ry / length : 0.0f;
+}
+
+static bool StartsWith(const_cstr i_str, const_cstr i_prefix)
+{
+    while (*i_prefix != 0 && *i_str == *i_prefix)
+    {
+        i_str++;
+        i_prefix++;
+    }
+    return *i_prefix == 0;
+}
+
+static u32 FindFontFace(const SWRState& i_state, const_cstr i_family)
+{
+    // the longest face family that starts the requested name ("Segoe UI Variable" for "Segoe UI Variable Display Semib")
+    u32 bestFace = 0;
+    size bestLength = 0;
+    for (u32 i = 0; i < i_state.fontFacesCount; i++)
+    {
+        const_cstr family = i_state.fontFaces[i].familyName;
+        const size length = cstr_length(family);
+        if (length > bestLength && StartsWith(i_family, family))
+        {
+            bestFace = i;
+            bestLength = length;
+        }
+    }
+    return bestFace;
+}
+
+static void ResetGlyphCache(SWRState* const io_state)
+{
+    mem_fill(io_state->glyphKeys, 0, k_glyphCacheCapacity * sizeof(u32));
+    io_state->glyphsCount = 0;
+    arena_reset(&io_state->glyphArena);
+}
+
+static bool RasterizeGlyph(SWRState* const io_state, const SWRFontStyle& i_style, const u32 i_glyph, SWRGlyph* o_glyph)
+{
+    const TTFFont& face = io_state->fontFaces[i_style.face];
+    const f32 scale = i_style.size * io_state->dpiScale / (f32)face.unitsPerEm;
+    s32 advance = 0;
+    s32 leftSideBearing = 0;
+    TTFGetGlyphHorizontalMetrics(face, i_glyph, &advance, &leftSideBearing);
+    o_glyph->advance = (f32)advance * scale;
+    o_glyph->mask = {};
+
+    RSTResetPath(&io_state->path);
+    if (!TTFAppendGlyphOutline(face, i_glyph, scale, vec2f(0.0f, 0.0f), &io_state->path, &io_state->arena))
+    {
+        return true; // malformed, drawn as a blank
+    }
+    if (io_state->path.contoursCount == 0)
+    {
+        return true;
+    }
+    return RSTRasterizePath(io_state->path, &io_state->glyphArena, &o_glyph->mask);
+}
+
+static const SWRGlyph* GetGlyph(SWRState* const io_state, const ssize i_fontStyle, const u32 i_glyph)
+{
+    // 0 is an empty slot
+    const u32 key = (((u32)i_fontStyle << 16) | i_glyph) + 1;
+    u32 slot = (key * 2654435761u) & (k_glyphCacheCapacity - 1);
+    while (io_state->glyphKeys[slot] != 0)
+    {
+        if (io_state->glyphKeys[slot] == key)
+        {
+            return &io_state->glyphs[slot];
+        }
+        slot = (slot + 1) & (k_glyphCacheCapacity - 1);
+    }
+
+    const SWRFontStyle& style = io_state->fontStyles[i_fontStyle];
+    SWRGlyph glyph = {};
+    if (io_state->glyphsCount >= k_glyphCacheCapacity * 3 / 4 || !RasterizeGlyph(io_state, style, i_glyph, &glyph))
+    {
+        // full, the glyphs of the current frame are rasterized again
+        ResetGlyphCache(io_state);
+        if (!RasterizeGlyph(io_state, style, i_glyph, &glyph))
+        {
+            glyph.mask = {};
+        }
+        slot = (key * 2654435761u) & (k_glyphCacheCapacity - 1);
+    }
+
+    io_state->glyphKeys[slot] = key;
+    io_state->glyphs[slot] = glyph;
+    io_state->glyphsCount++;
+    return &io_state->glyphs[slot];
+}
+
+// UTF-8, an invalid or truncated sequence is U+FFFD
+static u32 DecodeUTF8(const c8* i_text, const s32 i_length, s32* io_index)
+{
+    const u32 lead = (u8)i_text[*io_index];
+    (*io_index)++;
+    if (lead < 0x80)
+    {
+        return lead;
+    }
+
+    const s32 trailCount = lead >= 0xf0 ? 3 : (lead >= 0xe0 ? 2 : (lead >= 0xc0 ? 1 : 0));
+    if (trailCount == 0 || lead >= 0xf8 || *io_index + trailCount > i_length)
+    {
+        return 0xfffd;
+    }
+    u32 codepoint = lead & (0x3f >> trailCount);
+    for (s32 i = 0; i < trailCount; i++)
+    {
+        const u32 trail = (u8)i_text[*io_index];
+        if ((trail & 0xc0) != 0x80)
+        {
+            return 0xfffd;
+        }
+        codepoint = (codepoint << 6) | (trail & 0x3f);
+        (*io_index)++;
+    }
+    return codepoint;
+}
+
+#if defined(UNICODE)
+// UTF-16, a surrogate pair is one code point
+static u32 ReadCodepoint(const_tcstr i_text, const s32 i_length, s32* io_index)
+{
+    const u32 unit = (u32)i_text[*io_index];
+    (*io_index)++;
+    if (unit >= 0xd800 && unit < 0xdc00 && *io_index < i_length)
+    {
+        const u32 low = (u32)i_text[*io_index];
+        if (low >= 0xdc00 && low < 0xe000)
+        {
+            (*io_index)++;
+            return 0x10000 + ((unit - 0xd800) << 10) + (low - 0xdc00);
+        }
+    }
+    return unit;
+}
+
+// the UTF-8 of the scripts as UTF-16, o_text has room for i_length units
+static s32 ConvertText(const_cstr i_str, const s32 i_length, tcstr o_text)
+{
+    s32 written = 0;
+    for (s32 i = 0; i < i_length;)
+    {
+        const u32 codepoint = DecodeUTF8(i_str, i_length, &i);
+        if (codepoint >= 0x10000)
+        {
+            o_text[written++] = (tchar)(0xd800 + ((codepoint - 0x10000) >> 10));
+            o_text[written++] = (tchar)(0xdc00 + ((codepoint - 0x10000) & 0x3ff));
+        }
+        else
+        {
+            o_text[written++] = (tchar)codepoint;
+        }
+    }
+    return written;
+}
+#else
+static u32 ReadCodepoint(const_tcstr i_text, const s32 i_length, s32* io_index)
+{
+    return DecodeUTF8(i_text, i_length, io_index);
+}
+
+// tchar is already UTF-8
+static s32 ConvertText(const_cstr i_str, const s32 i_length, tcstr o_text)
+{
+    mem_copy(o_text, i_str, i_length);
+    return i_length;
+}
+#endif
+
+static f32 MeasureText(SWRState* const io_state, const ssize i_fontStyle, const_tcstr i_text, const s32 i_length)
+{
+    const TTFFont& face = io_state->fontFaces[io_state->fontStyles[i_fontStyle].face];
+    f32 width = 0.0f;
+    for (s32 i = 0; i < i_length;)
+    {
+        const u32 codepoint = ReadCodepoint(i_text, i_length, &i);
+        if (codepoint >= 0x20)
+        {
+            width += GetGlyph(io_state, i_fontStyle, TTFGetGlyphIndex(face, codepoint))->advance;
+        }
+    }
+    return width;
+}
+
+static f32 DrawGlyphs(SWRState* const io_state, const ssize i_fontStyle, const_tcstr i_text, const s32 i_length, f32 i_x, const s32 i_baseline,
+                      const u32 i_pixel)
+{
+    const TTFFont& face = io_state->fontFaces[io_state->fontStyles[i_fontStyle].face];
+    for (s32 i = 0; i < i_length;)
+    {
+        const u32 codepoint = ReadCodepoint(i_text, i_length, &i);
+        if (codepoint < 0x20)
+        {
+            continue;
+        }
+        const SWRGlyph* glyph = GetGlyph(io_state, i_fontStyle, TTFGetGlyphIndex(face, codepoint));
+        if (glyph->mask.coverage != nullptr)
+        {
+            RSTBlendMask(io_state->surface, glyph->mask, (s32)mathf_round(i_x), i_baseline, i_pixel);
+        }
+        i_x += glyph->advance;
+    }
+    return i_x;
+}
+
+// ----------------------------------------------------------------------------
+
+static void SoftwareDrawRect(SWRState* const i_swrState, const DRWDrawRect& i_command)
+{
+    const f32 dpiScale = i_swrState->dpiScale;
+    StrokeRect(i_swrState->surface, (f32)i_command.x * dpiScale, (f32)i_command.y * dpiScale, (f32)i_command.w * dpiScale,
+               (f32)i_command.h * dpiScale, i_command.width * dpiScale, ToSurfacePixel(i_command.color));
+}
+
+static void SoftwareDrawArc(SWRState* const i_swrState, const DRWDrawArc& i_command)
+{
+    const f32 x = i_command.x * i_swrState->dpiScale;
+    const f32 y = i_command.y * i_swrState->dpiScale;
+    const f32 w = i_command.w * i_swrState->dpiScale;
+    const f32 h = i_command.h * i_swrState->dpiScale;
+    const f32 width = i_command.width * i_swrState->dpiScale;
+    const f32 halfWidth = width * 0.5f;
+
+    if (i_swrState->debugDrawLayout)
+    {
+        StrokeRect(i_swrState->surface, x, y, w, h, 1.0f, ToSurfacePixel(0xff0000ff));
+    }
+
+    // the pen is centered on the ellipse inscribed in the bounds inset by half the pen, the arc is
+    // filled as the polygon between the outer and the inner edges of the stroke, angles clockwise
+    const vec2f center(x + w * 0.5f, y + h * 0.5f);
+    const f32 rx = (w - width) * 0.5f;
+    const f32 ry = (h - width) * 0.5f;
+    const f32 outerRadius = math_max(rx, ry) + halfWidth;
+    if (rx <= 0.0f || ry <= 0.0f || i_command.sweep == 0.0f)
+    {
+        return;
+    }
+
+    const f32 maxStep = 2.0f * mathf_acos(math_max(1.0f - k_arcTolerance / outerRadius, -1.0f));
+    const f32 startAngle = to_radians(i_command.start);
+    const f32 sweepAngle = to_radians(math_clamp(-360.0f, i_command.sweep, 360.0f));
+    const u32 segmentsCount = math_clamp(1u, (u32)mathf_ceil(mathf_abs(sweepAngle) / math_max(maxStep, 1e-3f)), k_maxArcSegments);
+
+    RSTPath* const path = &i_swrState->path;
+    RSTResetPath(path);
+    for (u32 i = 0; i <= segmentsCount; i++)
+    {
+        const f32 angle = startAngle + sweepAngle * (f32)i / (f32)segmentsCount;
+        const f32 radius = GetEllipseRadius(rx, ry, angle) + halfWidth;
+        RSTAddPoint(path, vec2f(center.x + radius * mathf_cos(angle), center.y + radius * mathf_sin(angle)));
+    }
+    for (u32 i = 0; i <= segmentsCount; i++)
+    {
+        const f32 angle = startAngle + sweepAngle * (f32)(segmentsCount - i) / (f32)segmentsCount;
+        const f32 radius = math_max(GetEllipseRadius(rx, ry, angle) - halfWidth, 0.0f);
+        RSTAddPoint(path, vec2f(center.x + radius * mathf_cos(angle), center.y + radius * mathf_sin(angle)));
+    }
+    RSTCloseContour(path);
+    RSTFillPath(i_swrState->surface, *path, ToSurfacePixel(i_command.color), &i_swrState->arena);
+}
+
+static void SoftwareFillRect(SWRState* const i_swrState, const DRWFillRect& i_command)
+{
+    const f32 dpiScale = i_swrState->dpiScale;
+    RSTFillRect(i_swrState->surface, (f32)i_command.x * dpiScale, (f32)i_command.y * dpiScale, (f32)i_command.w * dpiScale,
+                (f32)i_command.h * dpiScale, ToSurfacePixel(i_command.color));
+}
+
+static s32 ScriptingSoftwareLoadFont(lua_State* i_vm)
+{
+    LOG_SCOPE(font);
+    SWRState* const swrState = (SWRState* const)lua_touserdata(i_vm, lua_upvalueindex(1));
+
+    const s32 nArgs = lua_gettop(i_vm);
+    FLORAL_ASSERT(nArgs == 2);
+    const_cstr fontFamily = lua_tostring(i_vm, 1);
+    const f32 fontSize = (f32)lua_tointeger(i_vm, 2);
+
+    const ssize fontStyleHandle = handle_pool_alloc(&swrState->fontStyleHandlesPool);
+    if (fontStyleHandle < 0)
+    {
+        LOG_ERROR("Out of font styles, cannot load: %s", fontFamily);
+        lua_pushinteger(i_vm, -1);
+        return 1;
+    }
+    const u32 face = FindFontFace(*swrState, fontFamily);
+    swrState->fontStyles[fontStyleHandle] = {
+        .face = face,
+        .size = fontSize
+    };
+
+    LOG_DEBUG("Loaded new font. Family: %s (%s). Size: %.2f (%.2f). Handle: %d", fontFamily, swrState->fontFaces[face].familyName,
+              fontSize, fontSize * swrState->dpiScale, fontStyleHandle);
+    lua_pushinteger(i_vm, fontStyleHandle);
+    return 1;
+}
+
+static void SoftwareDrawText(SWRState* const i_swrState, const DRWDrawText& i_command)
+{
+    const ssize fontStyleHandle = (ssize)i_command.fontStyle;
+    const_cstr str = (const_cstr)(&i_command + 1);
+    const size strLen = i_command.textLength;
+    const s32 textAlign = (s32)i_command.textAlign;
+    const s32 lineAlign = (s32)i_command.lineAlign;
+    const f32 dpiScale = i_swrState->dpiScale;
+
+    if (fontStyleHandle < 0 || !handle_pool_validate(&i_swrState->fontStyleHandlesPool, fontStyleHandle))
+    {
+        return;
+    }
+
+    scratch_region_t scratch = scratch_begin(&i_swrState->arena);
+    // never more units than bytes
+    const tcstr tstr = (tcstr)arena_push_podarr(scratch.arena, tchar, strLen + 1);
+    const s32 written = ConvertText(str, (s32)strLen, tstr);
+    tstr[written] = 0;
+    const s32 tstrLen = written + 1;
+    HTMLText textLine = HTMLParse(tstr, tstrLen, scratch.arena);
+
+    const f32 rectX = (f32)i_command.x * dpiScale;
+    const f32 rectY = (f32)i_command.y * dpiScale;
+    const f32 rectW = (f32)i_command.w * dpiScale;
+    const f32 rectH = (f32)i_command.h * dpiScale;
+    if (i_swrState->debugDrawLayout)
+    {
+        StrokeRect(i_swrState->surface, rectX, rectY, rectW, rectH, 1.0f, ToSurfacePixel(0xff0000ff));
+    }
+
+    // a single line, aligned as a whole in the rect: near (0), center (1) or far (2)
+    const SWRFontStyle& style = i_swrState->fontStyles[fontStyleHandle];
+    const TTFFont& face = i_swrState->fontFaces[style.face];
+    const f32 scale = style.size * dpiScale / (f32)face.unitsPerEm;
+    const f32 lineHeight = (f32)(face.ascent + face.descent) * scale;
+    f32 textWidth = 0.0f;
+    dll_t<HTMLTextPart>::node_t* it = nullptr;
+    dll_for_each(&textLine.parts, it)
+    {
+        textWidth += MeasureText(i_swrState, fontStyleHandle, &textLine.rawData[it->data.startIndex], it->data.length);
+    }
+
+    f32 penX = rectX + (rectW - textWidth) * 0.5f * (f32)textAlign;
+    const f32 top = rectY + (rectH - lineHeight) * 0.5f * (f32)lineAlign;
+    const s32 baseline = (s32)mathf_round(top + (f32)face.ascent * scale);
+    dll_for_each(&textLine.parts, it)
+    {
+        const HTMLTextPart& part = it->data;
+        penX = DrawGlyphs(i_swrState, fontStyleHandle, &textLine.rawData[part.startIndex], part.length, penX, baseline,
+                          ToSurfacePixelFromBGR(part.color));
+    }
+
+    scratch_end(&scratch);
+}
+
+static s32 ScriptingSoftwareDebugSetLayoutDraw(lua_State* i_vm)
+{
+    SWRState* const swrState = (SWRState* const)lua_touserdata(i_vm, lua_upvalueindex(1));
+    const s32 nArgs = lua_gettop(i_vm);
+    FLORAL_ASSERT(nArgs == 1);
+    swrState->debugDrawLayout = (bool)lua_toboolean(i_vm, 1);
+    // the layout boxes are not part of the recorded commands
+    DRWInvalidate();
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+
+static bool AddFontFace(SWRState* const io_swrState, const_voidptr i_data, const size i_size)
+{
+    SWRState& state = *io_swrState;
+    if (state.fontFacesCount == k_maxSoftwareFontFaces)
+    {
+        return false;
+    }
+
+    TTFFont* const face = &state.fontFaces[state.fontFacesCount];
+    if (!TTFLoadFont(i_data, i_size, face))
+    {
+        return false;
+    }
+    LOG_DEBUG("Font face loaded: %s (%d glyphs)", face->familyName, face->glyphsCount);
+    state.fontFacesCount++;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool SWRInitialize(SWRState* const io_swrState, const const_buffer_t* i_fonts, const u32 i_fontsCount,
+                   linear_allocator_t* const i_allocator)
+{
+    LOG_SCOPE(software);
+    SWRState& state = *io_swrState;
+    state.arena = create_arena(i_allocator, SIZE_MB(2));
+    state.glyphArena = create_arena(i_allocator, SIZE_MB(1));
+    arena_t* const arena = &state.arena;
+
+    state.fontStyleHandlesPool = arena_create_handle_pool(arena, ssize, 128);
+    state.fontStyles = arena_create_array(arena, SWRFontStyle, state.fontStyleHandlesPool.capacity);
+    state.fontStyles.size = state.fontStyles.capacity;
+    state.glyphKeys = arena_push_podarr(arena, u32, k_glyphCacheCapacity);
+    state.glyphs = arena_push_podarr(arena, SWRGlyph, k_glyphCacheCapacity);
+    state.path = RSTCreatePath(arena, k_swrPathPointsCapacity, k_swrPathContoursCapacity);
+    state.fontFacesCount = 0;
+    state.dpiScale = 1.0f;
+    ResetGlyphCache(&state);
+
+    for (u32 i = 0; i < i_fontsCount; i++)
+    {
+        if (!AddFontFace(&state, i_fonts[i].addr, i_fonts[i].length))
+        {
+            LOG_ERROR("Failed to read font data (face %d).", i);
+            return false;
+        }
+    }
+
+    state.surface = {};
+    return true;
+}
+
+void SWRBindScriptingAPIs(SWRState* const i_swrState)
+{
+    SWRState& state = *i_swrState;
+    // the draw calls are recorded by the draw commands module and replayed by SWRExecuteCommands
+    SCRRegisterFunc(&ScriptingSoftwareLoadFont, "load_font", &state);
+
+    SCRRegisterFunc(&ScriptingSoftwareDebugSetLayoutDraw, "debug_set_layout_draw", &state);
+}
+
+void SWRDestroyAllResources(SWRState* i_swrState)
+{
+    handle_pool_reset(&i_swrState->fontStyleHandlesPool);
+    ResetGlyphCache(i_swrState);
+}
+
+void SWRRefresh(SWRState* i_swrState, u32* const i_pixels, const s32 i_stride, const vec2i& i_resolution, const f32 i_dpiScale)
+{
+    LOG_SCOPE(software);
+    SWRState& state = *i_swrState;
+
+    if (i_resolution.x <= 0 || i_resolution.y <= 0 || i_pixels == nullptr)
+    {
+        LOG_WARNING("Cannot render into an invalid buffer: %d x %d", i_resolution.x, i_resolution.y);
+        state.surface = {};
+        return;
+    }
+
+    state.surface = {
+        .pixels = i_pixels,
+        .width = i_resolution.x,
+        .height = i_resolution.y,
+        .stride = i_stride
+    };
+    state.resolution = i_resolution;
+    RSTClear(state.surface, 0);
+
+    // the glyphs are rasterized at the pixel size, they are all invalid once the dpi changes
+    if (state.dpiScale != i_dpiScale)
+    {
+        ResetGlyphCache(&state);
+        state.dpiScale = i_dpiScale;
+    }
+
+    LOG_DEBUG("RenderSurface updated. Dimension: %d x %d. DPI Scale: %.2f", i_resolution.x, i_resolution.y, i_dpiScale);
+}
+
+void SWRCleanUp(SWRState* const i_swrState)
+{
+    i_swrState->surface = {};
+}
+
+bool SWRBeginRender(SWRState* const i_swrState)
+{
+    if (i_swrState->surface.pixels == nullptr)
+    {
+        return false;
+    }
+
+    RSTClear(i_swrState->surface, 0);
+
+    if (i_swrState->debugDrawLayout)
+    {
+        StrokeRect(i_swrState->surface, 0.5f, 0.5f, (f32)i_swrState->resolution.x - 1.0f, (f32)i_swrState->resolution.y - 1.0f, 1.0f,
+                   ToSurfacePixel(0x00ff00ff));
+    }
+
+    return true;
+}
+
+void SWREndRender(SWRState* const i_swrState)
+{
+    FLORAL_ASSERT(i_swrState->surface.pixels != nullptr);
+}
+
+void SWRExecuteCommands(SWRState* const i_swrState, cmdbuff_t* const io_commands)
+{
+    const_voidptr payload = nullptr;
+    const DRWCommandHeader* header = DRWReadCommand(io_commands, &payload);
+    while (header)
+    {
+        switch (header->type)
+        {
+        case DRWCommandType::DrawRect:
+            SoftwareDrawRect(i_swrState, *(const DRWDrawRect*)payload);
+            break;
+        case DRWCommandType::DrawArc:
+            SoftwareDrawArc(i_swrState, *(const DRWDrawArc*)payload);
+            break;
+        case DRWCommandType::FillRect:
+            SoftwareFillRect(i_swrState, *(const DRWFillRect*)payload);
+            break;
+        case DRWCommandType::DrawText:
+            SoftwareDrawText(i_swrState, *(const DRWDrawText*)payload);
+            break;
+        default:
+            FLORAL_ASSERT(false);
+            break;
+        }
+        header = DRWReadCommand(io_commands, &payload);
+    }
+}
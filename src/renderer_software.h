@@ -0,0 +1,68 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+#include <floral/memory.h>
+#include <floral/container.h>
+#include <floral/vector_math.h>
+
+#include "draw_commands.h"
+#include "raster.h"
+#include "truetype.h"
+
+// The same scripting APIs as the GDI+ renderer, rasterized on the CPU straight into a 32-bit
+// premultiplied BGRA buffer. It needs neither Win32 nor a device context, so it also renders headless
+// and on Linux (floral/test/renderer_software_bench.cpp).
+
+constexpr u32 k_maxSoftwareFontFaces = 4;
+constexpr u32 k_glyphCacheCapacity = 1024; // power of 2
+
+struct SWRFontStyle
+{
+    u32 face;
+    f32 size; // pixels at 96 dpi
+};
+
+struct SWRGlyph
+{
+    RSTMask mask; // relative to the pen position on the baseline
+    f32 advance;
+};
+
+struct SWRState
+{
+    RSTSurface surface;
+    vec2i resolution;
+    f32 dpiScale;
+
+    TTFFont fontFaces[k_maxSoftwareFontFaces];
+    u32 fontFacesCount;
+    handle_pool_t<ssize> fontStyleHandlesPool;
+    array_t<SWRFontStyle> fontStyles;
+
+    // rasterized glyphs keyed by font style and glyph index, all dropped at once when full
+    u32* glyphKeys;
+    SWRGlyph* glyphs;
+    u32 glyphsCount;
+    arena_t glyphArena;
+
+    RSTPath path;
+
+    // debug
+    bool debugDrawLayout : 1;
+
+    arena_t arena;
+};
+
+// i_fonts are TrueType files, the text face first then the icons face. The bytes are not copied and
+// must outlive the state.
+bool SWRInitialize(SWRState* const io_swrState, const const_buffer_t* i_fonts, const u32 i_fontsCount,
+                   linear_allocator_t* const i_allocator);
+void SWRBindScriptingAPIs(SWRState* const i_swrState);
+void SWRDestroyAllResources(SWRState* i_swrState);
+// i_pixels is the top row, i_stride in pixels is negative for bottom-up buffers
+void SWRRefresh(SWRState* i_swrState, u32* const i_pixels, const s32 i_stride, const vec2i& i_resolution, const f32 i_dpiScale);
+void SWRCleanUp(SWRState* const i_swrState);
+bool SWRBeginRender(SWRState* const i_swrState);
+void SWREndRender(SWRState* const i_swrState);
+// replays the recorded draw commands between SWRBeginRender and SWREndRender
+void SWRExecuteCommands(SWRState* const i_swrState, cmdbuff_t* const io_commands);
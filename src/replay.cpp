@@ -0,0 +1,511 @@
+#include "replay.h"
+
+#include <floral/assert.h>
+#include <floral/log.h>
+#include <floral/misc.h>
+#include <floral/string_utils.h>
+#include <floral/time.h>
+
+static RPLContext s_replayContext;
+
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_replayMagic = 0x5052574d; // 'MWRP'
+// unchanged bytes shorter than this do not end a run of changed ones, a new run costs 2 bytes
+constexpr u32 k_replayMinGap = 3;
+// slot + delta + signal + payload size
+constexpr size k_maxFrameHeaderSize = 1 + 10 + sizeof(f32) + 5;
+
+static_assert(sizeof(RPLFileHeader) == 16, "File header layout changed, bump k_replayVersion");
+static_assert(sizeof(RPLProviderEntry) == 36, "Provider entry layout changed, bump k_replayVersion");
+static_assert(k_maxProviders <= 256, "Frames store their provider on a single byte");
+
+static u64 GetReplayClockMs()
+{
+    return (u64)time_ticks_to_ms(time_get_ticks());
+}
+
+// LEB128
+static size WriteReplayVarint(u8* o_buffer, u64 i_value)
+{
+    size written = 0;
+    while (i_value >= 0x80)
+    {
+        o_buffer[written++] = (u8)(i_value | 0x80);
+        i_value >>= 7;
+    }
+    o_buffer[written++] = (u8)i_value;
+    return written;
+}
+
+static bool ReadReplayVarint(const u8** io_data, const u8* i_end, u64* o_value)
+{
+    u64 value = 0;
+    for (u32 shift = 0; shift < 64; shift += 7)
+    {
+        if (*io_data >= i_end)
+        {
+            return false;
+        }
+        const u8 byte = *(*io_data)++;
+        value |= (u64)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            *o_value = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+
+size RPLGetMaxEncodedSize(const u32 i_recordSize)
+{
+    // at worst, runs of a single changed byte separated by the shortest gaps, each run costing
+    // two varints of at most 5 bytes
+    return i_recordSize + (i_recordSize / (k_replayMinGap + 1) + 1) * 10;
+}
+
+size RPLEncodeRecord(const u8* i_record, u8* io_reference, const u32 i_recordSize, u8* o_buffer)
+{
+    size written = 0;
+    u32 covered = 0; // bytes before this one are either in a previous run or skipped by it
+    u32 i = 0;
+    while (i < i_recordSize)
+    {
+        if (i_record[i] == io_reference[i])
+        {
+            i++;
+            continue;
+        }
+
+        const u32 runStart = i;
+        u32 lastChanged = i;
+        for (i++; i < i_recordSize && i - lastChanged <= k_replayMinGap; i++)
+        {
+            if (i_record[i] != io_reference[i])
+            {
+                lastChanged = i;
+            }
+        }
+        const u32 runEnd = lastChanged + 1;
+
+        written += WriteReplayVarint(o_buffer + written, runStart - covered);
+        written += WriteReplayVarint(o_buffer + written, runEnd - runStart);
+        for (u32 j = runStart; j < runEnd; j++)
+        {
+            o_buffer[written++] = i_record[j] ^ io_reference[j];
+            io_reference[j] = i_record[j];
+        }
+        covered = runEnd;
+        i = runEnd;
+    }
+    return written;
+}
+
+bool RPLDecodeRecord(const u8* i_data, const size i_dataSize, u8* io_record, const u32 i_recordSize)
+{
+    const u8* data = i_data;
+    const u8* const end = i_data + i_dataSize;
+    u64 position = 0;
+    while (data < end)
+    {
+        u64 skipped = 0;
+        u64 changed = 0;
+        if (!ReadReplayVarint(&data, end, &skipped) || !ReadReplayVarint(&data, end, &changed))
+        {
+            return false;
+        }
+        position += skipped;
+        if (position + changed > i_recordSize || changed > (u64)(end - data))
+        {
+            return false;
+        }
+
+        for (u64 j = 0; j < changed; j++)
+        {
+            io_record[position + j] ^= data[j];
+        }
+        data += changed;
+        position += changed;
+    }
+    return true;
+}
+
+bool RPLParseFrame(const u8* i_frames, const size i_framesSize, const size i_offset, const u32 i_slotsCount, RPLFrame* o_frame)
+{
+    const u8* data = i_frames + i_offset;
+    const u8* const end = i_frames + i_framesSize;
+    if (data >= end)
+    {
+        return false;
+    }
+
+    o_frame->slot = *data++;
+    u64 payloadSize = 0;
+    if (o_frame->slot >= i_slotsCount || !ReadReplayVarint(&data, end, &o_frame->deltaMs) || (size)(end - data) < sizeof(f32))
+    {
+        return false;
+    }
+    mem_copy(&o_frame->signal, data, sizeof(f32));
+    data += sizeof(f32);
+    if (!ReadReplayVarint(&data, end, &payloadSize) || payloadSize > (u64)(end - data))
+    {
+        return false;
+    }
+
+    o_frame->payload = data;
+    o_frame->payloadSize = (size)payloadSize;
+    o_frame->nextOffset = (size)(data + payloadSize - i_frames);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+static void FlushRecorder()
+{
+    RPLRecorder* const recorder = &s_replayContext.recorder;
+    if (recorder->bufferUsed > 0)
+    {
+        file_write(recorder->file, recorder->buffer, recorder->bufferUsed);
+        recorder->bytesCount += recorder->bufferUsed;
+        recorder->bufferUsed = 0;
+    }
+}
+
+static bool InitializeRecorder(const tstr& i_fileName)
+{
+    RPLRecorder* const recorder = &s_replayContext.recorder;
+    s_replayContext.fileGroup = create_file_group(s_replayContext.fileSystem, tstr_literal(LITERAL("recordings")));
+    recorder->file = file_wopen(&s_replayContext.fileGroup, i_fileName);
+    if (recorder->file.hasErrors)
+    {
+        return false;
+    }
+
+    const u32 providersCount = PRVGetProvidersCount();
+    size recordsSize = 0;
+    size maxRecordSize = 0;
+    for (u32 i = 0; i < providersCount; i++)
+    {
+        recordsSize += PRVGetProvider(i)->recordSize;
+        maxRecordSize = math_max(maxRecordSize, (size)PRVGetProvider(i)->recordSize);
+    }
+    recorder->maxFrameSize = k_maxFrameHeaderSize + RPLGetMaxEncodedSize((u32)maxRecordSize);
+    s_replayContext.arena = create_arena(s_replayContext.allocator, SIZE_KB(4) + k_replayWriteBufferSize + recorder->maxFrameSize * 2 +
+                                                                   recordsSize + providersCount * 8);
+    recorder->buffer = arena_push_podarr(&s_replayContext.arena, u8, k_replayWriteBufferSize + recorder->maxFrameSize);
+    recorder->encodeBuffer = arena_push_podarr(&s_replayContext.arena, u8, recorder->maxFrameSize);
+    recorder->bufferUsed = 0;
+    recorder->prevMs = 0;
+    recorder->framesCount = 0;
+    recorder->bytesCount = 0;
+
+    // the XOR references start zeroed, so do the records of a replay
+    RPLFileHeader* const header = (RPLFileHeader*)recorder->buffer;
+    header->magic = k_replayMagic;
+    header->version = k_replayVersion;
+    header->providersCount = providersCount;
+    header->reserved = 0;
+    RPLProviderEntry* const entries = (RPLProviderEntry*)(header + 1);
+    for (u32 i = 0; i < providersCount; i++)
+    {
+        const PRVProviderDesc* desc = PRVGetProvider(i);
+        mem_fill(entries[i].name, 0, k_maxReplayNameLength);
+        cstr_xcopy(entries[i].name, k_maxReplayNameLength, desc->name);
+        entries[i].recordSize = desc->recordSize;
+        recorder->prevRecords[i] = arena_push_podarr_aligned(&s_replayContext.arena, u8, desc->recordSize, 8);
+        mem_fill(recorder->prevRecords[i], 0, desc->recordSize);
+    }
+    recorder->bufferUsed = sizeof(RPLFileHeader) + providersCount * sizeof(RPLProviderEntry);
+    FlushRecorder();
+    return true;
+}
+
+void RPLRecord(const u32 i_providerIndex, const u64 i_timestampMs, const u8* i_record, const f32 i_signal)
+{
+    if (s_replayContext.mode != RPLMode::Record)
+    {
+        return;
+    }
+
+    RPLRecorder* const recorder = &s_replayContext.recorder;
+    if (recorder->framesCount == 0)
+    {
+        recorder->prevMs = i_timestampMs;
+    }
+    const u64 deltaMs = i_timestampMs > recorder->prevMs ? i_timestampMs - recorder->prevMs : 0;
+    recorder->prevMs = math_max(recorder->prevMs, i_timestampMs);
+
+    u8* const frame = recorder->buffer + recorder->bufferUsed;
+    size written = 0;
+    frame[written++] = (u8)i_providerIndex;
+    written += WriteReplayVarint(frame + written, deltaMs);
+    mem_copy(frame + written, &i_signal, sizeof(f32));
+    written += sizeof(f32);
+
+    const size payloadSize = RPLEncodeRecord(i_record, recorder->prevRecords[i_providerIndex], PRVGetProvider(i_providerIndex)->recordSize,
+                                             recorder->encodeBuffer);
+    written += WriteReplayVarint(frame + written, payloadSize);
+    mem_copy(frame + written, recorder->encodeBuffer, payloadSize);
+    written += payloadSize;
+
+    recorder->bufferUsed += written;
+    recorder->framesCount++;
+    if (recorder->bufferUsed >= k_replayWriteBufferSize)
+    {
+        FlushRecorder();
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+static void RestartCursor(RPLCursor* const io_cursor, voidptr io_record)
+{
+    io_cursor->offset = 0;
+    io_cursor->clockMs = 0;
+    mem_fill(io_record, 0, io_cursor->recordSize);
+}
+
+// consumes the next frame of the stream, applying it if it is the cursor's provider one
+static bool StepCursor(RPLCursor* const io_cursor, const RPLFrame& i_frame, voidptr io_record)
+{
+    io_cursor->clockMs += i_frame.deltaMs;
+    io_cursor->offset = i_frame.nextOffset;
+    if (i_frame.slot != io_cursor->slot)
+    {
+        return false;
+    }
+
+    RPLDecodeRecord(i_frame.payload, i_frame.payloadSize, (u8*)io_record, io_cursor->recordSize);
+    io_cursor->signal = i_frame.signal;
+    return true;
+}
+
+static f32 ReplayProviderSample(const u32 i_providerIndex, voidptr io_record)
+{
+    RPLCursor* const cursor = &s_replayContext.cursors[i_providerIndex];
+    const u32 slotsCount = s_replayContext.slotsCount;
+    RPLFrame frame;
+
+    if (s_replayContext.mode == RPLMode::ReplayMaxSpeed)
+    {
+        // every recorded provider has frames, a single wrap around always finds one
+        for (u32 wraps = 0; wraps < 2;)
+        {
+            if (!RPLParseFrame(s_replayContext.frames, s_replayContext.framesSize, cursor->offset, slotsCount, &frame))
+            {
+                RestartCursor(cursor, io_record);
+                wraps++;
+                continue;
+            }
+            if (StepCursor(cursor, frame, io_record))
+            {
+                break;
+            }
+        }
+        return cursor->signal;
+    }
+
+    const u64 nowMs = GetReplayClockMs();
+    if (!s_replayContext.started)
+    {
+        s_replayContext.replayStartMs = nowMs;
+        s_replayContext.started = true;
+    }
+
+    // applies all the frames due by now, the record ends up with the latest one
+    const u64 replayMs = nowMs - s_replayContext.replayStartMs;
+    for (;;)
+    {
+        if (!RPLParseFrame(s_replayContext.frames, s_replayContext.framesSize, cursor->offset, slotsCount, &frame))
+        {
+            // wraps around once the whole recording has been played
+            if (replayMs < cursor->loopBaseMs + s_replayContext.durationMs)
+            {
+                break;
+            }
+            cursor->loopBaseMs += s_replayContext.durationMs;
+            RestartCursor(cursor, io_record);
+            continue;
+        }
+        if (cursor->loopBaseMs + cursor->clockMs + frame.deltaMs > replayMs)
+        {
+            break;
+        }
+        StepCursor(cursor, frame, io_record);
+    }
+    return cursor->signal;
+}
+
+// the sampling functions get no context, one per registry index
+template <u32 N>
+static f32 ReplaySample(voidptr io_record, const f32 i_elapsedSecs)
+{
+    MARK_UNUSED(i_elapsedSecs);
+    return ReplayProviderSample(N, io_record);
+}
+
+#define REPLAY_SAMPLERS_4(n) &ReplaySample<n>, &ReplaySample<n + 1>, &ReplaySample<n + 2>, &ReplaySample<n + 3>
+static f32 (*const k_replaySamplers[])(voidptr, const f32) = {
+    REPLAY_SAMPLERS_4(0), REPLAY_SAMPLERS_4(4), REPLAY_SAMPLERS_4(8), REPLAY_SAMPLERS_4(12),
+    REPLAY_SAMPLERS_4(16), REPLAY_SAMPLERS_4(20), REPLAY_SAMPLERS_4(24), REPLAY_SAMPLERS_4(28)
+};
+#undef REPLAY_SAMPLERS_4
+static_assert(array_length(k_replaySamplers) == k_maxProviders, "One replay sampler per provider");
+
+static bool LoadRecording(const tstr& i_fileName)
+{
+    LOG_SCOPE(replay);
+    s_replayContext.fileGroup = file_system_find_all_files(s_replayContext.fileSystem, tstr_literal(LITERAL("recordings")), tstr_literal(k_replayExtension));
+    file_handle_t file = file_ropen(&s_replayContext.fileGroup, i_fileName);
+    if (file.hasErrors)
+    {
+        LOG_ERROR("Cannot open the recording");
+        return false;
+    }
+
+    // the whole recording is kept in memory, the sampling thread never waits for the disk
+    const size fileSize = file_get_size(file);
+    s_replayContext.recordingAllocator = create_linear_allocator("'replay' recording allocator", fileSize + SIZE_KB(16));
+    s_replayContext.arena = create_arena(&s_replayContext.recordingAllocator, fileSize + SIZE_KB(8));
+    const const_buffer_t content = file_read_all(file, &s_replayContext.arena);
+    file_close(&file);
+
+    const RPLFileHeader* header = (const RPLFileHeader*)content.addr;
+    if (content.length < sizeof(RPLFileHeader) || header->magic != k_replayMagic || header->version != k_replayVersion ||
+        header->providersCount > 256 || content.length < sizeof(RPLFileHeader) + header->providersCount * sizeof(RPLProviderEntry))
+    {
+        LOG_ERROR("Not a recording, or from another version");
+        allocator_destroy(&s_replayContext.recordingAllocator);
+        return false;
+    }
+
+    const RPLProviderEntry* entries = (const RPLProviderEntry*)(header + 1);
+    const size tableSize = sizeof(RPLFileHeader) + header->providersCount * sizeof(RPLProviderEntry);
+    s_replayContext.frames = (const u8*)content.addr + tableSize;
+    s_replayContext.slotsCount = header->providersCount;
+
+    // a recording which was not closed properly ends with a torn frame, it stops right before
+    u32 slotFramesCount[256] = {};
+    u32 framesCount = 0;
+    u64 durationMs = 0;
+    size offset = 0;
+    RPLFrame frame;
+    while (RPLParseFrame(s_replayContext.frames, content.length - tableSize, offset, header->providersCount, &frame))
+    {
+        slotFramesCount[frame.slot]++;
+        framesCount++;
+        durationMs += frame.deltaMs;
+        offset = frame.nextOffset;
+    }
+    if (offset < content.length - tableSize)
+    {
+        LOG_WARNING("The recording is truncated, %d bytes dropped", (u32)(content.length - tableSize - offset));
+    }
+    s_replayContext.framesSize = offset;
+    // a last sampling interval past the last frame, and never an empty loop
+    s_replayContext.durationMs = durationMs + math_max(durationMs / math_max(framesCount, 1u), (u64)1);
+
+    const bool maxSpeed = s_replayContext.mode == RPLMode::ReplayMaxSpeed;
+    u32 replayedCount = 0;
+    for (u32 i = 0; i < PRVGetProvidersCount(); i++)
+    {
+        const PRVProviderDesc* desc = PRVGetProvider(i);
+        u32 slot = 0;
+        while (slot < header->providersCount && cstr_compare(entries[slot].name, desc->name) != 0)
+        {
+            slot++;
+        }
+
+        if (slot == header->providersCount || entries[slot].recordSize != desc->recordSize || slotFramesCount[slot] == 0)
+        {
+            // nothing to replay, the live provider must not be sampled either
+            LOG_WARNING("'%s' is not in the recording, or with another record, it is disabled", desc->name);
+            PRVOverride(i, desc, false);
+            continue;
+        }
+
+        PRVProviderDesc* replayDesc = &s_replayContext.descs[i];
+        *replayDesc = *desc;
+        replayDesc->initialize = nullptr;
+        replayDesc->cleanUp = nullptr;
+        replayDesc->sample = k_replaySamplers[i];
+        if (maxSpeed)
+        {
+            // as often as the sampler's wheel allows, no adaptation
+            replayDesc->intervalMs = 1;
+            replayDesc->minIntervalMs = 1;
+            replayDesc->maxIntervalMs = 1;
+        }
+        PRVOverride(i, replayDesc, true);
+
+        RPLCursor* const cursor = &s_replayContext.cursors[i];
+        cursor->slot = slot;
+        cursor->recordSize = desc->recordSize;
+        cursor->offset = 0;
+        cursor->clockMs = 0;
+        cursor->loopBaseMs = 0;
+        cursor->signal = 0.0f;
+        replayedCount++;
+    }
+
+    s_replayContext.started = false;
+    LOG_DEBUG("Replaying %d frames of %d providers, %d ms per loop", framesCount, replayedCount, (u32)s_replayContext.durationMs);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+void RPLInitialize(linear_allocator_t* const i_allocator, file_system_t* const i_fileSystem, const RPLMode i_mode, const tstr& i_fileName)
+{
+    LOG_SCOPE(replay);
+    s_replayContext.fileSystem = i_fileSystem;
+    s_replayContext.allocator = i_allocator;
+    s_replayContext.mode = i_mode;
+    s_replayContext.ready = true;
+    if (i_mode == RPLMode::Off)
+    {
+        return;
+    }
+
+    // the replays only find the recordings with the extension, the recorder appends it as well
+    scratch_region_t scratch = scratch_begin(&i_fileSystem->arena);
+    const tstr fileName = tstr_printf(scratch.arena, LITERAL("%s.%s"), i_fileName.data, k_replayExtension);
+    if (i_mode == RPLMode::Record && !InitializeRecorder(fileName))
+    {
+        LOG_ERROR("Cannot create the recording, the samples will not be recorded");
+        s_replayContext.mode = RPLMode::Off;
+    }
+    else if ((i_mode == RPLMode::Replay || i_mode == RPLMode::ReplayMaxSpeed) && !LoadRecording(fileName))
+    {
+        LOG_ERROR("Cannot replay the recording, using the live providers");
+        s_replayContext.mode = RPLMode::Off;
+    }
+    scratch_end(&scratch);
+}
+
+void RPLCleanUp()
+{
+    LOG_SCOPE(replay);
+    FLORAL_ASSERT(s_replayContext.ready);
+    if (s_replayContext.mode == RPLMode::Record)
+    {
+        FlushRecorder();
+        file_flush(s_replayContext.recorder.file);
+        file_close(&s_replayContext.recorder.file);
+        LOG_DEBUG("Recorded %d frames, %d bytes", (u32)s_replayContext.recorder.framesCount, (u32)s_replayContext.recorder.bytesCount);
+    }
+    else if (RPLIsReplaying())
+    {
+        allocator_destroy(&s_replayContext.recordingAllocator);
+    }
+    s_replayContext.mode = RPLMode::Off;
+    s_replayContext.ready = false;
+}
+
+bool RPLIsReplaying()
+{
+    return s_replayContext.mode == RPLMode::Replay || s_replayContext.mode == RPLMode::ReplayMaxSpeed;
+}
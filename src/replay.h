@@ -0,0 +1,128 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+#include <floral/memory.h>
+#include <floral/file_system.h>
+
+#include "provider.h"
+
+// Recording of the providers' samples, and their replay in place of the hardware so the whole update
+// pipeline (history, aggregators, scripts, rendering) can be profiled the same way on any machine.
+// A recording starts with the registered providers' names and record sizes, then has one frame per
+// sample, in sampling order: the record is XOR-ed with the previous one of its provider and only the
+// runs of changed bytes are stored, most fields do not move from one sample to the next.
+// When replaying, the providers found in the recording are swapped for replay ones, which return
+// the recorded records either at the pace they were sampled or one per sampler tick, and loop.
+
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_replayVersion = 1;
+static const_tcstr k_replayExtension = LITERAL("mwr");
+constexpr u32 k_maxReplayNameLength = 32;
+constexpr size k_replayWriteBufferSize = SIZE_KB(64);
+
+enum class RPLMode : u8
+{
+    Off = 0,
+    Record,
+    Replay,        // at the recorded pace
+    ReplayMaxSpeed // a sample per provider on each tick of the sampler, ignoring the recorded pace
+};
+
+struct RPLFileHeader
+{
+    u32 magic;
+    u32 version;
+    u32 providersCount;
+    u32 reserved;
+};
+
+// follows the file header, one per registered provider, a frame refers to its provider by the
+// index in this table
+struct RPLProviderEntry
+{
+    c8 name[k_maxReplayNameLength];
+    u32 recordSize;
+};
+
+// a frame as parsed from the stream
+struct RPLFrame
+{
+    u32 slot;
+    u64 deltaMs; // since the previous frame, of any provider
+    f32 signal;  // the sample's one, so the sampler adapts its rate the way it did
+    const u8* payload;
+    size payloadSize;
+    size nextOffset;
+};
+
+// owned by the sampling thread while recording
+struct RPLRecorder
+{
+    file_handle_t file;
+    p8 buffer;
+    size bufferUsed;
+    p8 encodeBuffer;
+    size maxFrameSize;
+    p8 prevRecords[k_maxProviders]; // the last recorded record of each provider, the XOR reference
+    u64 prevMs;
+    u64 framesCount;
+    u64 bytesCount;
+};
+
+// replays one recorded provider, owned by the sampling thread once started
+struct RPLCursor
+{
+    u32 slot;       // in the recording's providers
+    u32 recordSize;
+    size offset;    // next frame to look at, in the frames stream
+    u64 clockMs;    // time of the frame before 'offset', relative to the recording's start
+    u64 loopBaseMs; // replay time at which the current loop started
+    f32 signal;     // of the last applied frame
+};
+
+struct RPLContext
+{
+    RPLMode mode;
+    file_system_t* fileSystem;
+    linear_allocator_t* allocator;
+    file_group_t fileGroup;
+
+    RPLRecorder recorder;
+
+    // the frames stream, after the providers' table
+    linear_allocator_t recordingAllocator; // sized for the recording
+    const u8* frames;
+    size framesSize;
+    u32 slotsCount;
+    u64 durationMs;
+    u64 replayStartMs;
+    bool started;
+    PRVProviderDesc descs[k_maxProviders]; // the replay providers, by registry index
+    RPLCursor cursors[k_maxProviders];     // by registry index
+
+    arena_t arena;
+    bool ready;
+};
+
+// ----------------------------------------------------------------------------
+
+// the recording is 'recordings/<i_fileName>.mwr', must come after PRVRegisterBuiltinProviders() and
+// before PRVInitialize(): the replay swaps the providers before they are initialized, the hardware is
+// then never touched
+void RPLInitialize(linear_allocator_t* const i_allocator, file_system_t* const i_fileSystem, const RPLMode i_mode, const tstr& i_fileName);
+void RPLCleanUp();
+// false as well when the recording could not be loaded, the live providers are then used
+bool RPLIsReplaying();
+
+// sampling thread only, right after the provider's sample
+void RPLRecord(const u32 i_providerIndex, const u64 i_timestampMs, const u8* i_record, const f32 i_signal);
+
+// frame codec, independent of the files so it can be fed synthetic records. Encodes i_record against
+// io_reference (updated to i_record), o_buffer needs RPLGetMaxEncodedSize() bytes, returns the size
+size RPLGetMaxEncodedSize(const u32 i_recordSize);
+size RPLEncodeRecord(const u8* i_record, u8* io_reference, const u32 i_recordSize, u8* o_buffer);
+// o_frame is only valid when returning true, false for a torn or malformed frame
+bool RPLParseFrame(const u8* i_frames, const size i_framesSize, const size i_offset, const u32 i_slotsCount, RPLFrame* o_frame);
+// applies an encoded record onto io_record, holding the previous one, false if it is malformed
+bool RPLDecodeRecord(const u8* i_data, const size i_dataSize, u8* io_record, const u32 i_recordSize);
@@ -0,0 +1,221 @@
+#include "rollup.h"
+
+#include <floral/assert.h>
+#include <floral/atomic.h>
+#include <floral/log.h>
+#include <floral/misc.h>
+
+#include "scripting.h"
+
+static RLPContext s_rollupContext;
+
+// ----------------------------------------------------------------------------
+
+static_assert(k_rollupCapacity[0] == k_historyCapacity, "Tier 0 is the history");
+static_assert((k_rollupCapacity[1] & (k_rollupCapacity[1] - 1)) == 0 && (k_rollupCapacity[2] & (k_rollupCapacity[2] - 1)) == 0,
+              "Rollup capacities must be powers of 2");
+
+// the slot after the newest bucket may be in the middle of being rewritten, it is never read
+static u32 GetReadableBucketsCount(const u32 i_tier)
+{
+    return k_rollupCapacity[i_tier] - 1;
+}
+
+static u64 GetBucketEndMs(const RLPBucket& i_bucket, const u32 i_tier)
+{
+    return i_bucket.startMs + math_max(k_rollupBucketMs[i_tier], (u64)1);
+}
+
+// ----------------------------------------------------------------------------
+
+// the rollup views are the history views over the buckets of a tier: 'view[i]' is the mean of the
+// i-th bucket, plus the bucket() and resolution() methods
+static bool ReadRollupViewBucket(const HSTView& i_view, const u32 i_index, u64* o_startMs, u64* o_endMs, f64* o_value)
+{
+    RLPBucket bucket;
+    if (!RLPReadBucket(i_view.series, i_view.tier, i_view.window, i_index, &bucket))
+    {
+        return false;
+    }
+    *o_startMs = bucket.startMs;
+    *o_endMs = GetBucketEndMs(bucket, i_view.tier);
+    *o_value = bucket.sum / bucket.count;
+    return true;
+}
+
+static const HSTViewSource k_rollupViewSource = { "rollup", "rollup_view", &ReadRollupViewBucket };
+
+// view:bucket(i), min, max, mean, count and last of the i-th bucket
+static s32 ScriptingRollupViewBucket(lua_State* i_vm)
+{
+    const HSTView* view = HSTCheckView(i_vm, &k_rollupViewSource, 1);
+    const s32 index = (s32)luaL_checkinteger(i_vm, 2);
+    RLPBucket bucket;
+    if (index < 1 || (u32)index > view->window.length || !RLPReadBucket(view->series, view->tier, view->window, (u32)index - 1, &bucket))
+    {
+        lua_pushnil(i_vm);
+        return 1;
+    }
+
+    lua_pushnumber(i_vm, bucket.minValue);
+    lua_pushnumber(i_vm, bucket.maxValue);
+    lua_pushnumber(i_vm, bucket.sum / bucket.count);
+    lua_pushinteger(i_vm, (lua_Integer)bucket.count);
+    lua_pushnumber(i_vm, bucket.lastValue);
+    return 5;
+}
+
+// view:resolution(), the size of the buckets in ms, 0 for the raw samples
+static s32 ScriptingRollupViewResolution(lua_State* i_vm)
+{
+    const HSTView* view = HSTCheckView(i_vm, &k_rollupViewSource, 1);
+    lua_pushnumber(i_vm, (lua_Number)k_rollupBucketMs[view->tier]);
+    return 1;
+}
+
+// get_rollup(name, resolutionMs), a view over the buckets of the coarsest tier not coarser than
+// the resolution, nil when there is no such series
+static s32 ScriptingGetRollup(lua_State* i_vm)
+{
+    const HSTSeries* series = HSTFindSeries(luaL_checkstring(i_vm, 1));
+    const lua_Number resolutionMs = luaL_checknumber(i_vm, 2);
+    if (series == nullptr)
+    {
+        lua_pushnil(i_vm);
+        return 1;
+    }
+
+    const u32 seriesIndex = (u32)(series - HSTGetSeries(0));
+    const u32 tier = RLPSelectTier(resolutionMs > 0 ? (u64)resolutionMs : 0);
+    HSTPushView(i_vm, &k_rollupViewSource, seriesIndex, tier, RLPGetWindowAll(seriesIndex, tier));
+    return 1;
+}
+
+// ----------------------------------------------------------------------------
+
+void RLPInitialize(linear_allocator_t* const i_allocator)
+{
+    LOG_SCOPE(rollup);
+
+    size seriesSize = 0;
+    for (u32 i = 1; i < k_rollupTiersCount; i++)
+    {
+        seriesSize += k_rollupCapacity[i] * sizeof(RLPBucket);
+    }
+
+    const u32 seriesCount = HSTGetSeriesCount();
+    s_rollupContext.arena = create_arena(i_allocator, SIZE_KB(4) + seriesCount * seriesSize);
+    for (u32 i = 0; i < seriesCount; i++)
+    {
+        RLPSeries* series = &s_rollupContext.series[i];
+        series->tiers[0] = {};
+        for (u32 j = 1; j < k_rollupTiersCount; j++)
+        {
+            RLPTier* tier = &series->tiers[j];
+            tier->buckets = arena_push_podarr(&s_rollupContext.arena, RLPBucket, k_rollupCapacity[j]);
+            tier->count = 0;
+            tier->open.count = 0;
+        }
+    }
+
+    s_rollupContext.ready = true;
+    LOG_DEBUG("%d series, %d tiers", seriesCount, k_rollupTiersCount);
+}
+
+void RLPCleanUp()
+{
+    FLORAL_ASSERT(s_rollupContext.ready);
+    s_rollupContext.ready = false;
+}
+
+void RLPBindScriptingAPIs()
+{
+    lua_State* vm = SCRGetContext()->vm;
+    SCRStackGuard guard(vm);
+
+    static const luaL_Reg k_rollupViewMethods[] = {
+        { "bucket", &ScriptingRollupViewBucket },
+        { "resolution", &ScriptingRollupViewResolution },
+        { nullptr, nullptr }
+    };
+    HSTBindViewMetatable(vm, &k_rollupViewSource, k_rollupViewMethods);
+
+    SCRRegisterFunc(&ScriptingGetRollup, "get_rollup", nullptr);
+}
+
+void RLPAppend(const u32 i_providerIndex)
+{
+    u32 firstSeries = 0;
+    u32 seriesCount = 0;
+    HSTGetProviderSeries(i_providerIndex, &firstSeries, &seriesCount);
+    for (u32 i = firstSeries; i < firstSeries + seriesCount; i++)
+    {
+        const HSTSeries* series = HSTGetSeries(i);
+        RLPBucket sample;
+        if (!RLPReadBucket(i, 0, HSTGetWindowLast(series, 1), 0, &sample))
+        {
+            continue;
+        }
+        RLPFeedTier(&s_rollupContext.series[i], 1, sample);
+    }
+}
+
+u32 RLPSelectTier(const u64 i_resolutionMs)
+{
+    u32 tier = 0;
+    while (tier + 1 < k_rollupTiersCount && k_rollupBucketMs[tier + 1] <= i_resolutionMs)
+    {
+        tier++;
+    }
+    return tier;
+}
+
+HSTWindow RLPGetWindowAll(const u32 i_series, const u32 i_tier)
+{
+    if (i_tier == 0)
+    {
+        return HSTGetWindowAll(HSTGetSeries(i_series));
+    }
+
+    const u32 count = s_rollupContext.series[i_series].tiers[i_tier].count;
+    const u32 readableCount = GetReadableBucketsCount(i_tier);
+    return { count, math_min(count, readableCount) };
+}
+
+HSTWindow RLPGetWindowSince(const u32 i_series, const u32 i_tier, const u64 i_sinceMs)
+{
+    const HSTView view = { &k_rollupViewSource, i_series, i_tier, RLPGetWindowAll(i_series, i_tier) };
+    return HSTNarrowViewWindow(view, i_sinceMs);
+}
+
+bool RLPReadBucket(const u32 i_series, const u32 i_tier, const HSTWindow& i_window, const u32 i_index, RLPBucket* o_bucket)
+{
+    FLORAL_ASSERT(i_index < i_window.length);
+    if (i_tier == 0)
+    {
+        u64 timestampMs = 0;
+        f64 value = 0.0;
+        if (!HSTReadSample(HSTGetSeries(i_series), i_window, i_index, &timestampMs, &value))
+        {
+            return false;
+        }
+        RLPBucketReset(o_bucket, timestampMs);
+        RLPBucketAdd(o_bucket, value);
+        return true;
+    }
+
+    const RLPTier* tier = &s_rollupContext.series[i_series].tiers[i_tier];
+    const u32 bucketIndex = i_window.end - i_window.length + i_index;
+    // volatile so it is not moved after the check below
+    const ATOMIC_TYPE(RLPBucket)* bucket = &tier->buckets[bucketIndex & (k_rollupCapacity[i_tier] - 1)];
+    o_bucket->startMs = bucket->startMs;
+    o_bucket->sum = bucket->sum;
+    o_bucket->minValue = bucket->minValue;
+    o_bucket->maxValue = bucket->maxValue;
+    o_bucket->lastValue = bucket->lastValue;
+    o_bucket->count = bucket->count;
+
+    // checked after the read: if the writer had not reached the slot yet by then, what was read is
+    // the bucket we were looking for
+    return tier->count - bucketIndex <= GetReadableBucketsCount(i_tier);
+}
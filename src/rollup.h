@@ -0,0 +1,75 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+#include <floral/memory.h>
+
+#include "history.h"
+
+// Coarser versions of the history series for long charts: each tier sums the samples of fixed-size
+// time buckets (min, max, mean, count and last), the 1 min buckets are fed by the samples and the
+// 1 h buckets by the closed 1 min ones, nothing is ever rescanned. The raw history is tier 0.
+// Like the history, the closed buckets of a tier are a ring filled by the sampling thread and read
+// without any lock, the bucket still being filled is not visible.
+
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_rollupTiersCount = 3; // including the raw history
+constexpr u64 k_rollupBucketMs[k_rollupTiersCount] = { 0, 60 * 1000, 60 * 60 * 1000 };
+constexpr u32 k_rollupCapacity[k_rollupTiersCount] = { k_historyCapacity, 1024, 512 }; // must be powers of 2
+
+struct RLPBucket
+{
+    u64 startMs; // same clock as the history, aligned on the tier's bucket size
+    f64 sum;
+    f64 minValue;
+    f64 maxValue;
+    f64 lastValue;
+    u32 count; // samples, 0 for an empty bucket
+};
+
+struct RLPTier
+{
+    RLPBucket* buckets;
+    ATOMIC_TYPE(u32) count; // buckets ever closed
+    RLPBucket open;
+};
+
+struct RLPSeries
+{
+    RLPTier tiers[k_rollupTiersCount]; // tiers[0] is unused, the raw samples are in the history
+};
+
+struct RLPContext
+{
+    RLPSeries series[k_maxHistorySeries]; // same indices as the history series
+
+    arena_t arena;
+    bool ready;
+};
+
+// ----------------------------------------------------------------------------
+
+// must come after HSTInitialize()
+void RLPInitialize(linear_allocator_t* const i_allocator);
+void RLPCleanUp();
+void RLPBindScriptingAPIs();
+
+// sampling thread only, right after HSTAppend()
+void RLPAppend(const u32 i_providerIndex);
+
+// the coarsest tier whose buckets are not larger than i_resolutionMs
+u32 RLPSelectTier(const u64 i_resolutionMs);
+// windows over the closed buckets of a tier, same semantics as the history ones
+HSTWindow RLPGetWindowAll(const u32 i_series, const u32 i_tier);
+HSTWindow RLPGetWindowSince(const u32 i_series, const u32 i_tier, const u64 i_sinceMs);
+// i_index is 0 for the oldest bucket of the window, false if it has been overwritten since. Raw
+// samples are returned as buckets of a single sample starting at their timestamp
+bool RLPReadBucket(const u32 i_series, const u32 i_tier, const HSTWindow& i_window, const u32 i_index, RLPBucket* o_bucket);
+
+// the tiers of a single series, independent of the history so they can be fed synthetic streams
+// (rollup_bucket.cpp). Folds i_bucket (a raw sample or a closed bucket of the tier below) into the
+// open bucket of the tier, which is closed first when i_bucket starts another one
+void RLPFeedTier(RLPSeries* const io_series, const u32 i_tier, const RLPBucket& i_bucket);
+void RLPBucketReset(RLPBucket* const o_bucket, const u64 i_startMs);
+void RLPBucketAdd(RLPBucket* const io_bucket, const f64 i_value);
+void RLPBucketMerge(RLPBucket* const io_bucket, const RLPBucket& i_other);
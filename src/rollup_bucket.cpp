@@ -0,0 +1,77 @@
+#include "rollup.h"
+
+#include <floral/atomic.h>
+#include <floral/misc.h>
+
+// The buckets and the tiers of a series alone, without the history nor the scripts: RLPAppend()
+// feeds them the samples, the tests synthetic streams
+
+// ----------------------------------------------------------------------------
+
+static void CloseBucket(RLPSeries* const io_series, const u32 i_tier);
+
+void RLPFeedTier(RLPSeries* const io_series, const u32 i_tier, const RLPBucket& i_bucket)
+{
+    RLPTier* tier = &io_series->tiers[i_tier];
+    const u64 startMs = i_bucket.startMs - i_bucket.startMs % k_rollupBucketMs[i_tier];
+    if (tier->open.count > 0 && tier->open.startMs != startMs)
+    {
+        CloseBucket(io_series, i_tier);
+    }
+    if (tier->open.count == 0)
+    {
+        RLPBucketReset(&tier->open, startMs);
+    }
+    RLPBucketMerge(&tier->open, i_bucket);
+}
+
+static void CloseBucket(RLPSeries* const io_series, const u32 i_tier)
+{
+    RLPTier* tier = &io_series->tiers[i_tier];
+    const u32 count = tier->count;
+    tier->buckets[count & (k_rollupCapacity[i_tier] - 1)] = tier->open;
+    // the slot has to be written before the reader can see it
+    interlocked_exchange(&tier->count, count + 1);
+
+    if (i_tier + 1 < k_rollupTiersCount)
+    {
+        RLPFeedTier(io_series, i_tier + 1, tier->open);
+    }
+    tier->open.count = 0;
+}
+
+// ----------------------------------------------------------------------------
+
+void RLPBucketReset(RLPBucket* const o_bucket, const u64 i_startMs)
+{
+    o_bucket->startMs = i_startMs;
+    o_bucket->sum = 0.0;
+    o_bucket->minValue = 0.0;
+    o_bucket->maxValue = 0.0;
+    o_bucket->lastValue = 0.0;
+    o_bucket->count = 0;
+}
+
+void RLPBucketAdd(RLPBucket* const io_bucket, const f64 i_value)
+{
+    io_bucket->minValue = io_bucket->count == 0 ? i_value : math_min(io_bucket->minValue, i_value);
+    io_bucket->maxValue = io_bucket->count == 0 ? i_value : math_max(io_bucket->maxValue, i_value);
+    io_bucket->sum += i_value;
+    io_bucket->lastValue = i_value;
+    io_bucket->count++;
+}
+
+// i_other must come after what io_bucket already holds, for 'last'
+void RLPBucketMerge(RLPBucket* const io_bucket, const RLPBucket& i_other)
+{
+    if (i_other.count == 0)
+    {
+        return;
+    }
+
+    io_bucket->minValue = io_bucket->count == 0 ? i_other.minValue : math_min(io_bucket->minValue, i_other.minValue);
+    io_bucket->maxValue = io_bucket->count == 0 ? i_other.maxValue : math_max(io_bucket->maxValue, i_other.maxValue);
+    io_bucket->sum += i_other.sum;
+    io_bucket->lastValue = i_other.lastValue;
+    io_bucket->count += i_other.count;
+}
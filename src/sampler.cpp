@@ -0,0 +1,280 @@
+#include "sampler.h"
+
+#include <floral/assert.h>
+#include <floral/atomic.h>
+#include <floral/log.h>
+#include <floral/misc.h>
+#include <floral/time.h>
+#include <floral/thread_context.h>
+
+#include "aggregator.h"
+#include "archive.h"
+#include "history.h"
+#include "publication.h"
+#include "replay.h"
+#include "rollup.h"
+#include "stream.h"
+
+
+static SMPContext s_samplerContext;
+
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_wheelResolutionMs = 10;
+constexpr u32 k_maxSamplerTimers = 32;
+// set on 'sharedIndex' when it holds a snapshot the reader has not seen yet
+constexpr u32 k_snapshotDirtyBit = 0x4;
+constexpr u32 k_snapshotIndexMask = 0x3;
+
+constexpr f32 k_volatilityEwmaAlpha = 0.3f;
+// below this fraction of the threshold a signal is considered flat and its task backs off
+constexpr f32 k_flatThresholdRatio = 0.25f;
+
+// ----------------------------------------------------------------------------
+
+static u64 GetTimeMs()
+{
+    return (u64)time_ticks_to_ms(time_get_ticks());
+}
+
+static void AdaptInterval(SMPTask* const io_task)
+{
+    const f32 value = io_task->signal;
+    if (io_task->samplesCount == 0)
+    {
+        io_task->mean = value;
+        io_task->variance = 0.0f;
+        io_task->prevSignal = value;
+        io_task->samplesCount++;
+        return;
+    }
+
+    // exponentially weighted mean and variance, recent samples matter the most
+    const f32 diff = value - io_task->mean;
+    io_task->mean += k_volatilityEwmaAlpha * diff;
+    io_task->variance = (1.0f - k_volatilityEwmaAlpha) * (io_task->variance + k_volatilityEwmaAlpha * diff * diff);
+    const f32 rateOfChange = mathf_abs(value - io_task->prevSignal);
+    const f32 stdDev = mathf_sqrt(io_task->variance);
+    io_task->prevSignal = value;
+    io_task->samplesCount++;
+
+    const f32 flatThreshold = io_task->threshold * k_flatThresholdRatio;
+    if (rateOfChange > io_task->threshold || stdDev > io_task->threshold)
+    {
+        const u32 intervalMs = math_max(io_task->intervalMs / 2, io_task->minIntervalMs);
+        if (intervalMs != io_task->intervalMs)
+        {
+            // a new period only applies after the next expiry, pull that one in as well so the
+            // spike is followed right away
+            io_task->intervalMs = intervalMs;
+            timer_wheel_set_period(&s_samplerContext.wheel, io_task->timer, intervalMs);
+            timer_wheel_reschedule(&s_samplerContext.wheel, io_task->timer, intervalMs);
+        }
+    }
+    else if (rateOfChange < flatThreshold && stdDev < flatThreshold)
+    {
+        const u32 intervalMs = math_min(io_task->intervalMs * 2, io_task->maxIntervalMs);
+        if (intervalMs != io_task->intervalMs)
+        {
+            io_task->intervalMs = intervalMs;
+            timer_wheel_set_period(&s_samplerContext.wheel, io_task->timer, intervalMs);
+        }
+    }
+}
+
+static void OnSampleTimer(timer_wheel_t* const i_wheel, const timer_handle_t i_handle, const u64 i_deadlineMs, voidptr i_data)
+{
+    MARK_UNUSED(i_wheel);
+    MARK_UNUSED(i_handle);
+    SMPTask* const task = (SMPTask*)i_data;
+
+    // the first sample has no previous one to compute rates against
+    const f32 elapsedSecs = task->lastSampleMs > 0 && i_deadlineMs > task->lastSampleMs ? (f32)(i_deadlineMs - task->lastSampleMs) / 1000.0f : 0.0f;
+    u8* const record = s_samplerContext.workingRecords + task->recordOffset;
+    task->signal = task->provider->sample(record, elapsedSecs);
+    RPLRecord(task->providerIndex, i_deadlineMs, record, task->signal);
+    HSTAppend(task->providerIndex, i_deadlineMs, record);
+    RLPAppend(task->providerIndex);
+    AGGAppend(task->providerIndex);
+    ARCAppend(task->providerIndex);
+    PUBAppend(task->providerIndex);
+    AdaptInterval(task);
+    task->lastSampleMs = i_deadlineMs;
+}
+
+static void PublishSnapshot()
+{
+    SMPSnapshot* const snapshot = &s_samplerContext.snapshots[s_samplerContext.backIndex];
+    snapshot->timestamp = time_get_ticks();
+    snapshot->sequence = ++s_samplerContext.sequence;
+    mem_copy(snapshot->records, s_samplerContext.workingRecords, s_samplerContext.recordsSize);
+
+    // hand the freshly written buffer over, take back whichever one was waiting in the middle
+    const u32 prevShared = interlocked_exchange(&s_samplerContext.sharedIndex, s_samplerContext.backIndex | k_snapshotDirtyBit);
+    s_samplerContext.backIndex = prevShared & k_snapshotIndexMask;
+}
+
+static void SMPThreadFunc(voidptr i_data)
+{
+    SMPContext* const ctx = (SMPContext*)i_data;
+
+    linear_allocator_t masterAllocator = create_linear_allocator("'sampler' master allocator", SIZE_MB(2));
+
+    thread_context_t threadContext = {
+        .allocator = create_linear_allocator(&masterAllocator, "sampler thread context allocator", SIZE_MB(1))
+    };
+    thread_set_context(&threadContext);
+
+    log_context_t logCtx = create_log_context("sampler", log_level_e::verbose, &masterAllocator);
+    log_set_context(&logCtx);
+
+    windows_logger_t windowsLogger = create_windows_logger(log_level_e::verbose);
+    log_context_add_logger(&logCtx, &windows_logger_log_message_cstr, &windows_logger_log_message_wcstr, &windowsLogger);
+
+    LOG_SCOPE(sampler);
+    LOG_DEBUG("Sampling thread started");
+
+    const timer_wheel_desc_t wheelDesc = {
+        .maxTimers = k_maxSamplerTimers,
+        .resolutionMs = k_wheelResolutionMs
+    };
+    const size wheelMemSize = calculate_memory_size_for_timer_wheel(wheelDesc);
+    initialize_timer_wheel(&ctx->wheel, wheelDesc, GetTimeMs(), arena_push(&ctx->arena, wheelMemSize), wheelMemSize);
+
+    for (u32 i = 0; i < ctx->tasksCount; i++)
+    {
+        SMPTask* const task = &ctx->tasks[i];
+        // first sample as soon as possible so the widget does not start with empty values
+        task->timer = timer_wheel_schedule(&ctx->wheel, 0, task->intervalMs, &OnSampleTimer, task);
+        FLORAL_ASSERT(task->timer != k_invalidTimerHandle);
+    }
+
+    bool terminate = false;
+    while (!terminate)
+    {
+        const u64 nowMs = GetTimeMs();
+        if (timer_wheel_advance(&ctx->wheel, nowMs) > 0)
+        {
+            PublishSnapshot();
+            STMAppend(nowMs);
+        }
+
+        DWORD waitMs = INFINITE;
+        u64 expiryMs = 0;
+        if (timer_wheel_get_next_expiry(&ctx->wheel, &expiryMs))
+        {
+            const u64 currMs = GetTimeMs();
+            waitMs = expiryMs > currMs ? (DWORD)(expiryMs - currMs) : 0;
+        }
+
+        terminate = (WaitForSingleObject(ctx->terminateEvent, waitMs) == WAIT_OBJECT_0);
+    }
+
+    LOG_DEBUG("Sampling thread ended.");
+    allocator_destroy(&masterAllocator);
+}
+
+// ----------------------------------------------------------------------------
+
+void SMPInitialize(linear_allocator_t* const i_allocator)
+{
+    LOG_SCOPE(sampler);
+    // the records of each snapshot are laid out the way the registry reports them, the providers'
+    // accessors read them at the same offsets
+    const size recordsSize = PRVGetRecordsSize();
+    s_samplerContext.arena = create_arena(i_allocator, SIZE_KB(16) + recordsSize * (array_length(s_samplerContext.snapshots) + 1));
+    s_samplerContext.recordsSize = recordsSize;
+    s_samplerContext.workingRecords = arena_push_podarr_aligned(&s_samplerContext.arena, u8, recordsSize, 16);
+    mem_fill(s_samplerContext.workingRecords, 0, recordsSize);
+    s_samplerContext.sequence = 0;
+
+    for (u32 i = 0; i < array_length(s_samplerContext.snapshots); i++)
+    {
+        SMPSnapshot* const snapshot = &s_samplerContext.snapshots[i];
+        snapshot->timestamp = 0;
+        snapshot->sequence = 0;
+        snapshot->records = arena_push_podarr_aligned(&s_samplerContext.arena, u8, recordsSize, 16);
+        mem_fill(snapshot->records, 0, recordsSize);
+    }
+    s_samplerContext.backIndex = 0;
+    s_samplerContext.frontIndex = 1;
+    s_samplerContext.sharedIndex = 2;
+
+    // disabled providers get no task, their record is not even part of the snapshots
+    s_samplerContext.tasksCount = 0;
+    for (u32 i = 0; i < PRVGetProvidersCount(); i++)
+    {
+        if (!PRVIsEnabled(i))
+        {
+            continue;
+        }
+
+        const PRVProviderDesc* provider = PRVGetProvider(i);
+        SMPTask* const task = &s_samplerContext.tasks[s_samplerContext.tasksCount++];
+        task->provider = provider;
+        task->providerIndex = i;
+        task->recordOffset = PRVGetRecordOffset(i);
+        task->intervalMs = provider->intervalMs;
+        task->minIntervalMs = provider->minIntervalMs;
+        task->maxIntervalMs = provider->maxIntervalMs;
+        task->timer = k_invalidTimerHandle;
+        task->lastSampleMs = 0;
+        task->threshold = provider->threshold;
+        task->signal = 0.0f;
+        task->prevSignal = 0.0f;
+        task->mean = 0.0f;
+        task->variance = 0.0f;
+        task->samplesCount = 0;
+    }
+
+    // reads can take a while (driver IOCTLs, NVAPI), they get their own thread so they never
+    // stall the window's one
+    thread_desc_t threadDesc = {
+        .data = &s_samplerContext,
+        .func = SMPThreadFunc,
+        .priority = thread_priority_e::below_normal,
+        .name = "sampler"
+    };
+    s_samplerContext.terminateEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    s_samplerContext.thread = create_thread(&threadDesc);
+
+    s_samplerContext.ready = true;
+    LOG_DEBUG("Sampler initialized with %d tasks", s_samplerContext.tasksCount);
+}
+
+void SMPStart()
+{
+    thread_start(&s_samplerContext.thread);
+}
+
+void SMPStop()
+{
+    SetEvent(s_samplerContext.terminateEvent);
+}
+
+void SMPCleanUp()
+{
+    LOG_SCOPE(sampler);
+    FLORAL_ASSERT(s_samplerContext.ready);
+    if (!s_samplerContext.ready)
+    {
+        return;
+    }
+
+    LOG_DEBUG("Joining sampling thread...");
+    thread_join(&s_samplerContext.thread);
+    CloseHandle(s_samplerContext.terminateEvent);
+    s_samplerContext.ready = false;
+    LOG_DEBUG("Sampler destroyed.");
+}
+
+const SMPSnapshot* SMPAcquireSnapshot()
+{
+    // only swap when there is something new, otherwise we would get back an older snapshot
+    if (s_samplerContext.sharedIndex & k_snapshotDirtyBit)
+    {
+        const u32 prevShared = interlocked_exchange(&s_samplerContext.sharedIndex, s_samplerContext.frontIndex);
+        s_samplerContext.frontIndex = prevShared & k_snapshotIndexMask;
+    }
+    return &s_samplerContext.snapshots[s_samplerContext.frontIndex];
+}
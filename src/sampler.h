@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <floral/stdaliases.h>
+#include <floral/memory.h>
+#include <floral/thread.h>
+#include <floral/timer_wheel.h>
+
+#include "provider.h"
+
+// ----------------------------------------------------------------------------
+
+struct SMPTask
+{
+    const PRVProviderDesc* provider;
+    u32 providerIndex;
+    size recordOffset; // in the snapshots' records
+    u32 intervalMs;
+    u32 minIntervalMs;
+    u32 maxIntervalMs;
+    timer_handle_t timer;
+    u64 lastSampleMs;
+
+    // adaptive rate, the volatility estimate of the task's main signal
+    f32 signal;
+    f32 threshold; // in the signal's unit, changes above it are considered significant
+    f32 prevSignal;
+    f32 mean;
+    f32 variance;
+    u32 samplesCount;
+};
+
+struct SMPSnapshot
+{
+    u64 timestamp; // ticks, see time_get_ticks()
+    u32 sequence;
+    p8 records; // of all the enabled providers, see PRVGetRecordOffset()
+};
+
+struct SMPContext
+{
+    SMPTask tasks[k_maxProviders];
+    u32 tasksCount;
+    size recordsSize;
+
+    // owned by the sampling thread
+    timer_wheel_t wheel;
+    p8 workingRecords;
+    u32 sequence;
+
+    // triple buffer: the sampling thread fills 'back', the reader reads 'front' and the third one
+    // moves between them through 'sharedIndex', neither side ever waits for the other
+    SMPSnapshot snapshots[3];
+    u32 backIndex;
+    u32 frontIndex;
+    ATOMIC_TYPE(u32) sharedIndex;
+
+    HANDLE terminateEvent;
+    thread_t thread;
+
+    arena_t arena;
+    bool ready;
+};
+
+// ----------------------------------------------------------------------------
+
+// must come after PRVInitialize(), one task per enabled provider
+void SMPInitialize(linear_allocator_t* const i_allocator);
+void SMPStart();
+void SMPStop();
+void SMPCleanUp();
+// latest published snapshot, there must be a single reader thread (the window's one)
+const SMPSnapshot* SMPAcquireSnapshot();
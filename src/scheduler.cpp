@@ -0,0 +1,275 @@
+#include "scheduler.h"
+
+#include <floral/assert.h>
+#include <floral/log.h>
+#include <floral/misc.h>
+#include <floral/time.h>
+
+#include "scripting.h"
+#include "winapi.h"
+
+static SCHContext s_schedulerContext;
+
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_timerResolutionMs = USER_TIMER_MINIMUM;
+constexpr u32 k_maxScheduledTimers = 256;
+
+// ----------------------------------------------------------------------------
+
+struct ScriptingOnTimerCallContext : SCRClosure
+{
+    timer_handle_t handle;
+    u64 deadlineMs;
+
+    s32 PushArgs(lua_State* i_vm)
+    {
+        lua_pushnumber(i_vm, (f64)handle);
+        lua_pushnumber(i_vm, (f64)deadlineMs);
+        return 2;
+    }
+    void DeserializeReturnValues(lua_State*) {}
+};
+
+// ----------------------------------------------------------------------------
+
+static void RearmWindowTimer(const bool i_force)
+{
+    if (s_schedulerContext.hwnd == NULL)
+    {
+        return;
+    }
+
+    u64 expiryMs = 0;
+    if (!timer_wheel_get_next_expiry(&s_schedulerContext.wheel, &expiryMs))
+    {
+        if (s_schedulerContext.armedExpiryMs != 0)
+        {
+            pxKillTimer(s_schedulerContext.hwnd, s_schedulerContext.timerId);
+            s_schedulerContext.armedExpiryMs = 0;
+        }
+        return;
+    }
+
+    // an earlier expiry is the only thing that can make the armed timer wrong, a later one will
+    // just cost a spurious tick
+    if (!i_force && s_schedulerContext.armedExpiryMs != 0 && expiryMs >= s_schedulerContext.armedExpiryMs)
+    {
+        return;
+    }
+
+    const u64 nowMs = SCHGetTimeMs();
+    const u64 delayMs = expiryMs > nowMs ? expiryMs - nowMs : 0;
+    pxSetTimer(s_schedulerContext.hwnd, s_schedulerContext.timerId, (UINT)math_max(delayMs, (u64)USER_TIMER_MINIMUM), NULL);
+    s_schedulerContext.armedExpiryMs = expiryMs;
+}
+
+static ssize FindScriptTimer(const timer_handle_t i_handle)
+{
+    for (ssize i = 0; i < s_schedulerContext.scriptTimers.size; i++)
+    {
+        if (s_schedulerContext.scriptTimers[i].handle == i_handle)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void RemoveScriptTimerAt(const ssize i_idx)
+{
+    auto* const scriptTimers = &s_schedulerContext.scriptTimers;
+    (*scriptTimers)[i_idx] = (*scriptTimers)[scriptTimers->size - 1];
+    scriptTimers->size--;
+}
+
+static void OnScriptTimer(timer_wheel_t* const i_wheel, const timer_handle_t i_handle, const u64 i_deadlineMs, voidptr i_data)
+{
+    MARK_UNUSED(i_wheel);
+    const s32 funcRef = (s32)(aptr)i_data;
+    ScriptingOnTimerCallContext callCtx = {};
+    callCtx.handle = i_handle;
+    callCtx.deadlineMs = i_deadlineMs;
+    SCRCallRef(funcRef, &callCtx);
+}
+
+static s32 ScriptingAddTimer(lua_State* i_vm)
+{
+    LOG_SCOPE(lua2cpp);
+    const s32 nArgs = lua_gettop(i_vm);
+    FLORAL_ASSERT(nArgs == 2);
+    const s32 intervalMs = (s32)lua_tointeger(i_vm, 1);
+    if (intervalMs <= 0 || !lua_isfunction(i_vm, 2))
+    {
+        LOG_ERROR("add_timer expects a positive interval and a function");
+        lua_pushnil(i_vm);
+        return 1;
+    }
+
+    auto* const scriptTimers = &s_schedulerContext.scriptTimers;
+    if (scriptTimers->size >= scriptTimers->capacity)
+    {
+        LOG_ERROR("Too many script timers (max: %d)", (s32)scriptTimers->capacity);
+        lua_pushnil(i_vm);
+        return 1;
+    }
+
+    const s32 funcRef = SCRCreateRef(i_vm, 2);
+    const timer_handle_t handle = SCHAddTimer(intervalMs, intervalMs, &OnScriptTimer, (voidptr)(aptr)funcRef);
+    if (handle == k_invalidTimerHandle)
+    {
+        SCRReleaseRef(funcRef);
+        lua_pushnil(i_vm);
+        return 1;
+    }
+
+    SCHScriptTimer scriptTimer = {
+        .handle = handle,
+        .funcRef = funcRef
+    };
+    array_push_back(scriptTimers, scriptTimer);
+    LOG_INFO("Script timer added, interval: %d ms", intervalMs);
+
+    lua_pushnumber(i_vm, (f64)handle);
+    return 1;
+}
+
+static s32 ScriptingRemoveTimer(lua_State* i_vm)
+{
+    LOG_SCOPE(lua2cpp);
+    const s32 nArgs = lua_gettop(i_vm);
+    FLORAL_ASSERT(nArgs == 1);
+    const timer_handle_t handle = (timer_handle_t)lua_tonumber(i_vm, 1);
+
+    const ssize idx = FindScriptTimer(handle);
+    if (idx < 0)
+    {
+        lua_pushboolean(i_vm, 0);
+        return 1;
+    }
+
+    // the ref can be released even from the timer's own callback, lua still holds the function
+    // on its stack for the duration of the call
+    SCHRemoveTimer(handle);
+    SCRReleaseRef(s_schedulerContext.scriptTimers[idx].funcRef);
+    RemoveScriptTimerAt(idx);
+
+    lua_pushboolean(i_vm, 1);
+    return 1;
+}
+
+// same clock as the timers and the metrics history
+static s32 ScriptingGetTimeMs(lua_State* i_vm)
+{
+    lua_pushnumber(i_vm, (lua_Number)SCHGetTimeMs());
+    return 1;
+}
+
+// ----------------------------------------------------------------------------
+
+void SCHInitialize(linear_allocator_t* const i_allocator)
+{
+    LOG_SCOPE(scheduler);
+    s_schedulerContext.arena = create_arena(i_allocator, SIZE_KB(64));
+
+    const timer_wheel_desc_t wheelDesc = {
+        .maxTimers = k_maxScheduledTimers,
+        .resolutionMs = k_timerResolutionMs
+    };
+    const size wheelMemSize = calculate_memory_size_for_timer_wheel(wheelDesc);
+    initialize_timer_wheel(&s_schedulerContext.wheel, wheelDesc, SCHGetTimeMs(), arena_push(&s_schedulerContext.arena, wheelMemSize), wheelMemSize);
+
+    s_schedulerContext.hwnd = NULL;
+    s_schedulerContext.timerId = 0;
+    s_schedulerContext.armedExpiryMs = 0;
+    array_initialize(&s_schedulerContext.scriptTimers);
+
+    s_schedulerContext.ready = true;
+    LOG_DEBUG("Scheduler initialized, resolution: %d ms", k_timerResolutionMs);
+}
+
+void SCHCleanUp()
+{
+    LOG_SCOPE(scheduler);
+    FLORAL_ASSERT(s_schedulerContext.ready);
+    if (!s_schedulerContext.ready)
+    {
+        return;
+    }
+
+    SCHDetachWindow();
+    s_schedulerContext.ready = false;
+    LOG_DEBUG("Scheduler destroyed.");
+}
+
+void SCHAttachWindow(HWND i_hwnd, UINT_PTR i_timerId)
+{
+    s_schedulerContext.hwnd = i_hwnd;
+    s_schedulerContext.timerId = i_timerId;
+    s_schedulerContext.armedExpiryMs = 0;
+    RearmWindowTimer(true);
+}
+
+void SCHDetachWindow()
+{
+    if (s_schedulerContext.hwnd != NULL)
+    {
+        pxKillTimer(s_schedulerContext.hwnd, s_schedulerContext.timerId);
+    }
+    s_schedulerContext.hwnd = NULL;
+    s_schedulerContext.timerId = 0;
+    s_schedulerContext.armedExpiryMs = 0;
+}
+
+void SCHBindScriptingAPIs()
+{
+    SCRRegisterFunc(&ScriptingAddTimer, "add_timer", nullptr);
+    SCRRegisterFunc(&ScriptingRemoveTimer, "remove_timer", nullptr);
+    SCRRegisterFunc(&ScriptingGetTimeMs, "get_time_ms", nullptr);
+}
+
+void SCHResetScriptTimers()
+{
+    // the VM that owned the function refs is already gone, only the timers need to be cancelled
+    auto* const scriptTimers = &s_schedulerContext.scriptTimers;
+    for (ssize i = 0; i < scriptTimers->size; i++)
+    {
+        timer_wheel_cancel(&s_schedulerContext.wheel, (*scriptTimers)[i].handle);
+    }
+    array_empty(scriptTimers);
+}
+
+u64 SCHGetTimeMs()
+{
+    return (u64)time_ticks_to_ms(time_get_ticks());
+}
+
+void SCHTick()
+{
+    timer_wheel_advance(&s_schedulerContext.wheel, SCHGetTimeMs());
+    RearmWindowTimer(true);
+}
+
+timer_handle_t SCHAddTimer(const u64 i_delayMs, const u64 i_periodMs, timer_callback_t i_callback, voidptr i_data)
+{
+    const timer_handle_t handle = timer_wheel_schedule(&s_schedulerContext.wheel, i_delayMs, i_periodMs, i_callback, i_data);
+    RearmWindowTimer(false);
+    return handle;
+}
+
+bool SCHRemoveTimer(const timer_handle_t i_handle)
+{
+    return timer_wheel_cancel(&s_schedulerContext.wheel, i_handle);
+}
+
+bool SCHSetTimerPeriod(const timer_handle_t i_handle, const u64 i_periodMs)
+{
+    return timer_wheel_set_period(&s_schedulerContext.wheel, i_handle, i_periodMs);
+}
+
+bool SCHRescheduleTimer(const timer_handle_t i_handle, const u64 i_delayMs)
+{
+    const bool result = timer_wheel_reschedule(&s_schedulerContext.wheel, i_handle, i_delayMs);
+    RearmWindowTimer(false);
+    return result;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <floral/stdaliases.h>
+#include <floral/container.h>
+#include <floral/memory.h>
+#include <floral/timer_wheel.h>
+
+// ----------------------------------------------------------------------------
+
+struct SCHScriptTimer
+{
+    timer_handle_t handle;
+    s32 funcRef;
+};
+
+struct SCHContext
+{
+    timer_wheel_t wheel;
+
+    // the wheel is pumped from the window's timer, re-armed to the next expiry after each tick
+    HWND hwnd;
+    UINT_PTR timerId;
+    u64 armedExpiryMs;
+
+    // timers registered from scripts, they are all dropped when the VM is reloaded
+    inplace_array_t<SCHScriptTimer, 32> scriptTimers;
+
+    arena_t arena;
+    bool ready;
+};
+
+// ----------------------------------------------------------------------------
+
+void SCHInitialize(linear_allocator_t* const i_allocator);
+void SCHCleanUp();
+void SCHAttachWindow(HWND i_hwnd, UINT_PTR i_timerId);
+void SCHDetachWindow();
+void SCHBindScriptingAPIs();
+void SCHResetScriptTimers();
+
+u64 SCHGetTimeMs();
+// fire all the expired timers and re-arm the window's timer
+void SCHTick();
+
+// i_periodMs == 0 makes a one-shot timer, callbacks are always invoked on the window's thread
+timer_handle_t SCHAddTimer(const u64 i_delayMs, const u64 i_periodMs, timer_callback_t i_callback, voidptr i_data);
+bool SCHRemoveTimer(const timer_handle_t i_handle);
+bool SCHSetTimerPeriod(const timer_handle_t i_handle, const u64 i_periodMs);
+bool SCHRescheduleTimer(const timer_handle_t i_handle, const u64 i_delayMs);
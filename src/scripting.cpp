@@ -166,7 +166,9 @@ bool SCRReloadVMThread()
             LOG_ERROR("Error compiling script: %s", lua_tostring(vm, -1));
             compileSucceed = false;
             lua_pop(vm, 1);
+#if defined(FLORAL_PLATFORM_WINDOWS)
             MessageBeep(MB_ICONERROR);
+#endif
             break;
         }
 
@@ -182,7 +184,9 @@ bool SCRReloadVMThread()
         LOG_DEBUG("VM thread unloaded");
 
         SCRLoadVMThread(tstr_literal(LITERAL("data")));
+#if defined(FLORAL_PLATFORM_WINDOWS)
         MessageBeep(MB_OK);
+#endif
         return true;
     }
     else
@@ -252,3 +256,14 @@ void SCRRegisterFunc(lua_CFunction i_func, const_cstr i_exportedFunc, voidptr i_
     lua_pushcclosure(vm, i_func, 2);
     lua_setglobal(vm, i_exportedFunc);
 }
+
+s32 SCRCreateRef(lua_State* i_vm, const s32 i_stackIndex)
+{
+    lua_pushvalue(i_vm, i_stackIndex);
+    return luaL_ref(i_vm, LUA_REGISTRYINDEX);
+}
+
+void SCRReleaseRef(const s32 i_ref)
+{
+    luaL_unref(s_context.vm, LUA_REGISTRYINDEX, i_ref);
+}
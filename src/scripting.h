@@ -74,6 +74,11 @@ void SCRAddEntryPoint(const tstr& i_filePath);
 void SCRRegisterFunc(lua_CFunction i_func, const_cstr i_exportedFunc, voidptr i_lightUserData);
 template <typename CallContext>
 void SCRCallFunc(const_cstr i_funcName, CallContext* const i_callCtx);
+// references are bound to the current VM, they are all gone after a reload
+s32 SCRCreateRef(lua_State* i_vm, const s32 i_stackIndex);
+void SCRReleaseRef(const s32 i_ref);
+template <typename CallContext>
+void SCRCallRef(const s32 i_ref, CallContext* const i_callCtx);
 
 // ----------------------------------------------------------------------------
 
@@ -94,3 +99,21 @@ void SCRCallFunc(const_cstr i_funcName, CallContext* const i_callCtx)
     }
     i_callCtx->DeserializeReturnValues(context->vm);
 }
+
+template <typename CallContext>
+void SCRCallRef(const s32 i_ref, CallContext* const i_callCtx)
+{
+    LOG_SCOPE(scripting);
+    SCRContext* context = SCRGetContext();
+
+    SCRStackGuard guard(context->vm);
+    lua_rawgeti(context->vm, LUA_REGISTRYINDEX, i_ref);
+    s32 numArgs = i_callCtx->PushArgs(context->vm);
+    if (lua_pcall(context->vm, numArgs, i_callCtx->returnValuesCount, 0) != 0)
+    {
+        LOG_ERROR("Error calling function ref '%d': %s", i_ref, lua_tostring(context->vm, -1));
+        FLORAL_DEBUG_BREAK();
+        return;
+    }
+    i_callCtx->DeserializeReturnValues(context->vm);
+}
@@ -0,0 +1,263 @@
+#include "stream.h"
+
+#include <floral/assert.h>
+#include <floral/log.h>
+#include <floral/misc.h>
+#include <floral/string_utils.h>
+
+#include "archive.h"
+
+static STMContext s_streamContext;
+
+// ----------------------------------------------------------------------------
+
+static tstr GetStreamFileName(arena_t* const i_arena, const u64 i_startMs)
+{
+    return tstr_printf(i_arena, LITERAL("%llu.mws"), (unsigned long long)i_startMs);
+}
+
+static void DeleteStreamFile(const u64 i_startMs)
+{
+    scratch_region_t scratch = scratch_begin(&s_streamContext.arena);
+    if (!file_delete(&s_streamContext.group, GetStreamFileName(scratch.arena, i_startMs)))
+    {
+        LOG_WARNING("Cannot delete the stream %llu.mws", (unsigned long long)i_startMs);
+    }
+    scratch_end(&scratch);
+}
+
+// the streams of the previous sessions, the newest ones within the retention are kept
+static void ScanStreams(const u64 i_nowMs)
+{
+    LOG_SCOPE(stream);
+    scratch_region_t scratch = scratch_begin(&s_streamContext.arena);
+    u64* startsMs = arena_push_podarr(scratch.arena, u64, s_streamContext.group.fileCount);
+    u32 count = 0;
+    dll_t<file_t>::node_t* it = nullptr;
+    dll_for_each(&s_streamContext.group.fileList, it)
+    {
+        if (ARCParseFileNameMs(it->data.path, &startsMs[count]))
+        {
+            count++;
+        }
+    }
+
+    for (u32 i = 1; i < count; i++)
+    {
+        const u64 startMs = startsMs[i];
+        u32 j = i;
+        for (; j > 0 && startsMs[j - 1] > startMs; j--)
+        {
+            startsMs[j] = startsMs[j - 1];
+        }
+        startsMs[j] = startMs;
+    }
+
+    s_streamContext.oldestFile = 0;
+    s_streamContext.filesCount = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+        if (count - i > k_maxStreamFiles || startsMs[i] + k_maxStreamAgeMs < i_nowMs)
+        {
+            DeleteStreamFile(startsMs[i]);
+        }
+        else
+        {
+            s_streamContext.filesStartMs[s_streamContext.filesCount++] = startsMs[i];
+        }
+    }
+    scratch_end(&scratch);
+}
+
+// makes room for one more file, the oldest ones go first, the current file is closed
+static void PruneStreams(const u64 i_nowMs)
+{
+    while (s_streamContext.filesCount > 0)
+    {
+        const u64 startMs = s_streamContext.filesStartMs[s_streamContext.oldestFile % k_maxStreamFiles];
+        if (s_streamContext.filesCount < k_maxStreamFiles && startMs + k_maxStreamAgeMs >= i_nowMs)
+        {
+            return;
+        }
+        DeleteStreamFile(startMs);
+        s_streamContext.oldestFile++;
+        s_streamContext.filesCount--;
+    }
+}
+
+// false when the file did not take the whole stream, it is then closed and the streaming stops
+static bool WriteStream()
+{
+    if (s_streamContext.stream.length == 0)
+    {
+        return true;
+    }
+
+    // written as a whole, a collector tailing the file never sees a block without its header
+    const bool written = file_write(s_streamContext.file, s_streamContext.stream.addr, s_streamContext.stream.length);
+    s_streamContext.fileSize += s_streamContext.stream.length;
+    s_streamContext.stream.length = 0;
+    if (!written)
+    {
+        LOG_SCOPE(stream);
+        LOG_ERROR("Cannot write to the stream file, the snapshots will not be streamed anymore");
+        file_close(&s_streamContext.file);
+        s_streamContext.fileOpened = false;
+        interlocked_exchange(&s_streamContext.enabled, 0);
+    }
+    return written;
+}
+
+static void OpenStream()
+{
+    LOG_SCOPE(stream);
+    const u64 startMs = ARCGetUnixTimeMs();
+    PruneStreams(startMs);
+    scratch_region_t scratch = scratch_begin(&s_streamContext.arena);
+    s_streamContext.file = file_wopen(&s_streamContext.group, GetStreamFileName(scratch.arena, startMs));
+    scratch_end(&scratch);
+    if (s_streamContext.file.hasErrors)
+    {
+        LOG_ERROR("Cannot create the stream file, the snapshots will not be streamed");
+        interlocked_exchange(&s_streamContext.enabled, 0);
+        return;
+    }
+
+    s_streamContext.filesStartMs[(s_streamContext.oldestFile + s_streamContext.filesCount) % k_maxStreamFiles] = startMs;
+    s_streamContext.filesCount++;
+    s_streamContext.fileSize = 0;
+    s_streamContext.fileOpened = true;
+    delta_encoder_write_header(&s_streamContext.encoder, &s_streamContext.stream);
+    if (!WriteStream())
+    {
+        return;
+    }
+    LOG_DEBUG("Streaming %d series into %llu.mws", s_streamContext.fieldsCount, (unsigned long long)startMs);
+}
+
+static void CloseStream()
+{
+    if (delta_encoder_flush(&s_streamContext.encoder, &s_streamContext.stream) && !WriteStream())
+    {
+        return;
+    }
+    file_close(&s_streamContext.file);
+    s_streamContext.fileOpened = false;
+}
+
+// ----------------------------------------------------------------------------
+
+void STMInitialize(linear_allocator_t* const i_allocator, file_system_t* const i_fileSystem)
+{
+    s_streamContext.fieldsCount = HSTGetSeriesCount();
+    if (s_streamContext.fieldsCount == 0)
+    {
+        s_streamContext.ready = false;
+        return;
+    }
+    for (u32 i = 0; i < s_streamContext.fieldsCount; i++)
+    {
+        s_streamContext.fields[i] = {
+            .name = HSTGetSeries(i)->name,
+            .type = delta_field_type_e::float64
+        };
+    }
+
+    const delta_stream_desc_t desc = {
+        .fields = s_streamContext.fields,
+        .fieldsCount = s_streamContext.fieldsCount,
+        .blockSize = k_streamBlockSize,
+        .compressed = true
+    };
+    s_streamContext.group = create_file_group(i_fileSystem, tstr_literal(LITERAL("streams")));
+    file_system_find_all_files(i_fileSystem, tstr_literal(LITERAL("streams")), tstr_literal(LITERAL("mws")), &s_streamContext.group);
+
+    // the encoder's block, its compressed copy and the hash table, then the stream and the scratch
+    s_streamContext.arena = create_arena(i_allocator, SIZE_KB(128) + s_streamContext.group.fileCount * sizeof(u64));
+    s_streamContext.encoder = create_delta_encoder(&s_streamContext.arena, desc);
+    const size streamCapacity = math_max(delta_encoder_get_header_size(&s_streamContext.encoder),
+                                         delta_encoder_get_max_block_size(&s_streamContext.encoder));
+    s_streamContext.stream = arena_create_buffer(&s_streamContext.arena, streamCapacity);
+    s_streamContext.values = arena_push_podarr(&s_streamContext.arena, u64, s_streamContext.fieldsCount);
+    mem_fill(s_streamContext.values, 0, s_streamContext.fieldsCount * sizeof(u64));
+
+    ScanStreams(ARCGetUnixTimeMs());
+    s_streamContext.fileOpened = false;
+    s_streamContext.ready = true;
+}
+
+void STMCleanUp()
+{
+    if (s_streamContext.ready && s_streamContext.fileOpened)
+    {
+        CloseStream();
+    }
+    s_streamContext.ready = false;
+}
+
+void STMSetEnabled(const bool i_enabled)
+{
+    interlocked_exchange(&s_streamContext.enabled, i_enabled ? 1 : 0);
+}
+
+bool STMIsEnabled()
+{
+    return s_streamContext.enabled != 0;
+}
+
+void STMAppend(const u64 i_nowMs)
+{
+    if (!s_streamContext.ready)
+    {
+        return;
+    }
+
+    const bool enabled = s_streamContext.enabled != 0;
+    if (enabled && !s_streamContext.fileOpened)
+    {
+        OpenStream();
+    }
+    else if (!enabled && s_streamContext.fileOpened)
+    {
+        CloseStream();
+    }
+    if (!s_streamContext.fileOpened)
+    {
+        return;
+    }
+
+    // a series without a new sample keeps its last value, which costs nothing in the stream
+    for (u32 i = 0; i < s_streamContext.fieldsCount; i++)
+    {
+        const HSTSeries* series = HSTGetSeries(i);
+        const HSTWindow window = HSTGetWindowLast(series, 1);
+        u64 timestampMs = 0;
+        f64 value = 0.0;
+        if (window.length > 0 && HSTReadSample(series, window, 0, &timestampMs, &value))
+        {
+            s_streamContext.values[i] = delta_stream_pack_f64(value);
+        }
+    }
+
+    if (s_streamContext.encoder.snapshotsCount == 0)
+    {
+        s_streamContext.blockOpenedMs = i_nowMs;
+    }
+    bool blockWritten = false;
+    if (delta_encoder_push(&s_streamContext.encoder, ARCGetUnixTimeMs(), s_streamContext.values, &s_streamContext.stream))
+    {
+        blockWritten = WriteStream();
+    }
+    else if (i_nowMs - s_streamContext.blockOpenedMs >= k_maxStreamBlockAgeMs)
+    {
+        delta_encoder_flush(&s_streamContext.encoder, &s_streamContext.stream);
+        blockWritten = WriteStream();
+    }
+
+    // at a block boundary, the new file starts with a block of its own
+    if (blockWritten && s_streamContext.fileSize >= k_maxStreamFileSize)
+    {
+        CloseStream();
+        OpenStream();
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+#include <floral/atomic.h>
+#include <floral/delta_stream.h>
+#include <floral/file_system.h>
+#include <floral/memory.h>
+
+#include "history.h"
+
+// Snapshots of the latest sample of every history series, appended to 'streams/<unix ms>.mws' in the
+// binary delta format of floral/delta_stream.h, for collectors which would rather not parse the
+// text of the metrics endpoint. A snapshot is taken after each round of samples, it only carries the
+// series which moved. Timestamps are wall clock ms since the Unix epoch, as in the archive.
+// A new file is started once one gets too large, only the newest files of the last days are kept.
+
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_streamBlockSize = 16384;
+constexpr u64 k_maxStreamBlockAgeMs = 10 * 1000; // how late a collector tailing the file can be
+constexpr size k_maxStreamFileSize = SIZE_MB(16);
+constexpr u32 k_maxStreamFiles = 16; // on disk, the current one included
+constexpr u64 k_maxStreamAgeMs = 7ull * 24 * 60 * 60 * 1000;
+
+struct STMContext
+{
+    delta_field_t fields[k_maxHistorySeries];
+    u32 fieldsCount;
+
+    // owned by the sampling thread
+    delta_encoder_t encoder;
+    buffer_t stream; // what has to be written to the file, never more than a block
+    u64* values;
+    u64 blockOpenedMs; // monotonic
+    file_group_t group;
+    file_handle_t file;
+    size fileSize;
+    bool fileOpened;
+    u64 filesStartMs[k_maxStreamFiles]; // the files on disk, oldest first, from oldestFile modulo the capacity
+    u32 oldestFile;
+    u32 filesCount;
+
+    ATOMIC_TYPE(u32) enabled; // set from the UI, the sampling thread opens and closes the file
+    arena_t arena;
+    bool ready;
+};
+
+// ----------------------------------------------------------------------------
+
+// must come after ARCInitialize()
+void STMInitialize(linear_allocator_t* const i_allocator, file_system_t* const i_fileSystem);
+// the sampler must be stopped
+void STMCleanUp();
+void STMSetEnabled(const bool i_enabled);
+bool STMIsEnabled();
+
+// sampling thread only, after a round of samples
+void STMAppend(const u64 i_nowMs);
@@ -9,25 +9,35 @@
 
 #include <resource.h>
 
+#include "draw_commands.h"
 #include "renderer_gdiplus.h"
+#include "renderer_software.h"
 #include "winapi.h"
 #include "defines.h"
-#include "monitor/cpu.h"
-#include "monitor/gpu.h"
-#include "monitor/network.h"
 #include "scripting.h"
+#include "scheduler.h"
+#include "sampler.h"
+#include "provider.h"
+#include "history.h"
+#include "archive.h"
+#include "rollup.h"
+#include "aggregator.h"
 #include "files_tracker.h"
 #include "utils.h"
 
 static OSTaskBarState s_taskBarState;
 static RNDState s_rndState;
+static SWRState s_swrState;
 static UIWidgetSurfaceState s_surfaceState;
 static UIWidgetState s_widgetState;
+static timer_handle_t s_renderTimer = k_invalidTimerHandle;
 
 // ----------------------------------------------------------------------------
 
 constexpr s32 k_refDpi = 96;
 constexpr u32 k_defaultUpdateInterval = 1000;
+constexpr s32 k_headlessTaskbarHeight = 48;
+constexpr u32 k_maxHeadlessFrames = 10000;
 
 // ----------------------------------------------------------------------------
 
@@ -88,8 +98,10 @@ static s32 ScriptingSetUpdateInterval(lua_State* i_vm)
 
     const s32 nArgs = lua_gettop(i_vm);
     FLORAL_ASSERT(nArgs == 1);
+    MARK_UNUSED(state);
     const s32 interval = (s32)lua_tointeger(i_vm, 1);
-    pxSetTimer(state->hwnd, ID_TASKBAR_TIMER, interval, NULL);
+    SCHSetTimerPeriod(s_renderTimer, interval);
+    SCHRescheduleTimer(s_renderTimer, interval);
     LOG_INFO("Update interval set to %d ms", interval);
 
     return 0;
@@ -107,119 +119,131 @@ static s32 ScriptingSetWidgetSize(lua_State* i_vm)
     return 0;
 }
 
-static s32 ScriptingGetProcessorUtilization(lua_State* i_vm)
+// ----------------------------------------------------------------------------
+
+// the software renderer is portable, the embedded fonts are handed to it from the resources
+static bool InitializeSoftwareRenderer(const HINSTANCE i_appInstance, linear_allocator_t* const i_allocator)
 {
-    scratch_region_t scratch = thread_scratch_begin();
-    f32 avgLoad = 0.0f;
-    cpu::ReadProcessorUtilization(&avgLoad, nullptr, nullptr, 0);
-    lua_pushnumber(i_vm, avgLoad);
-    thread_scratch_end(&scratch);
-    return 1;
+    const u32 fontIds[] = { IDF_CHARFONT, IDF_ICONFONT };
+    const_tcstr loadErrors[] = {
+        LITERAL("Failed to load embedded font data (IDF_CHARFONT)."),
+        LITERAL("Failed to load embedded font data (IDF_ICONFONT).")
+    };
+    const_buffer_t fonts[2];
+    for (u32 i = 0; i < 2; i++)
+    {
+        voidptr fontData = nullptr;
+        size fontDataSize = 0;
+        if (!UTLLoadEmbeddedData(i_appInstance, fontIds[i], &fontData, &fontDataSize))
+        {
+            UTLShowMessage(NULL, UTLSeverity::Error, loadErrors[i]);
+            return false;
+        }
+        fonts[i] = { fontData, fontDataSize };
+    }
+
+    if (!SWRInitialize(&s_swrState, fonts, 2, i_allocator))
+    {
+        UTLShowMessage(NULL, UTLSeverity::Error, LITERAL("Failed to read the embedded font data."));
+        return false;
+    }
+    return true;
 }
 
-static s32 ScriptingGetProcessorTemperature(lua_State* i_vm)
+static void RefreshRenderer(const vec2i& i_resolution, const s32 i_dpi)
 {
-    scratch_region_t scratch = thread_scratch_begin();
-    f32 packageTemp = 0.0f;
-    cpu::ReadProcessorTemperature(&packageTemp, nullptr, nullptr, 0);
-    lua_pushnumber(i_vm, packageTemp);
-    thread_scratch_end(&scratch);
-    return 1;
+    const f32 dpiScale = (f32)i_dpi / k_refDpi;
+    if (s_widgetState.renderer == UIRenderer::Software)
+    {
+        // the DIB section is bottom-up
+        u32* const topRow = (u32*)s_surfaceState.bufferData + (size)(i_resolution.y - 1) * i_resolution.x;
+        SWRRefresh(&s_swrState, topRow, -i_resolution.x, i_resolution, dpiScale);
+    }
+    else
+    {
+        RNDRefresh(&s_rndState, s_surfaceState.hdc, i_resolution, dpiScale);
+    }
+    DRWInvalidate();
 }
 
-static s32 ScriptingGetRAMUtilization(lua_State* i_vm)
+static bool BeginRender()
 {
-    lua_createtable(i_vm, 0, 2);
-
-    s32 physicalLoad = 0;
-    s32 virtualLoad = 0;
-    cpu::ReadMemoryUtilization(&physicalLoad, &virtualLoad);
-
-    lua_pushstring(i_vm, "physicalLoad");
-    lua_pushnumber(i_vm, physicalLoad);
-    lua_settable(i_vm, -3);
-
-    lua_pushstring(i_vm, "virtualLoad");
-    lua_pushnumber(i_vm, virtualLoad);
-    lua_settable(i_vm, -3);
-
-    return 1;
+    return s_widgetState.renderer == UIRenderer::Software ? SWRBeginRender(&s_swrState) : RNDBeginRender(&s_rndState);
 }
 
-static s32 ScriptingGetGPUUtilization(lua_State* i_vm)
+static void EndRender()
 {
-    u32 geLoad = 0;
-    u32 fbLoad = 0;
-    u32 vidLoad = 0;
-    u32 busLoad = 0;
-    gpu::ReadUtilization(&geLoad, &fbLoad, &vidLoad, &busLoad);
-
-    lua_createtable(i_vm, 0, 4);
-    lua_pushstring(i_vm, "graphicsEngineLoad");
-    lua_pushnumber(i_vm, geLoad);
-    lua_settable(i_vm, -3);
-
-    lua_pushstring(i_vm, "framebufferLoad");
-    lua_pushinteger(i_vm, fbLoad);
-    lua_settable(i_vm, -3);
-
-    lua_pushstring(i_vm, "videoLoad");
-    lua_pushinteger(i_vm, vidLoad);
-    lua_settable(i_vm, -3);
-
-    lua_pushstring(i_vm, "busLoad");
-    lua_pushinteger(i_vm, busLoad);
-    lua_settable(i_vm, -3);
-
-    return 1;
+    if (s_widgetState.renderer == UIRenderer::Software)
+    {
+        SWREndRender(&s_swrState);
+    }
+    else
+    {
+        RNDEndRender(&s_rndState);
+    }
 }
 
-static s32 ScriptingGetGPUTemperature(lua_State* i_vm)
+static void ExecuteCommands(cmdbuff_t* const io_commands)
 {
-    f32 temp = 0.0f;
-    gpu::ReadTemperature(&temp);
-    lua_pushnumber(i_vm, temp);
-    return 1;
+    if (s_widgetState.renderer == UIRenderer::Software)
+    {
+        SWRExecuteCommands(&s_swrState, io_commands);
+    }
+    else
+    {
+        RNDExecuteCommands(&s_rndState, io_commands);
+    }
 }
 
-static s32 ScriptingGetVRAMUtilization(lua_State* i_vm)
+// recompiles the scripts and binds all the APIs into the new VM, false when the scripts do not compile
+static bool ReloadScripts()
 {
-    u32 usage = 0;
-    gpu::ReadVRAMUtilization(&usage);
-    lua_pushinteger(i_vm, usage);
-    return 1;
+    if (!SCRReloadVMThread())
+    {
+        return false;
+    }
+
+    SCHResetScriptTimers();
+    AGGResetScriptAggregators();
+
+    SCRRegisterFunc(&ScriptingSetUpdateInterval, "set_update_interval", &s_widgetState);
+    SCRRegisterFunc(&ScriptingSetWidgetSize, "set_widget_size", &s_widgetState);
+
+    SCHBindScriptingAPIs();
+    PRVBindScriptingAPIs();
+    HSTBindScriptingAPIs();
+    RLPBindScriptingAPIs();
+    AGGBindScriptingAPIs();
+    ARCBindScriptingAPIs();
+
+    if (s_widgetState.renderer == UIRenderer::Software)
+    {
+        SWRDestroyAllResources(&s_swrState);
+        SWRBindScriptingAPIs(&s_swrState);
+    }
+    else
+    {
+        RNDDestroyAllResources(&s_rndState);
+        RNDBindScriptingAPIs(&s_rndState);
+    }
+    DRWBindScriptingAPIs();
+    // the font handles of the new VM may record the same commands as the old ones
+    DRWInvalidate();
+
+    ScriptingOnInitializeCallContext callCtx = {};
+    SCRCallFunc("on_initialize", &callCtx);
+    return true;
 }
 
-static s32 ScriptingGetNetworkStats(lua_State* i_vm)
+static void OnRenderTimer(timer_wheel_t* const i_wheel, const timer_handle_t i_handle, const u64 i_deadlineMs, voidptr i_data)
 {
-    f32 ingress = 0.0f;
-    f32 egress = 0.0f;
-    u64 sentBytes = 0;
-    u64 receivedBytes = 0;
-    network::ReadStats(&ingress, &egress, &sentBytes, &receivedBytes);
-
-    lua_createtable(i_vm, 0, 4);
-    lua_pushstring(i_vm, "sent");
-    lua_pushnumber(i_vm, (f64)sentBytes);
-    lua_settable(i_vm, -3);
-
-    lua_pushstring(i_vm, "received");
-    lua_pushnumber(i_vm, (f64)receivedBytes);
-    lua_settable(i_vm, -3);
-
-    lua_pushstring(i_vm, "egress");
-    lua_pushnumber(i_vm, egress);
-    lua_settable(i_vm, -3);
-
-    lua_pushstring(i_vm, "ingress");
-    lua_pushnumber(i_vm, ingress);
-    lua_settable(i_vm, -3);
-
-    return 1;
+    MARK_UNUSED(i_wheel);
+    MARK_UNUSED(i_handle);
+    MARK_UNUSED(i_deadlineMs);
+    const UIWidgetState* const state = (UIWidgetState*)i_data;
+    pxInvalidateRect(state->hwnd, NULL, TRUE);
 }
 
-// ----------------------------------------------------------------------------
-
 static void UpdateSurface(HWND i_hwnd)
 {
     // Check the DPI and where we are right now
@@ -281,6 +305,7 @@ static void UpdateSurface(HWND i_hwnd)
     {
         pxMoveWindow(i_hwnd, widgetOrigin.x, widgetOrigin.y, widgetSize.x, widgetSize.y, TRUE);
         s_widgetState.origin = widgetOrigin;
+        DRWInvalidate();
     }
 
     // 2nd phase: orientation changes
@@ -318,8 +343,7 @@ static void UpdateSurface(HWND i_hwnd)
         LOG_DEBUG("Created new bitmap surface: 0x%x (%d x %d)", (aptr)s_surfaceState.buffer, widgetSize.x, widgetSize.y);
 
         // refresh the renderer
-        const f32 dpiScale = (f32)dpi / k_refDpi;
-        RNDRefresh(&s_rndState, s_surfaceState.hdc, widgetSize, dpiScale);
+        RefreshRenderer(widgetSize, dpi);
 
         s_surfaceState.dpi = dpi;
         s_surfaceState.size = widgetSize;
@@ -380,41 +404,31 @@ static INT_PTR TaskbarDlgProc(HWND i_hwnd, UINT i_msg, WPARAM i_wParam, LPARAM i
         if (FTHasChanges())
         {
             FTLock();
-            if (SCRReloadVMThread())
-            {
-                SCRRegisterFunc(&ScriptingSetUpdateInterval, "set_update_interval", &s_widgetState);
-                SCRRegisterFunc(&ScriptingSetWidgetSize, "set_widget_size", &s_widgetState);
-
-                SCRRegisterFunc(&ScriptingGetNetworkStats, "get_network_stats", nullptr);
-
-                SCRRegisterFunc(&ScriptingGetProcessorUtilization, "get_processor_utilization", nullptr);
-                SCRRegisterFunc(&ScriptingGetProcessorTemperature, "get_processor_temperature", nullptr);
-                SCRRegisterFunc(&ScriptingGetRAMUtilization, "get_ram_utilization", nullptr);
-
-                SCRRegisterFunc(&ScriptingGetGPUUtilization, "get_gpu_utilization", nullptr);
-                SCRRegisterFunc(&ScriptingGetGPUTemperature, "get_gpu_temperature", nullptr);
-                SCRRegisterFunc(&ScriptingGetVRAMUtilization, "get_vram_utilization", nullptr);
-
-                RNDDestroyAllResources(&s_rndState);
-                RNDBindScriptingAPIs(&s_rndState);
-                ScriptingOnInitializeCallContext callCtx = {};
-                SCRCallFunc("on_initialize", &callCtx);
-            }
+            ReloadScripts();
             FTUnlock();
         }
 
-        cpu::UpdateOSPerfCounters();
+        // the scripts only record their draw calls, the frame is drawn and presented once they are
+        // done, and not at all when they recorded the same commands as the frame on screen
+        DRWBeginFrame();
+        ScriptingOnUpdateCallContext callCtx = {
+            .w = MulDiv(s_surfaceState.size.x, k_refDpi, s_surfaceState.dpi),
+            .h = MulDiv(s_surfaceState.size.y, k_refDpi, s_surfaceState.dpi)
+        };
+        SCRCallFunc("on_update", &callCtx);
 
-        if (RNDBeginRender(&s_rndState))
+        if (DRWEndFrame())
         {
-            ScriptingOnUpdateCallContext callCtx = {
-                .w = MulDiv(s_surfaceState.size.x, k_refDpi, s_surfaceState.dpi),
-                .h = MulDiv(s_surfaceState.size.y, k_refDpi, s_surfaceState.dpi)
-            };
-            SCRCallFunc("on_update", &callCtx);
-
-            RNDEndRender(&s_rndState);
-            Present(i_hwnd, s_taskBarState.hTaskBarWnd);
+            if (BeginRender())
+            {
+                ExecuteCommands(DRWGetFrameCommands());
+                EndRender();
+                Present(i_hwnd, s_taskBarState.hTaskBarWnd);
+            }
+            else
+            {
+                DRWInvalidate();
+            }
         }
 
         // since we are not actually use the WM_PAINT message, we will let the default DlgProc
@@ -434,7 +448,7 @@ static INT_PTR TaskbarDlgProc(HWND i_hwnd, UINT i_msg, WPARAM i_wParam, LPARAM i
         {
         case ID_TASKBAR_TIMER:
         {
-            pxInvalidateRect(i_hwnd, NULL, TRUE);
+            SCHTick();
             dlgResult = TRUE;
             break;
         }
@@ -456,6 +470,12 @@ static INT_PTR TaskbarDlgProc(HWND i_hwnd, UINT i_msg, WPARAM i_wParam, LPARAM i
 
 // ----------------------------------------------------------------------------
 
+void UIWidgetSetRenderer(const UIRenderer i_renderer)
+{
+    FLORAL_ASSERT(!s_widgetState.ready);
+    s_widgetState.renderer = i_renderer;
+}
+
 HWND UIWidgetInitialize(const HINSTANCE i_appInstance, linear_allocator_t* const i_allocator)
 {
     LOG_SCOPE(widget);
@@ -483,8 +503,17 @@ HWND UIWidgetInitialize(const HINSTANCE i_appInstance, linear_allocator_t* const
     s_surfaceState.hdc = pxCreateCompatibleDC(pxGetDC(s_widgetState.hwnd));
     s_surfaceState.buffer = NULL;
     s_surfaceState.bufferData = nullptr;
-    RNDInitialize(&s_rndState, i_appInstance, s_surfaceState.hdc, i_allocator);
-    pxSetTimer(s_widgetState.hwnd, ID_TASKBAR_TIMER, k_defaultUpdateInterval, NULL);
+    if (s_widgetState.renderer == UIRenderer::Software)
+    {
+        InitializeSoftwareRenderer(i_appInstance, i_allocator);
+    }
+    else
+    {
+        RNDInitialize(&s_rndState, i_appInstance, s_surfaceState.hdc, i_allocator);
+    }
+    DRWInitialize(i_allocator);
+    SCHAttachWindow(s_widgetState.hwnd, ID_TASKBAR_TIMER);
+    s_renderTimer = SCHAddTimer(k_defaultUpdateInterval, k_defaultUpdateInterval, &OnRenderTimer, &s_widgetState);
 
     s_widgetState.ready = true;
     LOG_DEBUG("Widget initialized");
@@ -492,6 +521,82 @@ HWND UIWidgetInitialize(const HINSTANCE i_appInstance, linear_allocator_t* const
     return s_widgetState.hwnd;
 }
 
+bool UIWidgetRunHeadless(const HINSTANCE i_appInstance, linear_allocator_t* const i_allocator, const u32 i_framesCount)
+{
+    LOG_SCOPE(widget);
+    FLORAL_ASSERT(!s_widgetState.ready);
+    s_widgetState.renderer = UIRenderer::Software;
+    s_widgetState.landscapeLength = 100;
+    s_widgetState.portraitLength = 100;
+    if (!InitializeSoftwareRenderer(i_appInstance, i_allocator))
+    {
+        return false;
+    }
+    DRWInitialize(i_allocator);
+
+    FTLock();
+    const bool scriptsLoaded = ReloadScripts();
+    FTUnlock();
+    if (!scriptsLoaded)
+    {
+        LOG_ERROR("Cannot compile the scripts, nothing to render");
+        DRWCleanUp();
+        return false;
+    }
+
+    // a landscape taskbar at 96 dpi, sized by the scripts' on_initialize()
+    const vec2i resolution(s_widgetState.landscapeLength, k_headlessTaskbarHeight);
+    const u32 framesCount = math_clamp(1u, i_framesCount, k_maxHeadlessFrames);
+    arena_t arena = create_arena(i_allocator, (size)resolution.x * resolution.y * sizeof(u32) + framesCount * sizeof(f64) + SIZE_KB(4));
+    u32* const pixels = arena_push_podarr(&arena, u32, (size)resolution.x * resolution.y);
+    f64* const frameTimes = arena_push_podarr(&arena, f64, framesCount);
+    SWRRefresh(&s_swrState, pixels, resolution.x, resolution, 1.0f);
+
+    // every frame is drawn, even the ones which did not change, to measure the replay
+    f64 recordMs = 0.0;
+    for (u32 i = 0; i < framesCount; i++)
+    {
+        const f64 startMs = time_get_absolute_highres_ms();
+        DRWBeginFrame();
+        ScriptingOnUpdateCallContext callCtx = {
+            .w = resolution.x,
+            .h = resolution.y
+        };
+        SCRCallFunc("on_update", &callCtx);
+        DRWEndFrame();
+        recordMs += time_get_absolute_highres_ms() - startMs;
+
+        if (SWRBeginRender(&s_swrState))
+        {
+            SWRExecuteCommands(&s_swrState, DRWGetFrameCommands());
+            SWREndRender(&s_swrState);
+        }
+        frameTimes[i] = time_get_absolute_highres_ms() - startMs;
+    }
+
+    // insertion sort, the frames are few
+    f64 totalMs = 0.0;
+    for (u32 i = 0; i < framesCount; i++)
+    {
+        const f64 frameTime = frameTimes[i];
+        u32 j = i;
+        for (; j > 0 && frameTimes[j - 1] > frameTime; j--)
+        {
+            frameTimes[j] = frameTimes[j - 1];
+        }
+        frameTimes[j] = frameTime;
+        totalMs += frameTime;
+    }
+    LOG_INFO("Rendered %u frames of %d x %d headless", framesCount, resolution.x, resolution.y);
+    LOG_INFO("  - frame time (ms): min %.4f, median %.4f, p99 %.4f, max %.4f, average %.4f", frameTimes[0],
+             frameTimes[framesCount / 2], frameTimes[(framesCount - 1) * 99 / 100], frameTimes[framesCount - 1], totalMs / framesCount);
+    LOG_INFO("  - of which on_update() records (ms): average %.4f", recordMs / framesCount);
+
+    DRWCleanUp();
+    SWRCleanUp(&s_swrState);
+    return true;
+}
+
 // ----------------------------------------------------------------------------
 
 void UIWidgetCleanUp()
@@ -501,9 +606,19 @@ void UIWidgetCleanUp()
         return;
     }
 
-    pxKillTimer(s_widgetState.hwnd, ID_TASKBAR_TIMER);
+    SCHRemoveTimer(s_renderTimer);
+    s_renderTimer = k_invalidTimerHandle;
+    SCHDetachWindow();
 
-    RNDCleanUp(&s_rndState);
+    DRWCleanUp();
+    if (s_widgetState.renderer == UIRenderer::Software)
+    {
+        SWRCleanUp(&s_swrState);
+    }
+    else
+    {
+        RNDCleanUp(&s_rndState);
+    }
 
     pxDeleteDC(s_surfaceState.hdc);
     pxDeleteObject(s_surfaceState.buffer);
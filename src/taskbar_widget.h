@@ -16,6 +16,12 @@ enum class Orientation : u8
     Portrait
 };
 
+enum class UIRenderer : u8
+{
+    GdiPlus = 0,
+    Software
+};
+
 struct OSTaskBarState
 {
     HWND hTaskBarWnd;
@@ -45,13 +51,18 @@ struct UIWidgetState
     // canvas
     s32 dpi;
     vec2i taskbarSize;
+    UIRenderer renderer;
 
     bool ready;
 };
 
 // ----------------------------------------------------------------------------
 
+// before UIWidgetInitialize()
+void UIWidgetSetRenderer(const UIRenderer i_renderer);
 HWND UIWidgetInitialize(const HINSTANCE i_appInstance, linear_allocator_t* const i_allocator);
+// renders the scripts into an offscreen buffer with the software renderer and logs the frame times
+bool UIWidgetRunHeadless(const HINSTANCE i_appInstance, linear_allocator_t* const i_allocator, const u32 i_framesCount);
 void UIWidgetReload();
 void UIWidgetCleanUp();
 bool UIWidgetToggle(const bool i_visible);
@@ -98,6 +98,14 @@ void UITrayIconHandleMessage(const u32 i_message, const HWND i_hwnd)
                          CFGGetBool(CFGKey::StartOnBoot) ? (MF_BYCOMMAND | MF_CHECKED)
                                                          : (MF_BYCOMMAND | MF_UNCHECKED),
                          ID_START_ON_BOOT, LITERAL("Start On Boot"));
+            pxInsertMenu(hContextMenu, IDM_TRAY_METRICS_ENDPOINT,
+                         CFGGetBool(CFGKey::MetricsEndpoint) ? (MF_BYCOMMAND | MF_CHECKED)
+                                                             : (MF_BYCOMMAND | MF_UNCHECKED),
+                         ID_METRICS_ENDPOINT, LITERAL("Metrics Endpoint"));
+            pxInsertMenu(hContextMenu, IDM_TRAY_SNAPSHOT_STREAM,
+                         CFGGetBool(CFGKey::SnapshotStream) ? (MF_BYCOMMAND | MF_CHECKED)
+                                                            : (MF_BYCOMMAND | MF_UNCHECKED),
+                         ID_SNAPSHOT_STREAM, LITERAL("Snapshot Stream"));
             pxInsertMenu(hContextMenu, IDM_TRAY_RESTORE, MF_BYCOMMAND, ID_RESTORE_FROM_TRAY, LITERAL("Restore"));
             pxInsertMenu(hContextMenu, IDM_TRAY_SWITCH_MODE, MF_BYCOMMAND, ID_SWITCH_MODE, LITERAL("Switch Mode"));
             pxInsertMenu(hContextMenu, IDM_TRAY_EXIT, MF_BYCOMMAND, ID_EXIT, LITERAL("Exit"));
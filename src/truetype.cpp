@@ -0,0 +1,662 @@
+#include "truetype.h"
+
+#include <floral/assert.h>
+#include <floral/misc.h>
+
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_maxGlyphPoints = 8192;
+constexpr u32 k_maxCompositeDepth = 8;
+constexpr u32 k_maxCurveSegments = 16;
+constexpr f32 k_flatteningTolerance = 0.2f; // pixels
+
+// simple glyph point flags
+constexpr u8 k_flagOnCurve = 0x01;
+constexpr u8 k_flagShortX = 0x02;
+constexpr u8 k_flagShortY = 0x04;
+constexpr u8 k_flagRepeat = 0x08;
+constexpr u8 k_flagSameOrPositiveX = 0x10;
+constexpr u8 k_flagSameOrPositiveY = 0x20;
+
+// composite glyph component flags
+constexpr u16 k_componentArgsAreWords = 0x0001;
+constexpr u16 k_componentArgsAreOffsets = 0x0002;
+constexpr u16 k_componentHasScale = 0x0008;
+constexpr u16 k_componentMoreComponents = 0x0020;
+constexpr u16 k_componentHasXYScale = 0x0040;
+constexpr u16 k_componentHasTwoByTwo = 0x0080;
+
+// font units to pixels: (a * x + c * y + e, b * x + d * y + f)
+struct TTFTransform
+{
+    f32 a, b, c, d, e, f;
+};
+
+// bounds checked big-endian reads, a read past the end fails the whole read
+struct TTFReader
+{
+    const u8* cursor;
+    const u8* end;
+    bool failed;
+};
+
+static u16 ReadBigEndianU16(const u8* i_data)
+{
+    return (u16)((i_data[0] << 8) | i_data[1]);
+}
+
+static u32 ReadBigEndianU32(const u8* i_data)
+{
+    return ((u32)i_data[0] << 24) | ((u32)i_data[1] << 16) | ((u32)i_data[2] << 8) | (u32)i_data[3];
+}
+
+static const u8* ReaderTake(TTFReader* io_reader, const size i_bytes)
+{
+    if (io_reader->failed || (size)(io_reader->end - io_reader->cursor) < i_bytes)
+    {
+        io_reader->failed = true;
+        return nullptr;
+    }
+    const u8* data = io_reader->cursor;
+    io_reader->cursor += i_bytes;
+    return data;
+}
+
+static u8 ReaderU8(TTFReader* io_reader)
+{
+    const u8* data = ReaderTake(io_reader, 1);
+    return data ? data[0] : 0;
+}
+
+static u16 ReaderU16(TTFReader* io_reader)
+{
+    const u8* data = ReaderTake(io_reader, 2);
+    return data ? ReadBigEndianU16(data) : 0;
+}
+
+static f32 ReaderF2Dot14(TTFReader* io_reader)
+{
+    return (f32)(s16)ReaderU16(io_reader) / 16384.0f;
+}
+
+static bool IsRangeInFont(const TTFFont& i_font, const u32 i_offset, const u32 i_length)
+{
+    return i_offset <= i_font.dataSize && i_length <= i_font.dataSize - i_offset;
+}
+
+static bool FindTable(const TTFFont& i_font, const_cstr i_tag, u32* o_offset, u32* o_length)
+{
+    const u32 tablesCount = ReadBigEndianU16(i_font.data + 4);
+    if (!IsRangeInFont(i_font, 12, tablesCount * 16))
+    {
+        return false;
+    }
+
+    const u32 tag = ((u32)i_tag[0] << 24) | ((u32)i_tag[1] << 16) | ((u32)i_tag[2] << 8) | (u32)i_tag[3];
+    for (u32 i = 0; i < tablesCount; i++)
+    {
+        const u8* record = i_font.data + 12 + i * 16;
+        if (ReadBigEndianU32(record) == tag)
+        {
+            *o_offset = ReadBigEndianU32(record + 8);
+            *o_length = ReadBigEndianU32(record + 12);
+            return IsRangeInFont(i_font, *o_offset, *o_length);
+        }
+    }
+    return false;
+}
+
+// the Unicode subtable of the cmap, the full repertoire (format 12) is preferred over the BMP one
+static bool FindCharacterMap(TTFFont* io_font, const u32 i_cmapOffset, const u32 i_cmapLength)
+{
+    if (i_cmapLength < 4)
+    {
+        return false;
+    }
+    const u8* cmap = io_font->data + i_cmapOffset;
+    const u32 subtablesCount = ReadBigEndianU16(cmap + 2);
+    if (4 + subtablesCount * 8 > i_cmapLength)
+    {
+        return false;
+    }
+
+    io_font->cmapFormat = 0;
+    for (u32 i = 0; i < subtablesCount; i++)
+    {
+        const u8* record = cmap + 4 + i * 8;
+        const u16 platform = ReadBigEndianU16(record);
+        const u16 encoding = ReadBigEndianU16(record + 2);
+        const u32 offset = ReadBigEndianU32(record + 4);
+        const bool isUnicode = platform == 0 || (platform == 3 && (encoding == 1 || encoding == 10));
+        if (!isUnicode || offset + 16 > i_cmapLength)
+        {
+            continue;
+        }
+
+        const u16 format = ReadBigEndianU16(cmap + offset);
+        const u32 length = format == 12 ? ReadBigEndianU32(cmap + offset + 4) : ReadBigEndianU16(cmap + offset + 2);
+        if ((format != 4 && format != 12) || offset + length > i_cmapLength || format <= io_font->cmapFormat)
+        {
+            continue;
+        }
+        if (format == 4 && length < 16 + (u32)ReadBigEndianU16(cmap + offset + 6) * 4)
+        {
+            continue;
+        }
+        if (format == 12 && length < 16 + ReadBigEndianU32(cmap + offset + 12) * 12)
+        {
+            continue;
+        }
+        io_font->cmapOffset = i_cmapOffset + offset;
+        io_font->cmapFormat = format;
+    }
+    return io_font->cmapFormat != 0;
+}
+
+static void ReadFamilyName(TTFFont* io_font, const u32 i_nameOffset, const u32 i_nameLength)
+{
+    io_font->familyName[0] = 0;
+    if (i_nameLength < 6)
+    {
+        return;
+    }
+    const u8* table = io_font->data + i_nameOffset;
+    const u32 recordsCount = ReadBigEndianU16(table + 2);
+    const u32 stringsOffset = ReadBigEndianU16(table + 4);
+    if (6 + recordsCount * 12 > i_nameLength)
+    {
+        return;
+    }
+
+    // the typographic family (16) groups the styles of variable fonts, the legacy family (1) is the fallback
+    u32 bestScore = 0;
+    for (u32 i = 0; i < recordsCount; i++)
+    {
+        const u8* record = table + 6 + i * 12;
+        const u16 platform = ReadBigEndianU16(record);
+        const u16 language = ReadBigEndianU16(record + 4);
+        const u16 nameId = ReadBigEndianU16(record + 6);
+        const u32 length = ReadBigEndianU16(record + 8);
+        const u32 offset = stringsOffset + ReadBigEndianU16(record + 10);
+        if (platform != 3 || (nameId != 1 && nameId != 16) || offset + length > i_nameLength)
+        {
+            continue;
+        }
+
+        const u32 score = (nameId == 16 ? 2 : 1) + (language == 0x409 ? 4 : 0);
+        if (score <= bestScore)
+        {
+            continue;
+        }
+        bestScore = score;
+
+        // UTF-16BE, anything but ASCII is replaced
+        const u32 charactersCount = math_min(length / 2, k_maxFontFamilyLength - 1);
+        for (u32 c = 0; c < charactersCount; c++)
+        {
+            const u16 character = ReadBigEndianU16(table + offset + c * 2);
+            io_font->familyName[c] = character < 0x80 ? (c8)character : '?';
+        }
+        io_font->familyName[charactersCount] = 0;
+    }
+}
+
+static bool GetGlyphRange(const TTFFont& i_font, const u32 i_glyph, u32* o_offset, u32* o_length)
+{
+    if (i_glyph >= i_font.glyphsCount)
+    {
+        return false;
+    }
+
+    u32 start = 0;
+    u32 end = 0;
+    if (i_font.longLoca)
+    {
+        start = ReadBigEndianU32(i_font.data + i_font.locaOffset + i_glyph * 4);
+        end = ReadBigEndianU32(i_font.data + i_font.locaOffset + i_glyph * 4 + 4);
+    }
+    else
+    {
+        start = ReadBigEndianU16(i_font.data + i_font.locaOffset + i_glyph * 2) * 2u;
+        end = ReadBigEndianU16(i_font.data + i_font.locaOffset + i_glyph * 2 + 2) * 2u;
+    }
+    if (start > end || end > i_font.glyfLength)
+    {
+        return false;
+    }
+    *o_offset = i_font.glyfOffset + start;
+    *o_length = end - start;
+    return true;
+}
+
+static vec2f TransformPoint(const TTFTransform& i_transform, const f32 i_x, const f32 i_y)
+{
+    return vec2f(i_transform.a * i_x + i_transform.c * i_y + i_transform.e, i_transform.b * i_x + i_transform.d * i_y + i_transform.f);
+}
+
+static void AppendQuadratic(RSTPath* const io_path, const vec2f& i_from, const vec2f& i_control, const vec2f& i_to)
+{
+    // the distance between the curve and its chord is a quarter of |from - 2 * control + to|
+    const f32 dx = i_from.x - 2.0f * i_control.x + i_to.x;
+    const f32 dy = i_from.y - 2.0f * i_control.y + i_to.y;
+    const f32 deviation = mathf_sqrt(dx * dx + dy * dy) * 0.25f;
+    const u32 segmentsCount = math_clamp(1u, (u32)mathf_ceil(mathf_sqrt(deviation / k_flatteningTolerance)), k_maxCurveSegments);
+    for (u32 i = 1; i <= segmentsCount; i++)
+    {
+        const f32 t = (f32)i / (f32)segmentsCount;
+        const f32 u = 1.0f - t;
+        RSTAddPoint(io_path, vec2f(u * u * i_from.x + 2.0f * u * t * i_control.x + t * t * i_to.x,
+                                   u * u * i_from.y + 2.0f * u * t * i_control.y + t * t * i_to.y));
+    }
+}
+
+static vec2f MidPoint(const vec2f& i_a, const vec2f& i_b)
+{
+    return vec2f((i_a.x + i_b.x) * 0.5f, (i_a.y + i_b.y) * 0.5f);
+}
+
+// points between two off-curve points are implied on the curve, in the middle of them
+static void AppendContour(RSTPath* const io_path, const vec2f* i_points, const u8* i_flags, const u32 i_count)
+{
+    if (i_count < 2)
+    {
+        return;
+    }
+
+    vec2f start;
+    u32 first = 0;
+    u32 last = i_count;
+    if (i_flags[0] & k_flagOnCurve)
+    {
+        start = i_points[0];
+        first = 1;
+    }
+    else if (i_flags[i_count - 1] & k_flagOnCurve)
+    {
+        start = i_points[i_count - 1];
+        last = i_count - 1;
+    }
+    else
+    {
+        start = MidPoint(i_points[i_count - 1], i_points[0]);
+    }
+
+    RSTAddPoint(io_path, start);
+    vec2f previous = start;
+    vec2f control;
+    bool hasControl = false;
+    for (u32 i = first; i < last; i++)
+    {
+        const vec2f& point = i_points[i];
+        if (i_flags[i] & k_flagOnCurve)
+        {
+            if (hasControl)
+            {
+                AppendQuadratic(io_path, previous, control, point);
+            }
+            else
+            {
+                RSTAddPoint(io_path, point);
+            }
+            previous = point;
+            hasControl = false;
+        }
+        else
+        {
+            if (hasControl)
+            {
+                const vec2f middle = MidPoint(control, point);
+                AppendQuadratic(io_path, previous, control, middle);
+                previous = middle;
+            }
+            control = point;
+            hasControl = true;
+        }
+    }
+    if (hasControl)
+    {
+        AppendQuadratic(io_path, previous, control, start);
+    }
+    RSTCloseContour(io_path);
+}
+
+static bool AppendSimpleGlyph(TTFReader* io_reader, const s32 i_contoursCount, const TTFTransform& i_transform, RSTPath* const io_path,
+                              arena_t* const i_scratchArena)
+{
+    const u8* contourEnds = ReaderTake(io_reader, (size)i_contoursCount * 2);
+    const u16 instructionsLength = ReaderU16(io_reader);
+    ReaderTake(io_reader, instructionsLength);
+    if (io_reader->failed)
+    {
+        return false;
+    }
+    const u32 pointsCount = (u32)ReadBigEndianU16(contourEnds + (i_contoursCount - 1) * 2) + 1;
+    if (pointsCount > k_maxGlyphPoints)
+    {
+        return false;
+    }
+
+    scratch_region_t scratch = scratch_begin(i_scratchArena);
+    u8* flags = arena_push_podarr(scratch.arena, u8, pointsCount);
+    vec2f* points = arena_push_podarr(scratch.arena, vec2f, pointsCount);
+
+    for (u32 i = 0; i < pointsCount;)
+    {
+        const u8 flag = ReaderU8(io_reader);
+        u32 repeatCount = (flag & k_flagRepeat) ? ReaderU8(io_reader) + 1u : 1u;
+        for (; repeatCount > 0 && i < pointsCount; repeatCount--)
+        {
+            flags[i++] = flag;
+        }
+    }
+
+    s32 x = 0;
+    for (u32 i = 0; i < pointsCount; i++)
+    {
+        if (flags[i] & k_flagShortX)
+        {
+            const s32 delta = ReaderU8(io_reader);
+            x += (flags[i] & k_flagSameOrPositiveX) ? delta : -delta;
+        }
+        else if ((flags[i] & k_flagSameOrPositiveX) == 0)
+        {
+            x += (s16)ReaderU16(io_reader);
+        }
+        points[i].x = (f32)x;
+    }
+
+    s32 y = 0;
+    for (u32 i = 0; i < pointsCount; i++)
+    {
+        if (flags[i] & k_flagShortY)
+        {
+            const s32 delta = ReaderU8(io_reader);
+            y += (flags[i] & k_flagSameOrPositiveY) ? delta : -delta;
+        }
+        else if ((flags[i] & k_flagSameOrPositiveY) == 0)
+        {
+            y += (s16)ReaderU16(io_reader);
+        }
+        points[i] = TransformPoint(i_transform, points[i].x, (f32)y);
+    }
+
+    bool succeeded = !io_reader->failed;
+    u32 start = 0;
+    for (s32 c = 0; succeeded && c < i_contoursCount; c++)
+    {
+        const u32 end = (u32)ReadBigEndianU16(contourEnds + c * 2) + 1;
+        if (end <= start || end > pointsCount)
+        {
+            succeeded = false;
+            break;
+        }
+        AppendContour(io_path, points + start, flags + start, end - start);
+        start = end;
+    }
+
+    scratch_end(&scratch);
+    return succeeded;
+}
+
+static bool AppendGlyph(const TTFFont& i_font, const u32 i_glyph, const TTFTransform& i_transform, const u32 i_depth, RSTPath* const io_path,
+                        arena_t* const i_scratchArena)
+{
+    u32 offset = 0;
+    u32 length = 0;
+    if (!GetGlyphRange(i_font, i_glyph, &offset, &length))
+    {
+        return false;
+    }
+    if (length == 0)
+    {
+        return true; // no outline, a space
+    }
+
+    TTFReader reader = {
+        .cursor = i_font.data + offset,
+        .end = i_font.data + offset + length,
+        .failed = false
+    };
+    const s32 contoursCount = (s16)ReaderU16(&reader);
+    ReaderTake(&reader, 8); // bounding box
+    if (contoursCount >= 0)
+    {
+        return contoursCount == 0 || AppendSimpleGlyph(&reader, contoursCount, i_transform, io_path, i_scratchArena);
+    }
+    if (i_depth >= k_maxCompositeDepth)
+    {
+        return false;
+    }
+
+    u16 flags = k_componentMoreComponents;
+    while ((flags & k_componentMoreComponents) && !reader.failed)
+    {
+        flags = ReaderU16(&reader);
+        const u32 component = ReaderU16(&reader);
+        f32 dx = 0.0f;
+        f32 dy = 0.0f;
+        if (flags & k_componentArgsAreWords)
+        {
+            dx = (f32)(s16)ReaderU16(&reader);
+            dy = (f32)(s16)ReaderU16(&reader);
+        }
+        else
+        {
+            dx = (f32)(s8)ReaderU8(&reader);
+            dy = (f32)(s8)ReaderU8(&reader);
+        }
+        if ((flags & k_componentArgsAreOffsets) == 0)
+        {
+            // anchored by matching points, not supported: the component is left where it is
+            dx = 0.0f;
+            dy = 0.0f;
+        }
+
+        f32 a = 1.0f, b = 0.0f, c = 0.0f, d = 1.0f;
+        if (flags & k_componentHasScale)
+        {
+            a = d = ReaderF2Dot14(&reader);
+        }
+        else if (flags & k_componentHasXYScale)
+        {
+            a = ReaderF2Dot14(&reader);
+            d = ReaderF2Dot14(&reader);
+        }
+        else if (flags & k_componentHasTwoByTwo)
+        {
+            a = ReaderF2Dot14(&reader);
+            b = ReaderF2Dot14(&reader);
+            c = ReaderF2Dot14(&reader);
+            d = ReaderF2Dot14(&reader);
+        }
+        if (reader.failed)
+        {
+            return false;
+        }
+
+        const TTFTransform& t = i_transform;
+        const TTFTransform componentTransform = {
+            .a = t.a * a + t.c * b,
+            .b = t.b * a + t.d * b,
+            .c = t.a * c + t.c * d,
+            .d = t.b * c + t.d * d,
+            .e = t.a * dx + t.c * dy + t.e,
+            .f = t.b * dx + t.d * dy + t.f
+        };
+        if (!AppendGlyph(i_font, component, componentTransform, i_depth + 1, io_path, i_scratchArena))
+        {
+            return false;
+        }
+    }
+    return !reader.failed;
+}
+
+// ----------------------------------------------------------------------------
+
+bool TTFLoadFont(const_voidptr i_data, const size i_size, TTFFont* o_font)
+{
+    *o_font = {};
+    o_font->data = (const u8*)i_data;
+    o_font->dataSize = i_size;
+    if (i_size < 12 || i_size > 0xffffffff || ReadBigEndianU32(o_font->data) != 0x00010000)
+    {
+        return false; // not a TrueType outlines font
+    }
+
+    u32 headOffset = 0, headLength = 0;
+    u32 maxpOffset = 0, maxpLength = 0;
+    u32 hheaOffset = 0, hheaLength = 0;
+    u32 hmtxLength = 0, locaLength = 0, cmapOffset = 0, cmapLength = 0;
+    if (!FindTable(*o_font, "head", &headOffset, &headLength) || headLength < 54 ||
+        !FindTable(*o_font, "maxp", &maxpOffset, &maxpLength) || maxpLength < 6 ||
+        !FindTable(*o_font, "hhea", &hheaOffset, &hheaLength) || hheaLength < 36 ||
+        !FindTable(*o_font, "hmtx", &o_font->hmtxOffset, &hmtxLength) ||
+        !FindTable(*o_font, "loca", &o_font->locaOffset, &locaLength) ||
+        !FindTable(*o_font, "glyf", &o_font->glyfOffset, &o_font->glyfLength) ||
+        !FindTable(*o_font, "cmap", &cmapOffset, &cmapLength) ||
+        !FindCharacterMap(o_font, cmapOffset, cmapLength))
+    {
+        return false;
+    }
+
+    const u8* data = o_font->data;
+    o_font->unitsPerEm = ReadBigEndianU16(data + headOffset + 18);
+    o_font->longLoca = ReadBigEndianU16(data + headOffset + 50) != 0;
+    o_font->glyphsCount = ReadBigEndianU16(data + maxpOffset + 4);
+    o_font->hMetricsCount = ReadBigEndianU16(data + hheaOffset + 34);
+    if (o_font->unitsPerEm == 0 || o_font->glyphsCount == 0 || o_font->hMetricsCount == 0 ||
+        o_font->hMetricsCount > o_font->glyphsCount ||
+        (u32)o_font->hMetricsCount * 4 + (u32)(o_font->glyphsCount - o_font->hMetricsCount) * 2 > hmtxLength ||
+        ((u32)o_font->glyphsCount + 1) * (o_font->longLoca ? 4 : 2) > locaLength)
+    {
+        return false;
+    }
+
+    // the Windows metrics are what GDI lays text out with, hhea is the fallback
+    u32 os2Offset = 0, os2Length = 0;
+    if (FindTable(*o_font, "OS/2", &os2Offset, &os2Length) && os2Length >= 78)
+    {
+        o_font->ascent = ReadBigEndianU16(data + os2Offset + 74);
+        o_font->descent = ReadBigEndianU16(data + os2Offset + 76);
+    }
+    else
+    {
+        o_font->ascent = (s16)ReadBigEndianU16(data + hheaOffset + 4);
+        o_font->descent = -(s16)ReadBigEndianU16(data + hheaOffset + 6);
+    }
+
+    u32 nameOffset = 0, nameLength = 0;
+    if (FindTable(*o_font, "name", &nameOffset, &nameLength))
+    {
+        ReadFamilyName(o_font, nameOffset, nameLength);
+    }
+    return true;
+}
+
+u32 TTFGetGlyphIndex(const TTFFont& i_font, const u32 i_codepoint)
+{
+    const u8* subtable = i_font.data + i_font.cmapOffset;
+    if (i_font.cmapFormat == 12)
+    {
+        u32 low = 0;
+        u32 high = ReadBigEndianU32(subtable + 12);
+        while (low < high)
+        {
+            const u32 middle = (low + high) / 2;
+            const u8* group = subtable + 16 + middle * 12;
+            if (i_codepoint < ReadBigEndianU32(group))
+            {
+                high = middle;
+            }
+            else if (i_codepoint > ReadBigEndianU32(group + 4))
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                const u32 glyph = ReadBigEndianU32(group + 8) + i_codepoint - ReadBigEndianU32(group);
+                return glyph < i_font.glyphsCount ? glyph : 0;
+            }
+        }
+        return 0;
+    }
+
+    if (i_codepoint > 0xffff)
+    {
+        return 0;
+    }
+    // format 4: segments sorted by their end code
+    const u32 segmentsCount = ReadBigEndianU16(subtable + 6) / 2;
+    const u8* endCodes = subtable + 14;
+    const u8* startCodes = endCodes + segmentsCount * 2 + 2;
+    const u8* deltas = startCodes + segmentsCount * 2;
+    const u8* rangeOffsets = deltas + segmentsCount * 2;
+    u32 low = 0;
+    u32 high = segmentsCount;
+    while (low < high)
+    {
+        const u32 middle = (low + high) / 2;
+        if (ReadBigEndianU16(endCodes + middle * 2) < i_codepoint)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    if (low == segmentsCount || ReadBigEndianU16(startCodes + low * 2) > i_codepoint)
+    {
+        return 0;
+    }
+
+    const u16 delta = ReadBigEndianU16(deltas + low * 2);
+    const u16 rangeOffset = ReadBigEndianU16(rangeOffsets + low * 2);
+    u32 glyph = 0;
+    if (rangeOffset == 0)
+    {
+        glyph = (i_codepoint + delta) & 0xffff;
+    }
+    else
+    {
+        const u8* glyphIds = rangeOffsets + low * 2 + rangeOffset + (i_codepoint - ReadBigEndianU16(startCodes + low * 2)) * 2;
+        if (glyphIds + 2 > i_font.data + i_font.dataSize)
+        {
+            return 0;
+        }
+        glyph = ReadBigEndianU16(glyphIds);
+        glyph = glyph != 0 ? (glyph + delta) & 0xffff : 0;
+    }
+    return glyph < i_font.glyphsCount ? glyph : 0;
+}
+
+void TTFGetGlyphHorizontalMetrics(const TTFFont& i_font, const u32 i_glyph, s32* o_advance, s32* o_leftSideBearing)
+{
+    const u8* hmtx = i_font.data + i_font.hmtxOffset;
+    const u32 glyph = math_min(i_glyph, (u32)i_font.glyphsCount - 1);
+    if (glyph < i_font.hMetricsCount)
+    {
+        *o_advance = ReadBigEndianU16(hmtx + glyph * 4);
+        *o_leftSideBearing = (s16)ReadBigEndianU16(hmtx + glyph * 4 + 2);
+    }
+    else
+    {
+        // monospaced tail: the advance of the last metric, then bearings only
+        *o_advance = ReadBigEndianU16(hmtx + (i_font.hMetricsCount - 1) * 4);
+        *o_leftSideBearing = (s16)ReadBigEndianU16(hmtx + i_font.hMetricsCount * 4 + (glyph - i_font.hMetricsCount) * 2);
+    }
+}
+
+bool TTFAppendGlyphOutline(const TTFFont& i_font, const u32 i_glyph, const f32 i_scale, const vec2f& i_origin, RSTPath* const io_path,
+                           arena_t* const i_scratchArena)
+{
+    const TTFTransform transform = {
+        .a = i_scale,
+        .b = 0.0f,
+        .c = 0.0f,
+        .d = -i_scale,
+        .e = i_origin.x,
+        .f = i_origin.y
+    };
+    return AppendGlyph(i_font, i_glyph, transform, 0, io_path, i_scratchArena);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+#include <floral/memory.h>
+#include <floral/vector_math.h>
+
+#include "raster.h"
+
+// The parts of TrueType (glyf outlines) the software renderer needs: character to glyph mapping,
+// horizontal metrics and outlines, flattened into a raster path. Variable fonts are read at their
+// default instance, hinting instructions are ignored. The font data is read in place, it must outlive
+// the font, and every offset read from it is checked against its size.
+
+// ----------------------------------------------------------------------------
+
+constexpr u32 k_maxFontFamilyLength = 64;
+
+struct TTFFont
+{
+    const u8* data;
+    size dataSize;
+
+    u32 cmapOffset; // the Unicode subtable
+    u32 locaOffset;
+    u32 glyfOffset;
+    u32 glyfLength;
+    u32 hmtxOffset;
+    u16 cmapFormat; // 4 or 12
+    u16 glyphsCount;
+    u16 hMetricsCount;
+    u16 unitsPerEm;
+    bool longLoca;
+
+    // font units, both positive
+    s32 ascent;
+    s32 descent;
+
+    c8 familyName[k_maxFontFamilyLength];
+};
+
+// ----------------------------------------------------------------------------
+
+bool TTFLoadFont(const_voidptr i_data, const size i_size, TTFFont* o_font);
+// 0 (the missing glyph) when the font does not have it
+u32 TTFGetGlyphIndex(const TTFFont& i_font, const u32 i_codepoint);
+void TTFGetGlyphHorizontalMetrics(const TTFFont& i_font, const u32 i_glyph, s32* o_advance, s32* o_leftSideBearing);
+// appends the outline in pixels, y down: (i_origin.x + x * i_scale, i_origin.y - y * i_scale), false when
+// the glyph data is malformed
+bool TTFAppendGlyphOutline(const TTFFont& i_font, const u32 i_glyph, const f32 i_scale, const vec2f& i_origin, RSTPath* const io_path,
+                           arena_t* const i_scratchArena);